@@ -0,0 +1,80 @@
+/* ANSI escape sequence output of curses windows, for terminals curses does not
+ * drive itself.
+ *
+ * A window's contents are captured into a frame of plain cells. The encoder
+ * then writes only the cells that changed since a previous frame, moving the
+ * cursor only where changed cells are not contiguous and changing the style
+ * only where it differs from the last cell written.
+ */
+
+#ifndef ANSI_H
+#define ANSI_H
+
+#include <curses.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Longest UTF-8 sequence stored per cell, including combining characters
+#define ANSI_CELL_TEXT_SIZE 16
+
+struct AnsiCell
+{
+    char text[ANSI_CELL_TEXT_SIZE]; // UTF-8, empty for the second column of a wide character
+    short color;                    // Foreground color, -1 for the terminal default
+    unsigned char attrs;            // ANSI_BOLD | ANSI_DIM
+};
+
+enum AnsiAttr
+{
+    ANSI_BOLD = 1 << 0,
+    ANSI_DIM = 1 << 1,
+};
+
+struct AnsiFrame
+{
+    int rows;
+    int cols;
+    struct AnsiCell *cells; // Row major
+};
+
+/* Growable output buffer
+ */
+struct AnsiBuffer
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+
+/* Allocate a frame of blank cells. This function allocates memory which must
+ * be freed with `free_ansi_frame`. Returns false upon memory allocation error
+ */
+bool generate_ansi_frame(struct AnsiFrame *frame, int rows, int cols);
+
+void free_ansi_frame(struct AnsiFrame *frame);
+
+/* Copy the contents of a window into a frame of the same size. Color pairs are
+ * resolved to their foreground color
+ */
+void ansi_frame_capture(struct AnsiFrame *frame, WINDOW *win);
+
+/* Append the escape sequences turning the terminal showing `prev` into `next`.
+ * If `prev` is NULL or has a different size, the screen is cleared and `next`
+ * is drawn in full. Returns false upon memory allocation error
+ */
+bool ansi_encode_frame(struct AnsiBuffer *buffer, const struct AnsiFrame *prev, const struct AnsiFrame *next);
+
+/* Append a frame as lines of text for files and pipes rather than a screen,
+ * with trailing blanks trimmed. If `styled`, SGR sequences set the colors and
+ * attributes of cells and are reset at the end of each line. Returns false upon
+ * memory allocation error
+ */
+bool ansi_encode_lines(struct AnsiBuffer *buffer, const struct AnsiFrame *frame, bool styled);
+
+/* Append raw bytes. Returns false upon memory allocation error
+ */
+bool ansi_buffer_append(struct AnsiBuffer *buffer, const char *data, size_t length);
+
+void free_ansi_buffer(struct AnsiBuffer *buffer);
+
+#endif // ANSI_H
@@ -0,0 +1,42 @@
+/* Bump allocator for data that lives and dies together, such as the strings
+ * and indices parsed from the embedded data files.
+ *
+ * An arena is one malloc'd block handed out front to back. The first
+ * allocation starts at the beginning of the block, so a table allocated first
+ * can later be released with a single call to `free` along with everything
+ * else in the arena.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct Arena
+{
+    unsigned char *base; // Start of the block
+    size_t size;         // Capacity of the block in bytes
+    size_t used;         // Bytes handed out so far, including padding
+};
+
+/* Allocate an arena with room for `size` bytes. Returns false upon memory
+ * allocation error
+ */
+bool arena_init(struct Arena *arena, size_t size);
+
+/* Release the arena and everything allocated from it
+ */
+void arena_free(struct Arena *arena);
+
+/* Allocate `size` bytes aligned to `align`, a power of two such as the
+ * `_Alignof` of the type stored. Returns NULL if the arena is full
+ */
+void *arena_alloc(struct Arena *arena, size_t size, size_t align);
+
+/* Copy `length` bytes of `str` into the arena as a null terminated string.
+ * Returns NULL if the arena is full
+ */
+char *arena_strndup(struct Arena *arena, const char *str, size_t length);
+
+#endif // ARENA_H
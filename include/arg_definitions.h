@@ -4,7 +4,7 @@
  *
  * The macro arguments are:
  * - The source-code variable name of the argument definition.
- * - The short and long versions of the argument.
+ * - The short and long versions of the argument. The short version may be NULL.
  * - The type of the argument (where applicable).
  * - The help text for the argument.
  *
@@ -47,6 +47,8 @@ INCLUDE_ARG_DEFINITION_STR0(
     "Use the latitude and longitude of the provided city. If the name contains multiple words, enclose the name in single or "
     "double quotes. For a list of available cities, see: https://github.com/da-luce/astroterm/blob/v" PROJ_VERSION
     "/data/cities.csv");
+INCLUDE_ARG_DEFINITION_STR0(complete_city_arg, NULL, "complete-city", "<prefix>",
+                            "Print the most populous cities whose names start with the prefix and exit");
 INCLUDE_ARG_DEFINITION_LIT0(color_arg, "c", "color", "Enable terminal colors");
 INCLUDE_ARG_DEFINITION_LIT0(
     constell_arg, "C", "constellations",
@@ -54,12 +56,57 @@ INCLUDE_ARG_DEFINITION_LIT0(
 INCLUDE_ARG_DEFINITION_LIT0(grid_arg, "g", "grid", "Draw an azimuthal grid");
 INCLUDE_ARG_DEFINITION_LIT0(unicode_arg, "u", "unicode", "Use unicode characters");
 INCLUDE_ARG_DEFINITION_LIT0(braille_arg, "b", "braille", "Use braille characters for constellation lines (requires Unicode)");
+INCLUDE_ARG_DEFINITION_LIT0(braille_stars_arg, NULL, "braille-stars",
+                            "Draw stars as braille dots, at twice the columns and four times the rows of the terminal "
+                            "(requires Unicode)");
+INCLUDE_ARG_DEFINITION_LIT0(combine_stars_arg, NULL, "combine-stars",
+                            "Draw stars sharing a cell with the symbol of their combined brightness rather than of the "
+                            "brightest");
 INCLUDE_ARG_DEFINITION_LIT0(quit_arg, "q", "quit-on-any", "Quit on any keypress (default is to quit on 'q' or 'ESC' only)");
 INCLUDE_ARG_DEFINITION_LIT0(meta_arg, "m", "metadata", "Display metadata");
 INCLUDE_ARG_DEFINITION_LIT0(help_arg, "h", "help", "Print this help message");
 INCLUDE_ARG_DEFINITION_LIT0(completions_arg, "B", "bash-completions", "Print bash completions");
 INCLUDE_ARG_DEFINITION_LIT0(version_arg, "v", "version", "Display version info and exit");
 INCLUDE_ARG_DEFINITION_INT0(fps_arg, "f", "fps", "<int>", "Frames per second (default: 24)");
+INCLUDE_ARG_DEFINITION_STR0(ephemeris_arg, NULL, "ephemeris", "<start,end,step>",
+                            "Print the azimuth and altitude of every object above the horizon from start to end (UTC, "
+                            "yyyy-mm-ddThh:mm:ss) every step (e.g. 30s, 10m, 1h, 1d) and exit");
+INCLUDE_ARG_DEFINITION_STR0(ephemeris_format_arg, NULL, "ephemeris-format", "<csv|binary>",
+                            "Output format of --ephemeris (default: csv)");
+INCLUDE_ARG_DEFINITION_STR0(events_arg, NULL, "events", "<start,end>",
+                            "Print conjunctions and occultations of the Moon and planets, and their close approaches to "
+                            "stars brighter than the threshold, from start to end (UTC, yyyy-mm-ddThh:mm:ss) and exit");
+INCLUDE_ARG_DEFINITION_DBL0(events_separation_arg, NULL, "events-separation", "<degrees>",
+                            "Largest separation of events printed by --events (default: 1.0)");
+INCLUDE_ARG_DEFINITION_INT0(threads_arg, NULL, "threads", "<int>",
+                            "Number of threads used by --ephemeris, --events and --render-frames (default: one per "
+                            "core)");
+INCLUDE_ARG_DEFINITION_STR0(serve_arg, NULL, "serve", "<address>",
+                            "Serve the sky to terminals connecting to a Unix socket path or TCP <host>:<port> instead of "
+                            "rendering it, e.g. 'nc -U <path>'");
+INCLUDE_ARG_DEFINITION_INT0(max_clients_arg, NULL, "max-clients", "<int>",
+                            "Number of terminals served by --serve at once (default: 1024)");
+INCLUDE_ARG_DEFINITION_STR0(stream_arg, NULL, "stream", "<ndjson|binary>",
+                            "Write the position and projected cell of every object in each frame to standard output "
+                            "instead of displaying the sky");
+INCLUDE_ARG_DEFINITION_STR0(stream_file_arg, NULL, "stream-file", "<path>",
+                            "Write --stream output to a file or named pipe and keep displaying the sky");
+INCLUDE_ARG_DEFINITION_STR0(shm_arg, NULL, "shm", "</name>",
+                            "Publish each frame's cells and object positions to a POSIX shared memory object");
+INCLUDE_ARG_DEFINITION_INT0(scrub_frames_arg, NULL, "scrub-frames", "<int>",
+                            "Number of frames kept in memory for scrubbing back and forth in time (default: 256, 0 "
+                            "disables)");
+INCLUDE_ARG_DEFINITION_STR0(record_arg, NULL, "record", "<path>",
+                            "Record the session to an asciicast v2 file, playable with 'asciinema play'");
+INCLUDE_ARG_DEFINITION_STR0(render_frames_arg, NULL, "render-frames", "<path>",
+                            "Render a frame for each '<yyyy-mm-ddThh:mm:ss>,<lat>,<lon>' or '<yyyy-mm-ddThh:mm:ss>,<city>' "
+                            "line of a file ('-' for standard input) to numbered files and exit");
+INCLUDE_ARG_DEFINITION_STR0(render_dir_arg, NULL, "render-dir", "<path>",
+                            "Directory --render-frames writes to (default: current directory)");
+INCLUDE_ARG_DEFINITION_STR0(render_format_arg, NULL, "render-format", "<ansi|text>",
+                            "Output format of --render-frames (default: ansi)");
+INCLUDE_ARG_DEFINITION_STR0(render_size_arg, NULL, "render-size", "<cols>x<rows>",
+                            "Size of frames rendered by --render-frames (default: 80x24)");
 
 #undef INCLUDE_ARG_DEFINITION_DBL0
 #undef INCLUDE_ARG_DEFINITION_STR0
@@ -131,6 +131,42 @@ void calc_planet_geo_ICRF(double xe, double ye, double ze, const struct KepElems
 void calc_moon_geo_ICRF(const struct KepElems *moon_elements, const struct KepRates *moon_rates, double julian_date, double *xg,
                         double *yg, double *zg);
 
+// Rise, transit and set
+
+// Altitude of a body's center at rise and set (degrees), accounting for
+// atmospheric refraction and, for the Sun and Moon, semi-diameter and parallax.
+// Astronomical Algorithms, Jean Meeus, ch. 15
+#define RISE_SET_ALTITUDE_STAR (-0.5667)
+#define RISE_SET_ALTITUDE_SUN (-0.8333)
+#define RISE_SET_ALTITUDE_MOON (0.125)
+
+enum RiseSetKind
+{
+    RISE_SET_NORMAL = 0,  // Rises and sets
+    RISE_SET_CIRCUMPOLAR, // Stays above the horizon
+    RISE_SET_NEVER_RISES, // Stays below the horizon
+};
+
+/* Times of the first rise, upper transit and set at or after the start of a
+ * search window, as julian dates. Events not occurring within the window are
+ * NAN
+ */
+struct RiseTransitSet
+{
+    double rise;
+    double transit;
+    double set;
+    enum RiseSetKind kind;
+};
+
+/* Calculate the next rise, upper transit and set after `julian_date` of a
+ * body at a fixed right ascension and declination, analytically from its hour
+ * angle. Every event occurs within one sidereal day. `horizon` is the altitude
+ * of the body at rise and set in radians
+ */
+void calc_rise_transit_set_fixed(double right_ascension, double declination, double latitude, double longitude,
+                                 double horizon, double julian_date, struct RiseTransitSet *events);
+
 // Miscellaneous
 
 /* Note: this is NOT the obliquity of the elliptic. Instead, it is the angle
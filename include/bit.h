@@ -1,5 +1,5 @@
 /* Byte formatting utilities. Converts little-endian sequence of bytes to
- * specified types
+ * specified types and back
  */
 
 #ifndef BIT_UTILS_H
@@ -25,4 +25,13 @@ double bytes_to_double64_LE(const uint8_t *buffer);
 
 bool bytes_to_bool32_LE(const uint8_t *buffer);
 
+// Writing: store a value as a little-endian sequence of bytes
+
+void uint16_to_bytes_LE(uint16_t value, uint8_t *buffer);
+void uint32_to_bytes_LE(uint32_t value, uint8_t *buffer);
+void uint64_to_bytes_LE(uint64_t value, uint8_t *buffer);
+
+void float32_to_bytes_LE(float value, uint8_t *buffer);
+void double64_to_bytes_LE(double value, uint8_t *buffer);
+
 #endif // BIT_UTILS_H
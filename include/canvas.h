@@ -0,0 +1,111 @@
+/* Surfaces the rendering functions draw on: a curses window, or a grid of
+ * cells in memory.
+ *
+ * Drawing into cells needs no curses, so any number of threads may each draw
+ * their own canvas. Cells take what curses would store for the same calls:
+ * strings wrap at the right edge and stop at the bottom right cell, zero width
+ * characters join the character before them, a wide character that does not
+ * fit at the end of a row moves to the next one, and writing over half of a
+ * wide character leaves the other half as curses does. Reading the cells back
+ * with `canvas_capture` then gives the frame `ansi_frame_capture` would read
+ * from a window. Color pairs are those of `ncurses_init`, pair n drawing in
+ * color n - 1.
+ */
+
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include "ansi.h"
+
+#include <curses.h>
+#include <stdbool.h>
+
+// Cells the Braille layer shared by windows covers
+#define BRAILLE_LAYER_ROWS 1024
+#define BRAILLE_LAYER_COLS 1024
+
+struct CanvasCell
+{
+    char text[ANSI_CELL_TEXT_SIZE]; // UTF-8, with zero width characters joined
+    short color_pair;
+    unsigned char column; // 1 or 2 for the columns of a wide character, else 0
+};
+
+struct Canvas
+{
+    WINDOW *win; // Drawn into if not NULL, otherwise `cells`
+
+    // The whole grid of cells, and the region of it drawn into
+    struct CanvasCell *cells; // Row major
+    unsigned char *braille;   // Braille dots drawn into each cell since last cleared
+    int rows;
+    int cols;
+    int top;
+    int left;
+    int height;
+    int width;
+
+    int y; // Cursor within the region
+    int x;
+    short color_pair; // Of what is drawn next into cells, 0 for none
+};
+
+/* Draw into a window. Windows share one layer of Braille dots
+ */
+struct Canvas window_canvas(WINDOW *win);
+
+/* Allocate a grid of blank cells, drawn into whole. This function allocates
+ * memory which must be freed with `free_canvas`. Returns false upon memory
+ * allocation error
+ */
+bool generate_cell_canvas(struct Canvas *canvas, int rows, int cols);
+
+/* Draw into a region of the cells of a canvas, which must lie inside them, as
+ * into a subwindow. The region shares the cells and is not freed itself
+ */
+struct Canvas canvas_region(const struct Canvas *canvas, int top, int left, int height, int width);
+
+void free_canvas(struct Canvas *canvas);
+
+void canvas_size(const struct Canvas *canvas, int *height, int *width);
+
+/* Blank every cell of the region
+ */
+void canvas_erase(struct Canvas *canvas);
+
+/* Draw in a color pair until `canvas_color_off`
+ */
+void canvas_color_on(struct Canvas *canvas, short pair);
+
+void canvas_color_off(struct Canvas *canvas, short pair);
+
+/* Draw a UTF-8 string from a cell, as `mvwaddstr`. Nothing is drawn if the
+ * cell lies outside
+ */
+void canvas_add_str(struct Canvas *canvas, int y, int x, const char *str);
+
+/* Draw an ASCII character at a cell, as `mvwaddch`
+ */
+void canvas_add_char(struct Canvas *canvas, int y, int x, char ch);
+
+/* Fill `count` cells of a row or column from a cell with a one column UTF-8
+ * character, clipped to the edge, as `mvwhline` and `mvwvline`
+ */
+void canvas_hline(struct Canvas *canvas, int y, int x, const char *fill, int count);
+
+void canvas_vline(struct Canvas *canvas, int y, int x, const char *fill, int count);
+
+/* Braille dots drawn into a cell of the region since the layer was last
+ * cleared, or NULL if the cell lies outside the layer
+ */
+unsigned char *canvas_braille_cell(struct Canvas *canvas, int y, int x);
+
+/* Clear the layer of Braille dots
+ */
+void canvas_clear_braille(struct Canvas *canvas);
+
+/* Copy the whole grid of a canvas of cells into a frame of the same size
+ */
+void canvas_capture(const struct Canvas *canvas, struct AnsiFrame *frame);
+
+#endif // CANVAS_H
@@ -1,20 +1,71 @@
 #ifndef CITY_H
 #define CITY_H
 
+#include <stdbool.h>
+
 typedef struct
 {
     const char *city_name;
+    const char *normalized_name; // Trimmed and lowercased name used for lookups
+    const char *country_code;
+    const char *timezone;
+    int population;
     float latitude;
     float longitude;
 } CityData;
 
-/* Attempt to get the coordinates of a city by name. Returns NULL if not found.
+/* Attempt to get the coordinates of a city by name. Where several cities share
+ * a name, the most populous is returned. Returns NULL if not found. The result
+ * points into a table generated at build time and must not be freed.
+ */
+const CityData *get_city(const char *name);
+
+/* Find up to `max_matches` cities whose names start with `prefix`, ignoring
+ * case and leading whitespace. Matches are written to `matches` ordered by
+ * decreasing population, listing only the most populous city of each name.
+ * Returns the number of matches found
  */
-CityData *get_city(const char *name);
+int complete_city(const char *prefix, const CityData **matches, int max_matches);
+
+typedef struct
+{
+    const CityData *city;
+    float similarity; // Jaccard similarity of the names' trigram sets, in (0, 1]
+    bool exact;       // The names only differ in case, accents or punctuation
+} CityMatch;
+
+/* Fuzzy search for cities whose names resemble `query`, tolerating typos and
+ * missing accents (e.g. "Sao Paolo" finds "São Paulo"). Up to `max_matches`
+ * results are written to `matches`, exact matches first, then ranked by
+ * similarity with a small bonus for larger populations. Only the most populous
+ * city of each name is considered. Returns the number of matches found
+ */
+int search_cities(const char *query, CityMatch *matches, int max_matches);
+
+/* Look up a city by name like `get_city`, also accepting names that only
+ * differ in accents or punctuation. Returns NULL if not found
+ */
+const CityData *find_city(const char *name);
+
+/* Find the city closest to a position given in degrees. If `distance_km` is
+ * not NULL, the great circle distance to the city is written to it. Returns
+ * NULL only if there are no cities
+ */
+const CityData *nearest_city(double latitude, double longitude, double *distance_km);
+
+/* Cursor over all city definitions. Cities are yielded as views into the
+ * generated table, so iterating allocates no memory
+ */
+typedef struct
+{
+    unsigned int index;
+} CityCursor;
+
+void city_cursor_init(CityCursor *cursor);
 
-/* Free memory used by CityData struct.
+/* Return the next city, or NULL once every city has been visited
  */
-void free_city(CityData *city);
+const CityData *city_cursor_next(CityCursor *cursor);
 
 /* Apply a callback and some associated data to all city definitions
  */
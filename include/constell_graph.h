@@ -0,0 +1,50 @@
+/* Constellation figures stored as one graph in compressed sparse row form.
+ *
+ * The segments of every figure are resolved to star table indices once, when
+ * the graph is built. Edges of constellation `c` are the pairs
+ * `edges[2 * offsets[c]] ... edges[2 * offsets[c + 1] - 1]`, and `vertices`
+ * lists each star used by any figure exactly once.
+ */
+
+#ifndef CONSTELL_GRAPH_H
+#define CONSTELL_GRAPH_H
+
+#include "arena.h"
+#include "core.h"
+
+#include <stdbool.h>
+
+struct ConstellGraph
+{
+    unsigned int num_constells;
+    unsigned int *offsets; // First edge of each constellation, plus the total number of edges
+    int *edges;            // Star table indices, two per edge
+    float *max_magnitude;  // Magnitude of the dimmest star in each figure
+
+    int *vertices; // Distinct star table indices referenced by any edge
+    unsigned int num_vertices;
+
+    // Edges of the figures whose stars all pass the magnitude threshold (see
+    // `constell_graph_set_threshold`), two star table indices per edge
+    int *visible_edges;
+    unsigned int num_visible_edges;
+
+    struct Arena arena; // Owns all of the above
+};
+
+/* Build the graph from a table parsed by `generate_constell_table`. Figures
+ * referencing stars outside the star table are never visible. This function
+ * allocates memory which must be freed with `free_constell_graph`. Returns
+ * false upon memory allocation error
+ */
+bool generate_constell_graph(struct ConstellGraph *graph, const struct Constell *constell_table, unsigned int num_const,
+                             const struct Star *star_table, unsigned int num_stars);
+
+void free_constell_graph(struct ConstellGraph *graph);
+
+/* Collect the edges of figures whose stars are all brighter than `threshold`
+ * into `visible_edges`
+ */
+void constell_graph_set_threshold(struct ConstellGraph *graph, float threshold);
+
+#endif // CONSTELL_GRAPH_H
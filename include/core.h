@@ -26,10 +26,36 @@ struct Conf
     bool quit_on_any;
     bool unicode;
     bool braille;
+    bool braille_stars; // Draw stars as Braille dots, several to a cell
+    bool combine_stars; // Draw stars sharing a cell by their combined brightness
     bool color;
     bool grid;
     bool constell;
     bool metadata;
+    const char *ephemeris;        // "<start>,<end>,<step>" to print an ephemeris instead of rendering
+    const char *ephemeris_format; // "csv" or "binary"
+    int threads;                  // Worker threads for batch modes, 0 for one per core
+    const char *serve;            // Address to serve the sky on instead of rendering
+    int max_clients;              // Connections accepted by the server
+    const char *stream;           // "ndjson" or "binary" to stream each frame's objects
+    const char *stream_file;      // Path streamed to, NULL for standard output without the display
+    const char *shm_name;         // Shared memory object each frame is published to
+    const char *render_frames;    // Jobs file to render frames for instead of displaying the sky
+    const char *render_dir;       // Directory rendered frames are written to
+    const char *render_format;    // "ansi" or "text"
+    const char *render_size;      // "<cols>x<rows>" of each rendered frame
+    const char *record;           // asciicast file the session is recorded to
+    int scrub_frames;             // Frames cached for scrubbing through time, 0 to disable
+    const char *events;           // "<start>,<end>" to search for conjunctions and occultations instead of rendering
+    double events_separation;     // Largest separation of events reported (degrees)
+};
+
+// Kinds of celestial body
+enum ObjectType
+{
+    OBJECT_STAR = 0,
+    OBJECT_PLANET,
+    OBJECT_MOON
 };
 
 // All information pertinent to rendering a celestial body
@@ -93,15 +119,16 @@ bool generate_star_table(struct Star **star_table, struct Entry *entries, const
                          unsigned int num_stars);
 
 /* Parse data from bsc5_names.txt and return an array of names. Stars with
- * catalog number `n` are mapped to index `n-1`. This function allocates memory
- * which should be freed by the caller. Returns false upon memory allocation
- * error.
+ * catalog number `n` are mapped to index `n-1`. The table and all names are
+ * allocated as one block which should be freed with `free_star_names`. Returns
+ * false upon memory allocation error.
  */
 bool generate_name_table(const uint8_t *data, size_t data_len, struct StarName **name_table_out, int num_stars);
 
 /* Parse data from bsc5_constellations.txt and return an array of constell
- * structs. This function allocates memory which should  be freed by the
- * caller. Returns false upon memory allocation error.
+ * structs. The table and all star numbers are allocated as one block which
+ * should be freed with `free_constells`. Returns false upon memory allocation
+ * error or malformed data.
  *
  * NOTE: bsc5.constellations.txt MUST end in a new line to grab all the data.
  */
@@ -126,6 +153,10 @@ void free_constells(struct Constell *constell_table, unsigned int size);
 void free_planets(struct Planet *planets, unsigned int size);
 void free_moon_object(struct Moon moon_data);
 
+/* Symbols a star of the given magnitude is drawn with
+ */
+void star_symbols(float magnitude, char *symbol_ASCII, const char **symbol_unicode);
+
 // Miscellaneous
 
 /* Comparator for star structs
@@ -133,7 +164,7 @@ void free_moon_object(struct Moon moon_data);
 int star_magnitude_comparator(const void *v1, const void *v2);
 
 /* Modify an array of star numbers sorted by increasing magnitude. Used in
- * rendering functions so brighter stars are always rendered on top
+ * rendering functions so brighter stars always take precedence
  */
 bool star_numbers_by_magnitude(int **num_by_mag, const struct Star *star_table, unsigned int num_stars);
 
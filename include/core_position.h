@@ -4,7 +4,9 @@
 #ifndef CORE_POSITION_H
 #define CORE_POSITION_H
 
+#include "constell_graph.h"
 #include "core.h"
+#include "sky_index.h"
 
 /* Update apparent star positions for a given observation time and location by
  * setting the azimuth and altitude of each star struct in an array of star
@@ -12,12 +14,34 @@
  */
 void update_star_positions(struct Star *star_table, int num_stars, double julian_date, double latitude, double longitude);
 
+/* Update apparent star positions like `update_star_positions`, but only for
+ * stars brighter than `threshold` in sky index tiles that reach above the
+ * horizon. The catalog numbers of stars above the horizon are written to
+ * `index->visible` sorted by decreasing magnitude, ready to be passed to
+ * `render_stars_stereo` in place of the full magnitude ordering
+ */
+void update_star_positions_indexed(struct Star *star_table, struct SkyIndex *index, double julian_date, double latitude,
+                                   double longitude, float threshold);
+
+/* Update apparent positions of the stars referenced by constellation figures.
+ * Figures may be drawn from stars the sky index culled below the horizon
+ */
+void update_constell_positions(struct Star *star_table, const struct ConstellGraph *graph, double julian_date,
+                               double latitude, double longitude);
+
 /* Update apparent Sun & planet positions for a given observation time and
  * location by setting the azimuth and altitude of each planet struct in an
  * array of planet structs
  */
 void update_planet_positions(struct Planet *planet_table, double julian_date, double latitude, double longitude);
 
+/* Calculate the geocentric rectangular equatorial coordinates of a planet (or
+ * the Sun) given the heliocentric coordinates of the Earth-Moon barycenter,
+ * which callers handling several planets compute once
+ */
+void calc_planet_geo_position(const struct Planet *planet_table, int planet, double xe, double ye, double ze,
+                              double julian_date, double *xg, double *yg, double *zg);
+
 /* Update apparent Moon positions for a given observation time and
  * location by setting the azimuth and altitude of a moon struct
  */
@@ -28,4 +52,32 @@ void update_moon_position(struct Moon *moon_object, double julian_date, double l
  */
 void update_moon_phase(struct Moon *moon_object, double julian_date, double latitude);
 
+/* Calculate the next rise, upper transit and set of each star after
+ * `julian_date` from its hour angle. `events` must hold `num_stars` entries
+ */
+void calc_star_rise_transit_set(const struct Star *star_table, unsigned int num_stars, double julian_date, double latitude,
+                                double longitude, struct RiseTransitSet *events);
+
+/* Calculate the first rise, upper transit and set of the Sun and each planet
+ * within one day of `julian_date`. Events are bracketed between hourly
+ * positions, then refined to the second on interpolated positions. `events`
+ * must hold NUM_PLANETS entries; the Earth's entry has no events
+ */
+void calc_planet_rise_transit_set(const struct Planet *planet_table, double julian_date, double latitude, double longitude,
+                                  struct RiseTransitSet *events);
+
+/* Calculate the first rise, upper transit and set of the Moon within one day
+ * of `julian_date` like `calc_planet_rise_transit_set`
+ */
+void calc_moon_rise_transit_set(const struct Moon *moon_object, double julian_date, double latitude, double longitude,
+                                struct RiseTransitSet *events);
+
+/* Calculate rise, transit and set for every star, planet and the Moon. See
+ * the functions above for the size of each output
+ */
+void calc_catalog_rise_transit_set(const struct Star *star_table, unsigned int num_stars, const struct Planet *planet_table,
+                                   const struct Moon *moon_object, double julian_date, double latitude, double longitude,
+                                   struct RiseTransitSet *star_events, struct RiseTransitSet *planet_events,
+                                   struct RiseTransitSet *moon_events);
+
 #endif // CORE_POSITION_H
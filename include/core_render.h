@@ -4,34 +4,273 @@
 #ifndef CORE_RENDER_H
 #define CORE_RENDER_H
 
+#include "canvas.h"
+#include "constell_graph.h"
 #include "core.h"
+#include "labels.h"
 
 #include <curses.h>
+#include <stdbool.h>
+#include <stdint.h>
 
-/* Render stars to the screen using a stereographic projection
+/* An inclusive rectangle of cells
  */
-void render_stars_stereo(WINDOW *win, const struct Conf *config, struct Star *star_table, int num_stars, const int *num_by_mag);
+struct CellRect
+{
+    int top;
+    int left;
+    int bottom;
+    int right;
+};
+
+// Regions a layer can track before the whole layer is composited instead
+#define MAX_DIRTY_RECTS 32
+
+// Objects a layer can track one by one
+#define MAX_LAYER_ITEMS 16
+
+/* One object drawn in a layer: the cells it may cover and a signature of how
+ * it is drawn there
+ */
+struct LayerItem
+{
+    uint64_t signature;
+    struct CellRect rect;
+    bool visible;
+};
+
+/* Cells drawn by one part of the sky, kept across frames in a pad of the
+ * window's size. Cells nothing was drawn in let the layers below show through,
+ * while drawn spaces such as those in labels cover them. The signature
+ * summarizes what the pad holds, so a layer is only drawn again when it would
+ * come out differently
+ */
+struct RenderLayer
+{
+    WINDOW *pad;
+    bool drawn; // Whether `signature` describes the pad
+    uint64_t signature;
+
+    // For layers tracked object by object
+    bool itemized; // Whether `items` describes the pad
+    struct LayerItem items[MAX_LAYER_ITEMS];
+    unsigned int num_items;
+
+    // Regions that changed since the layer was last composited
+    bool all_dirty;
+    struct CellRect dirty[MAX_DIRTY_RECTS];
+    unsigned int num_dirty;
+};
+
+/* Layers from bottom to top, each invalidated independently
+ */
+enum LayerIndex
+{
+    LAYER_GRID = 0,   // Changes only with the window size and options
+    LAYER_STARS,      // Stars and constellation figures, which creep across cells
+    LAYER_BODIES,     // Planets and the Moon, which move on their own
+    LAYER_DIRECTIONS, // Cardinal directions
+    NUM_LAYERS
+};
+
+/* A cell of a window and the brightest star projected onto it
+ */
+struct StarCell
+{
+    const struct Star *star;
+    int y;
+    int x;
+    float magnitude; // Of the star, or of every star in the cell combined
+};
+
+/* Stars projected onto the cells of a window by `bin_stars`, keeping only the
+ * brightest star in each cell so that every cell is drawn once. The memory of
+ * earlier frames is reused. A zero-initialized set of bins is empty and valid
+ */
+struct StarBins
+{
+    int height; // Of the window the stars were binned for
+    int width;
+
+    int *cells; // Index in `occupied` of each cell's star, or -1
+    size_t num_cells;
+
+    // With `braille_stars`, the Braille dots of every star in each cell
+    unsigned char *dots;
+
+    struct StarCell *occupied; // Brightest first
+    unsigned int num_occupied;
+    unsigned int capacity;
+};
+
+/* Where an object's label is drawn
+ */
+struct LabelSpot
+{
+    bool shown; // False if there was no room for the label
+    int y;
+    int x;
+};
+
+struct StarLabel
+{
+    const struct Star *star;
+    struct LabelSpot spot;
+};
+
+/* Labels placed around the objects of a frame by `place_labels`. The memory of
+ * earlier frames is reused. A zero-initialized layout is empty and valid
+ */
+struct LabelLayout
+{
+    struct LabelGrid grid;
+
+    struct StarLabel *stars; // Shown star labels, brightest first
+    unsigned int num_stars;
+    unsigned int capacity;
+
+    struct LabelSpot planets[NUM_PLANETS];
+    struct LabelSpot moon;
+};
+
+/* Layers merged into one window. Only the regions of layers that changed are
+ * merged again, so the window must keep its contents between frames. A
+ * zero-initialized compositor is empty and valid
+ */
+struct Compositor
+{
+    struct RenderLayer layers[NUM_LAYERS];
+    int height; // Of the window the layers are sized for
+    int width;
+    cchar_t *cells; // Row buffer for compositing, one cell wider than the window
+
+    // Of the frame being drawn
+    struct StarBins stars;
+    struct LabelLayout labels;
+};
+
+/* Map a horizontal position to polar coordinates on the stereographic
+ * projection used for rendering. Positions above the horizon have a radius of
+ * at most 1
+ */
+void horizontal_to_polar(double azimuth, double altitude, double *radius, double *theta);
+
+/* Render an object using a stereographic projection, and its label at `label`
+ * unless it is NULL or not shown
+ */
+void render_object_stereo(struct Canvas *canvas, const struct ObjectBase *object, const struct Conf *config,
+                          const struct LabelSpot *label);
+
+/* Number of cells the symbol of an object takes up
+ */
+int object_symbol_width(const struct ObjectBase *object, const struct Conf *config);
+
+/* Project the stars brighter than the threshold onto the cells of a window.
+ * `num_by_mag` lists them dimmest first, as from `star_numbers_by_magnitude`,
+ * and may be a subset such as the visible stars of the sky index. With
+ * `combine_stars` set, each cell takes the combined magnitude of all its
+ * stars. With `braille_stars` set, every star is also plotted as Braille dots
+ * on a grid of two by four dots per cell, bright stars as several. If memory
+ * runs out, no stars are kept
+ */
+void bin_stars(struct StarBins *bins, const struct Canvas *canvas, const struct Conf *config, const struct Star *star_table,
+               int num_stars, const int *num_by_mag);
+
+void free_star_bins(struct StarBins *bins);
+
+/* Place the labels of the Sun, planets, Moon and binned stars brighter than the
+ * label threshold so they overlap neither each other nor any symbol, brightest
+ * first. Labels that do not fit anywhere are left out, as are all labels if
+ * memory runs out
+ */
+void place_labels(struct LabelLayout *layout, const struct Canvas *canvas, const struct Conf *config,
+                  const struct StarBins *stars, const struct Planet *planet_table, const struct Moon *moon_object);
+
+void free_label_layout(struct LabelLayout *layout);
+
+/* Render binned stars to the screen, with one call per cell, and the star
+ * labels of `labels` unless it is NULL. Braille stars are drawn in the layer
+ * of Braille constellation lines, which it clears
+ */
+void render_stars_stereo(struct Canvas *canvas, const struct Conf *config, const struct StarBins *stars,
+                         const struct LabelLayout *labels);
 
 /* Render the Sun and planets to the screen using a stereographic projection
  */
-void render_planets_stereo(WINDOW *win, const struct Conf *config, const struct Planet *planet_table);
+void render_planets_stereo(struct Canvas *canvas, const struct Conf *config, const struct Planet *planet_table,
+                           const struct LabelLayout *labels);
 
 /* Render the Moon to the screen using a stereographic projection
  */
-void render_moon_stereo(WINDOW *win, const struct Conf *config, struct Moon moon_object);
+void render_moon_stereo(struct Canvas *canvas, const struct Conf *config, const struct Moon *moon_object,
+                        const struct LabelLayout *labels);
 
-/* Render constellations
+/* Render the visible edges of the constellation graph. Braille lines are
+ * merged with the Braille stars drawn just before, if any
  */
-void render_constells(WINDOW *win, const struct Conf *config, struct Constell **constell_table, int num_const,
+void render_constells(struct Canvas *canvas, const struct Conf *config, const struct ConstellGraph *graph,
                       const struct Star *star_table);
 
 /* Render an azimuthal grid on a stereographic projection
  */
-void render_azimuthal_grid(WINDOW *win, const struct Conf *config);
+void render_azimuthal_grid(struct Canvas *canvas, const struct Conf *config);
+
+/* Mix a value into a layer signature. Start from `LAYER_SIGNATURE_SEED`
+ */
+#define LAYER_SIGNATURE_SEED 0xCBF29CE484222325ull
+uint64_t layer_signature_add(uint64_t signature, long long value);
+
+/* Signature of what `render_stars_stereo` followed by `render_constells`, if
+ * enabled, would draw in a window. It changes whenever the star drawn in a
+ * cell, a star label or a constellation vertex moves to another cell
+ */
+uint64_t stars_layer_signature(const struct Canvas *canvas, const struct Conf *config, const struct StarBins *stars,
+                               const struct Star *star_table, const struct ConstellGraph *graph,
+                               const struct LabelLayout *labels);
+
+/* Describe an object drawn by `render_object_stereo` as a layer item
+ */
+void object_layer_item(const struct Canvas *canvas, const struct ObjectBase *object, const struct Conf *config,
+                       const struct LabelSpot *label, struct LayerItem *item);
+
+/* Size the layers for a window, discarding them if it was resized. Returns
+ * false upon memory allocation error, after which the compositor is empty
+ */
+bool compositor_begin(struct Compositor *compositor, WINDOW *win);
+
+/* Start drawing a whole layer again if its signature changed. Returns the
+ * layer's erased pad to draw in, or NULL if the layer is unchanged
+ */
+WINDOW *compositor_redraw_layer(struct Compositor *compositor, enum LayerIndex index, uint64_t signature);
+
+/* Start drawing a layer tracked by object again if any item changed. Only the
+ * cells around changed items are composited. Returns the layer's pad with
+ * every item erased, to draw all of them in again, or NULL if the layer is
+ * unchanged. Layers with too many items are redrawn whole
+ */
+WINDOW *compositor_redraw_items(struct Compositor *compositor, enum LayerIndex index, const struct LayerItem *items,
+                                unsigned int num_items);
+
+/* Draw the azimuthal grid into the compositor's grid layer. It depends only
+ * on the window size and options, so it is rasterized again only when they
+ * change. Call after `compositor_begin`
+ */
+void render_azimuthal_grid_layer(struct Compositor *compositor, const struct Conf *config);
+
+/* Merge the regions of layers that changed into the window, bottom to top
+ */
+void compositor_composite(struct Compositor *compositor, WINDOW *win);
+
+/* Discard every layer, e.g. when the window is cleared. They are drawn again
+ * on next use
+ */
+void invalidate_compositor(struct Compositor *compositor);
+
+void free_compositor(struct Compositor *compositor);
 
 /* Render cardinal direction indicators for the Northern, Eastern, Southern, and
  * Western horizons
  */
-void render_cardinal_directions(WINDOW *win, const struct Conf *config);
+void render_cardinal_directions(struct Canvas *canvas, const struct Conf *config);
 
 #endif // CORE_RENDER_H
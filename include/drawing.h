@@ -1,4 +1,4 @@
-/* ASCII and Unicode ncurses rendering functions. These functions aim to provide
+/* ASCII and Unicode rendering functions. These functions aim to provide
  * a balance of performance, readability, and style of the resulting render,
  * with more emphasis placed on the latter two objectives. Here, we forgo many
  * of the micro-optimizations (e.g. precomputing frequently used values) of the
@@ -13,6 +13,13 @@
  * represented as `y` and `x` and are only translated to their respective `row`
  * and `column` on the terminal when they are pushed to the screen buffer.
  *
+ * Lines are rasterized with integer steps and clipped to the window before
+ * anything is drawn, so only their cells inside it are visited. Each run of
+ * cells in a row or column is pushed to the screen buffer at once.
+ *
+ * Everything is drawn on a canvas: a window, or cells in memory which any thread
+ * may draw into.
+ *
  * IMPORTANT:   using Unicode-designated functions requires UTF-8 encoding
  *              for proper results
  *
@@ -23,35 +30,42 @@
 #ifndef DRAWING_H
 #define DRAWING_H
 
-#include <curses.h>
+#include "canvas.h"
+
 #include <stdbool.h>
 
 /* Draw an ASCII line segment from (xa, ya) and (xb, yb) where y and x
  * are synonymous with row and column, respectively.
  */
-void draw_line_ASCII(WINDOW *win, int ya, int xa, int yb, int xb);
+void draw_line_ASCII(struct Canvas *canvas, int ya, int xa, int yb, int xb);
 
 /* Draw a smooth unicode line segment from (xa, ya) and (xb, yb) where y and x
  * are synonymous with row and column, respectively
  */
-void draw_line_smooth(WINDOW *win, int ya, int xa, int yb, int xb);
+void draw_line_smooth(struct Canvas *canvas, int ya, int xa, int yb, int xb);
 
 /* Draw an dotted line segment from (xa, ya) and (xb, yb) where y and x
  * are synonymous with row and column, respectively.
  */
-void draw_line_dotted(WINDOW *win, int ya, int xa, int yb, int xb);
+void draw_line_dotted(struct Canvas *canvas, int ya, int xa, int yb, int xb);
+
+/* Bit of the dot at row `dot_y` (0 to 3) and column `dot_x` (0 or 1) of a
+ * Braille character, as offset from U+2800
+ */
+unsigned char braille_dot(int dot_y, int dot_x);
 
-/* Clear braille lines layer.
+/* Draw the Braille dots of `mask` in a cell, along with any drawn there since
+ * the layer was last cleared
  */
-void clear_braille_lines(void);
+void draw_braille_cell(struct Canvas *canvas, int y, int x, unsigned char mask);
 
 /* Draw a line segment from (xa, ya) to (xb, yb) using Braille characters
  */
-void draw_line_braille(WINDOW *win, int ya, int xa, int yb, int xb);
+void draw_line_braille(struct Canvas *canvas, int ya, int xa, int yb, int xb);
 
 /* Draw an ellipse. By taking advantage of knowing the cell aspect ratio,
  * this function can generate an "apparent" circle.
  */
-void draw_ellipse(WINDOW *win, int centerRow, int centerCol, int radiusY, int radiusX, bool no_unicode);
+void draw_ellipse(struct Canvas *canvas, int centerRow, int centerCol, int radiusY, int radiusX, bool no_unicode);
 
 #endif // DRAWING_H
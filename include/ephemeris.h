@@ -0,0 +1,90 @@
+/* Batch generation of alt/az tables for every object above the horizon over a
+ * range of times, without curses.
+ *
+ * Time steps are split across threads, each of which formats its rows into a
+ * private buffer. Buffers are written out in time order, so the output does not
+ * depend on the number of threads.
+ *
+ * CSV output has one header line followed by one row per object and step:
+ *
+ *      julian_date,object,id,name,azimuth,altitude,magnitude
+ *
+ * where `object` is one of "star", "planet" or "moon", `id` is the BSC5
+ * catalog number for stars and the `enum Planets` value for planets, and
+ * angles are in degrees.
+ *
+ * Binary output starts with a 16 byte header:
+ *
+ *      char     magic[8];      // "ASTEPHEM"
+ *      uint32_t version;       // EPHEMERIS_BINARY_VERSION
+ *      uint32_t record_size;   // EPHEMERIS_RECORD_SIZE
+ *
+ * followed by one fixed-size record per object and step. All values are
+ * little-endian and angles are in degrees:
+ *
+ *      double   julian_date;
+ *      int32_t  id;
+ *      uint8_t  object;        // enum ObjectType
+ *      uint8_t  reserved[3];
+ *      float    azimuth;
+ *      float    altitude;
+ *      float    magnitude;
+ */
+
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+#include "core.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define EPHEMERIS_BINARY_MAGIC "ASTEPHEM"
+#define EPHEMERIS_BINARY_VERSION 2
+#define EPHEMERIS_HEADER_SIZE 16
+#define EPHEMERIS_RECORD_SIZE 28
+
+enum EphemerisFormat
+{
+    EPHEMERIS_CSV = 0,
+    EPHEMERIS_BINARY
+};
+
+struct EphemerisConf
+{
+    double julian_date_start;
+    double julian_date_end; // Inclusive
+    double step;            // Time between rows (days)
+    double latitude;        // Observer location (radians)
+    double longitude;
+    float threshold; // Only list stars brighter than this magnitude
+    enum EphemerisFormat format;
+    unsigned int num_threads; // 0 uses every core
+};
+
+/* Number of time steps between the start and end dates, inclusive. Returns 0
+ * if the range is empty or the step is not positive
+ */
+unsigned long ephemeris_num_steps(const struct EphemerisConf *conf);
+
+/* Parse a step such as "30s", "15m", "1h" or "7d" into days. A number without
+ * a unit is in seconds. Returns false if the step is malformed or not positive
+ */
+bool parse_ephemeris_step(const char *string, double *step);
+
+/* Format a number with a fixed number of decimals (at most 8) like printf's
+ * "%.*f" in the C locale, without a terminating NUL. Writes at most 32 bytes
+ * and returns the number written. printf dominates the run time of batch output
+ * otherwise
+ */
+size_t format_fixed(char *buffer, double value, int decimals);
+
+/* Write the positions of every star, planet and moon above the horizon at each
+ * time step to `out`. The tables are only read. Returns false upon memory
+ * allocation or write error
+ */
+bool generate_ephemeris(FILE *out, const struct EphemerisConf *conf, const struct Star *star_table,
+                        unsigned int num_stars, const struct Planet *planet_table, const struct Moon *moon_object);
+
+#endif // EPHEMERIS_H
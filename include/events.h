@@ -0,0 +1,74 @@
+/* Search for conjunctions, occultations and appulses over a range of dates.
+ *
+ * The Moon and the planets from Mercury to Neptune are positioned at coarse
+ * time steps. Each minimum of the angular separation between two of them, or
+ * between one of them and a star, is bracketed by the steps on either side and
+ * refined by golden-section search on exact positions. Stars are shortlisted
+ * with the sky index around the path of each body, so only stars that come
+ * close are ever positioned. The range is split into windows searched in
+ * parallel.
+ *
+ * Separations are geocentric, as seen from the center of the Earth: the Moon's
+ * parallax shifts it by up to a degree for an observer on the surface, so
+ * whether a lunar occultation is visible depends on the location.
+ *
+ * CSV output has one header line followed by one row per event, in time order:
+ *
+ *      julian_date,date,event,object,id,name,other_object,other_id,other_name,separation
+ *
+ * where `date` is UTC, `event` is one of "conjunction", "occultation" or
+ * "appulse", objects and ids are as in ephemeris.h and the separation between
+ * centers is in degrees. The first object is always the Moon or the innermost
+ * planet.
+ */
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "core.h"
+#include "sky_index.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+enum SkyEventType
+{
+    EVENT_CONJUNCTION = 0, // Two bodies pass close to each other
+    EVENT_OCCULTATION,     // The Moon passes in front of a planet or star
+    EVENT_APPULSE          // A body passes close to a star
+};
+
+struct SkyEvent
+{
+    double julian_date; // Time of least separation
+    double separation;  // Angular separation between centers (radians)
+    enum SkyEventType type;
+    enum ObjectType object; // The Moon or a planet
+    int id;                 // `enum Planets` value for planets, 0 for the Moon
+    enum ObjectType other_object;
+    int other_id; // As `id`, or the catalog number for stars
+};
+
+struct EventsConf
+{
+    double julian_date_start;
+    double julian_date_end;   // Inclusive
+    double separation;        // Report events closer than this (radians)
+    float threshold;          // Only consider stars brighter than this magnitude
+    unsigned int num_threads; // 0 uses every core
+};
+
+/* Find every event between the start and end dates. The tables are only read.
+ * `events` is allocated and must be freed by the caller, sorted by time.
+ * Returns false upon memory allocation error
+ */
+bool search_events(const struct EventsConf *conf, const struct Star *star_table, const struct SkyIndex *sky_index,
+                   const struct Planet *planet_table, const struct Moon *moon_object, struct SkyEvent **events,
+                   unsigned int *num_events);
+
+/* Write events as CSV. Returns false upon write error
+ */
+bool write_events(FILE *out, const struct SkyEvent *events, unsigned int num_events, const struct Star *star_table,
+                  const struct Planet *planet_table, const struct Moon *moon_object);
+
+#endif // EVENTS_H
@@ -0,0 +1,91 @@
+/* Shared memory export of each frame for other local processes.
+ *
+ * The writer publishes the screen's cell grid and the objects drawn into a
+ * POSIX shared memory segment guarded by a sequence lock, so readers can map
+ * the segment and read the latest frame in place without blocking the writer.
+ * All values are in native byte order. The segment starts with a header:
+ *
+ *      char     magic[8];          // "ASTROFB"
+ *      uint32_t version;           // FRAMEBUFFER_VERSION
+ *      uint32_t sequence;          // Odd while a frame is being written
+ *      uint64_t segment_size;      // Only ever grows
+ *      uint64_t frame_number;
+ *      double   julian_date;
+ *      uint32_t rows;              // Size of the cell grid
+ *      uint32_t cols;
+ *      uint32_t sky_row;           // Projection window within the grid
+ *      uint32_t sky_col;
+ *      uint32_t sky_rows;
+ *      uint32_t sky_cols;
+ *      uint32_t cells_offset;      // rows * cols cells, row major
+ *      uint32_t objects_offset;    // One binary frame as in stream.h
+ *      uint32_t objects_size;
+ *      uint32_t reserved;
+ *
+ * Each cell is FRAMEBUFFER_CELL_SIZE bytes:
+ *
+ *      char     text[16];          // UTF-8, NUL padded, empty for the second
+ *                                  // column of a wide character
+ *      int16_t  color;             // Foreground color, -1 for the default
+ *      uint8_t  attrs;             // enum AnsiAttr
+ *      uint8_t  reserved;
+ *
+ * Object cells are relative to the projection window. A reader loads
+ * `sequence`, retries while it is odd, copies what it needs, then loads
+ * `sequence` again and retries if it changed. If `segment_size` exceeds the
+ * size mapped, the reader maps the segment again. `framebuffer_read` does all
+ * of this.
+ */
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "ansi.h"
+#include "stream.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FRAMEBUFFER_MAGIC "ASTROFB"
+#define FRAMEBUFFER_VERSION 1
+#define FRAMEBUFFER_HEADER_SIZE 80
+#define FRAMEBUFFER_CELL_SIZE 20
+
+struct Framebuffer
+{
+    char name[256]; // Shared memory object name, e.g. "/astroterm"
+    int fd;
+    void *segment;
+    size_t size; // Bytes mapped
+    size_t objects_capacity;
+    unsigned long long frame_number;
+};
+
+/* Create the shared memory object `name` with room for a grid of `rows` by
+ * `cols` cells and a binary stream frame of every star in a table of
+ * `num_stars`. An existing object of the same name is replaced. Must be freed
+ * with `free_framebuffer`. Returns false if the object could not be created
+ */
+bool generate_framebuffer(struct Framebuffer *framebuffer, const char *name, int rows, int cols,
+                          unsigned int num_stars);
+
+/* Unmap and remove the shared memory object
+ */
+void free_framebuffer(struct Framebuffer *framebuffer);
+
+/* Publish one frame: the screen's cells, where the projection window lies in
+ * them, and the objects as encoded by a binary `Stream`. The segment grows if
+ * the grid no longer fits. Returns false if it could not grow
+ */
+bool framebuffer_publish(struct Framebuffer *framebuffer, const struct AnsiFrame *frame, int sky_row, int sky_col,
+                         int sky_rows, int sky_cols, const struct Stream *objects, double julian_date);
+
+/* Copy a consistent snapshot of the used part of a mapped segment of
+ * `segment_size` bytes into `buffer`. The snapshot has the layout of the
+ * segment. Returns false if no frame was published yet, the segment was mapped
+ * too small (remap at the size in the header), or `buffer_size` is too small.
+ * `length` receives the number of bytes needed or copied
+ */
+bool framebuffer_read(const void *segment, size_t segment_size, void *buffer, size_t buffer_size, size_t *length);
+
+#endif // FRAMEBUFFER_H
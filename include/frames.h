@@ -0,0 +1,72 @@
+/* Headless rendering of many frames to numbered files, e.g. for time-lapses.
+ *
+ * Each job is a time and a location. Jobs are drawn into cells in memory, as
+ * curses would draw them into a window of the frame size, and written as ANSI
+ * or plain text to `<directory>/frame_<nnnnnn>.<ans|txt>`, numbered from 1 in
+ * job order. Each thread positions, draws and writes its own share of the jobs,
+ * without curses.
+ *
+ * A jobs file has one job per line, either of
+ *
+ *      <yyyy-mm-ddThh:mm:ss>,<latitude>,<longitude>
+ *      <yyyy-mm-ddThh:mm:ss>,<city>
+ *
+ * with times in UTC and coordinates in degrees. Blank lines and lines starting
+ * with '#' are skipped.
+ */
+
+#ifndef FRAMES_H
+#define FRAMES_H
+
+#include "core.h"
+#include "sky.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+enum FramesFormat
+{
+    FRAMES_ANSI = 0,
+    FRAMES_TEXT
+};
+
+struct FrameJob
+{
+    double julian_date;
+    double latitude; // Observer location (radians)
+    double longitude;
+};
+
+struct FramesConf
+{
+    const char *directory; // Existing directory frames are written to
+    enum FramesFormat format;
+    int rows; // Size of each frame in cells
+    int cols;
+    unsigned int num_threads; // 0 uses every core
+};
+
+/* Parse "ansi" or "text". Returns false for anything else
+ */
+bool parse_frames_format(const char *string, enum FramesFormat *format);
+
+/* Parse one line of a jobs file. Returns false and describes the problem in
+ * `error` if the line is malformed or the city is unknown
+ */
+bool parse_frame_job(const char *line, struct FrameJob *job, char *error, size_t error_size);
+
+/* Read every job from a jobs file. This function allocates memory which must be
+ * freed by the caller. Returns false, after printing the offending line, upon
+ * a malformed line or memory allocation error
+ */
+bool read_frame_jobs(FILE *in, struct FrameJob **jobs, unsigned int *num_jobs);
+
+/* Render every job with the options in `view` and write the frames. The sky's
+ * tables are copied for each thread and left unchanged. Returns false if a
+ * frame could not be rendered or written
+ */
+bool render_frames(const struct FramesConf *conf, const struct Conf *view, const struct FrameJob *jobs,
+                   unsigned int num_jobs, const struct Sky *sky);
+
+#endif // FRAMES_H
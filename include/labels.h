@@ -0,0 +1,53 @@
+/* Placement of labels next to the symbols they name, without overlapping each
+ * other or other symbols.
+ *
+ * The cells of the window are tracked in an occupancy grid holding one bit per
+ * cell. Symbols are marked first, then labels are placed greedily in order of
+ * priority: each tries a few positions around its symbol and takes the first
+ * that lies inside the window over free cells, or is left out. A row of a
+ * label only spans one or two words of the grid, so placing labels takes time
+ * proportional to their number, and the grid is only reallocated when the
+ * window grows.
+ */
+
+#ifndef LABELS_H
+#define LABELS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct LabelGrid
+{
+    uint64_t *bits; // Occupied cells, one bit each, rows padded to whole words
+    int height;     // Of the window the grid covers
+    int width;
+    int stride;      // Words per row
+    size_t capacity; // Words allocated in `bits`
+};
+
+/* Size the grid for a window and mark every cell free. Returns false upon
+ * memory allocation error, after which the grid covers nothing
+ */
+bool label_grid_reset(struct LabelGrid *grid, int height, int width);
+
+void free_label_grid(struct LabelGrid *grid);
+
+/* Mark `length` cells of a row starting at column `x` as occupied. Cells
+ * outside the window are ignored
+ */
+void label_grid_occupy(struct LabelGrid *grid, int y, int x, int length);
+
+/* Whether `length` cells of a row starting at column `x` all lie inside the
+ * window and are free
+ */
+bool label_grid_is_free(const struct LabelGrid *grid, int y, int x, int length);
+
+/* Find a place for a label of `length` cells next to a symbol `symbol_width`
+ * cells wide at (y, x), trying above to the right first as labels were always
+ * drawn, then right, above left, left, below right and below left. The label's
+ * cells are marked as occupied. Returns false if no position is free
+ */
+bool label_grid_place(struct LabelGrid *grid, int y, int x, int symbol_width, int length, int *label_y, int *label_x);
+
+#endif // LABELS_H
@@ -36,6 +36,6 @@ struct Entry
  * allocates memory which must be freed by the caller. Returns false in event
  * of a file error
  */
-bool parse_entries(uint8_t *data, size_t data_size, struct Entry **entries_out, unsigned int *num_entries_out);
+bool parse_entries(const uint8_t *data, size_t data_size, struct Entry **entries_out, unsigned int *num_entries_out);
 
 #endif // PARSE_BSC5_H
@@ -0,0 +1,66 @@
+/* asciicast v2 recording of the screen as drawn by astroterm itself.
+ *
+ * After each frame the screen is captured and only the cells that changed are
+ * encoded as escape sequences (see ansi.h), so a recording grows with what
+ * moves rather than with the size of the terminal. The render loop only queues
+ * those bytes; a writer thread formats the events and writes them through a
+ * buffered file. The file can be played back with `asciinema play`:
+ *
+ *      {"version": 2, "width": 80, "height": 24, "timestamp": 1735689600, ...}
+ *      [0.000000, "o", "\u001b[0m\u001b[?25l\u001b[2J..."]
+ *      [0.041667, "o", "\u001b[12;40H\u001b[0;33m*"]
+ *      [1.500000, "r", "100x30"]
+ *
+ * Resizes are recorded as "r" events followed by a full redraw.
+ */
+
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include "ansi.h"
+#include "stopwatch.h"
+#include "thread.h"
+
+#include <curses.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+struct Recording
+{
+    FILE *file;
+    struct SwTimestamp start;
+    struct AnsiFrame frames[2]; // Last frame captured and the one being captured
+    int current;                // Index of the last frame captured in `frames`
+    bool redraw;                // Encode the next frame in full
+    int rows;                   // Terminal size as last recorded
+    int cols;
+    struct AnsiBuffer events; // Events being queued by the render loop
+
+    // Shared with the writer thread
+    struct Thread writer;
+    struct Mutex mutex;
+    struct Condition condition;
+    struct AnsiBuffer pending; // Events queued and not yet written
+    bool stop;
+    bool failed;
+};
+
+/* Create the file at `path`, write the asciicast header for a terminal of
+ * `rows` by `cols` cells and start the writer thread. Must be freed with
+ * `free_recording`. Returns false if the file could not be created or upon
+ * memory allocation error
+ */
+bool generate_recording(struct Recording *recording, const char *path, int rows, int cols);
+
+/* Write any queued events, stop the writer thread and close the file. Returns
+ * false if anything failed to be written
+ */
+bool free_recording(struct Recording *recording);
+
+/* Queue the cells of `win` (usually `curscr` after `doupdate`) that changed
+ * since the last capture. Returns false once the writer has failed, e.g. when
+ * the disk is full
+ */
+bool recording_capture(struct Recording *recording, WINDOW *win);
+
+#endif // RECORDING_H
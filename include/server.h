@@ -0,0 +1,102 @@
+/* Sky server: renders the sky for many terminals connected over a Unix or TCP
+ * socket, e.g. with `nc -U /tmp/astroterm.sock` or `socat - TCP:localhost:7878`.
+ *
+ * A client may send one line of space separated options within
+ * SERVER_HANDSHAKE_MS of connecting, otherwise it is served the defaults: an
+ * 80x24 terminal and the location, thresholds and drawing flags given to the
+ * server on its own command line. Options a client sends override these, e.g.
+ *
+ *      rows=40 cols=120 lat=42.36 lon=-71.06 threshold=4 color unicode
+ *
+ * Accepted options are `rows`, `cols`, `lat`, `lon`, `city` (quoted if it
+ * contains spaces), `threshold`, `label-threshold` and the flags `color`,
+ * `unicode`, `braille`, `braille-stars`, `combine-stars`, `grid` and
+ * `constellations`. Flags may be given a value of 0 or 1. Anything a client
+ * sends after its options is ignored.
+ *
+ * Clients with the same options share a view, which is updated and rendered
+ * once per frame. Each frame is encoded as ANSI escape sequences once per view
+ * as the difference from the previous frame and sent to every client of the
+ * view. Clients that have not read the previous frame yet skip frames and are
+ * sent a full redraw once they catch up, so output buffered per client never
+ * exceeds one frame.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "sky.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Time a client has to send its options after connecting
+#define SERVER_HANDSHAKE_MS 500
+
+// Longest option line accepted, including the newline
+#define SERVER_MAX_REQUEST 256
+
+// Largest number of rows or columns of a client terminal
+#define SERVER_MAX_SIZE 1000
+
+struct ServerAddress
+{
+    bool is_unix;   // Listen on a Unix socket at `path`, otherwise on TCP
+    char path[108]; // At most as long as `sun_path`, which varies by platform
+    char host[256]; // Interface to bind, e.g. "127.0.0.1" or "::"
+    char port[6];   // Decimal port number
+};
+
+/* Everything that changes how a client's view is rendered
+ */
+struct ViewOptions
+{
+    double latitude; // Radians
+    double longitude;
+    float threshold;
+    float label_thresh;
+    int rows;
+    int cols;
+    bool color;
+    bool unicode;
+    bool braille;
+    bool braille_stars;
+    bool combine_stars;
+    bool grid;
+    bool constell;
+};
+
+struct ServerConf
+{
+    struct ServerAddress address;
+    struct ViewOptions defaults; // Options of clients that do not send any
+    double julian_date;          // Sky time when the server starts
+    float speed;                 // Sky time elapsed per real time
+    int fps;
+    double aspect_ratio; // Cell aspect ratio assumed for every client, 0 for the default
+    unsigned int max_clients;
+};
+
+/* Parse a listening address. Addresses containing a '/' are Unix socket paths,
+ * otherwise they are "<host>:<port>" or "<port>" for the loopback interface.
+ * Returns false if the address is malformed, or a path too long for a socket
+ * address on this platform (103 bytes on macOS and the BSDs, 107 on Linux)
+ */
+bool parse_server_address(const char *string, struct ServerAddress *address);
+
+/* Parse a client's option line into `options`, starting from `defaults`. On
+ * failure, returns false and writes a message to `error`
+ */
+bool parse_view_options(const char *request, const struct ViewOptions *defaults, struct ViewOptions *options,
+                        char *error, size_t error_size);
+
+/* Whether two clients can share one rendered frame
+ */
+bool same_view_options(const struct ViewOptions *a, const struct ViewOptions *b);
+
+/* Serve clients until interrupted. The sky's tables are updated for each view
+ * in turn. Returns false if the server could not be started
+ */
+bool run_server(const struct ServerConf *conf, struct Sky *sky);
+
+#endif // SERVER_H
@@ -0,0 +1,73 @@
+/* Everything drawn in the projection window, updated and rendered as one
+ *
+ * The interactive view and the sky server share these so every frontend draws
+ * the same sky for the same configuration.
+ */
+
+#ifndef SKY_H
+#define SKY_H
+
+#include "canvas.h"
+#include "constell_graph.h"
+#include "core.h"
+#include "core_render.h"
+#include "sky_index.h"
+
+#include <curses.h>
+#include <stdbool.h>
+
+/* Tables making up the sky. Nothing here is owned: the tables are generated and
+ * freed by the caller
+ */
+struct Sky
+{
+    struct Star *star_table;
+    unsigned int num_stars;
+    struct SkyIndex *sky_index;
+    struct ConstellGraph *constell_graph;
+    struct Planet *planet_table;
+    struct Moon *moon_object;
+};
+
+/* Private copy of a sky's star and planet tables, Moon and sky index, for a
+ * thread to position apart from the original. The constellation graph is only
+ * read, so it is shared. The copy points into itself and must not be moved
+ */
+struct SkyCopy
+{
+    struct Sky sky;
+    struct SkyIndex sky_index;
+    struct Moon moon;
+};
+
+/* Copy a sky. Returns false upon memory allocation error, after which the copy
+ * must still be freed
+ */
+bool copy_sky(struct SkyCopy *copy, const struct Sky *sky);
+
+void free_sky_copy(struct SkyCopy *copy);
+
+/* Update the positions of every object drawn by `render_sky` for the
+ * configuration's location at the given time
+ */
+void update_sky(struct Sky *sky, const struct Conf *config, double julian_date);
+
+/* Replace the contents of a window with the grid or cardinal directions,
+ * stars, constellations, planets and the Moon positioned by the last call to
+ * `update_sky`, each drawn over the ones before. Labels are moved around their
+ * symbols so that none overlap, fainter objects giving way to brighter ones,
+ * and left out where there is no room. With a compositor, which the caller
+ * keeps across frames, only the parts that changed since the last frame are
+ * drawn again and the window must not be modified in between. Without one, or
+ * if it cannot be allocated, everything is drawn directly
+ */
+void render_sky(WINDOW *win, const struct Conf *config, const struct Sky *sky, struct Compositor *compositor);
+
+/* Draw the same sky as `render_sky` into a canvas, all of it directly. The
+ * stars are binned and the labels placed in `stars` and `labels`, whose memory
+ * the caller keeps across frames
+ */
+void render_sky_canvas(struct Canvas *canvas, const struct Conf *config, const struct Sky *sky, struct StarBins *stars,
+                       struct LabelLayout *labels);
+
+#endif // SKY_H
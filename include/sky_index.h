@@ -0,0 +1,78 @@
+/* Hierarchical equal-area sky tiling used to cull and query the star table.
+ *
+ * Stars are binned into the pixels of a HEALPix grid using the NESTED
+ * numbering scheme, so the four children of tile `p` at order `k` are tiles
+ * `4p ... 4p + 3` at order `k + 1`, and every tile owns a contiguous run of
+ * `star_indices`. Within a leaf tile, stars are sorted by increasing magnitude
+ * (brightest first) so a magnitude threshold ends a scan early. Each tile also
+ * stores a bounding cap (center and angular radius) of its stars.
+ *
+ * Reference:   https://healpix.sourceforge.io/pdf/intro.pdf
+ *              Górski et al. 2005, ApJ 622, 759
+ */
+
+#ifndef SKY_INDEX_H
+#define SKY_INDEX_H
+
+#include "core.h"
+
+#include <stdbool.h>
+
+// Deepest supported leaf order (nside = 2^order)
+#define SKY_INDEX_MAX_ORDER 8
+
+struct SkyTile
+{
+    double x, y, z;     // Unit vector of the bounding cap center (equatorial)
+    double radius;      // Angular radius of the bounding cap (radians)
+    unsigned int first; // Offset of the tile's first star in `star_indices`
+    unsigned int count; // Number of stars in the tile and its descendants
+};
+
+struct SkyIndex
+{
+    int order;              // Order of the leaf level
+    struct SkyTile *tiles;  // Tiles of all levels, coarsest first
+    int *star_indices;      // Star table indices grouped by leaf tile
+    unsigned int num_stars; // Number of stars in the index
+    double max_motion;      // Largest proper motion of any star (radians/year)
+
+    // Per-frame results of `update_star_positions_indexed`
+    int *rank;                // Position of each star in `num_by_mag`
+    const int *num_by_mag;    // Catalog numbers sorted by decreasing magnitude
+    int *visible;             // Catalog numbers of stars above the horizon
+    unsigned int num_visible; // Number of entries in `visible`
+};
+
+/* Build a sky index over the star table. `num_by_mag` (see
+ * `star_numbers_by_magnitude`) must outlive the index. This function allocates
+ * memory which must be freed with `free_sky_index`. Returns false upon memory
+ * allocation error
+ */
+bool generate_sky_index(struct SkyIndex *index, const struct Star *star_table, unsigned int num_stars,
+                        const int *num_by_mag);
+
+void free_sky_index(struct SkyIndex *index);
+
+/* Return the nested HEALPix pixel of a direction given as a right ascension
+ * and declination
+ */
+unsigned int sky_index_pixel(int order, double right_ascension, double declination);
+
+/* Collect the table indices of stars brighter than `threshold` lying in tiles
+ * that intersect the cap centered on (right_ascension, declination) with
+ * angular radius `radius`. The result is a superset of the stars inside the cap
+ * which callers refine as needed. `margin` widens every tile to account for
+ * proper motion away from the catalog epoch. Returns the number of indices
+ * written to `out`, which is at most `max_out`
+ */
+unsigned int sky_index_query_cap(const struct SkyIndex *index, const struct Star *star_table, double right_ascension,
+                                 double declination, double radius, double margin, float threshold, int *out,
+                                 unsigned int max_out);
+
+/* Angular distance a star may have drifted from its catalog position by a
+ * given julian date
+ */
+double sky_index_motion_margin(const struct SkyIndex *index, double julian_date);
+
+#endif // SKY_INDEX_H
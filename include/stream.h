@@ -0,0 +1,84 @@
+/* Machine-readable output of the objects in every frame, for tools following
+ * the sky in real time.
+ *
+ * Each frame lists the stars, planets and moon above the horizon as positioned
+ * by `update_sky`, along with the cell each is drawn at in a projection window
+ * of the given size. A frame is formatted into a buffer allocated up front and
+ * written with a single write call.
+ *
+ * NDJSON output has one line per frame:
+ *
+ *      {"julian_date":2460677.50000000,"objects":[{"object":"star","id":424,
+ *       "azimuth":12.345678,"altitude":45.678901,"magnitude":2.02,"row":3,
+ *       "col":17},{"object":"planet","id":4,"name":"Mars",...},...]}
+ *
+ * where `id` is the BSC5 catalog number for stars and the `enum Planets` value
+ * for planets, and angles are in degrees. Binary output has a 16 byte header
+ * per frame:
+ *
+ *      char     magic[4];      // "ASTS"
+ *      uint32_t num_records;
+ *      double   julian_date;
+ *
+ * followed by one fixed-size record per object. All values are little-endian:
+ *
+ *      int32_t  id;
+ *      uint8_t  object;        // enum ObjectType
+ *      uint8_t  reserved[3];
+ *      float    azimuth;
+ *      float    altitude;
+ *      float    magnitude;
+ *      int16_t  row;           // -1 if outside the projection
+ *      int16_t  col;
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "sky.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define STREAM_BINARY_MAGIC "ASTS"
+#define STREAM_HEADER_SIZE 16
+#define STREAM_RECORD_SIZE 24
+
+enum StreamFormat
+{
+    STREAM_NDJSON = 0,
+    STREAM_BINARY
+};
+
+struct Stream
+{
+    int fd; // File descriptor frames are written to
+    enum StreamFormat format;
+    char *buffer;
+    size_t length;
+    size_t capacity;
+};
+
+/* Parse "ndjson" or "binary". Returns false for anything else
+ */
+bool parse_stream_format(const char *string, enum StreamFormat *format);
+
+/* Set up a stream writing to `fd`, with room for frames listing every star in a
+ * table of `num_stars`. This function allocates memory which must be freed with
+ * `free_stream`. Returns false upon memory allocation error
+ */
+bool generate_stream(struct Stream *stream, int fd, enum StreamFormat format, unsigned int num_stars);
+
+void free_stream(struct Stream *stream);
+
+/* Format the objects above the horizon after the last `update_sky` into the
+ * stream's buffer, projected into a window of `height` by `width` cells
+ */
+void stream_encode_frame(struct Stream *stream, const struct Sky *sky, double julian_date, int height, int width);
+
+/* Write the last encoded frame. Returns false upon write error, e.g. once the
+ * reading end of a pipe is closed
+ */
+bool stream_write_frame(struct Stream *stream);
+
+#endif // STREAM_H
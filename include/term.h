@@ -9,6 +9,10 @@
 #include <windows.h>
 #endif
 
+// Cell aspect ratio (font height to width) assumed for terminals that cannot be
+// queried for it, e.g. those of server clients or of frames rendered to files
+#define DEFAULT_CELL_ASPECT 2.0
+
 /* Initialize ncurses.h
  */
 void ncurses_init(bool color);
@@ -17,8 +21,35 @@ void ncurses_init(bool color);
  */
 void ncurses_kill(void);
 
+/* Initialize ncurses on a screen that is never displayed, for drawing windows
+ * and pads that are output some other way. Colors are always initialized when
+ * available. Returns NULL on failure
+ */
+SCREEN *ncurses_init_headless(void);
+
+/* Kill a screen from `ncurses_init_headless`
+ */
+void ncurses_kill_headless(SCREEN *screen);
+
 void wrectangle(WINDOW *win, int ya, int xa, int yb, int xb);
 
+/* Size of the square with largest possible area within `rows` by `cols` cells
+ * aspect: cell aspect ratio (font height to width)
+ */
+void fit_square(int rows, int cols, float aspect, int *height, int *width);
+
+/* The square with largest possible area within `rows` by `cols` cells, centered
+ * like the interactive view and at least one cell across. A non-positive
+ * `aspect` uses DEFAULT_CELL_ASPECT
+ */
+void centered_square(int rows, int cols, double aspect, int *top, int *left, int *height, int *width);
+
+/* Create a pad of `rows` by `cols` cells and a subpad of it for the square of
+ * `centered_square`. Returns false upon memory allocation error, after which
+ * both are NULL
+ */
+bool newpad_centered_square(int rows, int cols, double aspect, WINDOW **pad, WINDOW **square);
+
 /* Resize window to square with largest possible area
  * aspect: cell aspect ratio (font height to width)
  */
@@ -47,7 +78,8 @@ void term_size(int *y, int *x);
 float get_cell_aspect_ratio(void);
 
 /* Add string via mvwaddstr, but truncate text that does not fit in the window,
- * instead of having it wrap
+ * instead of having it wrap. Multibyte characters are kept whole and counted by
+ * their width in columns
  */
 void mvwaddstr_truncate(WINDOW *win, int y, int x, const char *str);
 
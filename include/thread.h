@@ -0,0 +1,90 @@
+/* Minimal portable threading on top of POSIX threads or the Win32 API
+ */
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+struct Thread
+{
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    void (*func)(void *arg);
+    void *arg;
+};
+
+struct Mutex
+{
+#ifdef _WIN32
+    CRITICAL_SECTION handle;
+#else
+    pthread_mutex_t handle;
+#endif
+};
+
+struct Condition
+{
+#ifdef _WIN32
+    CONDITION_VARIABLE handle;
+#else
+    pthread_cond_t handle;
+#endif
+};
+
+/* Start a thread running `func(arg)`. The struct must stay valid until the
+ * thread is joined. Returns false if the thread could not be started
+ */
+bool thread_create(struct Thread *thread, void (*func)(void *arg), void *arg);
+
+/* Wait for a thread to finish
+ */
+void thread_join(struct Thread *thread);
+
+/* Set up a mutex, which must be freed with `mutex_destroy`. Returns false if it
+ * could not be created
+ */
+bool mutex_init(struct Mutex *mutex);
+
+void mutex_destroy(struct Mutex *mutex);
+
+void mutex_lock(struct Mutex *mutex);
+
+void mutex_unlock(struct Mutex *mutex);
+
+/* Set up a condition variable, which must be freed with `condition_destroy`.
+ * Returns false if it could not be created
+ */
+bool condition_init(struct Condition *condition);
+
+void condition_destroy(struct Condition *condition);
+
+/* Atomically unlock `mutex` and wait until signaled, then lock it again. As
+ * wakeups may be spurious, callers wait in a loop checking their predicate
+ */
+void condition_wait(struct Condition *condition, struct Mutex *mutex);
+
+/* Wake one thread waiting on the condition, if any
+ */
+void condition_signal(struct Condition *condition);
+
+/* Number of logical processors available, at least 1
+ */
+unsigned int thread_hardware_concurrency(void);
+
+/* Run `task(index, data)` for every index in [0, count), each on its own
+ * thread, and wait for all of them. The calling thread runs index 0. Tasks
+ * whose thread cannot be started run on the calling thread instead
+ */
+void parallel_run(unsigned int count, void (*task)(unsigned int index, void *data), void *data);
+
+#endif // THREAD_H
@@ -0,0 +1,97 @@
+/* Ring buffer of precomputed sky positions for scrubbing back and forth in time.
+ *
+ * The display advances time in fixed steps, so frame `n` always shows
+ * `julian_date_start + n * step` and frames can be keyed by their number. Each
+ * slot holds a snapshot of everything `update_sky` computes for one frame:
+ * the stars above the horizon and their positions, the positions of
+ * constellation stars, planets and the Moon. Frame `n` lives in slot
+ * `n mod capacity`, so recent frames stay cached behind the playhead while a
+ * background thread fills slots ahead of it in the direction of playback.
+ * Rewinding, pausing or replaying a recent interval then restores snapshots
+ * instead of recomputing positions.
+ */
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "core.h"
+#include "sky.h"
+#include "sky_index.h"
+#include "thread.h"
+
+#include <stdbool.h>
+
+/* Snapshot of the sky at one frame, held in a slot of the timeline
+ */
+struct TimelineFrame
+{
+    long long frame; // Frame held, LLONG_MIN if none
+    unsigned int num_visible;
+    int *visible;      // Catalog numbers of stars above the horizon, as in `SkyIndex`
+    double *positions; // Azimuth and altitude of each visible star, then of each constellation vertex
+    double planet_positions[NUM_PLANETS][2];
+    double moon_position[2];
+    const char *moon_symbol;
+};
+
+struct Timeline
+{
+    struct Conf config;
+    double julian_date_start;
+    double step; // Days between frames
+    unsigned int capacity;
+    unsigned int depth; // Frames prefetched ahead of the playhead
+    unsigned int max_visible;
+    unsigned int num_vertices; // Constellation vertices stored per snapshot
+    struct TimelineFrame *slots;
+
+    // Tables the prefetch thread positions, copied from the displayed sky
+    struct SkyCopy copy;
+
+    // Shared with the prefetch thread
+    struct Thread prefetcher;
+    struct Mutex mutex;
+    struct Condition condition;
+    long long playhead;
+    int direction; // 1 when playing forward, -1 when playing backward
+    bool stop;
+};
+
+/* Number of frames to prefetch at a speed multiplier: half a second of
+ * playback, and another half second for every doubling of the speed, as fast
+ * playback is scrubbed over longer spans. At most half the ring so the
+ * frames just played stay cached
+ */
+unsigned int timeline_prefetch_depth(float speed, int fps, unsigned int capacity);
+
+/* Allocate `capacity` snapshots for the sky as configured and start the
+ * prefetch thread at frame 0. The sky's tables are copied. Must be freed with
+ * `free_timeline`. Returns false upon memory allocation error or if the thread
+ * could not be started
+ */
+bool generate_timeline(struct Timeline *timeline, const struct Conf *config, const struct Sky *sky,
+                       double julian_date_start, double step, unsigned int capacity, unsigned int depth);
+
+/* Stop the prefetch thread and free the snapshots
+ */
+void free_timeline(struct Timeline *timeline);
+
+/* Julian date shown at a frame
+ */
+double timeline_julian_date(const struct Timeline *timeline, long long frame);
+
+/* Copy the snapshot of a frame into the sky's tables, as if `update_sky` had
+ * run for it. Returns false, leaving the sky unchanged, if the frame is not
+ * cached
+ */
+bool timeline_restore(struct Timeline *timeline, long long frame, struct Sky *sky);
+
+/* Cache the positions `update_sky` computed for a frame
+ */
+void timeline_store(struct Timeline *timeline, long long frame, const struct Sky *sky);
+
+/* Move the playhead, prefetching frames after it in the given direction
+ */
+void timeline_seek(struct Timeline *timeline, long long frame, int direction);
+
+#endif // TIMELINE_H
@@ -0,0 +1,78 @@
+/* Batch visibility of every object for many observers at one time.
+ *
+ * Computing positions is split into a stage shared by every observer and a
+ * cheap per-observer transform. A snapshot holds the geocentric equatorial
+ * direction of each star, planet and the Moon at one julian date as unit
+ * vectors. An observer's view is then one rotation by their latitude and local
+ * sidereal time, applied over contiguous arrays of the snapshot's coordinates.
+ *
+ * Results match `update_star_positions`, `update_planet_positions` and
+ * `update_moon_position` for the same observer.
+ */
+
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include "core.h"
+
+#include <stdbool.h>
+
+struct Observer
+{
+    double latitude; // Radians
+    double longitude;
+};
+
+struct SkySnapshot
+{
+    double julian_date;
+    double gmst; // Greenwich mean sidereal time (radians)
+
+    // Objects in the order stars (table order), planets, Moon
+    unsigned int num_objects;
+    double *x; // Equatorial unit vectors
+    double *y;
+    double *z;
+    enum ObjectType *types;
+    int *indices; // Star table index, `enum Planets` value, or 0 for the Moon
+};
+
+struct VisibleObject
+{
+    enum ObjectType type;
+    int index; // As in `SkySnapshot.indices`
+    double azimuth;
+    double altitude;
+};
+
+/* Objects above the horizon for one observer, in snapshot order
+ */
+struct VisibilityList
+{
+    struct VisibleObject *objects;
+    unsigned int count;
+    unsigned int capacity;
+};
+
+/* Compute the shared stage: the direction of every star brighter than
+ * `threshold`, every planet except the Earth, and the Moon. This function
+ * allocates memory which must be freed with `free_sky_snapshot`. Returns false
+ * upon memory allocation error
+ */
+bool generate_sky_snapshot(struct SkySnapshot *snapshot, const struct Star *star_table, unsigned int num_stars,
+                           const struct Planet *planet_table, const struct Moon *moon_object, float threshold,
+                           double julian_date);
+
+void free_sky_snapshot(struct SkySnapshot *snapshot);
+
+/* Fill one list per observer with the objects of the snapshot above their
+ * horizon. `lists` must hold `num_observers` entries, zero initialized or
+ * reused from a previous call, and be freed with `free_visibility_lists`.
+ * Returns false upon memory allocation error
+ */
+bool compute_visibility(const struct SkySnapshot *snapshot, const struct Observer *observers, unsigned int num_observers,
+                        struct VisibilityList *lists);
+
+void free_visibility_lists(struct VisibilityList *lists, unsigned int num_observers);
+
+#endif // VISIBILITY_H
@@ -1,51 +1,129 @@
-import sys
-import os
+"""
+Embed a data file in the build as a single object.
+
+Two files are generated: a header declaring
+
+    extern const unsigned char <name>[];
+    extern const unsigned int <name>_len;
+
+and a source file defining them, which is compiled once into the library.
+The source file takes one of three forms, from cheapest to build to most
+portable:
+
+    - embed:  a C file using C23 `#embed`
+    - incbin: an assembly file (.S) using the `.incbin` directive
+    - hex:    a C file with the data spelled out as a hex array
+"""
+
 import argparse
+import os
+import sys
 
-def main():
-    # Argument parsing
-    parser = argparse.ArgumentParser(description="Generate a C header file with embedded binary data.")
-    parser.add_argument('--source', required=True, help="Path to the input binary file")
-    parser.add_argument('--header', required=True, help="Path to the output header file")
-    parser.add_argument('--array-name', required=True, help="Name of the C array")
+HEADER_TEMPLATE = """// Generated by scripts/embed.py. Do not edit.
 
-    args = parser.parse_args()
+#ifndef {guard}
+#define {guard}
 
-    input_file = args.source
-    output_file = args.header
-    array_name = args.array_name
+extern const unsigned char {name}[];
+extern const unsigned int {name}_len;
 
-    # Read the binary data from the input file
-    try:
-        with open(input_file, "rb") as f:
-            binary_data = f.read()
-    except FileNotFoundError:
-        print(f"Error: Input file '{input_file}' not found.")
-        sys.exit(1)
+#endif // {guard}
+"""
+
+EMBED_TEMPLATE = """// Generated by scripts/embed.py. Do not edit.
+
+const unsigned char {name}[] = {{
+#embed "{path}"
+}};
+const unsigned int {name}_len = sizeof({name});
+"""
 
-    # Generate the C array data (convert bytes to hex)
-    hex_data = ', '.join(f'0x{byte:02x}' for byte in binary_data)
+# Symbols carry a leading underscore on Mach-O and 32-bit Windows
+INCBIN_TEMPLATE = """// Generated by scripts/embed.py. Do not edit.
 
-    # Get the length of the array
-    array_length = len(binary_data)
+#if defined(__APPLE__) || (defined(_WIN32) && !defined(_WIN64))
+#define SYMBOL(name) _##name
+#else
+#define SYMBOL(name) name
+#endif
 
-    # Generate the C code content
-    c_code = f"""// Array length for {array_name}
-unsigned int {array_name}_len = {array_length};
+#if defined(__APPLE__)
+    .const_data
+#elif defined(_WIN32)
+    .section .rdata,"dr"
+#else
+    .section .rodata
+#endif
 
-unsigned char {array_name}[] = {{
-    {hex_data}
+    .globl SYMBOL({name})
+    .balign 16
+SYMBOL({name}):
+    .incbin "{path}"
+
+    .globl SYMBOL({name}_len)
+    .balign 4
+SYMBOL({name}_len):
+    .long {length}
+
+#if defined(__ELF__)
+    .section .note.GNU-stack,"",%progbits
+#endif
+"""
+
+HEX_TEMPLATE = """// Generated by scripts/embed.py. Do not edit.
+
+const unsigned char {name}[] = {{
+{data}
 }};
+const unsigned int {name}_len = {length};
 """
 
-    # Write the C code to the output file
+
+def escape_path(path: str) -> str:
+    return path.replace("\\", "/").replace('"', '\\"')
+
+
+def generate_source(mode, name, source, data):
+    path = escape_path(os.path.abspath(source))
+    if mode == "embed":
+        return EMBED_TEMPLATE.format(name=name, path=path)
+    if mode == "incbin":
+        return INCBIN_TEMPLATE.format(name=name, path=path, length=len(data))
+
+    # An empty array is not valid C
+    values = [f"0x{byte:02x}" for byte in data] or ["0x00"]
+    lines = ["    " + ", ".join(values[i : i + 16]) + "," for i in range(0, len(values), 16)]
+    return HEX_TEMPLATE.format(name=name, data="\n".join(lines), length=len(data))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Embed a data file as a single object.")
+    parser.add_argument("--source", required=True, help="Path to the input data file")
+    parser.add_argument("--header", required=True, help="Path to the output header file")
+    parser.add_argument("--output", required=True, help="Path to the output C or assembly file")
+    parser.add_argument("--array-name", required=True, help="Name of the C array")
+    parser.add_argument("--mode", choices=["embed", "incbin", "hex"], default="hex", help="How to embed the data")
+    args = parser.parse_args()
+
     try:
-        with open(output_file, "w") as f:
-            f.write(c_code)
-        print(f"Successfully generated {output_file} with array name '{array_name}' and length '{array_name}_len'")
-    except IOError as e:
-        print(f"Error writing to output file '{output_file}': {e}")
+        with open(args.source, "rb") as f:
+            data = f.read()
+    except OSError as e:
+        print(f"Error reading '{args.source}': {e}")
         sys.exit(1)
 
+    guard = args.array_name.upper() + "_H"
+    try:
+        with open(args.header, "w", newline="\n") as f:
+            f.write(HEADER_TEMPLATE.format(guard=guard, name=args.array_name))
+        with open(args.output, "w", newline="\n") as f:
+            f.write(generate_source(args.mode, args.array_name, args.source, data))
+    except OSError as e:
+        print(f"Error writing output files: {e}")
+        sys.exit(1)
+
+    print(f"Successfully embedded '{args.source}' as '{args.array_name}' ({args.mode}, {len(data)} bytes)")
+
+
 if __name__ == "__main__":
     main()
@@ -0,0 +1,351 @@
+"""
+Generate a C header containing a precomputed lookup index over data/cities.csv.
+
+The header defines:
+    - `city_table`: every city as a `CityData` record, sorted by normalized name
+    - `city_hash_table`: an open addressing hash table mapping normalized names to
+      the most populous city with that name (ties go to the first in the CSV)
+    - `city_fold_table`: ASCII spellings of accented Latin characters, used to
+      fold names for fuzzy search
+    - `city_trigram_*`: an inverted index from trigrams of folded names to the
+      cities returned by `get_city`, used for fuzzy search
+    - `city_kd_*`: an implicit k-d tree over the cities' positions as unit
+      vectors, used for nearest city lookups
+
+Names are normalized exactly as `normalize_city_name` in src/city.c does (trim
+whitespace and lowercase ASCII letters), and hashed with 32-bit FNV-1a, which
+must match `hash_city_name` in src/city.c.
+"""
+
+import argparse
+import csv
+import math
+import sys
+import unicodedata
+
+FNV_OFFSET = 0x811C9DC5
+FNV_PRIME = 0x01000193
+
+# Characters stripped by C's isspace() in the "C" locale
+C_WHITESPACE = b" \t\n\v\f\r"
+
+
+def normalize(name: str) -> bytes:
+    """Trim whitespace and lowercase ASCII letters, byte for byte like city.c"""
+    raw = name.encode("utf-8").strip(C_WHITESPACE)
+    return bytes(b + 32 if 65 <= b <= 90 else b for b in raw)
+
+
+def fnv1a(data: bytes) -> int:
+    h = FNV_OFFSET
+    for b in data:
+        h ^= b
+        h = (h * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+# Code points given an ASCII spelling when folding. Anything else that is not an
+# ASCII letter or digit separates words
+FOLD_RANGES = [(0x80, 0x24F), (0x300, 0x36F), (0x1E00, 0x1EFF)]
+
+# Letters without a decomposition into ASCII
+FOLD_SPECIAL = {
+    "ß": "ss",
+    "æ": "ae",
+    "œ": "oe",
+    "ø": "o",
+    "ł": "l",
+    "đ": "d",
+    "ð": "d",
+    "þ": "th",
+    "ı": "i",
+    "ħ": "h",
+    "ŧ": "t",
+    "ŋ": "n",
+    "ŀ": "l",
+}
+
+# Trigrams are made of spaces, ASCII letters and digits
+TRIGRAM_ALPHABET = " abcdefghijklmnopqrstuvwxyz0123456789"
+
+
+def fold_code_point(ch: str):
+    """ASCII spelling of a character, "" if it is dropped, or None if it
+    separates words. Must match `fold_city_name` in src/city.c"""
+    if ch.isascii():
+        lower = ch.lower()
+        return lower if lower.isalnum() else None
+    if unicodedata.combining(ch):
+        return ""
+    lower = ch.lower()
+    if len(lower) != 1:
+        # e.g. "İ" lowercases to "i" + combining dot
+        lower = lower[0]
+    decomposed = unicodedata.normalize("NFKD", FOLD_SPECIAL.get(lower, lower))
+    folded = "".join(c for c in decomposed if c.isascii() and c.isalnum()).lower()
+    return folded if folded else None
+
+
+def build_fold_table():
+    table = []
+    for first, last in FOLD_RANGES:
+        for cp in range(first, last + 1):
+            folded = fold_code_point(chr(cp))
+            if folded is not None:
+                table.append((cp, folded))
+    return table
+
+
+def fold(name: str) -> str:
+    """Fold a name to lowercase ASCII words separated by single spaces"""
+    words = []
+    word = ""
+    for ch in name:
+        cp = ord(ch)
+        folded = fold_code_point(ch) if ch.isascii() or any(a <= cp <= b for a, b in FOLD_RANGES) else None
+        if folded is None:
+            if word:
+                words.append(word)
+            word = ""
+        else:
+            word += folded
+    if word:
+        words.append(word)
+    return " ".join(words)
+
+
+def trigrams(folded: str):
+    """Distinct trigram ids of a folded name padded with spaces"""
+    padded = "  " + folded + " "
+    ids = set()
+    for i in range(len(padded) - 2):
+        a, b, c = (TRIGRAM_ALPHABET.index(ch) for ch in padded[i : i + 3])
+        ids.add((a * len(TRIGRAM_ALPHABET) + b) * len(TRIGRAM_ALPHABET) + c)
+    return ids
+
+
+def c_string(data: bytes) -> str:
+    """Encode bytes as a C string literal, escaping anything non-printable"""
+    out = []
+    for b in data:
+        if b in (ord('"'), ord("\\")):
+            out.append("\\" + chr(b))
+        elif 32 <= b < 127:
+            out.append(chr(b))
+        else:
+            # Octal escapes never absorb following characters past three digits
+            out.append("\\%03o" % b)
+    return '"' + "".join(out) + '"'
+
+
+def c_float(value) -> str:
+    """Format a number or decimal string as a C float literal"""
+    text = "%.9g" % float(value)
+    if "." not in text and "e" not in text:
+        text += ".0"
+    return text + "f"
+
+
+def read_cities(path):
+    cities = []
+    with open(path, "r", encoding="utf-8", newline="") as f:
+        reader = csv.reader(f)
+        next(reader)  # Skip header
+        for row in reader:
+            if len(row) < 6 or not row[0]:
+                continue
+            name, population, country_code, timezone, latitude, longitude = row[:6]
+            cities.append(
+                {
+                    "name": name,
+                    "normalized": normalize(name),
+                    "folded": fold(name),
+                    "population": int(population),
+                    "country_code": country_code,
+                    "timezone": timezone,
+                    "latitude": latitude,
+                    "longitude": longitude,
+                }
+            )
+    return cities
+
+
+def best_cities(cities):
+    """Best (most populous, first on ties) city index for each normalized name"""
+    best = {}
+    for i, city in enumerate(cities):
+        key = city["normalized"]
+        if key not in best or city["population"] > cities[best[key]]["population"]:
+            best[key] = i
+    return best
+
+
+def build_hash_table(cities):
+    best = best_cities(cities)
+
+    size = 1
+    while size < 2 * len(best):
+        size *= 2
+
+    table = [-1] * size
+    for key, i in best.items():
+        slot = fnv1a(key) & (size - 1)
+        while table[slot] != -1:
+            slot = (slot + 1) & (size - 1)
+        table[slot] = i
+
+    return table
+
+
+def build_trigram_index(cities):
+    postings = {}
+    for i in sorted(best_cities(cities).values()):
+        for trigram in trigrams(cities[i]["folded"]):
+            postings.setdefault(trigram, []).append(i)
+    return sorted(postings.items())
+
+
+def unit_vector(city):
+    lat = math.radians(float(city["latitude"]))
+    lon = math.radians(float(city["longitude"]))
+    return (math.cos(lat) * math.cos(lon), math.cos(lat) * math.sin(lon), math.sin(lat))
+
+
+def build_kd_tree(cities):
+    """Lay out city indices as an implicit k-d tree: the node of the range
+    [lo, hi) is at mid = (lo + hi) // 2, its children are [lo, mid) and
+    [mid + 1, hi), and it splits along the axis of greatest spread"""
+    points = [unit_vector(c) for c in cities]
+    order = list(range(len(cities)))
+    axes = [0] * len(cities)
+
+    def build(lo, hi):
+        if hi - lo <= 0:
+            return
+        spans = [max(points[i][a] for i in order[lo:hi]) - min(points[i][a] for i in order[lo:hi]) for a in range(3)]
+        axis = spans.index(max(spans))
+        order[lo:hi] = sorted(order[lo:hi], key=lambda i: (points[i][axis], i))
+        mid = (lo + hi) // 2
+        axes[mid] = axis
+        build(lo, mid)
+        build(mid + 1, hi)
+
+    build(0, len(order))
+    return order, axes, [points[i] for i in order]
+
+
+def emit_array(lines, declaration, values, per_line=16):
+    lines.append(declaration + " = {")
+    for start in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(str(v) for v in values[start : start + per_line]) + ",")
+    lines.append("};")
+    lines.append("")
+
+
+def generate_header(cities, table, fold_table, trigram_index, kd_tree):
+    lines = [
+        "// Generated by scripts/gen_city_index.py. Do not edit.",
+        "",
+        "#ifndef CITY_INDEX_H",
+        "#define CITY_INDEX_H",
+        "",
+        '#include "city.h"',
+        "",
+        f"#define CITY_COUNT {len(cities)}",
+        f"#define CITY_HASH_SIZE {len(table)}",
+        f"#define CITY_NAME_MAX {max(len(c['normalized']) for c in cities) + 1}",
+        "",
+        "static const CityData city_table[CITY_COUNT] = {",
+    ]
+
+    for city in cities:
+        lines.append(
+            "    {{{}, {}, {}, {}, {}, {}, {}}},".format(
+                c_string(city["name"].encode("utf-8")),
+                c_string(city["normalized"]),
+                c_string(city["country_code"].encode("utf-8")),
+                c_string(city["timezone"].encode("utf-8")),
+                city["population"],
+                c_float(city["latitude"]),
+                c_float(city["longitude"]),
+            )
+        )
+
+    lines.append("};")
+    lines.append("")
+    emit_array(lines, "static const int city_hash_table[CITY_HASH_SIZE]", table)
+
+    lines.append(f"#define CITY_FOLD_COUNT {len(fold_table)}")
+    lines.append("")
+    lines.append("static const struct")
+    lines.append("{")
+    lines.append("    unsigned int code_point;")
+    lines.append("    const char *ascii;")
+    lines.append("} city_fold_table[CITY_FOLD_COUNT] = {")
+    for cp, folded in fold_table:
+        lines.append(f'    {{0x{cp:04X}, "{folded}"}},')
+    lines.append("};")
+    lines.append("")
+
+    lines.append(f"#define CITY_TRIGRAM_COUNT {len(trigram_index)}")
+    lines.append("")
+    emit_array(
+        lines,
+        "static const unsigned char city_trigram_counts[CITY_COUNT]",
+        [len(trigrams(c["folded"])) for c in cities],
+    )
+    emit_array(lines, "static const unsigned short city_trigram_keys[CITY_TRIGRAM_COUNT]", [k for k, _ in trigram_index])
+    offsets = [0]
+    for _, posting in trigram_index:
+        offsets.append(offsets[-1] + len(posting))
+    emit_array(lines, "static const int city_trigram_offsets[CITY_TRIGRAM_COUNT + 1]", offsets)
+    emit_array(
+        lines,
+        f"static const int city_trigram_postings[{offsets[-1]}]",
+        [i for _, posting in trigram_index for i in posting],
+    )
+
+    kd_order, kd_axes, kd_points = kd_tree
+    emit_array(lines, "static const int city_kd_order[CITY_COUNT]", kd_order)
+    emit_array(lines, "static const unsigned char city_kd_axes[CITY_COUNT]", kd_axes, per_line=32)
+    lines.append("static const float city_kd_points[CITY_COUNT][3] = {")
+    for x, y, z in kd_points:
+        lines.append(f"    {{{c_float(x)}, {c_float(y)}, {c_float(z)}}},")
+    lines.append("};")
+    lines.append("")
+
+    lines.append("#endif // CITY_INDEX_H")
+    lines.append("")
+
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a C header with a precomputed city lookup index.")
+    parser.add_argument("--source", required=True, help="Path to cities.csv")
+    parser.add_argument("--header", required=True, help="Path to the output header file")
+    args = parser.parse_args()
+
+    try:
+        cities = read_cities(args.source)
+    except (OSError, ValueError) as e:
+        print(f"Error reading '{args.source}': {e}")
+        sys.exit(1)
+
+    # Sort by normalized name, keeping CSV order between equal names
+    cities.sort(key=lambda c: c["normalized"])
+    table = build_hash_table(cities)
+    trigram_index = build_trigram_index(cities)
+
+    try:
+        with open(args.header, "w", encoding="utf-8", newline="\n") as f:
+            f.write(generate_header(cities, table, build_fold_table(), trigram_index, build_kd_tree(cities)))
+    except OSError as e:
+        print(f"Error writing to output file '{args.header}': {e}")
+        sys.exit(1)
+
+    print(f"Successfully generated {args.header} with {len(cities)} cities")
+
+
+if __name__ == "__main__":
+    main()
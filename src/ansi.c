@@ -0,0 +1,307 @@
+#include "ansi.h"
+
+#include "macros.h"
+
+#include <curses.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+// Style of a cell before anything was written, forcing the first SGR sequence
+#define STYLE_UNKNOWN -2
+
+bool generate_ansi_frame(struct AnsiFrame *frame, int rows, int cols)
+{
+    frame->rows = rows;
+    frame->cols = cols;
+    frame->cells = malloc((size_t)MAX(1, rows * cols) * sizeof(struct AnsiCell));
+    if (frame->cells == NULL)
+    {
+        printf("Allocation of memory for ANSI frame failed\n");
+        return false;
+    }
+
+    for (int i = 0; i < rows * cols; ++i)
+    {
+        frame->cells[i] = (struct AnsiCell){.text = " ", .color = -1, .attrs = 0};
+    }
+
+    return true;
+}
+
+void free_ansi_frame(struct AnsiFrame *frame)
+{
+    free(frame->cells);
+    frame->cells = NULL;
+    frame->rows = 0;
+    frame->cols = 0;
+}
+
+/* Encode a code point as UTF-8. Returns the number of bytes written to
+ * `buffer`, or 0 if it does not fit in `size` bytes
+ */
+static size_t encode_utf8(unsigned long code_point, char *buffer, size_t size)
+{
+    unsigned char *out = (unsigned char *)buffer;
+
+    if (code_point > 0x10FFFF)
+    {
+        code_point = 0xFFFD; // Replacement character
+    }
+
+    if (code_point < 0x80 && size >= 1)
+    {
+        out[0] = (unsigned char)code_point;
+        return 1;
+    }
+    if (code_point < 0x800 && size >= 2)
+    {
+        out[0] = (unsigned char)(0xC0 | (code_point >> 6));
+        out[1] = (unsigned char)(0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    if (code_point < 0x10000 && size >= 3)
+    {
+        out[0] = (unsigned char)(0xE0 | (code_point >> 12));
+        out[1] = (unsigned char)(0x80 | ((code_point >> 6) & 0x3F));
+        out[2] = (unsigned char)(0x80 | (code_point & 0x3F));
+        return 3;
+    }
+    if (code_point >= 0x10000 && size >= 4)
+    {
+        out[0] = (unsigned char)(0xF0 | (code_point >> 18));
+        out[1] = (unsigned char)(0x80 | ((code_point >> 12) & 0x3F));
+        out[2] = (unsigned char)(0x80 | ((code_point >> 6) & 0x3F));
+        out[3] = (unsigned char)(0x80 | (code_point & 0x3F));
+        return 4;
+    }
+    return 0;
+}
+
+void ansi_frame_capture(struct AnsiFrame *frame, WINDOW *win)
+{
+    int height, width;
+    getmaxyx(win, height, width);
+    int rows = MIN(height, frame->rows);
+    int cols = MIN(width, frame->cols);
+
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+        {
+            struct AnsiCell *cell = &frame->cells[y * frame->cols + x];
+
+            cchar_t cch;
+            wchar_t wch[CCHARW_MAX + 1] = {0};
+            attr_t attrs = 0;
+            short pair = 0;
+            if (mvwin_wch(win, y, x, &cch) == ERR || getcchar(&cch, wch, &attrs, &pair, NULL) == ERR)
+            {
+                *cell = (struct AnsiCell){.text = " ", .color = -1, .attrs = 0};
+                continue;
+            }
+
+            size_t length = 0;
+            for (int i = 0; i < CCHARW_MAX && wch[i] != L'\0'; ++i)
+            {
+                length += encode_utf8((unsigned long)wch[i], &cell->text[length], ANSI_CELL_TEXT_SIZE - 1 - length);
+            }
+            if (length == 0)
+            {
+                cell->text[length++] = ' ';
+            }
+            cell->text[length] = '\0';
+
+            short foreground = -1, background = -1;
+            if (pair != 0 && pair_content(pair, &foreground, &background) == ERR)
+            {
+                foreground = -1;
+            }
+            cell->color = foreground;
+            cell->attrs = (unsigned char)(((attrs & A_BOLD) ? ANSI_BOLD : 0) | ((attrs & A_DIM) ? ANSI_DIM : 0));
+
+            // The column covered by a wide character is left empty
+            if (wcwidth(wch[0]) == 2 && x + 1 < cols)
+            {
+                ++x;
+                struct AnsiCell *next = &frame->cells[y * frame->cols + x];
+                *next = (struct AnsiCell){.text = "", .color = cell->color, .attrs = cell->attrs};
+            }
+        }
+    }
+}
+
+bool ansi_buffer_append(struct AnsiBuffer *buffer, const char *data, size_t length)
+{
+    if (buffer->length + length > buffer->capacity)
+    {
+        size_t capacity = MAX(MAX(buffer->capacity * 2, buffer->length + length), 256);
+        char *resized = realloc(buffer->data, capacity);
+        if (resized == NULL)
+        {
+            return false;
+        }
+        buffer->data = resized;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(&buffer->data[buffer->length], data, length);
+    buffer->length += length;
+    return true;
+}
+
+void free_ansi_buffer(struct AnsiBuffer *buffer)
+{
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+static bool append_string(struct AnsiBuffer *buffer, const char *string)
+{
+    return ansi_buffer_append(buffer, string, strlen(string));
+}
+
+static bool same_cell(const struct AnsiCell *a, const struct AnsiCell *b)
+{
+    return a->color == b->color && a->attrs == b->attrs && strcmp(a->text, b->text) == 0;
+}
+
+static bool is_blank(const struct AnsiCell *cell)
+{
+    return cell->color == -1 && cell->attrs == 0 && strcmp(cell->text, " ") == 0;
+}
+
+static bool append_style(struct AnsiBuffer *buffer, const struct AnsiCell *cell)
+{
+    char sgr[32];
+    int length = snprintf(sgr, sizeof(sgr), "\x1b[0");
+
+    if (cell->attrs & ANSI_BOLD)
+    {
+        length += snprintf(&sgr[length], sizeof(sgr) - length, ";1");
+    }
+    if (cell->attrs & ANSI_DIM)
+    {
+        length += snprintf(&sgr[length], sizeof(sgr) - length, ";2");
+    }
+    if (cell->color >= 0 && cell->color < 8)
+    {
+        length += snprintf(&sgr[length], sizeof(sgr) - length, ";%d", 30 + cell->color);
+    }
+    else if (cell->color >= 8)
+    {
+        length += snprintf(&sgr[length], sizeof(sgr) - length, ";38;5;%d", cell->color);
+    }
+    length += snprintf(&sgr[length], sizeof(sgr) - length, "m");
+
+    return ansi_buffer_append(buffer, sgr, (size_t)length);
+}
+
+bool ansi_encode_frame(struct AnsiBuffer *buffer, const struct AnsiFrame *prev, const struct AnsiFrame *next)
+{
+    bool full = prev == NULL || prev->rows != next->rows || prev->cols != next->cols;
+
+    bool ok = true;
+    if (full)
+    {
+        // Reset the style, hide the cursor and clear the screen
+        ok = append_string(buffer, "\x1b[0m\x1b[?25l\x1b[2J");
+    }
+
+    // Cursor position is unknown until the first move
+    int cursor_y = -1;
+    int cursor_x = -1;
+    short color = STYLE_UNKNOWN;
+    unsigned char attrs = 0;
+
+    for (int y = 0; y < next->rows && ok; ++y)
+    {
+        for (int x = 0; x < next->cols && ok; ++x)
+        {
+            const struct AnsiCell *cell = &next->cells[y * next->cols + x];
+
+            // The second column of a wide character is drawn with the first
+            if (cell->text[0] == '\0')
+            {
+                continue;
+            }
+
+            if (full ? is_blank(cell) : same_cell(cell, &prev->cells[y * prev->cols + x]))
+            {
+                continue;
+            }
+
+            if (y != cursor_y || x != cursor_x)
+            {
+                char move[32];
+                int length = snprintf(move, sizeof(move), "\x1b[%d;%dH", y + 1, x + 1);
+                ok = ansi_buffer_append(buffer, move, (size_t)length);
+            }
+
+            if (cell->color != color || cell->attrs != attrs)
+            {
+                ok = ok && append_style(buffer, cell);
+                color = cell->color;
+                attrs = cell->attrs;
+            }
+
+            ok = ok && append_string(buffer, cell->text);
+
+            bool wide = x + 1 < next->cols && next->cells[y * next->cols + x + 1].text[0] == '\0';
+            cursor_y = y;
+            cursor_x = x + (wide ? 2 : 1);
+        }
+    }
+
+    return ok;
+}
+
+bool ansi_encode_lines(struct AnsiBuffer *buffer, const struct AnsiFrame *frame, bool styled)
+{
+    bool ok = true;
+
+    for (int y = 0; y < frame->rows && ok; ++y)
+    {
+        const struct AnsiCell *row = &frame->cells[y * frame->cols];
+
+        int end = frame->cols;
+        while (end > 0 && (is_blank(&row[end - 1]) || (!styled && strcmp(row[end - 1].text, " ") == 0)))
+        {
+            --end;
+        }
+
+        short color = -1;
+        unsigned char attrs = 0;
+
+        for (int x = 0; x < end && ok; ++x)
+        {
+            const struct AnsiCell *cell = &row[x];
+
+            // The second column of a wide character is drawn with the first
+            if (cell->text[0] == '\0')
+            {
+                continue;
+            }
+
+            if (styled && (cell->color != color || cell->attrs != attrs))
+            {
+                ok = append_style(buffer, cell);
+                color = cell->color;
+                attrs = cell->attrs;
+            }
+
+            ok = ok && append_string(buffer, cell->text);
+        }
+
+        if (color != -1 || attrs != 0)
+        {
+            ok = ok && append_string(buffer, "\x1b[0m");
+        }
+        ok = ok && append_string(buffer, "\n");
+    }
+
+    return ok;
+}
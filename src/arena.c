@@ -0,0 +1,51 @@
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool arena_init(struct Arena *arena, size_t size)
+{
+    arena->base = malloc(size > 0 ? size : 1);
+    arena->size = size;
+    arena->used = 0;
+    return arena->base != NULL;
+}
+
+void arena_free(struct Arena *arena)
+{
+    free(arena->base);
+    arena->base = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+void *arena_alloc(struct Arena *arena, size_t size, size_t align)
+{
+    // Align the address rather than the offset, since malloc only guarantees
+    // alignment suitable for standard types
+    uintptr_t address = (uintptr_t)(arena->base + arena->used);
+    size_t padding = (align - (address & (align - 1))) & (align - 1);
+
+    if (padding > arena->size - arena->used || size > arena->size - arena->used - padding)
+    {
+        return NULL;
+    }
+
+    void *result = arena->base + arena->used + padding;
+    arena->used += padding + size;
+    return result;
+}
+
+char *arena_strndup(struct Arena *arena, const char *str, size_t length)
+{
+    char *result = arena_alloc(arena, length + 1, 1);
+    if (result == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(result, str, length);
+    result[length] = '\0';
+    return result;
+}
@@ -66,6 +66,40 @@ double greenwich_mean_sidereal_time_rad(double jd)
     return gmst;
 }
 
+/* Time in days for the hour angle of a fixed body to advance from
+ * `hour_angle` to `target`
+ */
+static double sidereal_time_until(double hour_angle, double target)
+{
+    // Rate of the Earth's rotation (IERS Technical Note No. 32: 5.4.4 eq. 14)
+    const double sidereal_day = 1.0 / 1.00273781191135448;
+    return norm_rad(target - hour_angle) / (2.0 * M_PI) * sidereal_day;
+}
+
+void calc_rise_transit_set_fixed(double right_ascension, double declination, double latitude, double longitude,
+                                 double horizon, double julian_date, struct RiseTransitSet *events)
+{
+    // Astronomical Algorithms, Jean Meeus, eq. 15.1
+    double hour_angle = greenwich_mean_sidereal_time_rad(julian_date) + longitude - right_ascension;
+    double cos_h0 = (sin(horizon) - sin(latitude) * sin(declination)) / (cos(latitude) * cos(declination));
+
+    events->transit = julian_date + sidereal_time_until(hour_angle, 0.0);
+
+    if (cos_h0 < -1.0 || cos_h0 > 1.0)
+    {
+        events->kind = cos_h0 < -1.0 ? RISE_SET_CIRCUMPOLAR : RISE_SET_NEVER_RISES;
+        events->rise = NAN;
+        events->set = NAN;
+        return;
+    }
+
+    // Hour angle at setting; the body rises at the opposite hour angle
+    double h0 = acos(cos_h0);
+    events->kind = RISE_SET_NORMAL;
+    events->rise = julian_date + sidereal_time_until(hour_angle, -h0);
+    events->set = julian_date + sidereal_time_until(hour_angle, h0);
+}
+
 double datetime_to_julian_date(const struct tm *time)
 {
     // Convert ISO C tm struct to Gregorian datetime format
@@ -442,23 +476,14 @@ const char *get_moon_phase_name(enum MoonPhase phase)
     return phase_names[phase];
 }
 
-/* Remove variant selector from emoji
- */
-const char *normalize_emoji(const char *emoji)
-{
-    static char normalized[5];
-    strncpy(normalized, emoji, 4);
-    normalized[4] = '\0';
-    return normalized;
-}
-
 const char *get_moon_phase_image(enum MoonPhase phase, bool northern)
 {
     // Moon phases throughout the synodic month *as seen from the Northern
-    // hemisphere*
+    // hemisphere*, without variation selectors. These are shared rather than
+    // copied into a buffer, so threads positioning the Moon don't race
     // FIXME: clang-format on CI fails on this line for some reason
     // clang-format off
-    static const char *moon_phases[8] = {"🌑︎", "🌒︎", "🌓︎", "🌔︎", "🌕︎", "🌖︎", "🌗︎", "🌘︎"};
+    static const char *moon_phases[8] = {"🌑", "🌒", "🌓", "🌔", "🌕", "🌖", "🌗", "🌘"};
     // clang-format on
 
     // If we are in the Southern hemisphere, negate the index to move in the
@@ -469,7 +494,7 @@ const char *get_moon_phase_image(enum MoonPhase phase, bool northern)
         phase = 8 - phase;
     }
 
-    return normalize_emoji(moon_phases[phase]);
+    return moon_phases[phase];
 }
 
 void decimal_to_dms(double decimal_value, int *degrees, int *minutes, double *seconds)
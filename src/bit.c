@@ -108,3 +108,43 @@ bool bytes_to_bool32_LE(const uint8_t *buffer)
     int result = bytes_to_int32_LE(buffer);
     return (result != 0);
 }
+
+// Writing
+
+void uint16_to_bytes_LE(uint16_t value, uint8_t *buffer)
+{
+    for (size_t i = 0; i < sizeof(uint16_t); ++i)
+    {
+        buffer[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+void uint32_to_bytes_LE(uint32_t value, uint8_t *buffer)
+{
+    for (size_t i = 0; i < sizeof(uint32_t); ++i)
+    {
+        buffer[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+void uint64_to_bytes_LE(uint64_t value, uint8_t *buffer)
+{
+    for (size_t i = 0; i < sizeof(uint64_t); ++i)
+    {
+        buffer[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+void float32_to_bytes_LE(float value, uint8_t *buffer)
+{
+    uint32_t tempInt;
+    memcpy(&tempInt, &value, sizeof(float));
+    uint32_to_bytes_LE(tempInt, buffer);
+}
+
+void double64_to_bytes_LE(double value, uint8_t *buffer)
+{
+    uint64_t tempInt;
+    memcpy(&tempInt, &value, sizeof(double));
+    uint64_to_bytes_LE(tempInt, buffer);
+}
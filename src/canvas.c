@@ -0,0 +1,473 @@
+#include "canvas.h"
+
+#include "ansi.h"
+#include "macros.h"
+
+#include <curses.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+// Color pairs set up by `ncurses_init`
+#define NUM_COLOR_PAIRS 8
+
+static unsigned char window_braille[BRAILLE_LAYER_ROWS][BRAILLE_LAYER_COLS];
+
+struct Canvas window_canvas(WINDOW *win)
+{
+    return (struct Canvas){.win = win};
+}
+
+static void blank_cell(struct CanvasCell *cell)
+{
+    *cell = (struct CanvasCell){.text = " "};
+}
+
+bool generate_cell_canvas(struct Canvas *canvas, int rows, int cols)
+{
+    *canvas = (struct Canvas){.rows = rows, .cols = cols, .height = rows, .width = cols};
+
+    size_t num_cells = (size_t)MAX(1, rows * cols);
+    canvas->cells = malloc(num_cells * sizeof(struct CanvasCell));
+    canvas->braille = calloc(num_cells, 1);
+    if (canvas->cells == NULL || canvas->braille == NULL)
+    {
+        printf("Allocation of memory for canvas failed\n");
+        free_canvas(canvas);
+        return false;
+    }
+
+    for (size_t i = 0; i < num_cells; ++i)
+    {
+        blank_cell(&canvas->cells[i]);
+    }
+    return true;
+}
+
+struct Canvas canvas_region(const struct Canvas *canvas, int top, int left, int height, int width)
+{
+    struct Canvas region = *canvas;
+    region.top = canvas->top + top;
+    region.left = canvas->left + left;
+    region.height = height;
+    region.width = width;
+    region.y = 0;
+    region.x = 0;
+    region.color_pair = 0;
+    return region;
+}
+
+void free_canvas(struct Canvas *canvas)
+{
+    free(canvas->cells);
+    free(canvas->braille);
+    canvas->cells = NULL;
+    canvas->braille = NULL;
+}
+
+void canvas_size(const struct Canvas *canvas, int *height, int *width)
+{
+    if (canvas->win != NULL)
+    {
+        getmaxyx(canvas->win, *height, *width);
+        return;
+    }
+    *height = canvas->height;
+    *width = canvas->width;
+}
+
+static struct CanvasCell *region_cell(const struct Canvas *canvas, int y, int x)
+{
+    return &canvas->cells[(size_t)(canvas->top + y) * canvas->cols + canvas->left + x];
+}
+
+void canvas_erase(struct Canvas *canvas)
+{
+    if (canvas->win != NULL)
+    {
+        werase(canvas->win);
+        return;
+    }
+
+    for (int y = 0; y < canvas->height; ++y)
+    {
+        for (int x = 0; x < canvas->width; ++x)
+        {
+            blank_cell(region_cell(canvas, y, x));
+        }
+    }
+}
+
+void canvas_color_on(struct Canvas *canvas, short pair)
+{
+    if (canvas->win != NULL)
+    {
+        wattron(canvas->win, COLOR_PAIR(pair));
+        return;
+    }
+    canvas->color_pair = pair;
+}
+
+void canvas_color_off(struct Canvas *canvas, short pair)
+{
+    if (canvas->win != NULL)
+    {
+        wattroff(canvas->win, COLOR_PAIR(pair));
+        return;
+    }
+    // As with curses, any pair turns the color off
+    (void)pair;
+    canvas->color_pair = 0;
+}
+
+/* Store a character in a cell, in the current color
+ */
+static void set_cell(struct Canvas *canvas, int y, int x, const char *text, size_t length, unsigned char column)
+{
+    struct CanvasCell *cell = region_cell(canvas, y, x);
+    *cell = (struct CanvasCell){.color_pair = canvas->color_pair, .column = column};
+    memcpy(cell->text, text, MIN(length, ANSI_CELL_TEXT_SIZE - 1));
+}
+
+/* Move the cursor past the right edge to the next row. Returns false at the
+ * bottom, leaving the cursor in the last column
+ */
+static bool wrap_cursor(struct Canvas *canvas)
+{
+    if (canvas->y + 1 >= canvas->height)
+    {
+        canvas->x = canvas->width - 1;
+        return false;
+    }
+    canvas->y += 1;
+    canvas->x = 0;
+    return true;
+}
+
+/* Store a one column character at the cursor and move past it. Returns false
+ * once the cursor cannot move on from the bottom right cell
+ */
+static bool add_narrow(struct Canvas *canvas, const char *text, size_t length)
+{
+    set_cell(canvas, canvas->y, canvas->x, text, length, 0);
+    if (++canvas->x < canvas->width)
+    {
+        return true;
+    }
+    return wrap_cursor(canvas);
+}
+
+/* Store blanks in `count` cells from the cursor, leaving the cursor where it is
+ */
+static void fill_blanks(struct Canvas *canvas, int count)
+{
+    int y = canvas->y;
+    int x = canvas->x;
+    while (count-- > 0 && add_narrow(canvas, " ", 1))
+    {
+    }
+    canvas->y = y;
+    canvas->x = x;
+}
+
+/* Store a two column character at the cursor and move past it
+ */
+static bool add_wide(struct Canvas *canvas, const char *text, size_t length)
+{
+    if (canvas->width < 2)
+    {
+        return false;
+    }
+
+    // Blank the rest of the row and move to the next if it does not fit
+    if (canvas->x + 2 > canvas->width)
+    {
+        fill_blanks(canvas, canvas->width - canvas->x);
+        if (!wrap_cursor(canvas))
+        {
+            return false;
+        }
+    }
+
+    // Landing on the second column of another wide character blanks the cells
+    // up to the end of it. Its first column is left alone
+    for (int i = 0; i < 2; ++i)
+    {
+        unsigned char column = region_cell(canvas, canvas->y, canvas->x + i)->column;
+        if (column == 1)
+        {
+            break;
+        }
+        if (column == 2)
+        {
+            int j = i;
+            while (canvas->x + j < canvas->width && region_cell(canvas, canvas->y, canvas->x + j)->column == 2)
+            {
+                ++j;
+            }
+            if (canvas->x + j < canvas->width)
+            {
+                fill_blanks(canvas, j);
+            }
+            break;
+        }
+    }
+
+    set_cell(canvas, canvas->y, canvas->x, text, length, 1);
+    set_cell(canvas, canvas->y, canvas->x + 1, text, length, 2);
+    canvas->x += 2;
+    if (canvas->x < canvas->width)
+    {
+        return true;
+    }
+    return wrap_cursor(canvas);
+}
+
+/* Join a zero width character to the cell before the cursor, which is the
+ * last of the row above at the start of a row
+ */
+static void join_cell(struct Canvas *canvas, const char *text, size_t length)
+{
+    struct CanvasCell *cell;
+    if (canvas->x > 0)
+    {
+        // The second column of a wide character passes it on to the first
+        cell = region_cell(canvas, canvas->y, canvas->x - 1);
+        if (cell->column == 2 && canvas->x > 1)
+        {
+            --cell;
+        }
+    }
+    else if (canvas->y > 0)
+    {
+        cell = region_cell(canvas, canvas->y - 1, canvas->width - 1);
+    }
+    else
+    {
+        return;
+    }
+
+    size_t used = strlen(cell->text);
+    if (used + length < ANSI_CELL_TEXT_SIZE)
+    {
+        memcpy(cell->text + used, text, length);
+        cell->text[used + length] = '\0';
+    }
+}
+
+void canvas_add_str(struct Canvas *canvas, int y, int x, const char *str)
+{
+    if (canvas->win != NULL)
+    {
+        mvwaddstr(canvas->win, y, x, str);
+        return;
+    }
+
+    if (y < 0 || y >= canvas->height || x < 0 || x >= canvas->width)
+    {
+        return;
+    }
+    canvas->y = y;
+    canvas->x = x;
+
+    // Canvases are drawn from several threads, so no shared conversion state
+    mbstate_t state = {0};
+    size_t remaining = strlen(str);
+    while (remaining > 0)
+    {
+        wchar_t wch;
+        size_t length = mbrtowc(&wch, str, remaining, &state);
+        if (length == (size_t)-1 || length == (size_t)-2 || length == 0)
+        {
+            return;
+        }
+
+        int width = wcwidth(wch);
+        bool added = true;
+        if (width == 0)
+        {
+            join_cell(canvas, str, length);
+        }
+        else if (width == 2)
+        {
+            added = add_wide(canvas, str, length);
+        }
+        else if (width == 1)
+        {
+            added = add_narrow(canvas, str, length);
+        }
+        if (!added)
+        {
+            return;
+        }
+        str += length;
+        remaining -= length;
+    }
+}
+
+void canvas_add_char(struct Canvas *canvas, int y, int x, char ch)
+{
+    if (canvas->win != NULL)
+    {
+        mvwaddch(canvas->win, y, x, ch);
+        return;
+    }
+
+    char str[2] = {ch, '\0'};
+    canvas_add_str(canvas, y, x, str);
+}
+
+/* Whether a fill character is drawn as a `chtype` by windows
+ */
+static bool is_ascii(const char *fill)
+{
+    return fill[0] != '\0' && fill[1] == '\0';
+}
+
+/* Blank the halves of wide characters cut off by drawing over columns `left`
+ * to `right` of a row, as curses does for lines of `chtype` characters but
+ * not for others
+ */
+static void blank_orphans(struct Canvas *canvas, int y, int left, int right)
+{
+    if (left > 0 && region_cell(canvas, y, left)->column == 2)
+    {
+        blank_cell(region_cell(canvas, y, left - 1));
+    }
+    if (right + 1 < canvas->width && region_cell(canvas, y, right + 1)->column == 2)
+    {
+        blank_cell(region_cell(canvas, y, right + 1));
+    }
+}
+
+/* Set up a one column fill character for a window
+ */
+static void window_fill(const char *fill, cchar_t *cell)
+{
+    mbstate_t state = {0};
+    wchar_t wch[2] = {L' ', L'\0'};
+    mbrtowc(&wch[0], fill, strlen(fill), &state);
+    setcchar(cell, wch, A_NORMAL, 0, NULL);
+}
+
+void canvas_hline(struct Canvas *canvas, int y, int x, const char *fill, int count)
+{
+    if (canvas->win != NULL)
+    {
+        if (is_ascii(fill))
+        {
+            mvwhline(canvas->win, y, x, (chtype)(unsigned char)fill[0], count);
+            return;
+        }
+        cchar_t cell;
+        window_fill(fill, &cell);
+        mvwhline_set(canvas->win, y, x, &cell, count);
+        return;
+    }
+
+    if (y < 0 || y >= canvas->height || x < 0 || x >= canvas->width)
+    {
+        return;
+    }
+    int end = MIN(canvas->width, x + count) - 1;
+    if (is_ascii(fill))
+    {
+        blank_orphans(canvas, y, x, end);
+    }
+    for (int i = x; i <= end; ++i)
+    {
+        set_cell(canvas, y, i, fill, strlen(fill), 0);
+    }
+}
+
+void canvas_vline(struct Canvas *canvas, int y, int x, const char *fill, int count)
+{
+    if (canvas->win != NULL)
+    {
+        if (is_ascii(fill))
+        {
+            mvwvline(canvas->win, y, x, (chtype)(unsigned char)fill[0], count);
+            return;
+        }
+        cchar_t cell;
+        window_fill(fill, &cell);
+        mvwvline_set(canvas->win, y, x, &cell, count);
+        return;
+    }
+
+    if (y < 0 || y >= canvas->height || x < 0 || x >= canvas->width)
+    {
+        return;
+    }
+    for (int i = y; i < MIN(canvas->height, y + count); ++i)
+    {
+        if (is_ascii(fill))
+        {
+            blank_orphans(canvas, i, x, x);
+        }
+        set_cell(canvas, i, x, fill, strlen(fill), 0);
+    }
+}
+
+unsigned char *canvas_braille_cell(struct Canvas *canvas, int y, int x)
+{
+    if (canvas->win != NULL)
+    {
+        return y >= 0 && y < BRAILLE_LAYER_ROWS && x >= 0 && x < BRAILLE_LAYER_COLS ? &window_braille[y][x] : NULL;
+    }
+    if (y < 0 || y >= canvas->height || x < 0 || x >= canvas->width)
+    {
+        return NULL;
+    }
+    return &canvas->braille[(size_t)(canvas->top + y) * canvas->cols + canvas->left + x];
+}
+
+void canvas_clear_braille(struct Canvas *canvas)
+{
+    if (canvas->win != NULL)
+    {
+        memset(window_braille, 0, sizeof(window_braille));
+        return;
+    }
+    for (int y = 0; y < canvas->height; ++y)
+    {
+        memset(&canvas->braille[(size_t)(canvas->top + y) * canvas->cols + canvas->left], 0, canvas->width);
+    }
+}
+
+void canvas_capture(const struct Canvas *canvas, struct AnsiFrame *frame)
+{
+    int rows = MIN(canvas->rows, frame->rows);
+    int cols = MIN(canvas->cols, frame->cols);
+
+    // Cells are read one by one as from a window, where either column of a
+    // wide character reads as the whole of it
+    mbstate_t state = {0};
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+        {
+            const struct CanvasCell *cell = &canvas->cells[(size_t)y * canvas->cols + x];
+            struct AnsiCell *out = &frame->cells[(size_t)y * frame->cols + x];
+
+            short pair = cell->color_pair;
+            short color = pair > 0 && pair <= NUM_COLOR_PAIRS ? pair - 1 : -1;
+            *out = (struct AnsiCell){.color = color, .attrs = 0};
+            memcpy(out->text, cell->text, sizeof(out->text));
+
+            wchar_t wch;
+            size_t length = mbrtowc(&wch, cell->text, strlen(cell->text), &state);
+            if (length == (size_t)-1 || length == (size_t)-2 || length == 0)
+            {
+                state = (mbstate_t){0};
+                continue;
+            }
+            if (wcwidth(wch) == 2 && x + 1 < cols)
+            {
+                ++x;
+                frame->cells[(size_t)y * frame->cols + x] = (struct AnsiCell){.text = "", .color = color, .attrs = 0};
+            }
+        }
+    }
+}
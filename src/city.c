@@ -1,205 +1,581 @@
 #include "city.h"
-#include "cities.h"
+#include "city_index.h"
 #include "macros.h"
-#include "split_lines.h"
 
 #include <ctype.h>
+#include <math.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_LINE_LENGTH 1024
+// Longest folded query considered by fuzzy search. Longer queries are truncated
+#define MAX_FOLDED_LENGTH 256
 
-// Function to normalize a city name: trim spaces and convert to lowercase.
-// Since this is used in a binary search of data/cities.csv, it must be sorted accordingly.
-char *normalize_city_name(const char *input)
+// Fuzzy matches less similar than this are discarded
+#define MIN_SIMILARITY 0.3f
+
+// Weight of log10(population) in the fuzzy ranking, which breaks near ties in
+// favor of larger cities
+#define POPULATION_WEIGHT 0.02f
+
+/* Normalize a city name into `out`: trim spaces and convert to lowercase. This
+ * must match `normalize` in scripts/gen_city_index.py. Returns false if the
+ * normalized name does not fit in `out_size` bytes.
+ */
+static bool normalize_city_name(const char *input, char *out, size_t out_size)
 {
-    if (input == NULL)
+    // Trim leading spaces
+    while (isspace((unsigned char)*input))
+    {
+        input++;
+    }
+
+    // Trim trailing spaces
+    size_t length = strlen(input);
+    while (length > 0 && isspace((unsigned char)input[length - 1]))
+    {
+        length--;
+    }
+
+    if (length >= out_size)
+    {
+        return false;
+    }
+
+    // Convert to lowercase
+    for (size_t i = 0; i < length; i++)
+    {
+        out[i] = (char)tolower((unsigned char)input[i]);
+    }
+    out[length] = '\0';
+
+    return true;
+}
+
+/* 32-bit FNV-1a hash. This must match `fnv1a` in scripts/gen_city_index.py
+ */
+static uint32_t hash_city_name(const char *name)
+{
+    uint32_t hash = 0x811C9DC5u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 0x01000193u;
+    }
+    return hash;
+}
+
+/* Find the city for an already normalized name. Each name maps to the city
+ * with the largest population (e.g. London UK vs London Ontario)
+ */
+static const CityData *city_hash_lookup(const char *normalized_name)
+{
+    uint32_t slot = hash_city_name(normalized_name) & (CITY_HASH_SIZE - 1);
+    while (city_hash_table[slot] != -1)
+    {
+        const CityData *city = &city_table[city_hash_table[slot]];
+        if (strcmp(city->normalized_name, normalized_name) == 0)
+        {
+            return city;
+        }
+        slot = (slot + 1) & (CITY_HASH_SIZE - 1);
+    }
+
+    return NULL;
+}
+
+const CityData *get_city(const char *name)
+{
+    if (name == NULL)
     {
         return NULL;
     }
 
-    // Create a mutable copy of the input string
-    char *normalized = strdup(input);
-    if (normalized == NULL)
+    char normalized_name[CITY_NAME_MAX];
+    if (!normalize_city_name(name, normalized_name, sizeof(normalized_name)))
     {
-        perror("Memory allocation failed");
+        // Longer than any known city
         return NULL;
     }
 
-    // Trim leading spaces
-    char *start = normalized;
-    while (isspace((unsigned char)*start))
+    return city_hash_lookup(normalized_name);
+}
+
+/* Index of the first city whose normalized name, compared on its first
+ * `length` bytes, is not less than `key` (or greater than `key` when
+ * `past_matches` is set)
+ */
+static int lower_bound_prefix(const char *key, size_t length, bool past_matches)
+{
+    int low = 0;
+    int high = CITY_COUNT;
+    while (low < high)
     {
-        start++;
+        int mid = low + (high - low) / 2;
+        int cmp = strncmp(city_table[mid].normalized_name, key, length);
+        if (cmp < 0 || (past_matches && cmp == 0))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
     }
+    return low;
+}
 
-    // Trim trailing spaces
-    char *end = start + strlen(start) - 1;
-    while (end >= start && isspace((unsigned char)*end))
+int complete_city(const char *prefix, const CityData **matches, int max_matches)
+{
+    if (prefix == NULL || matches == NULL || max_matches <= 0)
     {
-        *end = '\0';
-        end--;
+        return 0;
     }
 
-    // Convert to lowercase
-    for (char *p = start; *p; p++)
+    // Normalize the prefix, keeping trailing spaces since they separate words
+    // (e.g. "new " should not match "Newark")
+    while (isspace((unsigned char)*prefix))
+    {
+        prefix++;
+    }
+    size_t length = strlen(prefix);
+    if (length >= CITY_NAME_MAX)
+    {
+        return 0;
+    }
+    char key[CITY_NAME_MAX];
+    for (size_t i = 0; i <= length; i++)
     {
-        *p = tolower((unsigned char)*p);
+        key[i] = (char)tolower((unsigned char)prefix[i]);
     }
 
-    // Create a new string containing the normalized result
-    char *result = strdup(start);
-    free(normalized);
-    return result;
+    // The table is sorted by normalized name, so matches form one run
+    int first = lower_bound_prefix(key, length, false);
+    int last = lower_bound_prefix(key, length, true);
+
+    // Keep the most populous matches, sorted by decreasing population
+    int num_matches = 0;
+    for (int i = first; i < last; i++)
+    {
+        const CityData *city = &city_table[i];
+
+        // Only list the most populous city sharing a name, like get_city
+        if (city_hash_lookup(city->normalized_name) != city)
+        {
+            continue;
+        }
+
+        int slot = num_matches;
+        while (slot > 0 && matches[slot - 1]->population < city->population)
+        {
+            if (slot < max_matches)
+            {
+                matches[slot] = matches[slot - 1];
+            }
+            slot--;
+        }
+        if (slot < max_matches)
+        {
+            matches[slot] = city;
+            num_matches = MIN(num_matches + 1, max_matches);
+        }
+    }
+
+    return num_matches;
 }
 
-// Function to compare two city names for binary search
-static int compare_city(const void *key, const void *element)
+/* Decode one UTF-8 code point from `*s`, advancing it. Invalid sequences
+ * decode as U+FFFD one byte at a time
+ */
+static unsigned int decode_utf8(const char **s)
 {
-    const char *city_name = (const char *)key;
-    const char *line = *(const char **)element; // Dereference the element pointer (line array)
+    const unsigned char *p = (const unsigned char *)*s;
+    unsigned int code_point;
+    int continuation;
 
-    // Extract city name from the line
-    char temp_line[MAX_LINE_LENGTH];
-    strncpy(temp_line, line, MAX_LINE_LENGTH);
-    temp_line[MAX_LINE_LENGTH - 1] = '\0'; // Ensure null termination
+    if (p[0] < 0x80)
+    {
+        *s += 1;
+        return p[0];
+    }
+    else if ((p[0] & 0xE0) == 0xC0)
+    {
+        code_point = p[0] & 0x1F;
+        continuation = 1;
+    }
+    else if ((p[0] & 0xF0) == 0xE0)
+    {
+        code_point = p[0] & 0x0F;
+        continuation = 2;
+    }
+    else if ((p[0] & 0xF8) == 0xF0)
+    {
+        code_point = p[0] & 0x07;
+        continuation = 3;
+    }
+    else
+    {
+        *s += 1;
+        return 0xFFFD;
+    }
 
-    const char *token = strtok(temp_line, ","); // Extract the first token (city name)
-    if (token == NULL)
+    for (int i = 1; i <= continuation; i++)
     {
-        return -1;
+        if ((p[i] & 0xC0) != 0x80)
+        {
+            *s += 1;
+            return 0xFFFD;
+        }
+        code_point = (code_point << 6) | (p[i] & 0x3F);
     }
 
-    // Normalize both the input key and the extracted city name for comparison
-    char *normalized_city_name = normalize_city_name(city_name);
-    char *normalized_token = normalize_city_name(token);
+    *s += continuation + 1;
+    return code_point;
+}
 
-    if (normalized_city_name == NULL || normalized_token == NULL)
+/* ASCII spelling of a non-ASCII code point, "" if it is dropped (e.g.
+ * combining accents) or NULL if it separates words
+ */
+static const char *fold_code_point(unsigned int code_point)
+{
+    int low = 0;
+    int high = CITY_FOLD_COUNT - 1;
+    while (low <= high)
     {
-        free(normalized_city_name);
-        free(normalized_token);
-        return -1;
+        int mid = low + (high - low) / 2;
+        if (city_fold_table[mid].code_point == code_point)
+        {
+            return city_fold_table[mid].ascii;
+        }
+        else if (city_fold_table[mid].code_point < code_point)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid - 1;
+        }
     }
+    return NULL;
+}
+
+/* Fold a name to lowercase ASCII letters and digits, with words separated by
+ * single spaces (e.g. "São  Paulo" -> "sao paulo"). This must match `fold` in
+ * scripts/gen_city_index.py. Returns the length of the folded name, which is
+ * truncated to fit in `out_size` bytes
+ */
+static size_t fold_city_name(const char *input, char *out, size_t out_size)
+{
+    size_t length = 0;
+    bool pending_space = false;
 
-    int result = strcmp(normalized_city_name, normalized_token);
+    while (*input)
+    {
+        unsigned int code_point = decode_utf8(&input);
 
-    // Free allocated memory for normalized strings
-    free(normalized_city_name);
-    free(normalized_token);
+        char ascii[2] = {0};
+        const char *folded;
+        if (code_point < 0x80)
+        {
+            ascii[0] = (char)tolower((int)code_point);
+            folded = isalnum((int)code_point) ? ascii : NULL;
+        }
+        else
+        {
+            folded = fold_code_point(code_point);
+        }
 
-    return result;
+        if (folded == NULL)
+        {
+            pending_space = length > 0;
+            continue;
+        }
+
+        for (const char *c = folded; *c; c++)
+        {
+            if (length + 1 + pending_space >= out_size)
+            {
+                out[length] = '\0';
+                return length;
+            }
+            if (pending_space)
+            {
+                out[length++] = ' ';
+                pending_space = false;
+            }
+            out[length++] = *c;
+        }
+    }
+
+    out[length] = '\0';
+    return length;
 }
 
-CityData *get_city(const char *name)
+static int trigram_symbol(char c)
 {
-    if (name == NULL || cities_len == 0)
+    if (c >= 'a' && c <= 'z')
     {
-        return NULL;
+        return c - 'a' + 1;
     }
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0' + 27;
+    }
+    return 0; // Space
+}
+
+static int compare_trigrams(const void *a, const void *b)
+{
+    return (int)*(const unsigned short *)a - (int)*(const unsigned short *)b;
+}
 
-    // Normalize the input city name
-    char *normalized_name = normalize_city_name(name);
-    if (normalized_name == NULL)
+/* Write the distinct trigrams of a folded name, padded with two leading and
+ * one trailing space, to `out` in ascending order. Returns the number written
+ */
+static int folded_trigrams(const char *folded, size_t length, unsigned short *out)
+{
+    int count = 0;
+    int a = 0, b = 0; // The two leading spaces
+    for (size_t i = 0; i <= length; i++)
     {
-        return NULL;
+        int c = i < length ? trigram_symbol(folded[i]) : 0;
+        out[count++] = (unsigned short)((a * 37 + b) * 37 + c);
+        a = b;
+        b = c;
     }
 
-    char *data = malloc(cities_len + 1);
-    if (data == NULL)
+    qsort(out, count, sizeof(unsigned short), compare_trigrams);
+
+    int unique = 0;
+    for (int i = 0; i < count; i++)
     {
-        free(normalized_name);
-        return NULL;
+        if (unique == 0 || out[unique - 1] != out[i])
+        {
+            out[unique++] = out[i];
+        }
     }
+    return unique;
+}
 
-    memcpy(data, cities, cities_len);
-    data[cities_len] = '\0';
+static float match_score(const CityMatch *match)
+{
+    return match->similarity + POPULATION_WEIGHT * log10f((float)match->city->population + 1.0f);
+}
 
-    // Convert the byte array into an array of lines
-    int line_count = 0;
-    char **lines = split_lines(data, &line_count);
-    if (lines == NULL)
+/* Exact matches come first however small the city, then the best scores
+ */
+static bool ranks_before(const CityMatch *a, const CityMatch *b)
+{
+    if (a->exact != b->exact)
     {
-        free(normalized_name);
-        free(data);
-        return NULL;
+        return a->exact;
     }
+    return match_score(a) > match_score(b);
+}
 
-    // Perform a linear search through the lines to find the best match
-    // (largest population) for the city name. E.g. London UK vs London Ontario.
-    CityData *best_city = NULL;
-    int best_population = -1;
+int search_cities(const char *query, CityMatch *matches, int max_matches)
+{
+    if (query == NULL || matches == NULL || max_matches <= 0)
+    {
+        return 0;
+    }
 
-    for (int i = 0; i < line_count; i++)
+    char folded[MAX_FOLDED_LENGTH + 1];
+    size_t length = fold_city_name(query, folded, sizeof(folded));
+    if (length == 0)
     {
-        char *line = strdup(lines[i]); // strtok modifies the string
-        if (!line)
+        return 0;
+    }
+
+    unsigned short query_trigrams[MAX_FOLDED_LENGTH + 1];
+    int num_query_trigrams = folded_trigrams(folded, length, query_trigrams);
+
+    // Count the trigrams each city shares with the query
+    unsigned short *shared = calloc(CITY_COUNT, sizeof(unsigned short));
+    int *candidates = malloc(CITY_COUNT * sizeof(int));
+    if (shared == NULL || candidates == NULL)
+    {
+        printf("Allocation of memory for city search failed\n");
+        free(shared);
+        free(candidates);
+        return 0;
+    }
+
+    int num_candidates = 0;
+    for (int t = 0; t < num_query_trigrams; t++)
+    {
+        const unsigned short *key = bsearch(&query_trigrams[t], city_trigram_keys, CITY_TRIGRAM_COUNT,
+                                            sizeof(unsigned short), compare_trigrams);
+        if (key == NULL)
+        {
             continue;
+        }
 
-        char *city_name = strtok(line, ",");
-        char *population_str = strtok(NULL, ",");
-        char *country_code = strtok(NULL, ",");
-        strtok(NULL, ","); // timezone
-        char *latitude_str = strtok(NULL, ",");
-        char *longitude_str = strtok(NULL, ",");
+        int k = (int)(key - city_trigram_keys);
+        for (int p = city_trigram_offsets[k]; p < city_trigram_offsets[k + 1]; p++)
+        {
+            int city_index = city_trigram_postings[p];
+            if (shared[city_index]++ == 0)
+            {
+                candidates[num_candidates++] = city_index;
+            }
+        }
+    }
 
-        if (!city_name || !population_str || !latitude_str || !longitude_str)
+    // Rank candidates by Jaccard similarity of their trigram sets, keeping the
+    // best matches sorted by decreasing score
+    int num_matches = 0;
+    for (int i = 0; i < num_candidates; i++)
+    {
+        int city_index = candidates[i];
+        float similarity =
+            (float)shared[city_index] / (num_query_trigrams + city_trigram_counts[city_index] - shared[city_index]);
+        if (similarity < MIN_SIMILARITY)
         {
-            free(line);
             continue;
         }
 
-        char *current_normalized = normalize_city_name(city_name);
+        // Names that only differ in case, accents or punctuation share every
+        // trigram, so only those with a perfect similarity need comparing
+        CityMatch match = {.city = &city_table[city_index], .similarity = similarity, .exact = false};
+        if (similarity >= 1.0f)
+        {
+            char folded_city[MAX_FOLDED_LENGTH + 1];
+            fold_city_name(match.city->city_name, folded_city, sizeof(folded_city));
+            match.exact = strcmp(folded, folded_city) == 0;
+        }
 
-        // Check for match
-        if (current_normalized && strcmp(normalized_name, current_normalized) == 0)
+        int slot = num_matches;
+        while (slot > 0 && ranks_before(&match, &matches[slot - 1]))
         {
-            int population = atoi(population_str);
-            if (population > best_population)
+            if (slot < max_matches)
             {
-                best_population = population;
-
-                // Free previous best
-                if (best_city)
-                {
-                    free(best_city->city_name);
-                    free(best_city);
-                }
-
-                best_city = malloc(sizeof(CityData));
-                if (best_city)
-                {
-                    best_city->city_name = strdup(city_name);
-                    best_city->latitude = atof(latitude_str);
-                    best_city->longitude = atof(longitude_str);
-                }
+                matches[slot] = matches[slot - 1];
             }
+            slot--;
+        }
+        if (slot < max_matches)
+        {
+            matches[slot] = match;
+            num_matches = MIN(num_matches + 1, max_matches);
+        }
+    }
+
+    free(shared);
+    free(candidates);
+
+    return num_matches;
+}
+
+const CityData *find_city(const char *name)
+{
+    const CityData *city = get_city(name);
+    if (city != NULL)
+    {
+        return city;
+    }
+
+    CityMatch match;
+    if (search_cities(name, &match, 1) > 0 && match.exact)
+    {
+        return match.city;
+    }
+    return NULL;
+}
+
+struct NearestQuery
+{
+    float point[3];
+    int best;
+    float best_distance; // Squared chord length to the best city so far
+};
+
+/* Search the implicit k-d tree node covering [low, high) of the tree layout
+ */
+static void search_kd_tree(struct NearestQuery *query, int low, int high)
+{
+    if (low >= high)
+    {
+        return;
+    }
+
+    int mid = low + (high - low) / 2;
+    const float *point = city_kd_points[mid];
+
+    float dx = query->point[0] - point[0];
+    float dy = query->point[1] - point[1];
+    float dz = query->point[2] - point[2];
+    float distance = dx * dx + dy * dy + dz * dz;
+    if (distance < query->best_distance)
+    {
+        query->best_distance = distance;
+        query->best = mid;
+    }
+
+    // Descend into the side containing the query first, then visit the other
+    // side only if the splitting plane is closer than the best city so far
+    int axis = city_kd_axes[mid];
+    float split = query->point[axis] - point[axis];
+    if (split < 0.0f)
+    {
+        search_kd_tree(query, low, mid);
+        if (split * split < query->best_distance)
+        {
+            search_kd_tree(query, mid + 1, high);
         }
+    }
+    else
+    {
+        search_kd_tree(query, mid + 1, high);
+        if (split * split < query->best_distance)
+        {
+            search_kd_tree(query, low, mid);
+        }
+    }
+}
 
-        free(current_normalized);
-        free(line);
+const CityData *nearest_city(double latitude, double longitude, double *distance_km)
+{
+    const double EARTH_RADIUS_KM = 6371.0;
+
+    double lat = latitude * TO_RAD;
+    double lon = longitude * TO_RAD;
+    struct NearestQuery query = {
+        .point = {(float)(cos(lat) * cos(lon)), (float)(cos(lat) * sin(lon)), (float)sin(lat)},
+        .best = -1,
+        .best_distance = INFINITY,
+    };
+
+    search_kd_tree(&query, 0, CITY_COUNT);
+    if (query.best < 0)
+    {
+        return NULL;
     }
 
-    // Clean up
-    for (int i = 0; i < line_count; i++)
+    if (distance_km != NULL)
     {
-        free(lines[i]);
+        // Chord length to great circle distance
+        double chord = sqrt(query.best_distance);
+        *distance_km = 2.0 * asin(MIN(1.0, chord / 2.0)) * EARTH_RADIUS_KM;
     }
-    free(lines);
-    free(data);
-    free(normalized_name);
 
-    return best_city;
+    return &city_table[city_kd_order[query.best]];
 }
 
-void free_city(CityData *city)
+void city_cursor_init(CityCursor *cursor)
 {
-    if (city != NULL)
+    cursor->index = 0;
+}
+
+const CityData *city_cursor_next(CityCursor *cursor)
+{
+    if (cursor->index >= CITY_COUNT)
     {
-        free((void *)city->city_name);
-        free(city);
+        return NULL;
     }
+    return &city_table[cursor->index++];
 }
 
 /**
@@ -220,47 +596,12 @@ void iter_cities(void (*callback)(const CityData *city, void *data), void *user_
         return;
     }
 
-    // Get the city data as a buffer using split_lines
-    char *data = malloc(cities_len + 1);
-    memcpy(data, cities, cities_len);
-    data[cities_len] = '\0';
-
-    int line_count = 0;
-    char **lines = split_lines(data, &line_count);
-    if (lines == NULL)
-    {
-        free(data);
-        return;
-    }
-
-    for (int i = 1; i < line_count; i++)
-    {
-        char *line = lines[i];
-        const char *city_name, *latitude_str, *longitude_str;
-
-        city_name = strtok(line, ",");
-        strtok(NULL, ","); // Skip population
-        strtok(NULL, ","); // Skip country code
-        strtok(NULL, ","); // Skip timezone
-        latitude_str = strtok(NULL, ",");
-        longitude_str = strtok(NULL, ",");
-
-        if (city_name && latitude_str && longitude_str)
-        {
-            CityData city_data;
-            city_data.city_name = city_name;
-            city_data.latitude = atof(latitude_str);
-            city_data.longitude = atof(longitude_str);
-
-            callback(&city_data, user_data);
-        }
-    }
+    CityCursor cursor;
+    city_cursor_init(&cursor);
 
-    // Clean up
-    for (int i = 0; i < line_count; i++)
+    const CityData *city;
+    while ((city = city_cursor_next(&cursor)) != NULL)
     {
-        free(lines[i]);
+        callback(city, user_data);
     }
-    free(lines);
-    free(data);
 }
@@ -0,0 +1,125 @@
+#include "constell_graph.h"
+
+#include "arena.h"
+#include "macros.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Whether every star of a figure is in the star table
+ */
+static bool constell_is_valid(const struct Constell *constell, unsigned int num_stars)
+{
+    for (unsigned int i = 0; i < constell->num_segments * 2; ++i)
+    {
+        int catalog_num = constell->star_numbers[i];
+        if (catalog_num < 1 || (unsigned int)catalog_num > num_stars)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool generate_constell_graph(struct ConstellGraph *graph, const struct Constell *constell_table, unsigned int num_const,
+                             const struct Star *star_table, unsigned int num_stars)
+{
+    unsigned int num_edges = 0;
+    for (unsigned int c = 0; c < num_const; ++c)
+    {
+        if (constell_is_valid(&constell_table[c], num_stars))
+        {
+            num_edges += constell_table[c].num_segments;
+        }
+    }
+
+    // Every vertex is the endpoint of some edge, so there are at most twice as
+    // many vertices as edges. Each array gets slack for alignment padding
+    size_t size = (num_const + 1) * sizeof(unsigned int) + num_const * sizeof(float) +
+                  num_edges * 2 * sizeof(int) * 3 + 4 * sizeof(double);
+
+    bool *seen = calloc(MAX(num_stars, 1), sizeof(bool));
+    if (seen == NULL || !arena_init(&graph->arena, size))
+    {
+        printf("Allocation of memory for constellation graph failed\n");
+        free(seen);
+        return false;
+    }
+
+    graph->num_constells = num_const;
+    graph->offsets = arena_alloc(&graph->arena, (num_const + 1) * sizeof(unsigned int), _Alignof(unsigned int));
+    graph->max_magnitude = arena_alloc(&graph->arena, num_const * sizeof(float), _Alignof(float));
+    graph->edges = arena_alloc(&graph->arena, num_edges * 2 * sizeof(int), _Alignof(int));
+    graph->vertices = arena_alloc(&graph->arena, num_edges * 2 * sizeof(int), _Alignof(int));
+    graph->visible_edges = arena_alloc(&graph->arena, num_edges * 2 * sizeof(int), _Alignof(int));
+    graph->num_vertices = 0;
+    graph->num_visible_edges = 0;
+
+    unsigned int edge = 0;
+    for (unsigned int c = 0; c < num_const; ++c)
+    {
+        const struct Constell *constell = &constell_table[c];
+        graph->offsets[c] = edge;
+
+        if (!constell_is_valid(constell, num_stars))
+        {
+            graph->max_magnitude[c] = INFINITY;
+            continue;
+        }
+
+        float max_magnitude = -INFINITY;
+        for (unsigned int i = 0; i < constell->num_segments * 2; ++i)
+        {
+            int table_index = constell->star_numbers[i] - 1;
+            graph->edges[2 * edge + i] = table_index;
+            max_magnitude = MAX(max_magnitude, star_table[table_index].magnitude);
+
+            if (!seen[table_index])
+            {
+                seen[table_index] = true;
+                graph->vertices[graph->num_vertices++] = table_index;
+            }
+        }
+
+        graph->max_magnitude[c] = max_magnitude;
+        edge += constell->num_segments;
+    }
+    graph->offsets[num_const] = edge;
+
+    free(seen);
+
+    return true;
+}
+
+void free_constell_graph(struct ConstellGraph *graph)
+{
+    arena_free(&graph->arena);
+    graph->offsets = NULL;
+    graph->edges = NULL;
+    graph->max_magnitude = NULL;
+    graph->vertices = NULL;
+    graph->visible_edges = NULL;
+    graph->num_constells = 0;
+    graph->num_vertices = 0;
+    graph->num_visible_edges = 0;
+}
+
+void constell_graph_set_threshold(struct ConstellGraph *graph, float threshold)
+{
+    unsigned int num_visible = 0;
+    for (unsigned int c = 0; c < graph->num_constells; ++c)
+    {
+        if (graph->max_magnitude[c] > threshold)
+        {
+            continue;
+        }
+
+        for (unsigned int i = 2 * graph->offsets[c]; i < 2 * graph->offsets[c + 1]; ++i)
+        {
+            graph->visible_edges[num_visible++] = graph->edges[i];
+        }
+    }
+
+    graph->num_visible_edges = num_visible / 2;
+}
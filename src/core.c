@@ -1,5 +1,6 @@
 #include "core.h"
 
+#include "arena.h"
 #include "astro.h"
 #include "parse_BSC5.h"
 #include "strptime.h"
@@ -12,6 +13,32 @@
 
 // Data generation
 
+void star_symbols(float magnitude, char *symbol_ASCII, const char **symbol_unicode)
+{
+    // Star magnitude mapping
+    // FIXME: some of these characters render on WSL while not on macOS
+    // (system wide, not just this project). I haven't gotten to the bottom
+    // of this yet...
+    // TODO: add CLI option to choose between these
+    static const char *mag_map_unicode_round[10] = {"⬤", "●", "⦁", "•", "•", "∙", "⋅", "⋅", "⋅", "⋅"};
+    // const char *mag_map_unicode_diamond[10] = {"⯁", "◇", "⬥", "⬦", "⬩",
+    // "🞘", "🞗", "🞗", "🞗", "🞗"}; const char *mag_map_unicode_open[10]    =
+    // {"✩", "✧", "⋄", "⭒", "🞝", "🞝", "🞝", "🞝", "🞝", "🞝"}; const char
+    // *mag_map_unicode_filled[10]  = {"★", "✦", "⬩", "⭑", "🞝", "🞝", "🞝",
+    // "🞝", "🞝", "🞝"};
+    static const char mag_map_round_ASCII[10] = {'0', '0', 'O', 'O', 'o', 'o', '.', '.', '.', '.'};
+
+    const float min_magnitude = -1.46f;
+    const float max_magnitude = 7.96f;
+
+    // Combined magnitudes may be brighter than any one star
+    int symbol_index = map_float_to_int_range(min_magnitude, max_magnitude, 0, 9, magnitude);
+    symbol_index = symbol_index < 0 ? 0 : symbol_index > 9 ? 9 : symbol_index;
+
+    *symbol_ASCII = mag_map_round_ASCII[symbol_index];
+    *symbol_unicode = mag_map_unicode_round[symbol_index];
+}
+
 bool generate_star_table(struct Star **star_table_out, struct Entry *entries, const struct StarName *name_table,
                          unsigned int num_stars)
 {
@@ -33,30 +60,11 @@ bool generate_star_table(struct Star **star_table_out, struct Entry *entries, co
         temp_star.dec_motion = (double)entries[i].XDPM;
         temp_star.magnitude = entries[i].MAG / 100.0f;
 
-        // Star magnitude mapping
-        // FIXME: some of these characters render on WSL while not on macOS
-        // (system wide, not just this project). I haven't gotten to the bottom
-        // of this yet...
-        // TODO: add CLI option to choose between these
-        const char *mag_map_unicode_round[10] = {"⬤", "●", "⦁", "•", "•", "∙", "⋅", "⋅", "⋅", "⋅"};
-        // const char *mag_map_unicode_diamond[10] = {"⯁", "◇", "⬥", "⬦", "⬩",
-        // "🞘", "🞗", "🞗", "🞗", "🞗"}; const char *mag_map_unicode_open[10]    =
-        // {"✩", "✧", "⋄", "⭒", "🞝", "🞝", "🞝", "🞝", "🞝", "🞝"}; const char
-        // *mag_map_unicode_filled[10]  = {"★", "✦", "⬩", "⭑", "🞝", "🞝", "🞝",
-        // "🞝", "🞝", "🞝"};
-        const char mag_map_round_ASCII[10] = {'0', '0', 'O', 'O', 'o', 'o', '.', '.', '.', '.'};
-
-        const float min_magnitude = -1.46f;
-        const float max_magnitude = 7.96f;
-
-        int symbol_index = map_float_to_int_range(min_magnitude, max_magnitude, 0, 9, temp_star.magnitude);
-
         temp_star.base = (struct ObjectBase){
             .color_pair = 0,
-            .symbol_ASCII = (char)mag_map_round_ASCII[symbol_index],
-            .symbol_unicode = mag_map_unicode_round[symbol_index],
             .label = name_table[i].name,
         };
+        star_symbols(temp_star.magnitude, &temp_star.base.symbol_ASCII, &temp_star.base.symbol_unicode);
 
         // Copy temp struct to table index
         (*star_table_out)[i] = temp_star;
@@ -150,13 +158,18 @@ bool generate_moon_object(struct Moon *moon_data, const struct KepElems *moon_el
 // TODO: verify this catches the first and last entries
 bool generate_name_table(const uint8_t *data, size_t data_len, struct StarName **name_table_out, int num_stars)
 {
-    *name_table_out = malloc(num_stars * sizeof(struct StarName));
-    if (*name_table_out == NULL)
+    // The table and every name share one arena. Each name is shorter than its
+    // line, so the data length bounds the size of the string pool
+    struct Arena arena;
+    if (!arena_init(&arena, num_stars * sizeof(struct StarName) + data_len + 1))
     {
         printf("Allocation of memory for name table failed\n");
         return false;
     }
 
+    // First allocation, so freeing the table frees the arena
+    *name_table_out = arena_alloc(&arena, num_stars * sizeof(struct StarName), _Alignof(struct StarName));
+
     char buffer[BUF_SIZE];
     size_t offset = 0;
 
@@ -191,26 +204,58 @@ bool generate_name_table(const uint8_t *data, size_t data_len, struct StarName *
         const char *name = strtok(NULL, ",\n");
 
         int table_index = catalog_number - 1;
-
-        struct StarName temp_name;
-        temp_name.name = malloc(strlen(name) + 1);
-        if (temp_name.name == NULL)
+        if (name == NULL || table_index < 0 || table_index >= num_stars)
         {
-            return false;
+            continue; // Malformed line
         }
-        strcpy(temp_name.name, name);
 
-        (*name_table_out)[table_index] = temp_name;
+        (*name_table_out)[table_index].name = arena_strndup(&arena, name, strlen(name));
+    }
+
+    return true;
+}
+
+/* Find the next space separated token in data[*pos, end]. Returns false if
+ * there are no more tokens
+ */
+static bool next_token(const uint8_t *data, size_t *pos, size_t end, size_t *token_start, size_t *token_end)
+{
+    while (*pos <= end && data[*pos] == ' ')
+    {
+        (*pos)++;
+    }
+    if (*pos > end)
+    {
+        return false;
     }
 
+    *token_start = *pos;
+    while (*pos <= end && data[*pos] != ' ')
+    {
+        (*pos)++;
+    }
+    *token_end = *pos;
     return true;
 }
 
+/* Parse the leading integer of a token, like atoi
+ */
+static int token_to_int(const uint8_t *data, size_t start, size_t end)
+{
+    bool negative = start < end && data[start] == '-';
+    int value = 0;
+    for (size_t i = start + negative; i < end && data[i] >= '0' && data[i] <= '9'; ++i)
+    {
+        value = value * 10 + (data[i] - '0');
+    }
+    return negative ? -value : value;
+}
+
 /* Parse a single constellation entry, e.g.:
  *
  * CVn 1 4915 4785
  *
- * Adds the entry *constell_table_out[line_number]:
+ * into:
  *
  * struct Constell
  * {
@@ -218,105 +263,62 @@ bool generate_name_table(const uint8_t *data, size_t data_len, struct StarName *
  * int *star_numbers=[4915, 4785]
  * };
  *
- * NOTE: line numbers are 0-indexed
+ * The line spans data[line_start, line_end]. Star numbers are allocated from
+ * the arena
  */
-bool parse_line(const uint8_t *data, struct Constell **constell_table_out, int line_start, int line_end, int line_number)
+static bool parse_line(const uint8_t *data, size_t line_start, size_t line_end, struct Constell *constell,
+                       struct Arena *arena)
 {
     // Validate the input range
-    if (line_end <= line_start || data == NULL || constell_table_out == NULL)
-    {
-        return false;
-    }
-
-    // Create a temporary buffer for the line data
-    size_t line_length = line_end - line_start + 1; // +1 to include the last character
-
-    // #91: use dynamic allocation to avoid buffer overflow
-    char *buffer = malloc(line_length + 1); // +1 for null terminator
-    if (buffer == NULL)
+    if (line_end <= line_start || data == NULL)
     {
         return false;
     }
 
-    memcpy(buffer, &data[line_start], line_length);
-    buffer[line_length] = '\0';
+    size_t pos = line_start;
+    size_t token_start, token_end;
 
-    // Parse the line:
-    const char *name = strtok(buffer, " "); // First token is the constellation name
-    if (name == NULL)
+    // First token is the constellation name
+    if (!next_token(data, &pos, line_end, &token_start, &token_end))
     {
-        free(buffer);
         return false; // Malformed line, no name found
     }
 
     // The next token is the number of segments
-    const char *num_segments_str = strtok(NULL, " ");
-    if (num_segments_str == NULL)
+    if (!next_token(data, &pos, line_end, &token_start, &token_end))
     {
-        free(buffer);
         return false; // Malformed line, no number of segments
     }
 
-    unsigned int num_segments = atoi(num_segments_str);
-    if (num_segments == 0)
+    int num_segments = token_to_int(data, token_start, token_end);
+    if (num_segments <= 0)
     {
-        free(buffer);
         return false; // Invalid number of segments
     }
 
-    // Allocate memory for the star numbers
-    int *star_numbers = malloc(num_segments * 2 * sizeof(int)); // Each segment has two star numbers
+    // Each segment has two star numbers
+    int *star_numbers = arena_alloc(arena, num_segments * 2 * sizeof(int), _Alignof(int));
     if (star_numbers == NULL)
     {
-        free(buffer);
-        return false; // Memory allocation failed
+        return false; // More segments than the data could possibly hold
     }
 
     // Parse the star numbers (expecting num_segments * 2 star numbers)
-    unsigned int i = 0;
-    const char *token;
-    while ((token = strtok(NULL, " ")) != NULL && i < num_segments * 2)
+    int i = 0;
+    while (i < num_segments * 2 && next_token(data, &pos, line_end, &token_start, &token_end))
     {
-        star_numbers[i] = atoi(token);
+        star_numbers[i] = token_to_int(data, token_start, token_end);
         ++i;
     }
 
     // If we didn't get enough star numbers, it's an error
     if (i != num_segments * 2)
     {
-        free(star_numbers);
-        free(buffer);
         return false; // Malformed line, not enough star numbers
     }
 
-    // We're done with the buffer now
-    free(buffer);
-
-    // Allocate memory for the constellations table if necessary
-    if (*constell_table_out == NULL)
-    {
-        *constell_table_out = malloc(sizeof(struct Constell) * (line_number + 1));
-        if (*constell_table_out == NULL)
-        {
-            free(star_numbers);
-            return false; // Memory allocation failed for the table
-        }
-    }
-    else
-    {
-        // Reallocate memory to accommodate new constellations
-        *constell_table_out = realloc(*constell_table_out, sizeof(struct Constell) * (line_number + 1));
-        if (*constell_table_out == NULL)
-        {
-            free(star_numbers);
-            return false; // Memory allocation failed for the table
-        }
-    }
-
-    // Store the parsed constellation in the correct table location
-    struct Constell temp_constell = {.num_segments = num_segments, .star_numbers = star_numbers};
-
-    (*constell_table_out)[line_number] = temp_constell;
+    constell->num_segments = num_segments;
+    constell->star_numbers = star_numbers;
 
     return true;
 }
@@ -337,22 +339,28 @@ bool generate_constell_table(const uint8_t *data, size_t data_len, struct Conste
     // Count the number of lines in the data
     for (size_t i = 0; i < data_len; ++i)
     {
-        if (data[i] == '\n')
+        if (data[i] == '\n' || i == data_len - 1)
         {
             num_constells++;
         }
     }
 
-    // Allocate memory for the constellation table
-    *constell_table_out = malloc(num_constells * sizeof(struct Constell));
-    if (*constell_table_out == NULL)
+    // The table and all star numbers share one arena. Every star number takes
+    // at least two bytes of data (a digit and a separator), which bounds how
+    // many there can be
+    size_t max_star_numbers = data_len / 2 + 1;
+    struct Arena arena;
+    if (!arena_init(&arena, num_constells * sizeof(struct Constell) + sizeof(int) + max_star_numbers * sizeof(int)))
     {
         printf("Allocation of memory for constellation table failed\n");
         return false;
     }
 
+    // First allocation, so freeing the table frees the arena
+    *constell_table_out = arena_alloc(&arena, num_constells * sizeof(struct Constell), _Alignof(struct Constell));
+
     // Parse each line of data
-    int line_number = 0;
+    unsigned int line_number = 0;
     for (size_t i = 0; i < data_len; ++i)
     {
         // Find the start of the current line
@@ -367,9 +375,11 @@ bool generate_constell_table(const uint8_t *data, size_t data_len, struct Conste
             line_end = i;
 
             // Parse the line and store the parsed constellation in the table
-            if (!parse_line(data, constell_table_out, line_start, line_end, line_number))
+            if (!parse_line(data, line_start, line_end, &(*constell_table_out)[line_number], &arena))
             {
-                printf("Failed to parse line %d\n", line_number);
+                printf("Failed to parse line %u\n", line_number);
+                arena_free(&arena);
+                *constell_table_out = NULL;
                 return false;
             }
 
@@ -385,24 +395,6 @@ bool generate_constell_table(const uint8_t *data, size_t data_len, struct Conste
 
 // Memory freeing
 
-void free_constell_members(struct Constell constell_data)
-{
-    if (constell_data.star_numbers != NULL)
-    {
-        free(constell_data.star_numbers);
-    }
-    return;
-}
-
-void free_star_name_members(struct StarName name_data)
-{
-    if (name_data.name != NULL)
-    {
-        free(name_data.name);
-    }
-    return;
-}
-
 void free_stars(struct Star *star_table, unsigned int size)
 {
     (void)size;
@@ -426,20 +418,16 @@ void free_moon_object(struct Moon moon_data)
 
 void free_constells(struct Constell *constell_table, unsigned int size)
 {
-    for (unsigned int i = 0; i < size; i++)
-    {
-        free_constell_members(constell_table[i]);
-    }
+    // The table heads the arena holding every constellation's star numbers
+    (void)size;
     free(constell_table);
     return;
 }
 
 void free_star_names(struct StarName *name_table, unsigned int size)
 {
-    for (unsigned int i = 0; i < size; ++i)
-    {
-        free_star_name_members(name_table[i]);
-    }
+    // The table heads the arena holding every name
+    (void)size;
     free(name_table);
     return;
 }
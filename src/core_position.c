@@ -3,8 +3,25 @@
 #include "astro.h"
 #include "coord.h"
 #include "core.h"
+#include "macros.h"
+#include "sky_index.h"
 
 #include <math.h>
+#include <stdlib.h>
+
+static void update_star_position(struct Star *star, double julian_date, double gmst, double latitude, double longitude)
+{
+    double right_ascension, declination;
+    calc_star_position(star->right_ascension, star->ra_motion, star->declination, star->dec_motion, julian_date,
+                       &right_ascension, &declination);
+
+    // Convert to horizontal coordinates
+    double azimuth, altitude;
+    equatorial_to_horizontal(right_ascension, declination, gmst, latitude, longitude, &azimuth, &altitude);
+
+    star->base.azimuth = azimuth;
+    star->base.altitude = altitude;
+}
 
 void update_star_positions(struct Star *star_table, int num_stars, double julian_date, double latitude, double longitude)
 {
@@ -13,58 +30,105 @@ void update_star_positions(struct Star *star_table, int num_stars, double julian
     int i;
     for (i = 0; i < num_stars; ++i)
     {
-        struct Star *star = &star_table[i];
+        update_star_position(&star_table[i], julian_date, gmst, latitude, longitude);
+    }
 
-        double right_ascension, declination;
-        calc_star_position(star->right_ascension, star->ra_motion, star->declination, star->dec_motion, julian_date,
-                           &right_ascension, &declination);
+    return;
+}
 
-        // Convert to horizontal coordinates
-        double azimuth, altitude;
-        equatorial_to_horizontal(right_ascension, declination, gmst, latitude, longitude, &azimuth, &altitude);
+static int compare_ints(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+void update_star_positions_indexed(struct Star *star_table, struct SkyIndex *index, double julian_date, double latitude,
+                                   double longitude, float threshold)
+{
+    double gmst = greenwich_mean_sidereal_time_rad(julian_date);
+
+    // The zenith lies at the local sidereal time and the observer's latitude
+    double local_sidereal_time = gmst + longitude;
+    double margin = sky_index_motion_margin(index, julian_date);
+
+    unsigned int num_candidates = sky_index_query_cap(index, star_table, local_sidereal_time, latitude, M_PI / 2.0, margin,
+                                                      threshold, index->visible, index->num_stars);
+
+    // Keep stars above the horizon, recording their rank by magnitude
+    unsigned int num_visible = 0;
+    for (unsigned int i = 0; i < num_candidates; ++i)
+    {
+        int table_index = index->visible[i];
+        struct Star *star = &star_table[table_index];
+        update_star_position(star, julian_date, gmst, latitude, longitude);
+
+        if (star->base.altitude >= 0.0)
+        {
+            index->visible[num_visible++] = index->rank[table_index];
+        }
+    }
+
+    // Restore the global dimmest-first order used when rendering
+    qsort(index->visible, num_visible, sizeof(int), compare_ints);
+    for (unsigned int i = 0; i < num_visible; ++i)
+    {
+        index->visible[i] = index->num_by_mag[index->visible[i]];
+    }
+
+    index->num_visible = num_visible;
+
+    return;
+}
+
+void update_constell_positions(struct Star *star_table, const struct ConstellGraph *graph, double julian_date,
+                               double latitude, double longitude)
+{
+    double gmst = greenwich_mean_sidereal_time_rad(julian_date);
 
-        star->base.azimuth = azimuth;
-        star->base.altitude = altitude;
+    for (unsigned int i = 0; i < graph->num_vertices; ++i)
+    {
+        update_star_position(&star_table[graph->vertices[i]], julian_date, gmst, latitude, longitude);
     }
 
     return;
 }
 
+void calc_planet_geo_position(const struct Planet *planet_table, int planet, double xe, double ye, double ze,
+                              double julian_date, double *xg, double *yg, double *zg)
+{
+    if (planet == SUN)
+    {
+        // Since the origin of the ICRF frame is the barycenter of the Solar
+        // System, (for our purposes this is roughly the position of the
+        // Sun) we obtain the geocentric coordinates of the Sun by negating
+        // the heliocentric coordinates of the Earth
+        *xg = -xe;
+        *yg = -ye;
+        *zg = -ze;
+    }
+    else
+    {
+        calc_planet_geo_ICRF(xe, ye, ze, planet_table[planet].elements, planet_table[planet].rates,
+                             planet_table[planet].extras, julian_date, xg, yg, zg);
+    }
+}
+
 void update_planet_positions(struct Planet *planet_table, double julian_date, double latitude, double longitude)
 {
     double gmst = greenwich_mean_sidereal_time_rad(julian_date);
 
+    // Heliocentric coordinates of the Earth-Moon barycenter
+    double xe, ye, ze;
+    calc_planet_helio_ICRF(planet_table[EARTH].elements, planet_table[EARTH].rates, planet_table[EARTH].extras, julian_date,
+                           &xe, &ye, &ze);
+
     int i;
     for (i = SUN; i < NUM_PLANETS; ++i)
     {
         // Geocentric rectangular equatorial coordinates
         double xg, yg, zg;
-
-        // Heliocentric coordinates of the Earth-Moon barycenter
-        double xe, ye, ze;
-        calc_planet_helio_ICRF(planet_table[EARTH].elements, planet_table[EARTH].rates, planet_table[EARTH].extras, julian_date,
-                               &xe, &ye, &ze);
-
-        if (i == SUN)
-        {
-            // Since the origin of the ICRF frame is the barycenter of the Solar
-            // System, (for our purposes this is roughly the position of the
-            // Sun) we obtain the geocentric coordinates of the Sun by negating
-            // the heliocentric coordinates of the Earth
-            xg = -xe;
-            yg = -ye;
-            zg = -ze;
-        }
-        else
-        {
-            calc_planet_helio_ICRF(planet_table[i].elements, planet_table[i].rates, planet_table[i].extras, julian_date, &xg,
-                                   &yg, &zg);
-
-            // Obtain geocentric coordinates by subtracting Earth's coordinates
-            xg -= xe;
-            yg -= ye;
-            zg -= ze;
-        }
+        calc_planet_geo_position(planet_table, i, xe, ye, ze, julian_date, &xg, &yg, &zg);
 
         // Convert to spherical equatorial coordinates
         double right_ascension, declination;
@@ -98,6 +162,235 @@ void update_moon_position(struct Moon *moon_object, double julian_date, double l
     return;
 }
 
+// Rise, transit and set
+
+// Positions cached per day when searching for events of moving bodies. Events
+// are bracketed between samples, then refined on interpolated positions
+#define TRACK_SAMPLES 24
+
+// Bisection steps refining an event: one hour / 2^13 is under half a second
+#define EVENT_ITERATIONS 13
+
+/* Geocentric rectangular equatorial coordinates of a body sampled at regular
+ * intervals over one day
+ */
+struct Track
+{
+    double julian_date; // Time of the first sample
+    double interval;    // Time between samples (days)
+    double x[TRACK_SAMPLES + 1];
+    double y[TRACK_SAMPLES + 1];
+    double z[TRACK_SAMPLES + 1];
+};
+
+struct EventSearch
+{
+    const struct Track *track;
+    double latitude;
+    double longitude;
+    double horizon; // Altitude at rise and set (radians)
+};
+
+static void track_init(struct Track *track, double julian_date)
+{
+    track->julian_date = julian_date;
+    track->interval = 1.0 / TRACK_SAMPLES;
+}
+
+static double track_sample_date(const struct Track *track, int sample)
+{
+    return track->julian_date + sample * track->interval;
+}
+
+/* Interpolate the horizontal coordinates of a tracked body
+ */
+static void track_horizontal(const struct EventSearch *search, double julian_date, double *hour_angle, double *altitude)
+{
+    const struct Track *track = search->track;
+
+    double u = (julian_date - track->julian_date) / track->interval;
+    int k = MAX(0, MIN(TRACK_SAMPLES - 1, (int)floor(u)));
+    double f = u - k;
+
+    double x = track->x[k] + f * (track->x[k + 1] - track->x[k]);
+    double y = track->y[k] + f * (track->y[k + 1] - track->y[k]);
+    double z = track->z[k] + f * (track->z[k + 1] - track->z[k]);
+
+    double right_ascension, declination;
+    equatorial_rectangular_to_spherical(x, y, z, &right_ascension, &declination);
+
+    double gmst = greenwich_mean_sidereal_time_rad(julian_date);
+    double azimuth;
+    equatorial_to_horizontal(right_ascension, declination, gmst, search->latitude, search->longitude, &azimuth, altitude);
+    *altitude -= search->horizon;
+
+    // Hour angle in [-π, π)
+    *hour_angle = fmod(gmst + search->longitude - right_ascension, 2.0 * M_PI);
+    *hour_angle += *hour_angle < -M_PI ? 2.0 * M_PI : 0.0;
+    *hour_angle -= *hour_angle >= M_PI ? 2.0 * M_PI : 0.0;
+}
+
+/* Bisect a bracket [a, b] over which the altitude (or hour angle if
+ * `transit`) changes sign
+ */
+static double refine_event(const struct EventSearch *search, double a, double b, bool transit)
+{
+    double hour_angle, altitude;
+    track_horizontal(search, a, &hour_angle, &altitude);
+    bool negative_at_a = (transit ? hour_angle : altitude) < 0.0;
+
+    for (int i = 0; i < EVENT_ITERATIONS; ++i)
+    {
+        double mid = 0.5 * (a + b);
+        track_horizontal(search, mid, &hour_angle, &altitude);
+        if (((transit ? hour_angle : altitude) < 0.0) == negative_at_a)
+        {
+            a = mid;
+        }
+        else
+        {
+            b = mid;
+        }
+    }
+
+    return 0.5 * (a + b);
+}
+
+/* Find the first rise, transit and set of a tracked body
+ */
+static void search_track(const struct EventSearch *search, struct RiseTransitSet *events)
+{
+    const struct Track *track = search->track;
+
+    events->rise = NAN;
+    events->transit = NAN;
+    events->set = NAN;
+
+    double prev_hour_angle, prev_altitude;
+    track_horizontal(search, track->julian_date, &prev_hour_angle, &prev_altitude);
+    bool above_at_start = prev_altitude >= 0.0;
+
+    for (int k = 1; k <= TRACK_SAMPLES; ++k)
+    {
+        double a = track_sample_date(track, k - 1);
+        double b = track_sample_date(track, k);
+
+        double hour_angle, altitude;
+        track_horizontal(search, b, &hour_angle, &altitude);
+
+        if (isnan(events->rise) && prev_altitude < 0.0 && altitude >= 0.0)
+        {
+            events->rise = refine_event(search, a, b, false);
+        }
+        if (isnan(events->set) && prev_altitude >= 0.0 && altitude < 0.0)
+        {
+            events->set = refine_event(search, a, b, false);
+        }
+
+        // The hour angle also wraps from π to -π at lower transit
+        if (isnan(events->transit) && prev_hour_angle < 0.0 && hour_angle >= 0.0 && hour_angle - prev_hour_angle < M_PI)
+        {
+            events->transit = refine_event(search, a, b, true);
+        }
+
+        prev_hour_angle = hour_angle;
+        prev_altitude = altitude;
+    }
+
+    if (!isnan(events->rise) || !isnan(events->set))
+    {
+        events->kind = RISE_SET_NORMAL;
+    }
+    else
+    {
+        events->kind = above_at_start ? RISE_SET_CIRCUMPOLAR : RISE_SET_NEVER_RISES;
+    }
+}
+
+void calc_star_rise_transit_set(const struct Star *star_table, unsigned int num_stars, double julian_date, double latitude,
+                                double longitude, struct RiseTransitSet *events)
+{
+    for (unsigned int i = 0; i < num_stars; ++i)
+    {
+        const struct Star *star = &star_table[i];
+
+        double right_ascension, declination;
+        calc_star_position(star->right_ascension, star->ra_motion, star->declination, star->dec_motion, julian_date,
+                           &right_ascension, &declination);
+
+        calc_rise_transit_set_fixed(right_ascension, declination, latitude, longitude, RISE_SET_ALTITUDE_STAR * TO_RAD,
+                                    julian_date, &events[i]);
+    }
+}
+
+void calc_planet_rise_transit_set(const struct Planet *planet_table, double julian_date, double latitude, double longitude,
+                                  struct RiseTransitSet *events)
+{
+    // The Earth's position is shared by every planet
+    struct Track earth;
+    track_init(&earth, julian_date);
+    for (int k = 0; k <= TRACK_SAMPLES; ++k)
+    {
+        calc_planet_helio_ICRF(planet_table[EARTH].elements, planet_table[EARTH].rates, planet_table[EARTH].extras,
+                               track_sample_date(&earth, k), &earth.x[k], &earth.y[k], &earth.z[k]);
+    }
+
+    for (int i = SUN; i < NUM_PLANETS; ++i)
+    {
+        if (i == EARTH)
+        {
+            events[i] = (struct RiseTransitSet){NAN, NAN, NAN, RISE_SET_NEVER_RISES};
+            continue;
+        }
+
+        struct Track track;
+        track_init(&track, julian_date);
+        for (int k = 0; k <= TRACK_SAMPLES; ++k)
+        {
+            calc_planet_geo_position(planet_table, i, earth.x[k], earth.y[k], earth.z[k], track_sample_date(&track, k),
+                                     &track.x[k], &track.y[k], &track.z[k]);
+        }
+
+        struct EventSearch search = {
+            .track = &track,
+            .latitude = latitude,
+            .longitude = longitude,
+            .horizon = (i == SUN ? RISE_SET_ALTITUDE_SUN : RISE_SET_ALTITUDE_STAR) * TO_RAD,
+        };
+        search_track(&search, &events[i]);
+    }
+}
+
+void calc_moon_rise_transit_set(const struct Moon *moon_object, double julian_date, double latitude, double longitude,
+                                struct RiseTransitSet *events)
+{
+    struct Track track;
+    track_init(&track, julian_date);
+    for (int k = 0; k <= TRACK_SAMPLES; ++k)
+    {
+        calc_moon_geo_ICRF(moon_object->elements, moon_object->rates, track_sample_date(&track, k), &track.x[k],
+                           &track.y[k], &track.z[k]);
+    }
+
+    struct EventSearch search = {
+        .track = &track,
+        .latitude = latitude,
+        .longitude = longitude,
+        .horizon = RISE_SET_ALTITUDE_MOON * TO_RAD,
+    };
+    search_track(&search, events);
+}
+
+void calc_catalog_rise_transit_set(const struct Star *star_table, unsigned int num_stars, const struct Planet *planet_table,
+                                   const struct Moon *moon_object, double julian_date, double latitude, double longitude,
+                                   struct RiseTransitSet *star_events, struct RiseTransitSet *planet_events,
+                                   struct RiseTransitSet *moon_events)
+{
+    calc_star_rise_transit_set(star_table, num_stars, julian_date, latitude, longitude, star_events);
+    calc_planet_rise_transit_set(planet_table, julian_date, latitude, longitude, planet_events);
+    calc_moon_rise_transit_set(moon_object, julian_date, latitude, longitude, moon_events);
+}
+
 // FIXME: this does not render the correct phase and angle
 void update_moon_phase(struct Moon *moon_object, double julian_date, double latitude)
 {
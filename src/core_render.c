@@ -4,11 +4,14 @@
 #include "coord.h"
 #include "core.h"
 #include "drawing.h"
+#include "labels.h"
 #include "term.h"
 
 #include <curses.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
 
 void horizontal_to_polar(double azimuth, double altitude, double *radius, double *theta)
 {
@@ -20,195 +23,614 @@ void horizontal_to_polar(double azimuth, double altitude, double *radius, double
     return;
 }
 
-void render_object_stereo(WINDOW *win, struct ObjectBase *object, const struct Conf *config)
+/* Cell of an object on the projection. Returns false if it lies outside
+ */
+static bool object_cell(const struct Canvas *canvas, const struct ObjectBase *object, int *y, int *x)
 {
     double radius_polar, theta_polar;
     horizontal_to_polar(object->azimuth, object->altitude, &radius_polar, &theta_polar);
 
-    int y, x;
     int height, width;
-    getmaxyx(win, height, width);
-    polar_to_win(radius_polar, theta_polar, height, width, &y, &x);
+    canvas_size(canvas, &height, &width);
+    polar_to_win(radius_polar, theta_polar, height, width, y, x);
 
-    // If outside projection, ignore
-    if (fabs(radius_polar) > 1)
+    return fabs(radius_polar) <= 1;
+}
+
+/* Draw an object's label, in its color if it has one
+ */
+static void render_label(struct Canvas *canvas, const struct ObjectBase *object, const struct Conf *config,
+                         const struct LabelSpot *label)
+{
+    if (label == NULL || !label->shown || object->label == NULL)
     {
         return;
     }
 
+    bool use_color = config->color && object->color_pair != 0;
+    if (use_color)
+    {
+        canvas_color_on(canvas, object->color_pair);
+    }
+    canvas_add_str(canvas, label->y, label->x, object->label);
+    if (use_color)
+    {
+        canvas_color_off(canvas, object->color_pair);
+    }
+}
+
+/* Draw a symbol at a cell, in an object's color if it has one
+ */
+static void render_symbol(struct Canvas *canvas, const struct ObjectBase *object, const struct Conf *config, int y, int x,
+                          char symbol_ASCII, const char *symbol_unicode)
+{
     bool use_color = config->color && object->color_pair != 0;
 
     if (use_color)
     {
-        wattron(win, COLOR_PAIR(object->color_pair));
+        canvas_color_on(canvas, object->color_pair);
     }
 
     // Draw object
     if (config->unicode)
     {
-        mvwaddstr(win, y, x, object->symbol_unicode);
+        canvas_add_str(canvas, y, x, symbol_unicode);
     }
     else
     {
-        mvwaddch(win, y, x, object->symbol_ASCII);
+        canvas_add_char(canvas, y, x, symbol_ASCII);
     }
 
-    // Draw label
-    if (object->label != NULL)
+    if (use_color)
     {
-        mvwaddstr_truncate(win, y - 1, x + 1, object->label);
+        canvas_color_off(canvas, object->color_pair);
     }
+}
 
-    if (use_color)
+void render_object_stereo(struct Canvas *canvas, const struct ObjectBase *object, const struct Conf *config,
+                          const struct LabelSpot *label)
+{
+    // If outside projection, ignore
+    int y, x;
+    if (!object_cell(canvas, object, &y, &x))
     {
-        wattroff(win, COLOR_PAIR(object->color_pair));
+        return;
     }
 
+    render_symbol(canvas, object, config, y, x, object->symbol_ASCII, object->symbol_unicode);
+    render_label(canvas, object, config, label);
+
     return;
 }
 
-void render_stars_stereo(WINDOW *win, const struct Conf *config, struct Star *star_table, int num_stars, const int *num_by_mag)
+int object_symbol_width(const struct ObjectBase *object, const struct Conf *config)
 {
-    int i;
-    for (i = 0; i < num_stars; ++i)
+    if (!config->unicode || object->symbol_unicode == NULL)
     {
-        int catalog_num = num_by_mag[i];
-        int table_index = catalog_num - 1;
+        return 1;
+    }
 
-        struct Star *star = &star_table[table_index];
+    // Views are drawn from several threads, so no shared conversion state
+    mbstate_t state = {0};
+    wchar_t wch;
+    size_t length = mbrtowc(&wch, object->symbol_unicode, strlen(object->symbol_unicode), &state);
+    if (length == (size_t)-1 || length == (size_t)-2 || length == 0)
+    {
+        return 1;
+    }
+    return wcwidth(wch) == 2 ? 2 : 1;
+}
 
-        if (star->magnitude > config->threshold)
+/* Mark the cells of an object's symbol as occupied
+ */
+static void occupy_symbol(struct LabelGrid *grid, const struct Canvas *canvas, const struct ObjectBase *object,
+                          const struct Conf *config)
+{
+    int y, x;
+    if (object_cell(canvas, object, &y, &x))
+    {
+        label_grid_occupy(grid, y, x, object_symbol_width(object, config));
+    }
+}
+
+/* Place the label of an object drawn at (y, x)
+ */
+static void place_label_at(struct LabelGrid *grid, const struct ObjectBase *object, const struct Conf *config, int y,
+                           int x, struct LabelSpot *spot)
+{
+    *spot = (struct LabelSpot){0};
+    if (object->label != NULL)
+    {
+        spot->shown = label_grid_place(grid, y, x, object_symbol_width(object, config), (int)strlen(object->label),
+                                       &spot->y, &spot->x);
+    }
+}
+
+static void place_object_label(struct LabelGrid *grid, const struct Canvas *canvas, const struct ObjectBase *object,
+                               const struct Conf *config, struct LabelSpot *spot)
+{
+    int y, x;
+    if (object_cell(canvas, object, &y, &x))
+    {
+        place_label_at(grid, object, config, y, x, spot);
+    }
+    else
+    {
+        *spot = (struct LabelSpot){0};
+    }
+}
+
+// Drawn by `render_cardinal_directions` at `cardinal_direction_cell`
+static const char cardinal_directions[4] = {'N', 'W', 'S', 'E'};
+
+/* Cell of one of `cardinal_directions` on the horizon
+ */
+static void cardinal_direction_cell(int height, int width, int direction, int *y, int *x)
+{
+    int maxy = height - 1;
+    int maxx = width - 1;
+
+    int half_maxy = round(maxy / 2.0);
+    int half_maxx = round(maxx / 2.0);
+
+    const int cells[4][2] = {{0, half_maxx}, {half_maxy, width - 1}, {height - 1, half_maxx}, {half_maxy, 0}};
+    *y = cells[direction][0];
+    *x = cells[direction][1];
+}
+
+/* Make room for `count` star labels. Returns false upon memory allocation
+ * error
+ */
+static bool reserve_star_labels(struct LabelLayout *layout, unsigned int count)
+{
+    if (count <= layout->capacity)
+    {
+        return true;
+    }
+
+    struct StarLabel *stars = realloc(layout->stars, count * sizeof(struct StarLabel));
+    if (stars == NULL)
+    {
+        return false;
+    }
+    layout->stars = stars;
+    layout->capacity = count;
+    return true;
+}
+
+void place_labels(struct LabelLayout *layout, const struct Canvas *canvas, const struct Conf *config,
+                  const struct StarBins *stars, const struct Planet *planet_table, const struct Moon *moon_object)
+{
+    layout->num_stars = 0;
+    memset(layout->planets, 0, sizeof(layout->planets));
+    layout->moon = (struct LabelSpot){0};
+
+    int height, width;
+    canvas_size(canvas, &height, &width);
+    if (!reserve_star_labels(layout, stars->num_occupied) || !label_grid_reset(&layout->grid, height, width))
+    {
+        return;
+    }
+
+    // Every symbol is marked first, so no label covers one
+    for (unsigned int i = 0; i < stars->num_occupied; ++i)
+    {
+        const struct StarCell *cell = &stars->occupied[i];
+        label_grid_occupy(&layout->grid, cell->y, cell->x, object_symbol_width(&cell->star->base, config));
+    }
+    for (int i = 0; i < NUM_PLANETS; ++i)
+    {
+        if (i != EARTH)
+        {
+            occupy_symbol(&layout->grid, canvas, &planet_table[i].base, config);
+        }
+    }
+    occupy_symbol(&layout->grid, canvas, &moon_object->base, config);
+    for (int i = 0; !config->grid && i < (int)sizeof(cardinal_directions); ++i)
+    {
+        int y, x;
+        cardinal_direction_cell(height, width, i, &y, &x);
+        label_grid_occupy(&layout->grid, y, x, 1);
+    }
+
+    // Bodies sorted by magnitude, to be merged with the stars which already are
+    const struct ObjectBase *bodies[NUM_PLANETS];
+    float magnitudes[NUM_PLANETS];
+    struct LabelSpot *spots[NUM_PLANETS];
+    int num_bodies = 0;
+    for (int i = 0; i <= NUM_PLANETS; ++i)
+    {
+        if (i == EARTH)
         {
             continue;
         }
 
-        // FIXME: this is hacky
-        if (star->magnitude > config->label_thresh)
+        const struct ObjectBase *body = i < NUM_PLANETS ? &planet_table[i].base : &moon_object->base;
+        float magnitude = i < NUM_PLANETS ? planet_table[i].magnitude : moon_object->magnitude;
+        struct LabelSpot *spot = i < NUM_PLANETS ? &layout->planets[i] : &layout->moon;
+
+        int j = num_bodies++;
+        for (; j > 0 && magnitudes[j - 1] > magnitude; --j)
+        {
+            bodies[j] = bodies[j - 1];
+            magnitudes[j] = magnitudes[j - 1];
+            spots[j] = spots[j - 1];
+        }
+        bodies[j] = body;
+        magnitudes[j] = magnitude;
+        spots[j] = spot;
+    }
+
+    // Brightest first, so faint objects give way to bright ones: `occupied`
+    // lists stars brightest first, and bodies are merged in by magnitude. Stars
+    // hidden by brighter ones in the same cell are not labeled
+    unsigned int star_index = 0;
+    int body_index = 0;
+    while (true)
+    {
+        const struct StarCell *cell = NULL;
+        for (; cell == NULL && star_index < stars->num_occupied; ++star_index)
         {
-            star->base.label = NULL;
+            const struct StarCell *candidate = &stars->occupied[star_index];
+            if (candidate->star->base.label != NULL && candidate->star->magnitude <= config->label_thresh)
+            {
+                cell = candidate;
+            }
         }
 
-        render_object_stereo(win, &star->base, config);
+        // Ties go to bodies
+        while (body_index < num_bodies && (cell == NULL || magnitudes[body_index] <= cell->star->magnitude))
+        {
+            place_object_label(&layout->grid, canvas, bodies[body_index], config, spots[body_index]);
+            ++body_index;
+        }
+
+        if (cell == NULL)
+        {
+            break;
+        }
+
+        struct StarLabel *label = &layout->stars[layout->num_stars];
+        place_label_at(&layout->grid, &cell->star->base, config, cell->y, cell->x, &label->spot);
+        if (label->spot.shown)
+        {
+            label->star = cell->star;
+            ++layout->num_stars;
+        }
     }
+}
 
-    return;
+void free_label_layout(struct LabelLayout *layout)
+{
+    free_label_grid(&layout->grid);
+    free(layout->stars);
+    *layout = (struct LabelLayout){0};
 }
 
-void render_constellation(WINDOW *win, const struct Conf *config, struct Constell *constellation, const struct Star *star_table)
+/* Make room for `count` binned stars in a window of `num_cells` cells.
+ * Returns false upon memory allocation error
+ */
+static bool reserve_star_bins(struct StarBins *bins, size_t num_cells, unsigned int count)
 {
-    unsigned int num_segments = constellation->num_segments;
+    if (num_cells > bins->num_cells)
+    {
+        int *cells = realloc(bins->cells, num_cells * sizeof(int));
+        unsigned char *dots = cells != NULL ? realloc(bins->dots, num_cells) : NULL;
+        if (dots == NULL)
+        {
+            // Either may have moved, but neither holds anything yet
+            bins->cells = cells != NULL ? cells : bins->cells;
+            return false;
+        }
+        bins->cells = cells;
+        bins->dots = dots;
+        bins->num_cells = num_cells;
+    }
 
-    // Only render if all stars are visible
-    for (unsigned int i = 0; i < num_segments * 2; i += 1)
+    if (count > bins->capacity)
     {
-        int catalog_num = constellation->star_numbers[i];
-        int table_index = catalog_num - 1;
-        struct Star star = star_table[table_index];
-        if (star.magnitude > config->threshold)
+        struct StarCell *occupied = realloc(bins->occupied, count * sizeof(struct StarCell));
+        if (occupied == NULL)
         {
-            return;
+            return false;
         }
+        bins->occupied = occupied;
+        bins->capacity = count;
     }
 
-    for (unsigned int i = 0; i < num_segments * 2; i += 2)
+    return true;
+}
+
+/* Magnitude of the light of two stars together
+ */
+static float combined_magnitude(float a, float b)
+{
+    return -2.5f * log10f(powf(10.0f, -0.4f * a) + powf(10.0f, -0.4f * b));
+}
+
+/* Set a Braille dot of the binned window, given in dots from its top left
+ */
+static void plot_braille_dot(struct StarBins *bins, int dot_y, int dot_x)
+{
+    if (dot_y < 0 || dot_y >= 4 * bins->height || dot_x < 0 || dot_x >= 2 * bins->width)
     {
-        int catalog_num_a = constellation->star_numbers[i];
-        int catalog_num_b = constellation->star_numbers[i + 1];
+        return;
+    }
+    bins->dots[(size_t)(dot_y / 4) * bins->width + dot_x / 2] |= braille_dot(dot_y % 4, dot_x % 2);
+}
+
+/* Plot a star as Braille dots, returning the cell of its first dot. Stars of
+ * the two brightest symbols take a square of four dots and the next two a pair
+ */
+static void plot_braille_star(struct StarBins *bins, const struct Star *star, double radius, double theta, int *y,
+                              int *x)
+{
+    int dot_y, dot_x;
+    polar_to_win(radius, theta, 4 * bins->height, 2 * bins->width, &dot_y, &dot_x);
+    *y = dot_y / 4;
+    *x = dot_x / 2;
+
+    char symbol_ASCII;
+    const char *symbol_unicode;
+    star_symbols(star->magnitude, &symbol_ASCII, &symbol_unicode);
 
-        int table_index_a = catalog_num_a - 1;
-        int table_index_b = catalog_num_b - 1;
+    plot_braille_dot(bins, dot_y, dot_x);
+    if (symbol_ASCII == '0' || symbol_ASCII == 'O')
+    {
+        plot_braille_dot(bins, dot_y, dot_x + 1);
+    }
+    if (symbol_ASCII == '0')
+    {
+        plot_braille_dot(bins, dot_y + 1, dot_x);
+        plot_braille_dot(bins, dot_y + 1, dot_x + 1);
+    }
+}
 
-        struct Star star_a = star_table[table_index_a];
-        struct Star star_b = star_table[table_index_b];
+void bin_stars(struct StarBins *bins, const struct Canvas *canvas, const struct Conf *config, const struct Star *star_table,
+               int num_stars, const int *num_by_mag)
+{
+    bins->num_occupied = 0;
 
-        // TODO: Same code as in render_object_stereo... perhaps refactor this
-        // or cache coordinates
-        double radius_a, theta_a;
-        double radius_b, theta_b;
-        horizontal_to_polar(star_a.base.azimuth, star_a.base.altitude, &radius_a, &theta_a);
-        horizontal_to_polar(star_b.base.azimuth, star_b.base.altitude, &radius_b, &theta_b);
+    int height, width;
+    canvas_size(canvas, &height, &width);
+    size_t num_cells = (size_t)MAX(0, height) * MAX(0, width);
+    if (!reserve_star_bins(bins, num_cells, (unsigned int)MIN((size_t)MAX(0, num_stars), num_cells)))
+    {
+        bins->height = 0;
+        bins->width = 0;
+        return;
+    }
+    bins->height = MAX(0, height);
+    bins->width = MAX(0, width);
+    for (size_t i = 0; i < num_cells; ++i)
+    {
+        bins->cells[i] = -1;
+    }
+    if (num_cells > 0)
+    {
+        memset(bins->dots, 0, num_cells);
+    }
 
-        // Clip to edge of screen
-        if (fabs(radius_a) > 1 && fabs(radius_b) > 1)
+    // `num_by_mag` lists the dimmest star first, so walk it backwards
+    bool braille = config->braille_stars && config->unicode;
+    for (int i = num_stars - 1; i >= 0; --i)
+    {
+        const struct Star *star = &star_table[num_by_mag[i] - 1];
+        if (star->magnitude > config->threshold)
         {
-            // Segment lies outside of screen
             continue;
         }
 
-        bool a_clipped = false;
-        bool b_clipped = false;
+        double radius, theta;
+        horizontal_to_polar(star->base.azimuth, star->base.altitude, &radius, &theta);
+        if (fabs(radius) > 1)
+        {
+            continue;
+        }
 
-        // Clip the segment
-        if (fabs(radius_a) > 1)
+        int y, x;
+        if (braille)
+        {
+            plot_braille_star(bins, star, radius, theta, &y, &x);
+        }
+        else
         {
-            a_clipped = true;
-            radius_a = 1.0;
+            polar_to_win(radius, theta, height, width, &y, &x);
         }
-        else if (fabs(radius_b) > 1)
+        if (y < 0 || y >= height || x < 0 || x >= width)
         {
-            b_clipped = true;
-            radius_b = 1.0;
+            continue;
         }
 
-        int height, width;
-        getmaxyx(win, height, width);
+        // The first star to land in a cell is the brightest
+        int *cell = &bins->cells[(size_t)y * width + x];
+        if (*cell < 0)
+        {
+            *cell = (int)bins->num_occupied;
+            bins->occupied[bins->num_occupied++] = (struct StarCell){star, y, x, star->magnitude};
+        }
+        else if (config->combine_stars)
+        {
+            struct StarCell *occupant = &bins->occupied[*cell];
+            occupant->magnitude = combined_magnitude(occupant->magnitude, star->magnitude);
+        }
+    }
+}
 
-        int ya, xa;
-        int yb, xb;
-        polar_to_win(radius_a, theta_a, height, width, &ya, &xa);
+void free_star_bins(struct StarBins *bins)
+{
+    free(bins->cells);
+    free(bins->dots);
+    free(bins->occupied);
+    *bins = (struct StarBins){0};
+}
 
-        polar_to_win(radius_b, theta_b, height, width, &yb, &xb);
+/* Draw the symbol of each occupied cell
+ */
+static void render_star_cells(struct Canvas *canvas, const struct Conf *config, const struct StarBins *stars)
+{
+    for (unsigned int i = 0; i < stars->num_occupied; ++i)
+    {
+        const struct StarCell *cell = &stars->occupied[i];
+        const struct ObjectBase *base = &cell->star->base;
 
-        // TODO: In old version, constrained line length for some reason... not
-        // sure why?
-        // FIXME: this logic is super verbose/long (any way to cut it down?)
-        // FIXME: this clipping doesn't seem to work or no-unicode for some reason?
-        if (config->unicode)
+        char symbol_ASCII = base->symbol_ASCII;
+        const char *symbol_unicode = base->symbol_unicode;
+        if (config->combine_stars)
         {
-            if (config->braille)
-            {
-                draw_line_braille(win, ya, xa, yb, xb);
-            }
-            else
-            {
-                draw_line_smooth(win, ya, xa, yb, xb);
-            }
-            if (!a_clipped)
-            {
-                mvwaddstr(win, ya, xa, "\u25CB"); // Unicode circle symbol
-            }
-            if (!b_clipped)
+            star_symbols(cell->magnitude, &symbol_ASCII, &symbol_unicode);
+        }
+        render_symbol(canvas, base, config, cell->y, cell->x, symbol_ASCII, symbol_unicode);
+    }
+}
+
+/* Find the first cell from `*index` on holding Braille dots. Cells are checked
+ * eight at a time, so the empty sky is skipped quickly
+ */
+static bool next_braille_cell(const struct StarBins *bins, size_t *index)
+{
+    size_t num_cells = (size_t)bins->height * bins->width;
+    size_t i = *index;
+    while (i < num_cells)
+    {
+        if (i % 8 == 0 && num_cells - i >= 8)
+        {
+            uint64_t word;
+            memcpy(&word, bins->dots + i, sizeof(word));
+            if (word == 0)
             {
-                mvwaddstr(win, yb, xb, "\u25CB");
+                i += 8;
+                continue;
             }
         }
+        if (bins->dots[i] != 0)
+        {
+            *index = i;
+            return true;
+        }
+        ++i;
+    }
+    return false;
+}
+
+void render_stars_stereo(struct Canvas *canvas, const struct Conf *config, const struct StarBins *stars,
+                         const struct LabelLayout *labels)
+{
+    if (config->braille_stars && config->unicode)
+    {
+        // Constellation lines are merged with the stars' dots
+        canvas_clear_braille(canvas);
+        for (size_t i = 0; next_braille_cell(stars, &i); ++i)
+        {
+            draw_braille_cell(canvas, (int)(i / stars->width), (int)(i % stars->width), stars->dots[i]);
+        }
+    }
+    else
+    {
+        render_star_cells(canvas, config, stars);
+    }
+
+    for (unsigned int i = 0; labels != NULL && i < labels->num_stars; ++i)
+    {
+        render_label(canvas, &labels->stars[i].star->base, config, &labels->stars[i].spot);
+    }
+
+    return;
+}
+
+/* Cell of a constellation vertex, clamped to the edge of the projection.
+ * Returns true if the vertex lies outside and was clamped
+ */
+static bool constell_vertex_cell(const struct Canvas *canvas, const struct Star *star, int *y, int *x)
+{
+    double radius, theta;
+    horizontal_to_polar(star->base.azimuth, star->base.altitude, &radius, &theta);
+
+    bool clipped = fabs(radius) > 1;
+    if (clipped)
+    {
+        radius = 1.0;
+    }
+
+    int height, width;
+    canvas_size(canvas, &height, &width);
+    polar_to_win(radius, theta, height, width, y, x);
+
+    return clipped;
+}
+
+/* Render one constellation segment, clipped to the edge of the projection
+ */
+static void render_constell_segment(struct Canvas *canvas, const struct Conf *config, const struct Star *star_a,
+                                    const struct Star *star_b)
+{
+    int ya, xa;
+    int yb, xb;
+    bool a_clipped = constell_vertex_cell(canvas, star_a, &ya, &xa);
+    bool b_clipped = constell_vertex_cell(canvas, star_b, &yb, &xb);
+
+    if (a_clipped && b_clipped)
+    {
+        // Segment lies outside of screen
+        return;
+    }
+
+    // TODO: In old version, constrained line length for some reason... not
+    // sure why?
+    // FIXME: this logic is super verbose/long (any way to cut it down?)
+    if (config->unicode)
+    {
+        if (config->braille)
+        {
+            draw_line_braille(canvas, ya, xa, yb, xb);
+        }
         else
         {
-            draw_line_ASCII(win, ya, xa, yb, xb);
-            if (!a_clipped)
-            {
-                mvwaddch(win, ya, xa, '+');
-            }
-            if (!b_clipped)
-            {
-                mvwaddch(win, yb, xb, '+');
-            }
+            draw_line_smooth(canvas, ya, xa, yb, xb);
+        }
+        if (!a_clipped)
+        {
+            canvas_add_str(canvas, ya, xa, "\u25CB"); // Unicode circle symbol
+        }
+        if (!b_clipped)
+        {
+            canvas_add_str(canvas, yb, xb, "\u25CB");
+        }
+    }
+    else
+    {
+        draw_line_ASCII(canvas, ya, xa, yb, xb);
+        if (!a_clipped)
+        {
+            canvas_add_char(canvas, ya, xa, '+');
+        }
+        if (!b_clipped)
+        {
+            canvas_add_char(canvas, yb, xb, '+');
         }
     }
 }
 
-void render_constells(WINDOW *win, const struct Conf *config, struct Constell **constell_table, int num_const,
+void render_constells(struct Canvas *canvas, const struct Conf *config, const struct ConstellGraph *graph,
                       const struct Star *star_table)
 {
-    clear_braille_lines();
-    for (int i = 0; i < num_const; ++i)
+    // Braille stars were just drawn in the same layer, so keep their dots
+    if (!(config->braille_stars && config->unicode))
+    {
+        canvas_clear_braille(canvas);
+    }
+
+    // Figures with stars dimmer than the threshold were already dropped by
+    // `constell_graph_set_threshold`
+    const int *edges = graph->visible_edges;
+    for (unsigned int i = 0; i < graph->num_visible_edges; ++i)
     {
-        struct Constell *constellation = &((*constell_table)[i]);
-        render_constellation(win, config, constellation, star_table);
+        render_constell_segment(canvas, config, &star_table[edges[2 * i]], &star_table[edges[2 * i + 1]]);
     }
 }
 
-void render_planets_stereo(WINDOW *win, const struct Conf *config, const struct Planet *planet_table)
+void render_planets_stereo(struct Canvas *canvas, const struct Conf *config, const struct Planet *planet_table,
+                           const struct LabelLayout *labels)
 {
     // Render planets so that closest are drawn on top
     int i;
@@ -222,20 +644,23 @@ void render_planets_stereo(WINDOW *win, const struct Conf *config, const struct
             continue;
         }
 
-        struct Planet planet_data = planet_table[i];
-        render_object_stereo(win, &planet_data.base, config);
+        render_object_stereo(canvas, &planet_table[i].base, config, labels != NULL ? &labels->planets[i] : NULL);
     }
 
     return;
 }
 
-void render_moon_stereo(WINDOW *win, const struct Conf *config, struct Moon moon_object)
+void render_moon_stereo(struct Canvas *canvas, const struct Conf *config, const struct Moon *moon_object,
+                        const struct LabelLayout *labels)
 {
-    render_object_stereo(win, &moon_object.base, config);
+    render_object_stereo(canvas, &moon_object->base, config, labels != NULL ? &labels->moon : NULL);
 
     return;
 }
 
+// Smallest angle between grid spokes (degrees)
+#define GRID_MIN_STEP 10
+
 int gcd(int a, int b)
 {
     while (b != 0)
@@ -255,20 +680,21 @@ int compare_angles(const void *a, const void *b)
     return (90 / gcd(x, 90)) < (90 / gcd(y, 90));
 }
 
-void render_azimuthal_grid(WINDOW *win, const struct Conf *config)
+void render_azimuthal_grid(struct Canvas *canvas, const struct Conf *config)
 {
     const double to_rad = M_PI / 180.0;
 
     int height, width;
-    getmaxyx(win, height, width);
+    canvas_size(canvas, &height, &width);
     int maxy = height - 1;
     int maxx = width - 1;
 
     int rad_vertical = round(maxy / 2.0);
     int rad_horizontal = round(maxx / 2.0);
 
-    // Possible step sizes in degrees (multiples of 5 and factors of 90)
-    int step_sizes[5] = {10, 15, 30, 45, 90};
+    // Possible step sizes in degrees (multiples of 5 and factors of 90),
+    // smallest first. The smallest also sizes the list of angles below
+    static const int step_sizes[] = {GRID_MIN_STEP, 15, 30, 45, 90};
     int length = sizeof(step_sizes) / sizeof(step_sizes[0]);
 
     // Minimum number of rows separating grid line (at end of window)
@@ -288,7 +714,7 @@ void render_azimuthal_grid(WINDOW *win, const struct Conf *config)
 
     // Sort grid angles in the first quadrant by rendering priority
     int number_angles = 90 / inc + 1;
-    int *angles = malloc(number_angles * sizeof(int));
+    int angles[90 / GRID_MIN_STEP + 1];
 
     for (int i = 0; i < number_angles; ++i)
     {
@@ -309,24 +735,20 @@ void render_azimuthal_grid(WINDOW *win, const struct Conf *config)
 
             if (config->unicode)
             {
-                draw_line_smooth(win, y, x, rad_vertical, rad_horizontal);
+                draw_line_smooth(canvas, y, x, rad_vertical, rad_horizontal);
             }
             else
             {
-                draw_line_ASCII(win, y, x, rad_vertical, rad_horizontal);
+                draw_line_ASCII(canvas, y, x, rad_vertical, rad_horizontal);
             }
 
-            int str_len = snprintf(NULL, 0, "%d", angle);
-            char *label = malloc(str_len + 1);
-
-            snprintf(label, str_len + 1, "%d", angle);
+            char label[8];
+            int str_len = snprintf(label, sizeof(label), "%d", angle);
 
             // Offset to avoid truncating string
             int x_off = (x < rad_horizontal) ? 0 : -(str_len - 1);
 
-            mvwaddstr(win, y, x + x_off, label);
-
-            free(label);
+            canvas_add_str(canvas, y, x + x_off, label);
         }
     }
 
@@ -339,30 +761,464 @@ void render_azimuthal_grid(WINDOW *win, const struct Conf *config)
     // }
 }
 
-void render_cardinal_directions(WINDOW *win, const struct Conf *config)
+uint64_t layer_signature_add(uint64_t signature, long long value)
 {
-    // Render horizon directions
+    // FNV-1a taking a whole value at a time, folding the high bits back down
+    signature ^= (uint64_t)value;
+    signature *= 0x100000001B3ull;
+    return signature ^ (signature >> 29);
+}
 
-    if (config->color)
+static uint64_t layer_signature_add_string(uint64_t signature, const char *str)
+{
+    for (const char *p = str; p != NULL && *p != '\0'; ++p)
+    {
+        signature = layer_signature_add(signature, *p);
+    }
+    return layer_signature_add(signature, str != NULL);
+}
+
+uint64_t stars_layer_signature(const struct Canvas *canvas, const struct Conf *config, const struct StarBins *stars,
+                               const struct Star *star_table, const struct ConstellGraph *graph,
+                               const struct LabelLayout *labels)
+{
+    uint64_t signature = LAYER_SIGNATURE_SEED;
+    signature = layer_signature_add(signature, config->unicode);
+    signature = layer_signature_add(signature, config->color);
+    signature = layer_signature_add(signature, config->braille);
+
+    // Braille stars differ in their dots instead, which hidden stars add to
+    signature = layer_signature_add(signature, config->braille_stars);
+    for (size_t i = 0; config->braille_stars && config->unicode && next_braille_cell(stars, &i); ++i)
+    {
+        signature = layer_signature_add(signature, (long long)i);
+        signature = layer_signature_add(signature, stars->dots[i]);
+    }
+
+    // Stars hidden by brighter ones in the same cell make no difference
+    signature = layer_signature_add(signature, config->combine_stars);
+    for (unsigned int i = 0; i < stars->num_occupied; ++i)
+    {
+        const struct StarCell *cell = &stars->occupied[i];
+        signature = layer_signature_add(signature, cell->star->catalog_number);
+        signature = layer_signature_add(signature, cell->y);
+        signature = layer_signature_add(signature, cell->x);
+        if (config->combine_stars)
+        {
+            signature = layer_signature_add(signature, (long long)(cell->magnitude * 1000.0f));
+        }
+    }
+
+    // Labels move aside for each other and for the planets and Moon
+    for (unsigned int i = 0; labels != NULL && i < labels->num_stars; ++i)
+    {
+        const struct StarLabel *label = &labels->stars[i];
+        signature = layer_signature_add(signature, label->star->catalog_number);
+        signature = layer_signature_add(signature, label->spot.y);
+        signature = layer_signature_add(signature, label->spot.x);
+    }
+
+    if (!config->constell)
+    {
+        return signature;
+    }
+
+    // Segments follow their vertices, and those outside are drawn up to the edge
+    const int *edges = graph->visible_edges;
+    signature = layer_signature_add(signature, graph->num_visible_edges);
+    for (unsigned int i = 0; i < 2 * graph->num_visible_edges; ++i)
+    {
+        int y, x;
+        bool clipped = constell_vertex_cell(canvas, &star_table[edges[i]], &y, &x);
+        signature = layer_signature_add(signature, clipped);
+        signature = layer_signature_add(signature, y);
+        signature = layer_signature_add(signature, x);
+    }
+
+    return signature;
+}
+
+void object_layer_item(const struct Canvas *canvas, const struct ObjectBase *object, const struct Conf *config,
+                       const struct LabelSpot *label, struct LayerItem *item)
+{
+    int y, x;
+    item->visible = object_cell(canvas, object, &y, &x);
+    item->signature = layer_signature_add(LAYER_SIGNATURE_SEED, item->visible);
+    item->rect = (struct CellRect){0};
+    if (!item->visible)
+    {
+        return;
+    }
+
+    // Symbols may be two cells wide
+    item->rect = (struct CellRect){.top = y, .left = x, .bottom = y, .right = x + 1};
+
+    bool labeled = label != NULL && label->shown && object->label != NULL;
+    if (labeled)
+    {
+        item->rect.top = MIN(item->rect.top, label->y);
+        item->rect.left = MIN(item->rect.left, label->x);
+        item->rect.bottom = MAX(item->rect.bottom, label->y);
+        item->rect.right = MAX(item->rect.right, label->x + (int)strlen(object->label) - 1);
+    }
+
+    // A wide symbol in the last column wraps onto the start of the next line
+    int height, width;
+    canvas_size(canvas, &height, &width);
+    if (x >= width - 1)
+    {
+        item->rect.left = 0;
+        item->rect.bottom = MAX(item->rect.bottom, y + 1);
+    }
+
+    item->signature = layer_signature_add(item->signature, y);
+    item->signature = layer_signature_add(item->signature, x);
+    item->signature = layer_signature_add(item->signature, config->color ? object->color_pair : 0);
+    if (config->unicode)
+    {
+        item->signature = layer_signature_add_string(item->signature, object->symbol_unicode);
+    }
+    else
     {
-        wattron(win, COLOR_PAIR(5));
+        item->signature = layer_signature_add(item->signature, object->symbol_ASCII);
     }
+    item->signature = layer_signature_add(item->signature, labeled);
+    if (labeled)
+    {
+        item->signature = layer_signature_add(item->signature, label->y);
+        item->signature = layer_signature_add(item->signature, label->x);
+        item->signature = layer_signature_add_string(item->signature, object->label);
+    }
+}
+
+// Fills the cells of a layer nothing was drawn in, so that spaces drawn in
+// labels still cover the layers below
+#define EMPTY_CELL 0x01
+
+/* Cell nothing was drawn in. Nothing lies under the bottom layer, so its empty
+ * cells are simply blank
+ */
+static chtype empty_cell(enum LayerIndex index)
+{
+    return index == 0 ? ' ' : EMPTY_CELL;
+}
+
+/* Empty a layer. Lines are marked as touched again once anything is drawn in
+ * them, so empty lines can be skipped when compositing
+ */
+static void erase_layer(const struct Compositor *compositor, enum LayerIndex index)
+{
+    WINDOW *pad = compositor->layers[index].pad;
+    wbkgdset(pad, empty_cell(index));
+    werase(pad);
+    wbkgdset(pad, ' ');
+    untouchwin(pad);
+}
 
+/* Fill a rectangle of a window, clipped to it
+ */
+static void fill_rect(WINDOW *win, struct CellRect rect, chtype fill)
+{
     int height, width;
     getmaxyx(win, height, width);
-    int maxy = height - 1;
-    int maxx = width - 1;
 
-    int half_maxy = round(maxy / 2.0);
-    int half_maxx = round(maxx / 2.0);
+    int left = MAX(0, rect.left);
+    int right = MIN(width - 1, rect.right);
+    for (int y = MAX(0, rect.top); y <= MIN(height - 1, rect.bottom) && left <= right; ++y)
+    {
+        mvwhline(win, y, left, fill, right - left + 1);
+    }
+}
+
+static void mark_dirty(struct RenderLayer *layer, struct CellRect rect)
+{
+    if (layer->num_dirty == MAX_DIRTY_RECTS)
+    {
+        layer->all_dirty = true;
+        return;
+    }
+    layer->dirty[layer->num_dirty++] = rect;
+}
+
+bool compositor_begin(struct Compositor *compositor, WINDOW *win)
+{
+    int height, width;
+    getmaxyx(win, height, width);
+
+    if (compositor->layers[0].pad != NULL && (compositor->height != height || compositor->width != width))
+    {
+        invalidate_compositor(compositor);
+    }
+
+    if (compositor->layers[0].pad != NULL)
+    {
+        return true;
+    }
+
+    cchar_t *cells = realloc(compositor->cells, (width + 1) * sizeof(cchar_t));
+    if (cells == NULL)
+    {
+        return false;
+    }
+    compositor->cells = cells;
+
+    compositor->height = height;
+    compositor->width = width;
+    for (int i = 0; i < NUM_LAYERS; ++i)
+    {
+        struct RenderLayer *layer = &compositor->layers[i];
+        layer->pad = newpad(height, width);
+        if (layer->pad == NULL)
+        {
+            invalidate_compositor(compositor);
+            return false;
+        }
+        layer->all_dirty = true;
+    }
+
+    return true;
+}
+
+WINDOW *compositor_redraw_layer(struct Compositor *compositor, enum LayerIndex index, uint64_t signature)
+{
+    struct RenderLayer *layer = &compositor->layers[index];
+    if (layer->drawn && layer->signature == signature)
+    {
+        return NULL;
+    }
+
+    erase_layer(compositor, index);
+    layer->drawn = true;
+    layer->signature = signature;
+    layer->itemized = false;
+    layer->all_dirty = true;
+
+    return layer->pad;
+}
 
-    mvwaddch(win, 0, half_maxx, 'N');
-    mvwaddch(win, half_maxy, width - 1, 'W');
-    mvwaddch(win, height - 1, half_maxx, 'S');
-    mvwaddch(win, half_maxy, 0, 'E');
+WINDOW *compositor_redraw_items(struct Compositor *compositor, enum LayerIndex index, const struct LayerItem *items,
+                                unsigned int num_items)
+{
+    if (num_items > MAX_LAYER_ITEMS)
+    {
+        uint64_t signature = LAYER_SIGNATURE_SEED;
+        for (unsigned int i = 0; i < num_items; ++i)
+        {
+            signature = layer_signature_add(signature, (long long)items[i].signature);
+        }
+        return compositor_redraw_layer(compositor, index, signature);
+    }
+
+    struct RenderLayer *layer = &compositor->layers[index];
+    bool tracked = layer->itemized && layer->num_items == num_items;
+
+    bool changed = !tracked;
+    for (unsigned int i = 0; tracked && i < num_items; ++i)
+    {
+        const struct LayerItem *old = &layer->items[i];
+        const struct LayerItem *item = &items[i];
+        if (old->signature == item->signature)
+        {
+            continue;
+        }
+
+        changed = true;
+        if (old->visible)
+        {
+            mark_dirty(layer, old->rect);
+        }
+        if (item->visible)
+        {
+            mark_dirty(layer, item->rect);
+        }
+    }
+    if (!changed)
+    {
+        return NULL;
+    }
+
+    if (tracked)
+    {
+        // Unchanged items are drawn again exactly where they were
+        for (unsigned int i = 0; i < num_items; ++i)
+        {
+            if (layer->items[i].visible)
+            {
+                fill_rect(layer->pad, layer->items[i].rect, empty_cell(index));
+            }
+        }
+    }
+    else
+    {
+        erase_layer(compositor, index);
+        layer->all_dirty = true;
+    }
+
+    memcpy(layer->items, items, num_items * sizeof(struct LayerItem));
+    layer->num_items = num_items;
+    layer->itemized = true;
+    layer->drawn = false;
+
+    return layer->pad;
+}
+
+void render_azimuthal_grid_layer(struct Compositor *compositor, const struct Conf *config)
+{
+    // The window size is covered by `compositor_begin`, which discards every
+    // layer when it changes
+    uint64_t signature = layer_signature_add(LAYER_SIGNATURE_SEED, config->grid);
+    signature = layer_signature_add(signature, config->unicode);
+    WINDOW *pad = compositor_redraw_layer(compositor, LAYER_GRID, signature);
+    if (pad != NULL && config->grid)
+    {
+        struct Canvas canvas = window_canvas(pad);
+        render_azimuthal_grid(&canvas, config);
+    }
+}
+
+/* Merge part of a row of every layer into the window, drawing the cells of each
+ * layer over those below as if they had been drawn directly. `cells` holds at
+ * least one more cell than the row
+ */
+static void composite_row(const struct Compositor *compositor, WINDOW *win, cchar_t *cells, int y, int left,
+                          int right)
+{
+    // Nothing lies under the bottom layer, so it is copied whole
+    copywin(compositor->layers[0].pad, win, y, left, y, left, y, right, FALSE);
+
+    for (int i = 1; i < NUM_LAYERS; ++i)
+    {
+        WINDOW *pad = compositor->layers[i].pad;
+        if (!is_linetouched(pad, y))
+        {
+            continue;
+        }
+
+        // Read from the start of the row, which skips the second column of wide
+        // characters, so columns are counted by width
+        if (mvwin_wchnstr(pad, y, 0, cells, right + 1) == ERR)
+        {
+            continue;
+        }
+
+        int x = 0;
+        for (const cchar_t *cell = cells; x <= right; ++cell)
+        {
+            wchar_t wch[CCHARW_MAX + 1] = {0};
+            attr_t attrs;
+            short pair;
+            if (getcchar(cell, wch, &attrs, &pair, NULL) == ERR || wch[0] == L'\0')
+            {
+                break;
+            }
+
+            if (x >= left && wch[0] != EMPTY_CELL)
+            {
+                mvwadd_wch(win, y, x, cell);
+            }
+            x += wcwidth(wch[0]) == 2 ? 2 : 1;
+        }
+    }
+}
+
+/* Merge one region of every layer into the window
+ */
+static void composite_rect(const struct Compositor *compositor, WINDOW *win, cchar_t *cells, struct CellRect rect)
+{
+    // Take in a column on either side for wide characters cut by the edges
+    int top = MAX(0, rect.top);
+    int left = MAX(0, rect.left - 1);
+    int bottom = MIN(compositor->height - 1, rect.bottom);
+    int right = MIN(compositor->width - 1, rect.right + 1);
+
+    for (int y = top; y <= bottom && left <= right; ++y)
+    {
+        composite_row(compositor, win, cells, y, left, right);
+    }
+}
+
+void compositor_composite(struct Compositor *compositor, WINDOW *win)
+{
+    if (compositor->layers[0].pad == NULL)
+    {
+        return;
+    }
+
+    cchar_t *cells = compositor->cells;
+
+    bool all_dirty = false;
+    for (int i = 0; i < NUM_LAYERS; ++i)
+    {
+        all_dirty = all_dirty || compositor->layers[i].all_dirty;
+    }
+
+    if (all_dirty)
+    {
+        composite_rect(compositor, win, cells, (struct CellRect){0, 0, compositor->height - 1, compositor->width - 1});
+    }
+    else
+    {
+        for (int i = 0; i < NUM_LAYERS; ++i)
+        {
+            const struct RenderLayer *layer = &compositor->layers[i];
+            for (unsigned int j = 0; j < layer->num_dirty; ++j)
+            {
+                composite_rect(compositor, win, cells, layer->dirty[j]);
+            }
+        }
+    }
+
+    for (int i = 0; i < NUM_LAYERS; ++i)
+    {
+        compositor->layers[i].all_dirty = false;
+        compositor->layers[i].num_dirty = 0;
+    }
+}
+
+void invalidate_compositor(struct Compositor *compositor)
+{
+    for (int i = 0; i < NUM_LAYERS; ++i)
+    {
+        if (compositor->layers[i].pad != NULL)
+        {
+            delwin(compositor->layers[i].pad);
+        }
+        compositor->layers[i] = (struct RenderLayer){0};
+    }
+    compositor->height = 0;
+    compositor->width = 0;
+}
+
+void free_compositor(struct Compositor *compositor)
+{
+    invalidate_compositor(compositor);
+    free(compositor->cells);
+    compositor->cells = NULL;
+    free_star_bins(&compositor->stars);
+    free_label_layout(&compositor->labels);
+}
+
+void render_cardinal_directions(struct Canvas *canvas, const struct Conf *config)
+{
+    // Render horizon directions
+
+    if (config->color)
+    {
+        canvas_color_on(canvas, 5);
+    }
+
+    int height, width;
+    canvas_size(canvas, &height, &width);
+
+    for (int i = 0; i < (int)sizeof(cardinal_directions); ++i)
+    {
+        int y, x;
+        cardinal_direction_cell(height, width, i, &y, &x);
+        canvas_add_char(canvas, y, x, cardinal_directions[i]);
+    }
 
     if (config->color)
     {
-        wattroff(win, COLOR_PAIR(5));
+        canvas_color_off(canvas, 5);
     }
 }
@@ -1,17 +1,197 @@
 #include "drawing.h"
 
-#include <curses.h>
+#include "canvas.h"
+
 #include <math.h>
+#include <stdbool.h>
 #include <stdlib.h>
-#include <string.h>
+
+/* A line segment stepped one cell at a time along its major axis, the axis it
+ * spans more cells of. The minor coordinate at step `k` is that of the cell
+ * nearest the exact line, halves rounded away from the start, and is tracked
+ * with an integer remainder instead of rounding a running double. Only the
+ * steps whose cells lie inside a clipping rectangle are visited: they are found
+ * up front, so any length of segment off the window costs nothing
+ */
+struct LineRaster
+{
+    bool steep;         // Rows are the major axis
+    int step_y, step_x; // Direction along each axis
+    int major;          // Cells spanned along the major axis, less one
+    int minor;          // Cells spanned along the minor axis, less one
+    int y, x;           // Cell of the current step
+    int step;           // Steps from the start of the segment
+    int end;            // Last step inside the clipping rectangle
+    long long error;    // Remainder of (2 * step * minor + major) / (2 * major)
+};
+
+/* A run of cells of a segment along its major axis, all in one row or column
+ */
+struct LineSpan
+{
+    int y, x;     // First cell, in the direction the segment is drawn
+    int length;   // Cells in the run
+    bool entered; // The step before the run, on the segment, was in another row or column
+    bool turns;   // The step after the run, were the segment extended, is in another row or column
+    bool last;    // The run ends the segment
+};
+
+static long long floor_div(long long a, long long b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/* Range of offsets `t` keeping `start + direction * t` in [0, limit)
+ */
+static void axis_range(int start, int direction, int limit, long long *low, long long *high)
+{
+    *low = direction > 0 ? -(long long)start : (long long)start - limit + 1;
+    *high = direction > 0 ? (long long)limit - 1 - start : start;
+}
+
+/* Set up a segment from (ya, xa) to (yb, xb) clipped to a rectangle of `height`
+ * rows and `width` columns at the origin, using Liang-Barsky style bounds on
+ * the steps. `steep` must be set if the segment spans more rows than columns,
+ * and may be if as many. Returns false if no cell lies inside
+ */
+static bool clip_line(struct LineRaster *line, int ya, int xa, int yb, int xb, bool steep, int height, int width)
+{
+    line->steep = steep;
+    line->step_y = yb < ya ? -1 : 1;
+    line->step_x = xb < xa ? -1 : 1;
+    line->major = steep ? abs(yb - ya) : abs(xb - xa);
+    line->minor = steep ? abs(xb - xa) : abs(yb - ya);
+
+    long long low = 0;
+    long long high = line->major;
+    long long range_low, range_high;
+
+    // Along the major axis, each step moves one cell
+    axis_range(steep ? ya : xa, steep ? line->step_y : line->step_x, steep ? height : width, &range_low, &range_high);
+    low = range_low > low ? range_low : low;
+    high = range_high < high ? range_high : high;
+
+    // Along the minor axis, each step moves by the slope, rounded
+    axis_range(steep ? xa : ya, steep ? line->step_x : line->step_y, steep ? width : height, &range_low, &range_high);
+    long long twice_major = 2LL * line->major;
+    long long twice_minor = 2LL * line->minor;
+    if (line->minor == 0)
+    {
+        if (range_low > 0 || range_high < 0)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // The minor offset of step `k` is floor((k * twice_minor + major) / twice_major)
+        long long first = -floor_div(line->major - twice_major * range_low, twice_minor);
+        long long last = floor_div(twice_major * (range_high + 1) - line->major - 1, twice_minor);
+        low = first > low ? first : low;
+        high = last < high ? last : high;
+    }
+    if (low > high)
+    {
+        return false;
+    }
+
+    long long numerator = twice_minor * low + line->major;
+    int offset = line->major > 0 ? (int)(numerator / twice_major) : 0;
+    line->error = line->major > 0 ? numerator % twice_major : 0;
+    line->step = (int)low;
+    line->end = (int)high;
+    line->y = ya + line->step_y * (steep ? line->step : offset);
+    line->x = xa + line->step_x * (steep ? offset : line->step);
+    return true;
+}
+
+/* Take the next run of cells of a clipped segment. Returns false once the
+ * segment leaves the clipping rectangle
+ */
+static bool next_line_span(struct LineRaster *line, struct LineSpan *span)
+{
+    if (line->step > line->end)
+    {
+        return false;
+    }
+
+    long long twice_major = 2LL * line->major;
+    long long twice_minor = 2LL * line->minor;
+
+    // Steps until the remainder wraps and the row or column changes
+    long long remaining = line->end - line->step + 1;
+    long long until_turn = line->minor > 0 ? (twice_major - line->error + twice_minor - 1) / twice_minor
+                                           : remaining + 1;
+
+    span->y = line->y;
+    span->x = line->x;
+    span->length = (int)(until_turn < remaining ? until_turn : remaining);
+    span->entered = line->step > 0 && line->minor > 0 && line->error < twice_minor;
+    span->turns = until_turn <= remaining;
+    span->last = line->step + span->length - 1 == line->major;
+
+    line->step += span->length;
+    line->error += twice_minor * span->length;
+    if (line->steep)
+    {
+        line->y += line->step_y * span->length;
+    }
+    else
+    {
+        line->x += line->step_x * span->length;
+    }
+    if (span->turns)
+    {
+        line->error -= twice_major;
+        if (line->steep)
+        {
+            line->x += line->step_x;
+        }
+        else
+        {
+            line->y += line->step_y;
+        }
+    }
+    return true;
+}
+
+/* Cell `offset` cells into a run
+ */
+static void span_cell(const struct LineRaster *line, const struct LineSpan *span, int offset, int *y, int *x)
+{
+    *y = span->y + (line->steep ? line->step_y * offset : 0);
+    *x = span->x + (line->steep ? 0 : line->step_x * offset);
+}
+
+/* Fill a run with a one column character, skipping its first `skip` cells
+ */
+static void fill_span(struct Canvas *canvas, const struct LineRaster *line, const struct LineSpan *span, int skip,
+                      const char *fill)
+{
+    int count = span->length - skip;
+    if (count <= 0)
+    {
+        return;
+    }
+
+    // Lines are drawn from the top left cell of the run
+    int y, x;
+    span_cell(line, span, (line->steep ? line->step_y : line->step_x) > 0 ? skip : span->length - 1, &y, &x);
+    if (line->steep)
+    {
+        canvas_vline(canvas, y, x, fill, count);
+    }
+    else
+    {
+        canvas_hline(canvas, y, x, fill, count);
+    }
+}
 
 // The difference in logic between drawing an ASCII and unicode line differs
 // enough that having two different functions is warranted
 
-void draw_line_ASCII(WINDOW *win, int ya, int xa, int yb, int xb)
+void draw_line_ASCII(struct Canvas *canvas, int ya, int xa, int yb, int xb)
 {
-    // The logic here is not particularly elegant or efficient
-
     int dy = yb - ya;
     int dx = xb - xa;
 
@@ -28,101 +208,90 @@ void draw_line_ASCII(WINDOW *win, int ya, int xa, int yb, int xb)
         slope = dy > 0 ? '/' : '\\';
     }
 
-    if (abs(dy) >= abs(dx))
-    {
-        int y = 0;
-        double x = 0.0;
+    int height, width;
+    canvas_size(canvas, &height, &width);
 
-        // Step size
-        int sy = (dy > 0) ? 1 : -1;
-        double sx = (double)dx / abs(dy);
+    struct LineRaster line;
+    struct LineSpan span;
+    if (!clip_line(&line, ya, xa, yb, xb, abs(dy) >= abs(dx), height, width))
+    {
+        return;
+    }
 
-        while (abs(y) <= abs(dy))
+    if (line.steep)
+    {
+        while (next_line_span(&line, &span))
         {
-            int curr_y = ya + y;
-            int curr_x = xa + (int)round(x);
-
-            int next_y = ya + y + sy;
-            int next_x = xa + (int)round(x + sx);
-
-            mvwaddch(win, curr_y, curr_x, '|');
+            fill_span(canvas, &line, &span, 0, "|");
 
             // Draw slope if we jump a column
-            if (next_x != curr_x)
+            if (span.turns)
             {
-                mvwaddch(win, curr_y, curr_x, slope);
+                int y, x;
+                span_cell(&line, &span, span.length - 1, &y, &x);
+                canvas_add_char(canvas, y, x, slope);
             }
-
-            y += sy;
-            x += sx;
         }
+        return;
     }
-    else
-    {
-        double y = 0.0;
-        int x = 0;
 
-        // Step size
-        double sy = (double)dy / abs(dx);
-        int sx = (dx > 0) ? 1 : -1;
+    // Edge case where we draw a horizontal line
+    const char *horizontal = ya == yb ? "-" : "_";
 
-        while (abs(x) <= abs(dx))
-        {
-            int curr_y = ya + (int)round(y);
-            int curr_x = xa + x;
-
-            int next_y = ya + (int)round(y + sy);
-            int next_x = xa + x + sx;
+    // Drawing '-' characters isn't as smooth as '_' characters. Thus, to draw a
+    // good lookin' line, the slope characters must be drawn in a particular
+    // way... (remember we're in screen space coordinates and the y-axis is
+    // "flipped"). Moving "down", the slope takes the first cell of the next row
+    bool slope_first = false;
+    bool first = true;
+    while (next_line_span(&line, &span))
+    {
+        // Even if the row before lies outside the window
+        slope_first = slope_first || (first && dy > 0 && span.entered);
+        first = false;
 
-            // Edge case where we draw a horizontal line
-            char horizontal = ya == yb ? '-' : '_';
+        int skip = 0;
+        if (slope_first)
+        {
+            canvas_add_char(canvas, span.y, span.x, slope);
+            slope_first = false;
+            skip = 1;
 
-            mvwaddch(win, curr_y, curr_x, horizontal);
+            // The cell taken by the slope doesn't start another one
+            if (span.length == 1)
+            {
+                continue;
+            }
+        }
 
-            // This bit requires a little more logic: drawing '-' characters
-            // isn't as smooth as '_' characters. Thus, to draw a good lookin'
-            // line, the slope characters must be drawn in a particular way...
-            // (remember we're in screen space coordinates and the y-axis is
-            // "flipped")
+        fill_span(canvas, &line, &span, skip, horizontal);
 
-            // Draw slope if we jump a row
-            if (next_y != curr_y)
+        // Draw slope if we jump a row
+        if (span.turns)
+        {
+            if (dy > 0)
             {
-                if (dy > 0)
-                {
-                    // We're moving "down": add the slope to the next position
-                    // Make sure we're not on the last cell first
-                    if (curr_y != yb)
-                    {
-                        mvwaddch(win, next_y, next_x, slope);
-
-                        // Skip drawing the next position the next iteration
-                        y += sy;
-                        x += sx;
-                    }
-                }
-                else
-                {
-                    // We're moving "up": just add the slope to the current cell
-                    mvwaddch(win, curr_y, curr_x, slope);
-                }
+                // Make sure we're not on the last cell first
+                slope_first = !span.last;
+            }
+            else
+            {
+                // We're moving "up": just add the slope to the current cell
+                int y, x;
+                span_cell(&line, &span, span.length - 1, &y, &x);
+                canvas_add_char(canvas, y, x, slope);
             }
-
-            y += sy;
-            x += sx;
         }
     }
 
     // Could add asterisks at beginning and end of segment to "prettify",
     // but not for this application
-    // mvwaddch(win, ya, xa, '*');
-    // mvwaddch(win, yb, xb, '*');
+    // canvas_add_char(canvas, ya, xa, '*');
+    // canvas_add_char(canvas, yb, xb, '*');
 }
 
-void draw_line_smooth(WINDOW *win, int ya, int xa, int yb, int xb)
+void draw_line_smooth(struct Canvas *canvas, int ya, int xa, int yb, int xb)
 {
-    // The logic here is not particularly elegant or efficient
-
     int dy = yb - ya;
     int dx = xb - xa;
 
@@ -130,7 +299,8 @@ void draw_line_smooth(WINDOW *win, int ya, int xa, int yb, int xb)
     char *joint_a;
     char *joint_b;
 
-    if (abs(dy) > abs(dx))
+    bool steep = abs(dy) > abs(dx);
+    if (steep)
     {
         // No intelligence... just choose based on case
         if (dx > 0)
@@ -143,38 +313,9 @@ void draw_line_smooth(WINDOW *win, int ya, int xa, int yb, int xb)
             joint_a = dy > 0 ? "╯" : "╮";
             joint_b = dy > 0 ? "╭" : "╰";
         }
-
-        int y = 0;
-        double x = 0.0;
-
-        // Step size
-        int sy = (dy > 0) ? 1 : -1;
-        double sx = (double)dx / abs(dy);
-
-        while (abs(y) <= abs(dy))
-        {
-            int curr_y = ya + y;
-            int curr_x = xa + (int)round(x);
-
-            int next_y = ya + y + sy;
-            int next_x = xa + (int)round(x + sx);
-
-            mvwaddstr(win, curr_y, curr_x, "│");
-
-            // Draw joint if we jump a column && we're not on the last cell
-            if (curr_x != next_x && curr_x != xb)
-            {
-                mvwaddstr(win, curr_y, curr_x, joint_a);
-                mvwaddstr(win, curr_y, next_x, joint_b);
-            }
-
-            y += sy;
-            x += sx;
-        }
     }
     else
     {
-        // No intelligence... just choose based on case
         if (dy > 0)
         {
             joint_a = dx > 0 ? "╮" : "╭";
@@ -185,105 +326,75 @@ void draw_line_smooth(WINDOW *win, int ya, int xa, int yb, int xb)
             joint_b = dx > 0 ? "╭" : "╮";
             joint_a = dx > 0 ? "╯" : "╰";
         }
+    }
 
-        double y = 0.0;
-        int x = 0;
-
-        // Step size
-        double sy = (double)dy / abs(dx);
-        int sx = (dx > 0) ? 1 : -1;
-
-        while (abs(x) <= abs(dx))
-        {
-            int curr_y = ya + (int)round(y);
-            int curr_x = xa + x;
+    int height, width;
+    canvas_size(canvas, &height, &width);
 
-            int next_y = ya + (int)round(y + sy);
-            int next_x = xa + x + sx;
+    struct LineRaster line;
+    struct LineSpan span;
+    if (!clip_line(&line, ya, xa, yb, xb, steep, height, width))
+    {
+        return;
+    }
 
-            mvwaddstr(win, curr_y, curr_x, "─");
+    bool first = true;
+    while (next_line_span(&line, &span))
+    {
+        fill_span(canvas, &line, &span, 0, steep ? "│" : "─");
 
-            // Draw joint if we jump a row && we're not on the last cell
-            if (curr_y != next_y && curr_y != yb)
-            {
-                mvwaddstr(win, curr_y, curr_x, joint_a);
-                mvwaddstr(win, next_y, curr_x, joint_b);
-            }
+        // The second joint of a jump from a cell outside the window may be inside
+        if (first && span.entered)
+        {
+            canvas_add_str(canvas, span.y - (steep ? line.step_y : 0), span.x - (steep ? 0 : line.step_x), joint_b);
+        }
+        first = false;
 
-            y += sy;
-            x += sx;
+        // Draw joints if we jump a row or column && we're not on the last cell
+        if (span.turns && !span.last)
+        {
+            int y, x;
+            span_cell(&line, &span, span.length - 1, &y, &x);
+            canvas_add_str(canvas, y, x, joint_a);
+            canvas_add_str(canvas, y + (steep ? 0 : line.step_y), x + (steep ? line.step_x : 0), joint_b);
         }
     }
 }
 
-void draw_line_dotted(WINDOW *win, int ya, int xa, int yb, int xb)
+void draw_line_dotted(struct Canvas *canvas, int ya, int xa, int yb, int xb)
 {
-    // The logic here is not particularly elegant or efficient
-
-    int dy = yb - ya;
-    int dx = xb - xa;
-
-    char *fill = "•";
+    int height, width;
+    canvas_size(canvas, &height, &width);
 
-    if (abs(dy) >= abs(dx))
+    struct LineRaster line;
+    struct LineSpan span;
+    if (!clip_line(&line, ya, xa, yb, xb, abs(yb - ya) >= abs(xb - xa), height, width))
     {
-        int y = 0;
-        double x = 0.0;
-
-        // Step size
-        int sy = (dy > 0) ? 1 : -1;
-        double sx = (double)dx / abs(dy);
-
-        while (abs(y) <= abs(dy))
-        {
-            int curr_y = ya + y;
-            int curr_x = xa + (int)round(x);
-
-            mvwaddstr(win, curr_y, curr_x, fill);
-
-            y += sy;
-            x += sx;
-        }
+        return;
     }
-    else
-    {
-        double y = 0.0;
-        int x = 0;
-
-        // Step size
-        double sy = (double)dy / abs(dx);
-        int sx = (dx > 0) ? 1 : -1;
-
-        while (abs(x) <= abs(dx))
-        {
-            int curr_y = ya + (int)round(y);
-            int curr_x = xa + x;
 
-            mvwaddstr(win, curr_y, curr_x, fill);
-
-            y += sy;
-            x += sx;
-        }
+    while (next_line_span(&line, &span))
+    {
+        fill_span(canvas, &line, &span, 0, "•");
     }
 }
 
-#define MAX_COLS 1024
-#define MAX_ROWS 1024
-
-static unsigned char braille_layer[MAX_ROWS][MAX_COLS];
+// Bits of the dots of a braille character, by row and column within the cell
+static const unsigned char braille_dots[4][2] = {{0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}};
 
-void clear_braille_lines(void)
+unsigned char braille_dot(int dot_y, int dot_x)
 {
-    memset(braille_layer, 0, sizeof(braille_layer));
+    return braille_dots[dot_y][dot_x];
 }
 
-void draw_braille_cell(WINDOW *win, int y, int x, unsigned char mask)
+void draw_braille_cell(struct Canvas *canvas, int y, int x, unsigned char mask)
 {
-    if (mask == 0)
+    unsigned char *dots = canvas_braille_cell(canvas, y, x);
+    if (mask == 0 || dots == NULL)
         return;
 
-    mask |= braille_layer[y][x];
-    braille_layer[y][x] = mask;
+    mask |= *dots;
+    *dots = mask;
 
     unsigned char utf8[4];
     utf8[0] = 0xE2;
@@ -291,15 +402,11 @@ void draw_braille_cell(WINDOW *win, int y, int x, unsigned char mask)
     utf8[2] = 0x80 | (mask & 0x3F); // Bottom 6 bits of mask
     utf8[3] = '\0';
 
-    mvwaddstr(win, y, x, (char *)utf8);
+    canvas_add_str(canvas, y, x, (char *)utf8);
 }
 
-void draw_line_braille(WINDOW *win, int ya, int xa, int yb, int xb)
+void draw_line_braille(struct Canvas *canvas, int ya, int xa, int yb, int xb)
 {
-    // ncurses coordinates
-    int curs_xa = xa;
-    int curs_ya = ya;
-
     // braille coordinates
     if (xa < xb)
     {
@@ -333,56 +440,47 @@ void draw_line_braille(WINDOW *win, int ya, int xa, int yb, int xb)
         yb = yb * 4 + 1;
     }
 
-    int dx = abs(xb - xa);
-    int dy = abs(yb - ya);
+    // Clip to the cells the braille layer can hold
+    int height, width;
+    canvas_size(canvas, &height, &width);
+    height = height < BRAILLE_LAYER_ROWS ? height : BRAILLE_LAYER_ROWS;
+    width = width < BRAILLE_LAYER_COLS ? width : BRAILLE_LAYER_COLS;
 
-    int incx = (xa < xb) ? 1 : -1;
-    int incy = (ya < yb) ? 1 : -1;
+    struct LineRaster line;
+    struct LineSpan span;
+    if (!clip_line(&line, ya, xa, yb, xb, abs(yb - ya) > abs(xb - xa), 4 * height, 2 * width))
+    {
+        return;
+    }
 
-    int err = ((dx > dy) ? dx : -dy) / 2;
-    int e2 = 0;
+    // ncurses coordinates
+    int curs_y = line.y / 4;
+    int curs_x = line.x / 2;
 
     unsigned char braille_mask = 0;
 
-    for (;;)
+    while (next_line_span(&line, &span))
     {
-        int curs_x = xa / 2;
-        int curs_y = ya / 4;
-
-        if (curs_x != curs_xa || curs_y != curs_ya)
+        int dot_y = span.y;
+        int dot_x = span.x;
+        for (int i = 0; i < span.length; ++i)
         {
-            draw_braille_cell(win, curs_ya, curs_xa, braille_mask);
-            braille_mask = 0;
-            curs_xa = curs_x;
-            curs_ya = curs_y;
-        }
-
-        int dot_x = xa % 2;
-        int dot_y = ya % 4;
-
-        static const unsigned char dot_map[4][2] = {{0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}};
+            if (dot_y / 4 != curs_y || dot_x / 2 != curs_x)
+            {
+                draw_braille_cell(canvas, curs_y, curs_x, braille_mask);
+                braille_mask = 0;
+                curs_y = dot_y / 4;
+                curs_x = dot_x / 2;
+            }
 
-        braille_mask |= dot_map[dot_y][dot_x];
+            braille_mask |= braille_dots[dot_y % 4][dot_x % 2];
 
-        if (xa == xb && ya == yb)
-        {
-            break;
-        }
-
-        e2 = err;
-        if (e2 > -dx)
-        {
-            err -= dy;
-            xa += incx;
-        }
-        if (e2 < dy)
-        {
-            err += dx;
-            ya += incy;
+            dot_y += line.steep ? line.step_y : 0;
+            dot_x += line.steep ? 0 : line.step_x;
         }
     }
 
-    draw_braille_cell(win, curs_ya, curs_xa, braille_mask);
+    draw_braille_cell(canvas, curs_y, curs_x, braille_mask);
 }
 
 enum FillType
@@ -394,65 +492,65 @@ enum FillType
 
 // Reference: https://dai.fmph.uniba.sk/upload/0/01/Ellipse.pdf
 
-void print_chars_ellipse_ASCII(WINDOW *win, int center_y, int center_x, int y, int x, int fill)
+void print_chars_ellipse_ASCII(struct Canvas *canvas, int center_y, int center_x, int y, int x, int fill)
 {
     switch (fill)
     {
     case CORNER:
-        mvwaddch(win, center_y - y, center_x + x, '\\'); // Quad I
-        mvwaddch(win, center_y - y, center_x - x, '/');  // Quad II
-        mvwaddch(win, center_y + y, center_x - x, '\\'); // Quad III
-        mvwaddch(win, center_y + y, center_x + x, '/');  // Quad IV
+        canvas_add_char(canvas, center_y - y, center_x + x, '\\'); // Quad I
+        canvas_add_char(canvas, center_y - y, center_x - x, '/');  // Quad II
+        canvas_add_char(canvas, center_y + y, center_x - x, '\\'); // Quad III
+        canvas_add_char(canvas, center_y + y, center_x + x, '/');  // Quad IV
         break;
 
     case VERTICAL:
-        mvwaddch(win, center_y - y, center_x + x, '|');
-        mvwaddch(win, center_y - y, center_x - x, '|');
-        mvwaddch(win, center_y + y, center_x - x, '|');
-        mvwaddch(win, center_y + y, center_x + x, '|');
+        canvas_add_char(canvas, center_y - y, center_x + x, '|');
+        canvas_add_char(canvas, center_y - y, center_x - x, '|');
+        canvas_add_char(canvas, center_y + y, center_x - x, '|');
+        canvas_add_char(canvas, center_y + y, center_x + x, '|');
         break;
 
     case HORIZONTAL:
-        mvwaddch(win, center_y - y, center_x + x, '-');
-        mvwaddch(win, center_y - y, center_x - x, '-');
-        mvwaddch(win, center_y + y, center_x - x, '-');
-        mvwaddch(win, center_y + y, center_x + x, '-');
+        canvas_add_char(canvas, center_y - y, center_x + x, '-');
+        canvas_add_char(canvas, center_y - y, center_x - x, '-');
+        canvas_add_char(canvas, center_y + y, center_x - x, '-');
+        canvas_add_char(canvas, center_y + y, center_x + x, '-');
         break;
     }
 }
 
-void print_chars_ellipse_unicode(WINDOW *win, int center_y, int center_x, int y, int x, int fill)
+void print_chars_ellipse_unicode(struct Canvas *canvas, int center_y, int center_x, int y, int x, int fill)
 {
     // TODO: def not correct
     switch (fill)
     {
     case CORNER:
         // Quad I
-        mvwaddstr(win, center_y - y - 1, center_x + x, "╮");
-        mvwaddstr(win, center_y - y, center_x + x, "╰");
+        canvas_add_str(canvas, center_y - y - 1, center_x + x, "╮");
+        canvas_add_str(canvas, center_y - y, center_x + x, "╰");
         // Quad II
-        mvwaddstr(win, center_y - y - 1, center_x - x, "╭");
-        mvwaddstr(win, center_y - y, center_x - x, "╯");
+        canvas_add_str(canvas, center_y - y - 1, center_x - x, "╭");
+        canvas_add_str(canvas, center_y - y, center_x - x, "╯");
         // Quad III
-        mvwaddstr(win, center_y + y - 1, center_x - x, "╮");
-        mvwaddstr(win, center_y + y, center_x - x, "╰");
+        canvas_add_str(canvas, center_y + y - 1, center_x - x, "╮");
+        canvas_add_str(canvas, center_y + y, center_x - x, "╰");
         // Quad IV
-        mvwaddstr(win, center_y + y - 1, center_x + x, "╭");
-        mvwaddstr(win, center_y + y, center_x + x, "╯");
+        canvas_add_str(canvas, center_y + y - 1, center_x + x, "╭");
+        canvas_add_str(canvas, center_y + y, center_x + x, "╯");
         break;
 
     case VERTICAL:
-        mvwaddstr(win, center_y - y, center_x + x, "│");
-        mvwaddstr(win, center_y - y, center_x - x, "│");
-        mvwaddstr(win, center_y + y, center_x - x, "│");
-        mvwaddstr(win, center_y + y, center_x + x, "│");
+        canvas_add_str(canvas, center_y - y, center_x + x, "│");
+        canvas_add_str(canvas, center_y - y, center_x - x, "│");
+        canvas_add_str(canvas, center_y + y, center_x - x, "│");
+        canvas_add_str(canvas, center_y + y, center_x + x, "│");
         break;
 
     case HORIZONTAL:
-        mvwaddstr(win, center_y - y, center_x + x, "─");
-        mvwaddstr(win, center_y - y, center_x - x, "─");
-        mvwaddstr(win, center_y + y, center_x - x, "─");
-        mvwaddstr(win, center_y + y, center_x + x, "─");
+        canvas_add_str(canvas, center_y - y, center_x + x, "─");
+        canvas_add_str(canvas, center_y - y, center_x - x, "─");
+        canvas_add_str(canvas, center_y + y, center_x - x, "─");
+        canvas_add_str(canvas, center_y + y, center_x + x, "─");
         break;
     }
 
@@ -464,7 +562,7 @@ int ellipse_error(int y, int x, int rad_y, int rad_x)
     return (rad_x * rad_x + x * x) + (rad_y * rad_y + y * y) - (rad_x * rad_x * rad_y * rad_y);
 }
 
-void draw_ellipse(WINDOW *win, int center_y, int center_x, int rad_y, int rad_x, bool no_unicode)
+void draw_ellipse(struct Canvas *canvas, int center_y, int center_x, int rad_y, int rad_x, bool no_unicode)
 {
     int y = 0;
     int x = rad_x;
@@ -489,11 +587,11 @@ void draw_ellipse(WINDOW *win, int center_y, int center_x, int rad_y, int rad_x,
 
         if (no_unicode)
         {
-            print_chars_ellipse_ASCII(win, center_y, center_x, y, x, fill);
+            print_chars_ellipse_ASCII(canvas, center_y, center_x, y, x, fill);
         }
         else
         {
-            print_chars_ellipse_unicode(win, center_y, center_x, y, x, fill);
+            print_chars_ellipse_unicode(canvas, center_y, center_x, y, x, fill);
         }
 
         y = y_next;
@@ -514,11 +612,11 @@ void draw_ellipse(WINDOW *win, int center_y, int center_x, int rad_y, int rad_x,
 
         if (no_unicode)
         {
-            print_chars_ellipse_ASCII(win, center_y, center_x, y, x, fill);
+            print_chars_ellipse_ASCII(canvas, center_y, center_x, y, x, fill);
         }
         else
         {
-            print_chars_ellipse_unicode(win, center_y, center_x, y, x, fill);
+            print_chars_ellipse_unicode(canvas, center_y, center_x, y, x, fill);
         }
 
         y = y_next;
@@ -0,0 +1,401 @@
+#include "ephemeris.h"
+
+#include "astro.h"
+#include "bit.h"
+#include "core.h"
+#include "core_position.h"
+#include "macros.h"
+#include "thread.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Time steps each thread handles before buffers are flushed. Large enough to
+// amortize starting threads, small enough to keep buffers to a few megabytes
+#define STEPS_PER_TASK 64
+
+// Upper bound on the length of a CSV row, excluding the name
+#define MAX_CSV_ROW 128
+
+struct EphemerisWorker
+{
+    struct Star *stars; // Private copy of the stars passing the threshold
+    unsigned int num_stars;
+    struct Planet planets[NUM_PLANETS];
+    struct Moon moon;
+
+    char *buffer;
+    size_t length;
+    size_t capacity;
+    bool ok;
+
+    unsigned long first_step;
+    unsigned long num_steps;
+};
+
+struct EphemerisRound
+{
+    const struct EphemerisConf *conf;
+    struct EphemerisWorker *workers;
+};
+
+unsigned long ephemeris_num_steps(const struct EphemerisConf *conf)
+{
+    if (!(conf->step > 0.0) || conf->julian_date_end < conf->julian_date_start)
+    {
+        return 0;
+    }
+
+    // Tolerate rounding so the end date itself is included
+    double steps = (conf->julian_date_end - conf->julian_date_start) / conf->step;
+    return (unsigned long)floor(steps + 1.0E-9) + 1;
+}
+
+bool parse_ephemeris_step(const char *string, double *step)
+{
+    char *end;
+    double value = strtod(string, &end);
+    if (end == string)
+    {
+        return false;
+    }
+
+    double seconds_per_unit;
+    switch (*end)
+    {
+    case '\0':
+    case 's':
+        seconds_per_unit = 1.0;
+        break;
+    case 'm':
+        seconds_per_unit = 60.0;
+        break;
+    case 'h':
+        seconds_per_unit = 3600.0;
+        break;
+    case 'd':
+        seconds_per_unit = 86400.0;
+        break;
+    default:
+        return false;
+    }
+
+    if (*end != '\0' && end[1] != '\0')
+    {
+        return false;
+    }
+
+    if (!(value > 0.0) || !isfinite(value))
+    {
+        return false;
+    }
+
+    *step = value * seconds_per_unit / 86400.0;
+    return true;
+}
+
+static bool reserve(struct EphemerisWorker *worker, size_t size)
+{
+    if (worker->length + size <= worker->capacity)
+    {
+        return true;
+    }
+
+    size_t capacity = MAX(worker->capacity * 2, worker->length + size);
+    char *buffer = realloc(worker->buffer, capacity);
+    if (buffer == NULL)
+    {
+        return false;
+    }
+
+    worker->buffer = buffer;
+    worker->capacity = capacity;
+    return true;
+}
+
+size_t format_fixed(char *buffer, double value, int decimals)
+{
+    static const double scales[] = {1.0E0, 1.0E1, 1.0E2, 1.0E3, 1.0E4, 1.0E5, 1.0E6, 1.0E7, 1.0E8};
+
+    bool negative = value < 0.0;
+    uint64_t scaled = (uint64_t)(fabs(value) * scales[decimals] + 0.5);
+
+    // Digits are generated least significant first
+    char digits[32];
+    int num_digits = 0;
+    for (int i = 0; i < decimals; ++i)
+    {
+        digits[num_digits++] = (char)('0' + scaled % 10);
+        scaled /= 10;
+    }
+    if (decimals > 0)
+    {
+        digits[num_digits++] = '.';
+    }
+    do
+    {
+        digits[num_digits++] = (char)('0' + scaled % 10);
+        scaled /= 10;
+    } while (scaled > 0);
+
+    if (negative)
+    {
+        digits[num_digits++] = '-';
+    }
+
+    size_t length = 0;
+    while (num_digits > 0)
+    {
+        buffer[length++] = digits[--num_digits];
+    }
+    return length;
+}
+
+static void append_fixed(struct EphemerisWorker *worker, double value, int decimals)
+{
+    worker->length += format_fixed(&worker->buffer[worker->length], value, decimals);
+}
+
+static void append_string(struct EphemerisWorker *worker, const char *string)
+{
+    size_t length = strlen(string);
+    memcpy(&worker->buffer[worker->length], string, length);
+    worker->length += length;
+}
+
+/* Append a name as a CSV field, quoting it if needed
+ */
+static void append_csv_name(struct EphemerisWorker *worker, const char *name)
+{
+    if (name == NULL)
+    {
+        return;
+    }
+
+    if (strpbrk(name, ",\"\r\n") == NULL)
+    {
+        append_string(worker, name);
+        return;
+    }
+
+    worker->buffer[worker->length++] = '"';
+    for (const char *c = name; *c != '\0'; ++c)
+    {
+        if (*c == '"')
+        {
+            worker->buffer[worker->length++] = '"';
+        }
+        worker->buffer[worker->length++] = *c;
+    }
+    worker->buffer[worker->length++] = '"';
+}
+
+static void append_row(struct EphemerisWorker *worker, const struct EphemerisConf *conf, double julian_date,
+                       enum ObjectType object, int id, const struct ObjectBase *base, float magnitude)
+{
+    static const char *const object_names[] = {"star,", "planet,", "moon,"};
+
+    double azimuth = base->azimuth * 180.0 / M_PI;
+    double altitude = base->altitude * 180.0 / M_PI;
+
+    if (conf->format == EPHEMERIS_BINARY)
+    {
+        if (!reserve(worker, EPHEMERIS_RECORD_SIZE))
+        {
+            worker->ok = false;
+            return;
+        }
+
+        uint8_t *record = (uint8_t *)&worker->buffer[worker->length];
+        double64_to_bytes_LE(julian_date, record);
+        uint32_to_bytes_LE((uint32_t)id, record + 8);
+        record[12] = (uint8_t)object;
+        record[13] = 0;
+        record[14] = 0;
+        record[15] = 0;
+        float32_to_bytes_LE((float)azimuth, record + 16);
+        float32_to_bytes_LE((float)altitude, record + 20);
+        float32_to_bytes_LE(magnitude, record + 24);
+        worker->length += EPHEMERIS_RECORD_SIZE;
+        return;
+    }
+
+    // Quoting at most doubles the name's length
+    size_t name_length = base->label != NULL ? strlen(base->label) : 0;
+    if (!reserve(worker, MAX_CSV_ROW + 2 * name_length + 2))
+    {
+        worker->ok = false;
+        return;
+    }
+
+    append_fixed(worker, julian_date, 8);
+    worker->buffer[worker->length++] = ',';
+    append_string(worker, object_names[object]);
+    append_fixed(worker, id, 0);
+    worker->buffer[worker->length++] = ',';
+    append_csv_name(worker, base->label);
+    worker->buffer[worker->length++] = ',';
+    append_fixed(worker, azimuth, 6);
+    worker->buffer[worker->length++] = ',';
+    append_fixed(worker, altitude, 6);
+    worker->buffer[worker->length++] = ',';
+    append_fixed(worker, magnitude, 2);
+    worker->buffer[worker->length++] = '\n';
+}
+
+static void run_worker(unsigned int index, void *data)
+{
+    struct EphemerisRound *round = data;
+    const struct EphemerisConf *conf = round->conf;
+    struct EphemerisWorker *worker = &round->workers[index];
+
+    for (unsigned long step = worker->first_step; step < worker->first_step + worker->num_steps && worker->ok; ++step)
+    {
+        // Computed from the start date rather than accumulated to avoid drift
+        double julian_date = conf->julian_date_start + (double)step * conf->step;
+
+        update_star_positions(worker->stars, (int)worker->num_stars, julian_date, conf->latitude, conf->longitude);
+        update_planet_positions(worker->planets, julian_date, conf->latitude, conf->longitude);
+        update_moon_position(&worker->moon, julian_date, conf->latitude, conf->longitude);
+
+        for (unsigned int i = 0; i < worker->num_stars; ++i)
+        {
+            const struct Star *star = &worker->stars[i];
+            if (star->base.altitude >= 0.0)
+            {
+                append_row(worker, conf, julian_date, OBJECT_STAR, star->catalog_number, &star->base,
+                           star->magnitude);
+            }
+        }
+
+        for (int i = SUN; i < NUM_PLANETS; ++i)
+        {
+            const struct Planet *planet = &worker->planets[i];
+            if (i != EARTH && planet->base.altitude >= 0.0)
+            {
+                append_row(worker, conf, julian_date, OBJECT_PLANET, i, &planet->base, planet->magnitude);
+            }
+        }
+
+        if (worker->moon.base.altitude >= 0.0)
+        {
+            append_row(worker, conf, julian_date, OBJECT_MOON, 0, &worker->moon.base, worker->moon.magnitude);
+        }
+    }
+}
+
+static bool write_header(FILE *out, enum EphemerisFormat format)
+{
+    if (format == EPHEMERIS_BINARY)
+    {
+        uint8_t header[EPHEMERIS_HEADER_SIZE];
+        memcpy(header, EPHEMERIS_BINARY_MAGIC, 8);
+        uint32_to_bytes_LE(EPHEMERIS_BINARY_VERSION, header + 8);
+        uint32_to_bytes_LE(EPHEMERIS_RECORD_SIZE, header + 12);
+        return fwrite(header, 1, sizeof(header), out) == sizeof(header);
+    }
+
+    return fputs("julian_date,object,id,name,azimuth,altitude,magnitude\n", out) >= 0;
+}
+
+bool generate_ephemeris(FILE *out, const struct EphemerisConf *conf, const struct Star *star_table,
+                        unsigned int num_stars, const struct Planet *planet_table, const struct Moon *moon_object)
+{
+    unsigned long num_steps = ephemeris_num_steps(conf);
+
+    unsigned int num_threads = conf->num_threads > 0 ? conf->num_threads : thread_hardware_concurrency();
+    num_threads = (unsigned int)MAX(1, MIN((unsigned long)num_threads, num_steps));
+
+    // Only stars passing the threshold are ever output
+    unsigned int num_bright = 0;
+    for (unsigned int i = 0; i < num_stars; ++i)
+    {
+        num_bright += star_table[i].magnitude <= conf->threshold;
+    }
+
+    struct EphemerisWorker *workers = calloc(num_threads, sizeof(struct EphemerisWorker));
+    if (workers == NULL)
+    {
+        fprintf(stderr, "Allocation of memory for ephemeris workers failed\n");
+        return false;
+    }
+
+    bool success = true;
+
+    for (unsigned int t = 0; t < num_threads && success; ++t)
+    {
+        struct EphemerisWorker *worker = &workers[t];
+        worker->stars = malloc(MAX(1, num_bright) * sizeof(struct Star));
+        if (worker->stars == NULL)
+        {
+            fprintf(stderr, "Allocation of memory for ephemeris workers failed\n");
+            success = false;
+            break;
+        }
+
+        for (unsigned int i = 0; i < num_stars; ++i)
+        {
+            if (star_table[i].magnitude <= conf->threshold)
+            {
+                worker->stars[worker->num_stars++] = star_table[i];
+            }
+        }
+
+        memcpy(worker->planets, planet_table, sizeof(worker->planets));
+        worker->moon = *moon_object;
+    }
+
+    success = success && write_header(out, conf->format);
+
+    struct EphemerisRound round = {.conf = conf, .workers = workers};
+    unsigned long next_step = 0;
+
+    while (success && next_step < num_steps)
+    {
+        // Give each thread a contiguous run of steps so buffers concatenate in
+        // time order
+        unsigned long round_steps = MIN(num_steps - next_step, (unsigned long)num_threads * STEPS_PER_TASK);
+        unsigned long per_worker = (round_steps + num_threads - 1) / num_threads;
+
+        for (unsigned int t = 0; t < num_threads; ++t)
+        {
+            struct EphemerisWorker *worker = &workers[t];
+            unsigned long begin = MIN(round_steps, t * per_worker);
+            worker->first_step = next_step + begin;
+            worker->num_steps = MIN(round_steps - begin, per_worker);
+            worker->length = 0;
+            worker->ok = true;
+        }
+
+        parallel_run(num_threads, run_worker, &round);
+
+        for (unsigned int t = 0; t < num_threads && success; ++t)
+        {
+            struct EphemerisWorker *worker = &workers[t];
+            if (!worker->ok)
+            {
+                fprintf(stderr, "Allocation of memory for ephemeris output failed\n");
+                success = false;
+            }
+            else if (worker->length > 0 && fwrite(worker->buffer, 1, worker->length, out) != worker->length)
+            {
+                success = false;
+            }
+        }
+
+        next_step += round_steps;
+    }
+
+    success = success && fflush(out) == 0;
+
+    for (unsigned int t = 0; t < num_threads; ++t)
+    {
+        free(workers[t].stars);
+        free(workers[t].buffer);
+    }
+    free(workers);
+
+    return success;
+}
@@ -0,0 +1,504 @@
+#include "events.h"
+
+#include "astro.h"
+#include "coord.h"
+#include "macros.h"
+#include "thread.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Time between coarse positions (days). The Moon moves about 7° in that time,
+// so each minimum of its separation from a star or planet stands out between
+// neighboring steps
+#define EVENTS_STEP 0.5
+
+// Steps sharing one shortlist of stars per body. The Moon sweeps a cap of
+// about 30° over a block; planets barely move
+#define BLOCK_STEPS 4
+
+// Golden-section steps refining an event: one day * 0.618^30 is under a
+// tenth of a second
+#define REFINE_ITERATIONS 30
+
+// Radius of the Moon in the Earth radii `calc_moon_geo_ICRF` measures its
+// distance in, and the largest angular radius it reaches at perigee
+#define MOON_RADIUS 0.2725
+#define MOON_MAX_SEMI_DIAMETER (0.3 * TO_RAD)
+
+// The Moon first, so it is always the first object of an event, then the
+// planets outward from the Sun
+#define NUM_BODIES 8
+#define BODY_MOON 0
+static const int body_planets[NUM_BODIES] = {-1, MERCURY, VENUS, MARS, JUPITER, SATURN, URANUS, NEPTUNE};
+
+struct EventsSearch
+{
+    const struct EventsConf *conf;
+    const struct Star *star_table;
+    const struct SkyIndex *sky_index;
+    const struct Planet *planet_table;
+    const struct Moon *moon_object;
+};
+
+struct EventsWorker
+{
+    unsigned long first_step;
+    unsigned long num_steps;
+    int *candidates; // Star table indices shortlisted for a body
+
+    struct SkyEvent *events;
+    unsigned int num_events;
+    unsigned int capacity;
+    bool ok;
+};
+
+struct EventsRound
+{
+    const struct EventsSearch *search;
+    struct EventsWorker *workers;
+};
+
+// What a body's separation is measured from: another body, or a star's
+// direction when `body` is negative
+struct EventTarget
+{
+    int body;
+    double star[3];
+};
+
+static double date_of_step(const struct EventsConf *conf, double step)
+{
+    return conf->julian_date_start + step * EVENTS_STEP;
+}
+
+/* Unit vector from the center of the Earth towards a body. Sets `distance` in
+ * au for planets and Earth radii for the Moon
+ */
+static void body_direction(const struct EventsSearch *search, int body, double julian_date, double v[3],
+                           double *distance)
+{
+    if (body == BODY_MOON)
+    {
+        calc_moon_geo_ICRF(search->moon_object->elements, search->moon_object->rates, julian_date, &v[0], &v[1], &v[2]);
+    }
+    else
+    {
+        const struct Planet *earth = &search->planet_table[EARTH];
+        const struct Planet *planet = &search->planet_table[body_planets[body]];
+
+        double xe, ye, ze;
+        calc_planet_helio_ICRF(earth->elements, earth->rates, earth->extras, julian_date, &xe, &ye, &ze);
+        calc_planet_geo_ICRF(xe, ye, ze, planet->elements, planet->rates, planet->extras, julian_date, &v[0], &v[1],
+                             &v[2]);
+    }
+
+    *distance = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    v[0] /= *distance;
+    v[1] /= *distance;
+    v[2] /= *distance;
+}
+
+/* Angle between two unit vectors, accurate for small angles unlike acos
+ */
+static double angle_between(const double a[3], const double b[3])
+{
+    double cx = a[1] * b[2] - a[2] * b[1];
+    double cy = a[2] * b[0] - a[0] * b[2];
+    double cz = a[0] * b[1] - a[1] * b[0];
+    return atan2(sqrt(cx * cx + cy * cy + cz * cz), a[0] * b[0] + a[1] * b[1] + a[2] * b[2]);
+}
+
+static double separation_at(const struct EventsSearch *search, int body, const struct EventTarget *target,
+                            double julian_date)
+{
+    double v[3], distance;
+    body_direction(search, body, julian_date, v, &distance);
+    if (target->body < 0)
+    {
+        return angle_between(v, target->star);
+    }
+
+    double w[3];
+    body_direction(search, target->body, julian_date, w, &distance);
+    return angle_between(v, w);
+}
+
+/* Find the least separation between a body and a target within [a, b] by
+ * golden-section search
+ */
+static void refine_minimum(const struct EventsSearch *search, int body, const struct EventTarget *target, double a,
+                           double b, double *julian_date, double *separation)
+{
+    const double ratio = (sqrt(5.0) - 1.0) / 2.0;
+
+    double c = b - ratio * (b - a);
+    double d = a + ratio * (b - a);
+    double fc = separation_at(search, body, target, c);
+    double fd = separation_at(search, body, target, d);
+
+    for (int i = 0; i < REFINE_ITERATIONS; ++i)
+    {
+        if (fc < fd)
+        {
+            b = d;
+            d = c;
+            fd = fc;
+            c = b - ratio * (b - a);
+            fc = separation_at(search, body, target, c);
+        }
+        else
+        {
+            a = c;
+            c = d;
+            fc = fd;
+            d = a + ratio * (b - a);
+            fd = separation_at(search, body, target, d);
+        }
+    }
+
+    *julian_date = 0.5 * (a + b);
+    *separation = separation_at(search, body, target, *julian_date);
+}
+
+/* Refine a bracketed minimum and record it if it is close enough to be an
+ * event. `other_id` is the catalog number of a star target
+ */
+static void add_event(const struct EventsSearch *search, struct EventsWorker *worker, int body,
+                      const struct EventTarget *target, int other_id, double a, double b)
+{
+    const struct EventsConf *conf = search->conf;
+
+    double julian_date, separation;
+    refine_minimum(search, body, target, a, b, &julian_date, &separation);
+    if (julian_date < conf->julian_date_start || julian_date > conf->julian_date_end)
+    {
+        return;
+    }
+
+    double semi_diameter = 0.0;
+    if (body == BODY_MOON)
+    {
+        double v[3], distance;
+        body_direction(search, BODY_MOON, julian_date, v, &distance);
+        semi_diameter = asin(MOON_RADIUS / distance);
+    }
+
+    enum SkyEventType type;
+    if (separation < semi_diameter)
+    {
+        type = EVENT_OCCULTATION;
+    }
+    else if (separation <= conf->separation)
+    {
+        type = target->body < 0 ? EVENT_APPULSE : EVENT_CONJUNCTION;
+    }
+    else
+    {
+        return;
+    }
+
+    if (worker->num_events == worker->capacity)
+    {
+        unsigned int capacity = MAX(64, worker->capacity * 2);
+        struct SkyEvent *events = realloc(worker->events, capacity * sizeof(struct SkyEvent));
+        if (events == NULL)
+        {
+            worker->ok = false;
+            return;
+        }
+        worker->events = events;
+        worker->capacity = capacity;
+    }
+
+    worker->events[worker->num_events++] = (struct SkyEvent){
+        .julian_date = julian_date,
+        .separation = separation,
+        .type = type,
+        .object = body == BODY_MOON ? OBJECT_MOON : OBJECT_PLANET,
+        .id = body == BODY_MOON ? 0 : body_planets[body],
+        .other_object = target->body < 0 ? OBJECT_STAR : OBJECT_PLANET,
+        .other_id = target->body < 0 ? other_id : body_planets[target->body],
+    };
+}
+
+/* Whether a path through three samples may pass within `limit` of a
+ * direction, given the least separation lies between the outer samples. The
+ * path is compared to the great circle through the outer samples, allowing for
+ * it to bend twice as far from it as the middle sample does. Refining every
+ * local minimum would position the Moon for each star it passes within degrees
+ */
+static bool may_pass_within(const double a[3], const double b[3], const double c[3], const double v[3],
+                            double limit)
+{
+    double n[3] = {a[1] * c[2] - a[2] * c[1], a[2] * c[0] - a[0] * c[2], a[0] * c[1] - a[1] * c[0]};
+    double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length < 1.0E-9)
+    {
+        return true; // A stationary body does not define a great circle
+    }
+
+    double bend = fabs(n[0] * b[0] + n[1] * b[1] + n[2] * b[2]) / length;
+    double cross_track = fabs(n[0] * v[0] + n[1] * v[1] + n[2] * v[2]) / length;
+    return asin(MIN(1.0, cross_track)) <= limit + 2.0 * asin(MIN(1.0, bend)) + 1.0E-6;
+}
+
+/* Search the stars near a body's path over one block of samples
+ */
+static void search_stars(const struct EventsSearch *search, struct EventsWorker *worker, int body,
+                         double positions[][3], const double *dates, int num_samples)
+{
+    const struct EventsConf *conf = search->conf;
+    const double *center = positions[num_samples / 2];
+    double julian_date = dates[num_samples / 2];
+
+    // Any star passing close enough lies within this radius of the middle
+    // sample, the path bending at most one step away from the samples
+    double reach = 0.0;
+    double longest_step = 0.0;
+    for (int k = 0; k < num_samples; ++k)
+    {
+        reach = MAX(reach, angle_between(center, positions[k]));
+        if (k > 0)
+        {
+            longest_step = MAX(longest_step, angle_between(positions[k - 1], positions[k]));
+        }
+    }
+    double limit = body == BODY_MOON ? MAX(conf->separation, MOON_MAX_SEMI_DIAMETER) : conf->separation;
+
+    double right_ascension, declination;
+    equatorial_rectangular_to_spherical(center[0], center[1], center[2], &right_ascension, &declination);
+    unsigned int num_candidates = sky_index_query_cap(
+        search->sky_index, search->star_table, right_ascension, declination, reach + longest_step + limit,
+        sky_index_motion_margin(search->sky_index, julian_date), conf->threshold, worker->candidates,
+        search->sky_index->num_stars);
+
+    for (unsigned int i = 0; i < num_candidates && worker->ok; ++i)
+    {
+        const struct Star *star = &search->star_table[worker->candidates[i]];
+
+        // Stars hardly move over a block
+        double star_right_ascension, star_declination;
+        calc_star_position(star->right_ascension, star->ra_motion, star->declination, star->dec_motion, julian_date,
+                           &star_right_ascension, &star_declination);
+        struct EventTarget target = {
+            .body = -1,
+            .star = {cos(star_declination) * cos(star_right_ascension),
+                     cos(star_declination) * sin(star_right_ascension), sin(star_declination)},
+        };
+
+        double prev = angle_between(positions[0], target.star);
+        double here = angle_between(positions[1], target.star);
+        for (int k = 1; k < num_samples - 1; ++k)
+        {
+            double next = angle_between(positions[k + 1], target.star);
+            if (prev > here && here <= next && may_pass_within(positions[k - 1], positions[k], positions[k + 1],
+                                                               target.star, limit))
+            {
+                add_event(search, worker, body, &target, star->catalog_number, dates[k - 1], dates[k + 1]);
+            }
+            prev = here;
+            here = next;
+        }
+    }
+}
+
+static void run_worker(unsigned int index, void *data)
+{
+    struct EventsRound *round = data;
+    const struct EventsSearch *search = round->search;
+    struct EventsWorker *worker = &round->workers[index];
+
+    // Positions at the steps of a block and one step on either side, so
+    // minima at the block's own steps are bracketed
+    double positions[NUM_BODIES][BLOCK_STEPS + 2][3];
+    double dates[BLOCK_STEPS + 2];
+
+    unsigned long end = worker->first_step + worker->num_steps;
+    for (unsigned long first = worker->first_step; first < end && worker->ok; first += BLOCK_STEPS)
+    {
+        int num_samples = (int)MIN(BLOCK_STEPS, end - first) + 2;
+        for (int k = 0; k < num_samples; ++k)
+        {
+            dates[k] = date_of_step(search->conf, (double)first + k - 1.0);
+            for (int body = 0; body < NUM_BODIES; ++body)
+            {
+                double distance;
+                body_direction(search, body, dates[k], positions[body][k], &distance);
+            }
+        }
+
+        for (int body = 0; body < NUM_BODIES; ++body)
+        {
+            for (int other = body + 1; other < NUM_BODIES; ++other)
+            {
+                struct EventTarget target = {.body = other};
+                for (int k = 1; k < num_samples - 1 && worker->ok; ++k)
+                {
+                    double prev = angle_between(positions[body][k - 1], positions[other][k - 1]);
+                    double here = angle_between(positions[body][k], positions[other][k]);
+                    double next = angle_between(positions[body][k + 1], positions[other][k + 1]);
+                    if (prev > here && here <= next)
+                    {
+                        add_event(search, worker, body, &target, 0, dates[k - 1], dates[k + 1]);
+                    }
+                }
+            }
+
+            search_stars(search, worker, body, positions[body], dates, num_samples);
+        }
+    }
+}
+
+static int compare_events(const void *a, const void *b)
+{
+    const struct SkyEvent *ea = a;
+    const struct SkyEvent *eb = b;
+    return (ea->julian_date > eb->julian_date) - (ea->julian_date < eb->julian_date);
+}
+
+bool search_events(const struct EventsConf *conf, const struct Star *star_table, const struct SkyIndex *sky_index,
+                   const struct Planet *planet_table, const struct Moon *moon_object, struct SkyEvent **events,
+                   unsigned int *num_events)
+{
+    *events = NULL;
+    *num_events = 0;
+    if (conf->julian_date_end < conf->julian_date_start)
+    {
+        return true;
+    }
+
+    unsigned long num_steps =
+        (unsigned long)floor((conf->julian_date_end - conf->julian_date_start) / EVENTS_STEP) + 1;
+    unsigned int num_threads = conf->num_threads > 0 ? conf->num_threads : thread_hardware_concurrency();
+    num_threads = (unsigned int)MAX(1, MIN((unsigned long)num_threads, num_steps));
+
+    struct EventsWorker *workers = calloc(num_threads, sizeof(struct EventsWorker));
+    if (workers == NULL)
+    {
+        fprintf(stderr, "Allocation of memory for event search failed\n");
+        return false;
+    }
+
+    // Each thread searches one window of consecutive steps
+    unsigned long per_worker = (num_steps + num_threads - 1) / num_threads;
+    bool success = true;
+    for (unsigned int t = 0; t < num_threads; ++t)
+    {
+        struct EventsWorker *worker = &workers[t];
+        worker->first_step = MIN(num_steps, t * per_worker);
+        worker->num_steps = MIN(num_steps - worker->first_step, per_worker);
+        worker->candidates = malloc(MAX(1, sky_index->num_stars) * sizeof(int));
+        worker->ok = worker->candidates != NULL;
+        success = success && worker->ok;
+    }
+
+    struct EventsSearch search = {
+        .conf = conf,
+        .star_table = star_table,
+        .sky_index = sky_index,
+        .planet_table = planet_table,
+        .moon_object = moon_object,
+    };
+    struct EventsRound round = {.search = &search, .workers = workers};
+    if (success)
+    {
+        parallel_run(num_threads, run_worker, &round);
+    }
+
+    unsigned int total = 0;
+    for (unsigned int t = 0; t < num_threads; ++t)
+    {
+        success = success && workers[t].ok;
+        total += workers[t].num_events;
+    }
+
+    if (success)
+    {
+        *events = malloc(MAX(1, total) * sizeof(struct SkyEvent));
+        success = *events != NULL;
+    }
+    for (unsigned int t = 0; t < num_threads; ++t)
+    {
+        if (success)
+        {
+            memcpy(&(*events)[*num_events], workers[t].events, workers[t].num_events * sizeof(struct SkyEvent));
+            *num_events += workers[t].num_events;
+        }
+        free(workers[t].events);
+        free(workers[t].candidates);
+    }
+    free(workers);
+
+    if (!success)
+    {
+        fprintf(stderr, "Allocation of memory for event search failed\n");
+        free(*events);
+        *events = NULL;
+        *num_events = 0;
+        return false;
+    }
+
+    qsort(*events, *num_events, sizeof(struct SkyEvent), compare_events);
+    return true;
+}
+
+/* Write an object's type, id and name as CSV fields, quoting the name if
+ * needed
+ */
+static void write_object(FILE *out, enum ObjectType object, int id, const struct Star *star_table,
+                         const struct Planet *planet_table, const struct Moon *moon_object)
+{
+    static const char *const object_names[] = {"star", "planet", "moon"};
+
+    const char *name = object == OBJECT_STAR     ? star_table[id - 1].base.label
+                       : object == OBJECT_PLANET ? planet_table[id].base.label
+                                                 : moon_object->base.label;
+
+    fprintf(out, "%s,%d,", object_names[object], id);
+    if (name == NULL)
+    {
+        return;
+    }
+    if (strpbrk(name, ",\"\r\n") == NULL)
+    {
+        fputs(name, out);
+        return;
+    }
+
+    fputc('"', out);
+    for (const char *c = name; *c != '\0'; ++c)
+    {
+        if (*c == '"')
+        {
+            fputc('"', out);
+        }
+        fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+bool write_events(FILE *out, const struct SkyEvent *events, unsigned int num_events, const struct Star *star_table,
+                  const struct Planet *planet_table, const struct Moon *moon_object)
+{
+    static const char *const event_names[] = {"conjunction", "occultation", "appulse"};
+
+    fputs("julian_date,date,event,object,id,name,other_object,other_id,other_name,separation\n", out);
+
+    for (unsigned int i = 0; i < num_events; ++i)
+    {
+        const struct SkyEvent *event = &events[i];
+
+        // Round to the second before splitting into calendar fields
+        struct tm date = julian_date_to_datetime(event->julian_date + 0.5 / 86400.0);
+        fprintf(out, "%.8f,%04d-%02d-%02dT%02d:%02d:%02d,%s,", event->julian_date, date.tm_year + 1900,
+                date.tm_mon + 1, date.tm_mday, date.tm_hour, date.tm_min, date.tm_sec, event_names[event->type]);
+        write_object(out, event->object, event->id, star_table, planet_table, moon_object);
+        fputc(',', out);
+        write_object(out, event->other_object, event->other_id, star_table, planet_table, moon_object);
+        fprintf(out, ",%.6f\n", event->separation / TO_RAD);
+    }
+
+    return fflush(out) == 0 && !ferror(out);
+}
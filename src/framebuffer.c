@@ -0,0 +1,282 @@
+#include "framebuffer.h"
+
+#include "ansi.h"
+#include "macros.h"
+#include "stream.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool generate_framebuffer(struct Framebuffer *framebuffer, const char *name, int rows, int cols,
+                          unsigned int num_stars)
+{
+    (void)rows;
+    (void)cols;
+    (void)num_stars;
+    memset(framebuffer, 0, sizeof(*framebuffer));
+    fprintf(stderr, "ERROR: Unable to create shared memory '%s': not supported on Windows\n", name);
+    return false;
+}
+
+void free_framebuffer(struct Framebuffer *framebuffer)
+{
+    (void)framebuffer;
+}
+
+bool framebuffer_publish(struct Framebuffer *framebuffer, const struct AnsiFrame *frame, int sky_row, int sky_col,
+                         int sky_rows, int sky_cols, const struct Stream *objects, double julian_date)
+{
+    (void)framebuffer;
+    (void)frame;
+    (void)sky_row;
+    (void)sky_col;
+    (void)sky_rows;
+    (void)sky_cols;
+    (void)objects;
+    (void)julian_date;
+    return false;
+}
+
+bool framebuffer_read(const void *segment, size_t segment_size, void *buffer, size_t buffer_size, size_t *length)
+{
+    (void)segment;
+    (void)segment_size;
+    (void)buffer;
+    (void)buffer_size;
+    *length = 0;
+    return false;
+}
+
+#else
+
+// Times a reader retries while frames are being written before giving up, e.g.
+// because the writer died mid-frame
+#define READ_ATTEMPTS 10000
+
+struct FramebufferHeader
+{
+    char magic[8];
+    uint32_t version;
+    _Atomic uint32_t sequence;
+    uint64_t segment_size;
+    uint64_t frame_number;
+    double julian_date;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t sky_row;
+    uint32_t sky_col;
+    uint32_t sky_rows;
+    uint32_t sky_cols;
+    uint32_t cells_offset;
+    uint32_t objects_offset;
+    uint32_t objects_size;
+    uint32_t reserved;
+};
+
+_Static_assert(sizeof(struct FramebufferHeader) == FRAMEBUFFER_HEADER_SIZE, "Framebuffer header layout changed");
+
+struct FramebufferCell
+{
+    char text[ANSI_CELL_TEXT_SIZE];
+    int16_t color;
+    uint8_t attrs;
+    uint8_t reserved;
+};
+
+_Static_assert(sizeof(struct FramebufferCell) == FRAMEBUFFER_CELL_SIZE, "Framebuffer cell layout changed");
+
+static size_t segment_size(const struct Framebuffer *framebuffer, int rows, int cols)
+{
+    return FRAMEBUFFER_HEADER_SIZE + (size_t)rows * cols * FRAMEBUFFER_CELL_SIZE + framebuffer->objects_capacity;
+}
+
+/* Map at least `size` bytes of the segment. Returns false upon error
+ */
+static bool map_segment(struct Framebuffer *framebuffer, size_t size)
+{
+    if (ftruncate(framebuffer->fd, (off_t)size) == -1)
+    {
+        return false;
+    }
+
+    void *segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, framebuffer->fd, 0);
+    if (segment == MAP_FAILED)
+    {
+        return false;
+    }
+
+    if (framebuffer->segment != NULL)
+    {
+        munmap(framebuffer->segment, framebuffer->size);
+    }
+    framebuffer->segment = segment;
+    framebuffer->size = size;
+    return true;
+}
+
+bool generate_framebuffer(struct Framebuffer *framebuffer, const char *name, int rows, int cols,
+                          unsigned int num_stars)
+{
+    memset(framebuffer, 0, sizeof(*framebuffer));
+    framebuffer->fd = -1;
+
+    // Portable names are a single slash followed by a file name
+    if (name[0] != '/' || strchr(name + 1, '/') != NULL || strlen(name) >= sizeof(framebuffer->name))
+    {
+        fprintf(stderr, "ERROR: Shared memory names must be of the form /<name>\n");
+        return false;
+    }
+    strcpy(framebuffer->name, name);
+
+    // Replace anything left behind by a previous run
+    shm_unlink(name);
+    framebuffer->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    framebuffer->objects_capacity =
+        STREAM_HEADER_SIZE + ((size_t)num_stars + NUM_PLANETS + 1) * STREAM_RECORD_SIZE;
+
+    if (framebuffer->fd == -1 || !map_segment(framebuffer, segment_size(framebuffer, MAX(1, rows), MAX(1, cols))))
+    {
+        fprintf(stderr, "ERROR: Unable to create shared memory '%s': %s\n", name, strerror(errno));
+        free_framebuffer(framebuffer);
+        return false;
+    }
+
+    struct FramebufferHeader *header = framebuffer->segment;
+    memcpy(header->magic, FRAMEBUFFER_MAGIC, sizeof(header->magic));
+    header->version = FRAMEBUFFER_VERSION;
+    header->segment_size = framebuffer->size;
+    atomic_store_explicit(&header->sequence, 0, memory_order_release);
+
+    return true;
+}
+
+void free_framebuffer(struct Framebuffer *framebuffer)
+{
+    if (framebuffer->segment != NULL)
+    {
+        munmap(framebuffer->segment, framebuffer->size);
+    }
+    if (framebuffer->fd != -1)
+    {
+        close(framebuffer->fd);
+        shm_unlink(framebuffer->name);
+    }
+    framebuffer->segment = NULL;
+    framebuffer->size = 0;
+    framebuffer->fd = -1;
+}
+
+bool framebuffer_publish(struct Framebuffer *framebuffer, const struct AnsiFrame *frame, int sky_row, int sky_col,
+                         int sky_rows, int sky_cols, const struct Stream *objects, double julian_date)
+{
+    // Grow before taking the lock. Readers still mapping less notice the new
+    // size in the header and map again
+    size_t needed = segment_size(framebuffer, frame->rows, frame->cols);
+    if (needed > framebuffer->size && !map_segment(framebuffer, needed))
+    {
+        return false;
+    }
+
+    struct FramebufferHeader *header = framebuffer->segment;
+    uint32_t sequence = atomic_load_explicit(&header->sequence, memory_order_relaxed);
+    atomic_store_explicit(&header->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    size_t cells_offset = FRAMEBUFFER_HEADER_SIZE;
+    size_t num_cells = (size_t)frame->rows * frame->cols;
+    size_t objects_offset = cells_offset + num_cells * FRAMEBUFFER_CELL_SIZE;
+    size_t objects_size = MIN(objects->length, framebuffer->objects_capacity);
+
+    header->segment_size = framebuffer->size;
+    header->frame_number = ++framebuffer->frame_number;
+    header->julian_date = julian_date;
+    header->rows = (uint32_t)frame->rows;
+    header->cols = (uint32_t)frame->cols;
+    header->sky_row = (uint32_t)sky_row;
+    header->sky_col = (uint32_t)sky_col;
+    header->sky_rows = (uint32_t)sky_rows;
+    header->sky_cols = (uint32_t)sky_cols;
+    header->cells_offset = (uint32_t)cells_offset;
+    header->objects_offset = (uint32_t)objects_offset;
+    header->objects_size = (uint32_t)objects_size;
+
+    struct FramebufferCell *cells = (struct FramebufferCell *)((char *)framebuffer->segment + cells_offset);
+    for (size_t i = 0; i < num_cells; ++i)
+    {
+        const struct AnsiCell *cell = &frame->cells[i];
+        memcpy(cells[i].text, cell->text, sizeof(cells[i].text));
+        cells[i].color = cell->color;
+        cells[i].attrs = cell->attrs;
+        cells[i].reserved = 0;
+    }
+
+    memcpy((char *)framebuffer->segment + objects_offset, objects->buffer, objects_size);
+
+    atomic_store_explicit(&header->sequence, sequence + 2, memory_order_release);
+    return true;
+}
+
+bool framebuffer_read(const void *segment, size_t segment_size, void *buffer, size_t buffer_size, size_t *length)
+{
+    // Only the sequence is read atomically; the rest is validated by it
+    struct FramebufferHeader *header = (struct FramebufferHeader *)segment;
+    *length = 0;
+
+    for (int attempt = 0; attempt < READ_ATTEMPTS; ++attempt)
+    {
+        uint32_t begin = atomic_load_explicit(&header->sequence, memory_order_acquire);
+        if (begin == 0)
+        {
+            return false; // Nothing published yet
+        }
+        if (begin & 1)
+        {
+            sched_yield();
+            continue;
+        }
+
+        size_t published_size = (size_t)header->segment_size;
+        size_t used = (size_t)header->objects_offset + header->objects_size;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&header->sequence, memory_order_relaxed) != begin)
+        {
+            continue;
+        }
+
+        if (published_size > segment_size)
+        {
+            *length = published_size;
+            return false;
+        }
+
+        *length = used;
+        if (used > buffer_size)
+        {
+            return false;
+        }
+
+        memcpy(buffer, segment, used);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&header->sequence, memory_order_relaxed) == begin)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#endif // _WIN32
@@ -0,0 +1,333 @@
+#include "frames.h"
+
+#include "ansi.h"
+#include "canvas.h"
+#include "city.h"
+#include "core.h"
+#include "core_render.h"
+#include "macros.h"
+#include "sky_index.h"
+#include "term.h"
+#include "thread.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Longest line read from a jobs file
+#define MAX_JOB_LINE 256
+
+struct FramesWorker
+{
+    struct SkyCopy copy;
+    struct Conf config;
+    struct Canvas cells;      // The whole frame
+    struct Canvas sky_canvas; // The square of `cells` the sky is drawn in
+    struct StarBins stars;
+    struct LabelLayout labels;
+    struct AnsiFrame frame;
+    struct AnsiBuffer buffer;
+    bool ok;
+    char path[1024]; // Last frame written
+};
+
+struct FramesRun
+{
+    const struct FramesConf *conf;
+    const struct FrameJob *jobs;
+    unsigned int num_jobs;
+    unsigned int num_threads;
+    struct FramesWorker *workers;
+};
+
+bool parse_frames_format(const char *string, enum FramesFormat *format)
+{
+    if (strcmp(string, "ansi") == 0)
+    {
+        *format = FRAMES_ANSI;
+        return true;
+    }
+    if (strcmp(string, "text") == 0)
+    {
+        *format = FRAMES_TEXT;
+        return true;
+    }
+    return false;
+}
+
+/* Parse a number within [min, max] spanning the whole string, ignoring
+ * surrounding spaces
+ */
+static bool parse_coordinate(const char *string, double min, double max, double *value)
+{
+    char *end;
+    errno = 0;
+    *value = strtod(string, &end);
+    while (*end == ' ' || *end == '\t')
+    {
+        ++end;
+    }
+    return end != string && *end == '\0' && errno == 0 && *value >= min && *value <= max;
+}
+
+/* Copy `string` without surrounding whitespace. Returns false if it does not
+ * fit in `size` bytes
+ */
+static bool copy_trimmed(char *buffer, size_t size, const char *string, size_t length)
+{
+    while (length > 0 && (*string == ' ' || *string == '\t'))
+    {
+        ++string;
+        --length;
+    }
+    while (length > 0 && (string[length - 1] == ' ' || string[length - 1] == '\t' || string[length - 1] == '\r' ||
+                          string[length - 1] == '\n'))
+    {
+        --length;
+    }
+    if (length >= size)
+    {
+        return false;
+    }
+    memcpy(buffer, string, length);
+    buffer[length] = '\0';
+    return true;
+}
+
+bool parse_frame_job(const char *line, struct FrameJob *job, char *error, size_t error_size)
+{
+    const char *comma = strchr(line, ',');
+    char datetime_string[64];
+    char location[MAX_JOB_LINE];
+    if (comma == NULL || !copy_trimmed(datetime_string, sizeof(datetime_string), line, (size_t)(comma - line)) ||
+        !copy_trimmed(location, sizeof(location), comma + 1, strlen(comma + 1)) || location[0] == '\0')
+    {
+        snprintf(error, error_size, "Jobs must be in form <yyyy-mm-ddThh:mm:ss>,<latitude>,<longitude> or "
+                                    "<yyyy-mm-ddThh:mm:ss>,<city>");
+        return false;
+    }
+
+    struct tm datetime = {0};
+    if (!string_to_time(datetime_string, &datetime))
+    {
+        snprintf(error, error_size, "Unable to parse datetime string '%s'", datetime_string);
+        return false;
+    }
+    job->julian_date = datetime_to_julian_date(&datetime);
+
+    // A second comma separates coordinates; city names may contain commas too,
+    // so only fall back to a city if the coordinates do not parse
+    char *separator = strchr(location, ',');
+    if (separator != NULL)
+    {
+        *separator = '\0';
+        double latitude, longitude;
+        if (parse_coordinate(location, -90.0, 90.0, &latitude) &&
+            parse_coordinate(separator + 1, -180.0, 180.0, &longitude))
+        {
+            job->latitude = latitude * M_PI / 180.0;
+            job->longitude = longitude * M_PI / 180.0;
+            return true;
+        }
+        *separator = ',';
+    }
+
+    const CityData *city = find_city(location);
+    if (city == NULL)
+    {
+        snprintf(error, error_size, "Could not find city '%s'", location);
+        return false;
+    }
+
+    job->latitude = city->latitude * M_PI / 180.0;
+    job->longitude = city->longitude * M_PI / 180.0;
+    return true;
+}
+
+bool read_frame_jobs(FILE *in, struct FrameJob **jobs, unsigned int *num_jobs)
+{
+    unsigned int capacity = 64;
+    *num_jobs = 0;
+    *jobs = malloc(capacity * sizeof(struct FrameJob));
+    if (*jobs == NULL)
+    {
+        fprintf(stderr, "Allocation of memory for frame jobs failed\n");
+        return false;
+    }
+
+    char line[MAX_JOB_LINE];
+    unsigned int line_number = 0;
+    while (fgets(line, sizeof(line), in) != NULL)
+    {
+        ++line_number;
+
+        const char *start = line;
+        while (*start == ' ' || *start == '\t')
+        {
+            ++start;
+        }
+        if (*start == '#' || *start == '\n' || *start == '\r' || *start == '\0')
+        {
+            continue;
+        }
+
+        if (*num_jobs == capacity)
+        {
+            capacity *= 2;
+            struct FrameJob *resized = realloc(*jobs, capacity * sizeof(struct FrameJob));
+            if (resized == NULL)
+            {
+                fprintf(stderr, "Allocation of memory for frame jobs failed\n");
+                return false;
+            }
+            *jobs = resized;
+        }
+
+        char error[MAX_JOB_LINE + 128];
+        if (!parse_frame_job(start, &(*jobs)[*num_jobs], error, sizeof(error)))
+        {
+            fprintf(stderr, "ERROR: Line %u of the jobs file: %s\n", line_number, error);
+            return false;
+        }
+        ++*num_jobs;
+    }
+
+    return true;
+}
+
+/* Encode the captured frame of a job and write it to its numbered file
+ */
+static void write_frame(const struct FramesConf *conf, struct FramesWorker *worker, unsigned int job)
+{
+    const char *extension = conf->format == FRAMES_ANSI ? "ans" : "txt";
+    int length = snprintf(worker->path, sizeof(worker->path), "%s/frame_%06u.%s", conf->directory, job + 1, extension);
+    if (length < 0 || (size_t)length >= sizeof(worker->path))
+    {
+        worker->ok = false;
+        return;
+    }
+
+    worker->buffer.length = 0;
+    if (!ansi_encode_lines(&worker->buffer, &worker->frame, conf->format == FRAMES_ANSI))
+    {
+        worker->ok = false;
+        return;
+    }
+
+    FILE *file = fopen(worker->path, "wb");
+    if (file == NULL)
+    {
+        worker->ok = false;
+        return;
+    }
+    bool written = fwrite(worker->buffer.data, 1, worker->buffer.length, file) == worker->buffer.length;
+    worker->ok = fclose(file) == 0 && written;
+}
+
+/* Position, draw and write every job whose number leaves a remainder of
+ * `index` when divided by the number of workers, stopping at the first frame
+ * that cannot be written
+ */
+static void run_worker(unsigned int index, void *data)
+{
+    struct FramesRun *run = data;
+    struct FramesWorker *worker = &run->workers[index];
+
+    for (unsigned int j = index; j < run->num_jobs && worker->ok; j += run->num_threads)
+    {
+        const struct FrameJob *job = &run->jobs[j];
+        worker->config.latitude = job->latitude;
+        worker->config.longitude = job->longitude;
+        update_sky(&worker->copy.sky, &worker->config, job->julian_date);
+
+        render_sky_canvas(&worker->sky_canvas, &worker->config, &worker->copy.sky, &worker->stars, &worker->labels);
+        canvas_capture(&worker->cells, &worker->frame);
+        write_frame(run->conf, worker, j);
+    }
+}
+
+/* Copy the sky's tables and allocate the cells for one worker. Returns false
+ * upon memory allocation error
+ */
+static bool generate_worker(struct FramesWorker *worker, const struct FramesConf *conf, const struct Conf *view,
+                            const struct Sky *sky)
+{
+    worker->config = *view;
+    worker->ok = true;
+
+    if (!copy_sky(&worker->copy, sky))
+    {
+        printf("Allocation of memory for frame workers failed\n");
+        return false;
+    }
+
+    if (!generate_cell_canvas(&worker->cells, conf->rows, conf->cols))
+    {
+        return false;
+    }
+
+    int top, left, height, width;
+    centered_square(conf->rows, conf->cols, view->aspect_ratio, &top, &left, &height, &width);
+    worker->sky_canvas = canvas_region(&worker->cells, top, left, height, width);
+
+    return generate_ansi_frame(&worker->frame, conf->rows, conf->cols);
+}
+
+static void free_worker(struct FramesWorker *worker)
+{
+    free_sky_copy(&worker->copy);
+    free_canvas(&worker->cells);
+    free_star_bins(&worker->stars);
+    free_label_layout(&worker->labels);
+    free_ansi_frame(&worker->frame);
+    free_ansi_buffer(&worker->buffer);
+}
+
+bool render_frames(const struct FramesConf *conf, const struct Conf *view, const struct FrameJob *jobs,
+                   unsigned int num_jobs, const struct Sky *sky)
+{
+    if (num_jobs == 0)
+    {
+        return true;
+    }
+
+    unsigned int num_threads = conf->num_threads > 0 ? conf->num_threads : thread_hardware_concurrency();
+    num_threads = MAX(1, MIN(num_threads, num_jobs));
+
+    struct FramesWorker *workers = calloc(num_threads, sizeof(struct FramesWorker));
+    bool success = workers != NULL;
+    for (unsigned int t = 0; t < num_threads && success; ++t)
+    {
+        success = generate_worker(&workers[t], conf, view, sky);
+    }
+    if (workers == NULL)
+    {
+        printf("Allocation of memory for frame workers failed\n");
+    }
+
+    if (success)
+    {
+        struct FramesRun run = {
+            .conf = conf, .jobs = jobs, .num_jobs = num_jobs, .num_threads = num_threads, .workers = workers};
+        parallel_run(num_threads, run_worker, &run);
+    }
+
+    for (unsigned int t = 0; t < num_threads && success; ++t)
+    {
+        if (!workers[t].ok)
+        {
+            fprintf(stderr, "ERROR: Unable to write frame '%s'\n", workers[t].path);
+            success = false;
+        }
+    }
+
+    for (unsigned int t = 0; workers != NULL && t < num_threads; ++t)
+    {
+        free_worker(&workers[t]);
+    }
+    free(workers);
+
+    return success;
+}
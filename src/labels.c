@@ -0,0 +1,108 @@
+#include "labels.h"
+
+#include "macros.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool label_grid_reset(struct LabelGrid *grid, int height, int width)
+{
+    int stride = (MAX(0, width) + 63) / 64;
+    size_t words = (size_t)MAX(0, height) * stride;
+
+    if (words > grid->capacity)
+    {
+        uint64_t *bits = realloc(grid->bits, words * sizeof(uint64_t));
+        if (bits == NULL)
+        {
+            free_label_grid(grid);
+            return false;
+        }
+        grid->bits = bits;
+        grid->capacity = words;
+    }
+
+    grid->height = MAX(0, height);
+    grid->width = MAX(0, width);
+    grid->stride = stride;
+    if (words > 0)
+    {
+        memset(grid->bits, 0, words * sizeof(uint64_t));
+    }
+
+    return true;
+}
+
+void free_label_grid(struct LabelGrid *grid)
+{
+    free(grid->bits);
+    *grid = (struct LabelGrid){0};
+}
+
+/* Bits of the word holding column `x` that lie in columns [x, end)
+ */
+static uint64_t word_mask(int x, int end)
+{
+    int first = x % 64;
+    int count = MIN(64 - first, end - x);
+    uint64_t mask = count == 64 ? ~0ull : ((1ull << count) - 1);
+    return mask << first;
+}
+
+void label_grid_occupy(struct LabelGrid *grid, int y, int x, int length)
+{
+    if (y < 0 || y >= grid->height)
+    {
+        return;
+    }
+
+    int end = MIN(grid->width, x + length);
+    uint64_t *row = grid->bits + (size_t)y * grid->stride;
+    for (x = MAX(0, x); x < end; x = (x / 64 + 1) * 64)
+    {
+        row[x / 64] |= word_mask(x, end);
+    }
+}
+
+bool label_grid_is_free(const struct LabelGrid *grid, int y, int x, int length)
+{
+    if (y < 0 || y >= grid->height || x < 0 || x + length > grid->width)
+    {
+        return false;
+    }
+
+    int end = x + length;
+    const uint64_t *row = grid->bits + (size_t)y * grid->stride;
+    for (; x < end; x = (x / 64 + 1) * 64)
+    {
+        if (row[x / 64] & word_mask(x, end))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool label_grid_place(struct LabelGrid *grid, int y, int x, int symbol_width, int length, int *label_y, int *label_x)
+{
+    const int candidates[][2] = {
+        {y - 1, x + 1},            // Above right
+        {y, x + symbol_width + 1}, // Right, a cell away from the symbol
+        {y - 1, x - length},       // Above left
+        {y, x - length - 1},       // Left
+        {y + 1, x + 1},            // Below right
+        {y + 1, x - length},       // Below left
+    };
+
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); ++i)
+    {
+        if (label_grid_is_free(grid, candidates[i][0], candidates[i][1], length))
+        {
+            *label_y = candidates[i][0];
+            *label_x = candidates[i][1];
+            label_grid_occupy(grid, *label_y, *label_x, length);
+            return true;
+        }
+    }
+    return false;
+}
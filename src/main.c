@@ -1,12 +1,22 @@
 #include "city.h"
+#include "constell_graph.h"
 #include "core.h"
 #include "core_position.h"
-#include "core_render.h"
 #include "data/keplerian_elements.h"
+#include "ephemeris.h"
+#include "events.h"
+#include "framebuffer.h"
+#include "frames.h"
 #include "macros.h"
 #include "parse_BSC5.h"
+#include "recording.h"
+#include "server.h"
+#include "sky.h"
+#include "sky_index.h"
 #include "stopwatch.h"
+#include "stream.h"
 #include "term.h"
+#include "timeline.h"
 #include "version.h"
 
 // Embedded data generated during build
@@ -25,22 +35,51 @@
 #include <curses.h>
 
 #include <locale.h>
+#include <math.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+// Number of cities listed by --complete-city
+#define MAX_CITY_COMPLETIONS 20
+
+// Number of close matches suggested when --city is not found
+#define MAX_CITY_SUGGESTIONS 5
+
 static void catch_winch(int sig);
+static void catch_stop(int sig);
 static void resize_ncurses(void);
 static void resize_meta(WINDOW *win);
 static void resize_main(WINDOW *win, const struct Conf *config);
 static void parse_options(int argc, char *argv[], struct Conf *config);
 static void convert_options(struct Conf *config);
+static void convert_ephemeris_options(const struct Conf *config, struct EphemerisConf *ephemeris_config);
+static void convert_events_options(const struct Conf *config, struct EventsConf *events_config);
+static bool run_events(const struct EventsConf *events_config, const struct Sky *sky);
+static void convert_server_options(const struct Conf *config, struct ServerConf *server_config);
+static void convert_frames_options(const struct Conf *config, struct FramesConf *frames_config);
+static bool run_render_frames(const struct Conf *config, const struct FramesConf *frames_config, const struct Sky *sky);
+static void open_stream(const struct Conf *config, struct Stream *stream, FILE **stream_file, unsigned int num_stars);
+static void run_headless_stream(struct Stream *stream, struct Sky *sky, const struct Conf *config);
+static bool publish_frame(struct Framebuffer *framebuffer, struct AnsiFrame *frame, struct Stream *objects,
+                          WINDOW *main_win, const struct Sky *sky);
 static const char *get_timezone(const struct tm *local_time);
-static void render_metadata(WINDOW *win, const struct Conf *config);
+static void render_metadata(WINDOW *win, const struct Conf *config, const struct Planet *planet_table,
+                            const struct Moon *moon_object);
 
 // Track if we need to resize the curses window
 static volatile bool perform_resize = false;
+
+// Track if an interrupt asked to quit, so files are finished and the terminal
+// restored as on 'q'
+static volatile sig_atomic_t perform_stop = 0;
 #ifdef _WIN32
 // Track console size on windows
 static COORD winsize;
@@ -66,16 +105,58 @@ int main(int argc, char *argv[])
         .quit_on_any = false,
         .unicode = false,
         .braille = false,
+        .braille_stars = false,
+        .combine_stars = false,
         .color = false,
         .grid = false,
         .constell = false,
         .metadata = false,
+        .ephemeris = NULL,
+        .ephemeris_format = "csv",
+        .threads = 0,
+        .serve = NULL,
+        .max_clients = 1024,
+        .stream = NULL,
+        .stream_file = NULL,
+        .shm_name = NULL,
+        .render_frames = NULL,
+        .render_dir = ".",
+        .render_format = "ansi",
+        .render_size = "80x24",
+        .record = NULL,
+        .scrub_frames = 256,
+        .events = NULL,
+        .events_separation = 1.0,
     };
 
     // Parse command line args and convert to internal representations
     parse_options(argc, argv, &config);
     convert_options(&config);
 
+    struct EphemerisConf ephemeris_config;
+    if (config.ephemeris != NULL)
+    {
+        convert_ephemeris_options(&config, &ephemeris_config);
+    }
+
+    struct EventsConf events_config;
+    if (config.events != NULL)
+    {
+        convert_events_options(&config, &events_config);
+    }
+
+    struct ServerConf server_config;
+    if (config.serve != NULL)
+    {
+        convert_server_options(&config, &server_config);
+    }
+
+    struct FramesConf frames_config;
+    if (config.render_frames != NULL)
+    {
+        convert_frames_options(&config, &frames_config);
+    }
+
     // Time for each frame in microseconds
     unsigned long dt = (unsigned long)(1.0 / config.fps * 1.0E6);
 
@@ -89,6 +170,8 @@ int main(int argc, char *argv[])
     struct Planet *planet_table = NULL;
     struct Moon moon_object;
     int *num_by_mag = NULL;
+    struct SkyIndex sky_index;
+    struct ConstellGraph constell_graph;
 
     // Track success of functions
     bool s = true;
@@ -105,6 +188,8 @@ int main(int argc, char *argv[])
     s = s && generate_planet_table(&planet_table, planet_elements, planet_rates, planet_extras);
     s = s && generate_moon_object(&moon_object, &moon_elements, &moon_rates);
     s = s && star_numbers_by_magnitude(&num_by_mag, star_table, num_stars);
+    s = s && generate_sky_index(&sky_index, star_table, num_stars, num_by_mag);
+    s = s && generate_constell_graph(&constell_graph, constell_table, num_const, star_table, num_stars);
 
     if (!s)
     {
@@ -114,20 +199,167 @@ int main(int argc, char *argv[])
 
     // This memory is no longer needed
     free(BSC5_entries);
+    free_constells(constell_table, num_const);
+
+    constell_graph_set_threshold(&constell_graph, config.threshold);
+
+    struct Sky sky = {
+        .star_table = star_table,
+        .num_stars = num_stars,
+        .sky_index = &sky_index,
+        .constell_graph = &constell_graph,
+        .planet_table = planet_table,
+        .moon_object = &moon_object,
+    };
+
+    // Server mode: render for connected terminals only
+    if (config.serve != NULL)
+    {
+        setlocale(LC_ALL, ""); // Required for unicode rendering
+        bool server_success = run_server(&server_config, &sky);
+
+        free_constell_graph(&constell_graph);
+        free_stars(star_table, num_stars);
+        free_planets(planet_table, NUM_PLANETS);
+        free_moon_object(moon_object);
+        free_star_names(name_table, num_stars);
+        free_sky_index(&sky_index);
+        free(num_by_mag);
+
+        return server_success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Batch mode: print the ephemeris and skip curses entirely
+    if (config.ephemeris != NULL)
+    {
+        bool ephemeris_success =
+            generate_ephemeris(stdout, &ephemeris_config, star_table, num_stars, planet_table, &moon_object);
+
+        free_constell_graph(&constell_graph);
+        free_stars(star_table, num_stars);
+        free_planets(planet_table, NUM_PLANETS);
+        free_moon_object(moon_object);
+        free_star_names(name_table, num_stars);
+        free_sky_index(&sky_index);
+        free(num_by_mag);
+
+        return ephemeris_success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Batch mode: print the events found and skip curses entirely
+    if (config.events != NULL)
+    {
+        bool events_success = run_events(&events_config, &sky);
+
+        free_constell_graph(&constell_graph);
+        free_stars(star_table, num_stars);
+        free_planets(planet_table, NUM_PLANETS);
+        free_moon_object(moon_object);
+        free_star_names(name_table, num_stars);
+        free_sky_index(&sky_index);
+        free(num_by_mag);
+
+        return events_success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Batch mode: render frames to files without a terminal
+    if (config.render_frames != NULL)
+    {
+        setlocale(LC_ALL, ""); // Required for unicode rendering
+        bool frames_success = run_render_frames(&config, &frames_config, &sky);
+
+        free_constell_graph(&constell_graph);
+        free_stars(star_table, num_stars);
+        free_planets(planet_table, NUM_PLANETS);
+        free_moon_object(moon_object);
+        free_star_names(name_table, num_stars);
+        free_sky_index(&sky_index);
+        free(num_by_mag);
+
+        return frames_success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Streaming output, alongside the display or in place of it
+    struct Stream stream;
+    FILE *stream_file = NULL;
+    bool streaming = config.stream != NULL;
+    if (streaming)
+    {
+        open_stream(&config, &stream, &stream_file, num_stars);
+    }
+
+    if (streaming && config.stream_file == NULL)
+    {
+        run_headless_stream(&stream, &sky, &config);
+
+        free_stream(&stream);
+        free_constell_graph(&constell_graph);
+        free_stars(star_table, num_stars);
+        free_planets(planet_table, NUM_PLANETS);
+        free_moon_object(moon_object);
+        free_star_names(name_table, num_stars);
+        free_sky_index(&sky_index);
+        free(num_by_mag);
+
+        return EXIT_SUCCESS;
+    }
 
     // Terminal/System settings
     setlocale(LC_ALL, ""); // Required for unicode rendering
 #ifndef _WIN32
     signal(SIGWINCH, catch_winch); // Capture window resizes
 #endif
+    signal(SIGINT, catch_stop);
+    signal(SIGTERM, catch_stop);
     tzset(); // Initialize timezone information
 
     // Ncurses initialization
     ncurses_init(config.color);
 
-    // Main (projection) window
+    // Shared memory export of each frame
+    struct Framebuffer framebuffer;
+    struct AnsiFrame framebuffer_frame = {0};
+    struct Stream framebuffer_objects;
+    bool publishing = config.shm_name != NULL;
+    if (publishing)
+    {
+        bool framebuffer_success = generate_framebuffer(&framebuffer, config.shm_name, LINES, COLS, num_stars);
+        framebuffer_success =
+            framebuffer_success && generate_stream(&framebuffer_objects, -1, STREAM_BINARY, num_stars);
+        if (!framebuffer_success)
+        {
+            ncurses_kill();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Recording of the session
+    struct Recording recording;
+    bool recording_frames = config.record != NULL;
+    if (recording_frames && !generate_recording(&recording, config.record, LINES, COLS))
+    {
+        ncurses_kill();
+        exit(EXIT_FAILURE);
+    }
+
+    // Time advances by a fixed step per frame so frames can be revisited
+    const double microsec_per_day = 24.0 * 60.0 * 60.0 * 1.0E6;
+    const double step = (double)dt / microsec_per_day * config.speed;
+    long long frame = 0;
+    int direction = 1;
+    bool paused = false;
+
+    // Positions of recent and upcoming frames. Without it every frame is
+    // computed as it is shown
+    struct Timeline timeline;
+    bool scrubbing = config.scrub_frames > 0 &&
+                     generate_timeline(&timeline, &config, &sky, julian_date_start, step, (unsigned int)config.scrub_frames,
+                                       timeline_prefetch_depth(config.speed, config.fps, (unsigned int)config.scrub_frames));
+
+    // Main (projection) window, and the layers composited into it
     WINDOW *main_win = newwin(0, 0, 0, 0);
     resize_main(main_win, &config);
+    struct Compositor compositor = {0};
 
     // Metadata window
     WINDOW *metadata_win = newwin(0, 0, 0, 0); // Position at top left
@@ -151,6 +383,7 @@ int main(int argc, char *argv[])
         {
             resize_ncurses();
             resize_main(main_win, &config);
+            invalidate_compositor(&compositor);
             if (config.metadata)
             {
                 resize_meta(metadata_win);
@@ -162,45 +395,64 @@ int main(int argc, char *argv[])
         else
         {
             werase(metadata_win);
-            werase(main_win);
         }
 
-        // Update object positions
-        update_star_positions(star_table, num_stars, julian_date, config.latitude, config.longitude);
-        update_planet_positions(planet_table, julian_date, config.latitude, config.longitude);
-        update_moon_position(&moon_object, julian_date, config.latitude, config.longitude);
-        update_moon_phase(&moon_object, julian_date, config.latitude);
-
-        // Render objects
-        render_stars_stereo(main_win, &config, star_table, num_stars, num_by_mag);
-        if (config.constell)
+        // Update object positions and render them
+        julian_date = julian_date_start + (double)frame * step;
+        if (scrubbing)
         {
-            render_constells(main_win, &config, &constell_table, num_const, star_table);
+            timeline_seek(&timeline, frame, direction);
         }
-        render_planets_stereo(main_win, &config, planet_table);
-        render_moon_stereo(main_win, &config, moon_object);
-        if (config.grid)
+        if (!scrubbing || !timeline_restore(&timeline, frame, &sky))
         {
-            render_azimuthal_grid(main_win, &config);
+            update_sky(&sky, &config, julian_date);
+            if (scrubbing)
+            {
+                timeline_store(&timeline, frame, &sky);
+            }
         }
-        else
+        render_sky(main_win, &config, &sky, &compositor);
+
+        // Stream the objects just rendered. Stop if the reader goes away
+        if (streaming)
         {
-            render_cardinal_directions(main_win, &config);
+            int height, width;
+            getmaxyx(main_win, height, width);
+            stream_encode_frame(&stream, &sky, julian_date, height, width);
+            streaming = stream_write_frame(&stream);
         }
 
         // Render metadata
         if (config.metadata)
         {
-            render_metadata(metadata_win, &config);
+            render_metadata(metadata_win, &config, planet_table, &moon_object);
         }
 
         // Exit if ESC or q is pressed
         int ch = getch();
-        if (ch != ERR && (ch == 27 || ch == 'q' || config.quit_on_any))
+        if (perform_stop || (ch != ERR && (ch == 27 || ch == 'q' || config.quit_on_any)))
         {
             break;
         }
 
+        // Scrub through time, jumping by one second of playback
+        if (ch == ' ')
+        {
+            paused = !paused;
+        }
+        else if (ch == 'r')
+        {
+            direction = -direction;
+        }
+        else if (ch == KEY_LEFT)
+        {
+            frame -= config.fps;
+        }
+        else if (ch == KEY_RIGHT)
+        {
+            frame += config.fps;
+        }
+
         // Use double buffering to avoid flickering while updating
         wnoutrefresh(main_win);
         if (config.metadata)
@@ -209,12 +461,26 @@ int main(int argc, char *argv[])
         }
         doupdate();
 
+        // Publish the screen just drawn. Stop if shared memory runs out
+        if (publishing)
+        {
+            publishing = publish_frame(&framebuffer, &framebuffer_frame, &framebuffer_objects, main_win, &sky);
+        }
+
+        // Record the changes just drawn. Stop if the file can't be written
+        if (recording_frames)
+        {
+            recording_frames = recording_capture(&recording, curscr);
+        }
+
         // TODO: this timing scheme *should* minimize any drift or divergence
         // between simulation time and realtime. Check this to make sure.
 
         // Increment "simulation" time
-        const double microsec_per_day = 24.0 * 60.0 * 60.0 * 1.0E6;
-        julian_date += (double)dt / microsec_per_day * config.speed;
+        if (!paused)
+        {
+            frame += direction;
+        }
 
         // Determine time it took to update positions and render to screen
         struct SwTimestamp frame_end;
@@ -233,38 +499,46 @@ int main(int argc, char *argv[])
 
     // Clean up
 
+    free_compositor(&compositor);
     ncurses_kill();
 
-    free_constells(constell_table, num_const);
+    if (config.stream != NULL)
+    {
+        free_stream(&stream);
+        fclose(stream_file);
+    }
+    if (config.shm_name != NULL)
+    {
+        free_framebuffer(&framebuffer);
+        free_ansi_frame(&framebuffer_frame);
+        free_stream(&framebuffer_objects);
+    }
+    if (scrubbing)
+    {
+        free_timeline(&timeline);
+    }
+    if (config.record != NULL && !free_recording(&recording))
+    {
+        fprintf(stderr, "ERROR: Unable to write recording file '%s'\n", config.record);
+    }
+    free_constell_graph(&constell_graph);
     free_stars(star_table, num_stars);
     free_planets(planet_table, NUM_PLANETS);
     free_moon_object(moon_object);
     free_star_names(name_table, num_stars);
+    free_sky_index(&sky_index);
+    free(num_by_mag);
 
     return EXIT_SUCCESS;
 }
 
-void print_city_name_quoted(const CityData *city, void *unused)
+void print_option_completion(const char *short_name, const char *long_name)
 {
-    const char *s = city->city_name;
-
-    putchar('\'');
-    // Single-quote wrapping with escaping--needed for bash completions to
-    // handle city names single quotes in them (e.g. "St. John's")
-    while (*s)
+    if (short_name != NULL)
     {
-        if (*s == '\'')
-        {
-            printf("'\\''"); // close, escape, reopen
-        }
-        else
-        {
-            putchar(*s);
-        }
-        s++;
+        printf("    -%s\n", short_name);
     }
-    putchar('\'');
-    putchar('\n');
+    printf("    --%s\n", long_name);
 }
 
 void parse_options(int argc, char *argv[], struct Conf *config)
@@ -280,9 +554,12 @@ void parse_options(int argc, char *argv[], struct Conf *config)
 #include "arg_definitions.h"
     struct arg_end *end = arg_end(20);
 
-    void *argtable[] = {latitude_arg, longitude_arg, datetime_arg,    threshold_arg, label_arg,   fps_arg,  speed_arg,
-                        color_arg,    constell_arg,  grid_arg,        unicode_arg,   braille_arg, quit_arg, meta_arg,
-                        ratio_arg,    help_arg,      completions_arg, city_arg,      version_arg, end};
+    void *argtable[] = {latitude_arg, longitude_arg, datetime_arg, threshold_arg, label_arg, fps_arg, speed_arg, color_arg,
+                        constell_arg, grid_arg, unicode_arg, braille_arg, quit_arg, meta_arg, ratio_arg, help_arg,
+                        completions_arg, city_arg, version_arg, complete_city_arg, ephemeris_arg, ephemeris_format_arg,
+                        events_arg, events_separation_arg, threads_arg, serve_arg, max_clients_arg, stream_arg, stream_file_arg,
+                        shm_arg, record_arg, scrub_frames_arg, render_frames_arg, render_dir_arg, render_format_arg,
+                        render_size_arg, braille_stars_arg, combine_stars_arg, end};
 
     int nerrors = arg_parse(argc, argv, argtable);
 
@@ -300,22 +577,15 @@ void parse_options(int argc, char *argv[], struct Conf *config)
         printf("# Bash completions for astroterm\n");
         printf("ASTROTERM_OPTIONS=(\n");
 #define INCLUDE_ARG_DEFINITION_DBL0(token, short_name, long_name, datatype, glossary)                                          \
-    printf("    -%s\n", short_name);                                                                                           \
-    printf("    --%s\n", long_name);
+    print_option_completion(short_name, long_name);
 #define INCLUDE_ARG_DEFINITION_STR0(token, short_name, long_name, datatype, glossary)                                          \
-    printf("    -%s\n", short_name);                                                                                           \
-    printf("    --%s\n", long_name);
+    print_option_completion(short_name, long_name);
 #define INCLUDE_ARG_DEFINITION_LIT0(token, short_name, long_name, glossary)                                                    \
-    printf("    -%s\n", short_name);                                                                                           \
-    printf("    --%s\n", long_name);
+    print_option_completion(short_name, long_name);
 #define INCLUDE_ARG_DEFINITION_INT0(token, short_name, long_name, datatype, glossary)                                          \
-    printf("    -%s\n", short_name);                                                                                           \
-    printf("    --%s\n", long_name);
+    print_option_completion(short_name, long_name);
 #include "arg_definitions.h"
         printf(")\n\n");
-        printf("ASTROTERM_CITIES=(\n");
-        iter_cities(&print_city_name_quoted, NULL);
-        printf(")\n");
         // Warning: this is a vibe code modified version from PR #80 in order to
         // get things working on bash 3.2. The cleaning of the input word seems
         // necessary to prevent some weird escaping issues that cause the completions
@@ -329,12 +599,10 @@ void parse_options(int argc, char *argv[], struct Conf *config)
         printf("            clean_word=\"${clean_word//\\\"/}\"\n");
         printf("            clean_word=\"${clean_word//\\'/}\"\n");
         printf("            COMPREPLY=()\n");
-        printf("            for city in \"${ASTROTERM_CITIES[@]}\"; do\n");
-        printf("                if [[ \"$city\" == \"${clean_word}\"* ]]; then\n");
-        printf("                    printf -v city_esc '%%q ' \"$city\"\n");
-        printf("                    COMPREPLY+=(\"$city_esc\")\n");
-        printf("                fi\n");
-        printf("            done\n");
+        printf("            while IFS= read -r city; do\n");
+        printf("                printf -v city_esc '%%q ' \"$city\"\n");
+        printf("                COMPREPLY+=(\"$city_esc\")\n");
+        printf("            done < <(\"${COMP_WORDS[0]}\" --complete-city \"$clean_word\" 2>/dev/null)\n");
         printf("            ;;\n");
         printf("        *)\n");
         printf("            COMPREPLY=( $(compgen -W \"${ASTROTERM_OPTIONS[*]}\" -- \"${word}\") )\n");
@@ -345,6 +613,29 @@ void parse_options(int argc, char *argv[], struct Conf *config)
         exit(EXIT_SUCCESS);
     }
 
+    if (complete_city_arg->count > 0)
+    {
+        // Queried by the bash completion function on every TAB
+        const CityData *matches[MAX_CITY_COMPLETIONS];
+        int num_matches = complete_city(complete_city_arg->sval[0], matches, MAX_CITY_COMPLETIONS);
+        for (int i = 0; i < num_matches; i++)
+        {
+            printf("%s\n", matches[i]->city_name);
+        }
+
+        // Fall back to fuzzy matches for typos and missing accents
+        if (num_matches == 0)
+        {
+            CityMatch fuzzy_matches[MAX_CITY_COMPLETIONS];
+            num_matches = search_cities(complete_city_arg->sval[0], fuzzy_matches, MAX_CITY_COMPLETIONS);
+            for (int i = 0; i < num_matches; i++)
+            {
+                printf("%s\n", fuzzy_matches[i].city->city_name);
+            }
+        }
+        exit(EXIT_SUCCESS);
+    }
+
     if (nerrors > 0)
     {
         arg_print_errors(stderr, end, argv[0]);
@@ -438,6 +729,16 @@ void parse_options(int argc, char *argv[], struct Conf *config)
         config->braille = true;
     }
 
+    if (braille_stars_arg->count > 0)
+    {
+        config->braille_stars = true;
+    }
+
+    if (combine_stars_arg->count > 0)
+    {
+        config->combine_stars = true;
+    }
+
     if (quit_arg->count > 0)
     {
         config->quit_on_any = true;
@@ -448,20 +749,152 @@ void parse_options(int argc, char *argv[], struct Conf *config)
         config->aspect_ratio = ratio_arg->dval[0];
     }
 
+    if (ephemeris_arg->count > 0)
+    {
+        config->ephemeris = ephemeris_arg->sval[0];
+    }
+
+    if (ephemeris_format_arg->count > 0)
+    {
+        config->ephemeris_format = ephemeris_format_arg->sval[0];
+        if (strcmp(config->ephemeris_format, "csv") != 0 && strcmp(config->ephemeris_format, "binary") != 0)
+        {
+            fprintf(stderr, "ERROR: Ephemeris format must be 'csv' or 'binary'\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (events_arg->count > 0)
+    {
+        config->events = events_arg->sval[0];
+    }
+
+    if (events_separation_arg->count > 0)
+    {
+        config->events_separation = events_separation_arg->dval[0];
+        if (!(config->events_separation > 0.0) || config->events_separation > 180.0)
+        {
+            fprintf(stderr, "ERROR: Events separation must be in range (0, 180]\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (threads_arg->count > 0)
+    {
+        config->threads = threads_arg->ival[0];
+        if (config->threads < 1)
+        {
+            fprintf(stderr, "ERROR: Threads must be greater than or equal to 1\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (serve_arg->count > 0)
+    {
+        config->serve = serve_arg->sval[0];
+    }
+
+    if (max_clients_arg->count > 0)
+    {
+        config->max_clients = max_clients_arg->ival[0];
+        if (config->max_clients < 1)
+        {
+            fprintf(stderr, "ERROR: Max clients must be greater than or equal to 1\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (stream_arg->count > 0)
+    {
+        config->stream = stream_arg->sval[0];
+        enum StreamFormat format;
+        if (!parse_stream_format(config->stream, &format))
+        {
+            fprintf(stderr, "ERROR: Stream format must be 'ndjson' or 'binary'\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (stream_file_arg->count > 0)
+    {
+        config->stream_file = stream_file_arg->sval[0];
+        if (config->stream == NULL)
+        {
+            fprintf(stderr, "ERROR: --stream-file requires --stream\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (shm_arg->count > 0)
+    {
+        config->shm_name = shm_arg->sval[0];
+    }
+
+    if (scrub_frames_arg->count > 0)
+    {
+        config->scrub_frames = scrub_frames_arg->ival[0];
+        if (config->scrub_frames < 0)
+        {
+            fprintf(stderr, "ERROR: Scrub frames must be greater than or equal to 0\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (record_arg->count > 0)
+    {
+        config->record = record_arg->sval[0];
+    }
+
+    if (render_frames_arg->count > 0)
+    {
+        config->render_frames = render_frames_arg->sval[0];
+    }
+
+    if (render_dir_arg->count > 0)
+    {
+        config->render_dir = render_dir_arg->sval[0];
+    }
+
+    if (render_format_arg->count > 0)
+    {
+        config->render_format = render_format_arg->sval[0];
+        enum FramesFormat format;
+        if (!parse_frames_format(config->render_format, &format))
+        {
+            fprintf(stderr, "ERROR: Render format must be 'ansi' or 'text'\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (render_size_arg->count > 0)
+    {
+        config->render_size = render_size_arg->sval[0];
+    }
+
     if (city_arg->count > 0)
     {
         const char *city_name = city_arg->sval[0];
-        CityData *city = get_city(city_name);
+        const CityData *city = find_city(city_name);
 
         if (!city)
         {
+            // Suggest close matches
+            CityMatch matches[MAX_CITY_SUGGESTIONS];
+            int num_matches = search_cities(city_name, matches, MAX_CITY_SUGGESTIONS);
             fprintf(stderr, "ERROR: Could not find city \"%s\"\n", city_name);
+            if (num_matches > 0)
+            {
+                fprintf(stderr, "Did you mean:\n");
+            }
+            for (int i = 0; i < num_matches; i++)
+            {
+                fprintf(stderr, "    %s (%s)\n", matches[i].city->city_name, matches[i].city->country_code);
+            }
             exit(EXIT_FAILURE);
         }
 
         config->latitude = city->latitude;
         config->longitude = city->longitude;
-        free_city(city);
     }
 
     // Free Argtable resources
@@ -499,12 +932,320 @@ void convert_options(struct Conf *config)
     return;
 }
 
+/* Parse an ephemeris datetime field. Exits on error
+ */
+static double parse_ephemeris_date(const char *string)
+{
+    struct tm datetime;
+    if (!string_to_time(string, &datetime))
+    {
+        fprintf(stderr,
+                "ERROR: Unable to parse datetime string '%s'\nDatetimes "
+                "must be in form <yyyy-mm-ddThh:mm:ss>\n",
+                string);
+        exit(EXIT_FAILURE);
+    }
+    return datetime_to_julian_date(&datetime);
+}
+
+void convert_ephemeris_options(const struct Conf *config, struct EphemerisConf *ephemeris_config)
+{
+    // Split "<start>,<end>,<step>". Spaces also separate fields so the range
+    // may be given as one quoted argument
+    char range[128];
+    snprintf(range, sizeof(range), "%s", config->ephemeris);
+
+    const char *fields[3];
+    int num_fields = 0;
+    for (char *field = strtok(range, ", "); field != NULL; field = strtok(NULL, ", "))
+    {
+        if (num_fields == 3)
+        {
+            num_fields++;
+            break;
+        }
+        fields[num_fields++] = field;
+    }
+
+    if (num_fields != 3)
+    {
+        fprintf(stderr, "ERROR: Ephemeris range must be in form <start>,<end>,<step>\n");
+        exit(EXIT_FAILURE);
+    }
+
+    *ephemeris_config = (struct EphemerisConf){
+        .julian_date_start = parse_ephemeris_date(fields[0]),
+        .julian_date_end = parse_ephemeris_date(fields[1]),
+        .latitude = config->latitude,
+        .longitude = config->longitude,
+        .threshold = config->threshold,
+        .format = strcmp(config->ephemeris_format, "binary") == 0 ? EPHEMERIS_BINARY : EPHEMERIS_CSV,
+        .num_threads = (unsigned int)config->threads,
+    };
+
+    if (!parse_ephemeris_step(fields[2], &ephemeris_config->step))
+    {
+        fprintf(stderr,
+                "ERROR: Unable to parse ephemeris step '%s'\nSteps must be a positive number of seconds or end in "
+                "s, m, h or d\n",
+                fields[2]);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ephemeris_config->julian_date_end < ephemeris_config->julian_date_start)
+    {
+        fprintf(stderr, "ERROR: Ephemeris end must not be before its start\n");
+        exit(EXIT_FAILURE);
+    }
+
+#ifdef _WIN32
+    // Keep line endings and binary records intact
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+}
+
+void convert_events_options(const struct Conf *config, struct EventsConf *events_config)
+{
+    char range[128];
+    snprintf(range, sizeof(range), "%s", config->events);
+
+    const char *fields[2];
+    int num_fields = 0;
+    for (char *field = strtok(range, ", "); field != NULL; field = strtok(NULL, ", "))
+    {
+        if (num_fields == 2)
+        {
+            num_fields++;
+            break;
+        }
+        fields[num_fields++] = field;
+    }
+
+    if (num_fields != 2)
+    {
+        fprintf(stderr, "ERROR: Events range must be in form <start>,<end>\n");
+        exit(EXIT_FAILURE);
+    }
+
+    *events_config = (struct EventsConf){
+        .julian_date_start = parse_ephemeris_date(fields[0]),
+        .julian_date_end = parse_ephemeris_date(fields[1]),
+        .separation = config->events_separation * TO_RAD,
+        .threshold = config->threshold,
+        .num_threads = (unsigned int)config->threads,
+    };
+
+    if (events_config->julian_date_end < events_config->julian_date_start)
+    {
+        fprintf(stderr, "ERROR: Events end must not be before its start\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+bool run_events(const struct EventsConf *events_config, const struct Sky *sky)
+{
+    struct SkyEvent *events;
+    unsigned int num_events;
+    if (!search_events(events_config, sky->star_table, sky->sky_index, sky->planet_table, sky->moon_object, &events,
+                       &num_events))
+    {
+        return false;
+    }
+
+    bool success = write_events(stdout, events, num_events, sky->star_table, sky->planet_table, sky->moon_object);
+    free(events);
+    return success;
+}
+
+void convert_server_options(const struct Conf *config, struct ServerConf *server_config)
+{
+    *server_config = (struct ServerConf){
+        .defaults =
+            {
+                .latitude = config->latitude,
+                .longitude = config->longitude,
+                .threshold = config->threshold,
+                .label_thresh = config->label_thresh,
+                .rows = 24,
+                .cols = 80,
+                .color = config->color,
+                .unicode = config->unicode,
+                .braille = config->braille,
+                .braille_stars = config->braille_stars,
+                .combine_stars = config->combine_stars,
+                .grid = config->grid,
+                .constell = config->constell,
+            },
+        .julian_date = julian_date_start,
+        .speed = config->speed,
+        .fps = config->fps,
+        .aspect_ratio = config->aspect_ratio,
+        .max_clients = (unsigned int)config->max_clients,
+    };
+
+    if (!parse_server_address(config->serve, &server_config->address))
+    {
+        fprintf(stderr,
+                "ERROR: Unable to parse server address '%s'\nAddresses must be a Unix socket path containing '/', "
+                "shorter than 104 bytes, <host>:<port> or <port>\n",
+                config->serve);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void convert_frames_options(const struct Conf *config, struct FramesConf *frames_config)
+{
+    *frames_config = (struct FramesConf){
+        .directory = config->render_dir,
+        .num_threads = (unsigned int)config->threads,
+    };
+    parse_frames_format(config->render_format, &frames_config->format);
+
+    char separator;
+    char trailing;
+    if (sscanf(config->render_size, "%d%c%d%c", &frames_config->cols, &separator, &frames_config->rows, &trailing) !=
+            3 ||
+        separator != 'x' || frames_config->cols < 1 || frames_config->rows < 1 || frames_config->cols > 4096 ||
+        frames_config->rows > 4096)
+    {
+        fprintf(stderr, "ERROR: Render size must be in form <cols>x<rows>, each between 1 and 4096\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+bool run_render_frames(const struct Conf *config, const struct FramesConf *frames_config, const struct Sky *sky)
+{
+    bool from_stdin = strcmp(config->render_frames, "-") == 0;
+    FILE *in = from_stdin ? stdin : fopen(config->render_frames, "r");
+    if (in == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to open jobs file '%s'\n", config->render_frames);
+        return false;
+    }
+
+    struct FrameJob *jobs = NULL;
+    unsigned int num_jobs = 0;
+    bool success = read_frame_jobs(in, &jobs, &num_jobs);
+    if (!from_stdin)
+    {
+        fclose(in);
+    }
+
+    success = success && render_frames(frames_config, config, jobs, num_jobs, sky);
+    free(jobs);
+    return success;
+}
+
+void open_stream(const struct Conf *config, struct Stream *stream, FILE **stream_file, unsigned int num_stars)
+{
+    enum StreamFormat format;
+    parse_stream_format(config->stream, &format);
+
+    int fd;
+    if (config->stream_file == NULL)
+    {
+        fd = fileno(stdout);
+#ifdef _WIN32
+        // Keep line endings and binary records intact
+        _setmode(fd, _O_BINARY);
+#endif
+    }
+    else
+    {
+        // Opening a named pipe waits for a reader
+        *stream_file = fopen(config->stream_file, "wb");
+        if (*stream_file == NULL)
+        {
+            fprintf(stderr, "ERROR: Unable to open stream file '%s'\n", config->stream_file);
+            exit(EXIT_FAILURE);
+        }
+        fd = fileno(*stream_file);
+    }
+
+#ifndef _WIN32
+    // Notice readers going away through write errors
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    if (!generate_stream(stream, fd, format, num_stars))
+    {
+        exit(EXIT_FAILURE);
+    }
+}
+
+void run_headless_stream(struct Stream *stream, struct Sky *sky, const struct Conf *config)
+{
+    // Time for each frame in microseconds
+    unsigned long dt = (unsigned long)(1.0 / config->fps * 1.0E6);
+
+    // Project cells as the display would on an 80x24 terminal
+    float aspect = (float)(config->aspect_ratio > 0.0 ? config->aspect_ratio : DEFAULT_CELL_ASPECT);
+    int height, width;
+    fit_square(24, 80, aspect, &height, &width);
+
+    while (true)
+    {
+        struct SwTimestamp frame_begin;
+        sw_gettime(&frame_begin);
+
+        update_sky(sky, config, julian_date);
+        stream_encode_frame(stream, sky, julian_date, height, width);
+        if (!stream_write_frame(stream))
+        {
+            return;
+        }
+
+        const double microsec_per_day = 24.0 * 60.0 * 60.0 * 1.0E6;
+        julian_date += (double)dt / microsec_per_day * config->speed;
+
+        struct SwTimestamp frame_end;
+        sw_gettime(&frame_end);
+
+        unsigned long long frame_time;
+        sw_timediff_usec(frame_end, frame_begin, &frame_time);
+        if (frame_time < dt)
+        {
+            sw_sleep(dt - frame_time);
+        }
+    }
+}
+
+bool publish_frame(struct Framebuffer *framebuffer, struct AnsiFrame *frame, struct Stream *objects, WINDOW *main_win,
+                   const struct Sky *sky)
+{
+    // Follow the terminal's size
+    if (frame->rows != LINES || frame->cols != COLS)
+    {
+        free_ansi_frame(frame);
+        if (!generate_ansi_frame(frame, LINES, COLS))
+        {
+            return false;
+        }
+    }
+
+    // `curscr` holds what is on the screen after `doupdate`
+    ansi_frame_capture(frame, curscr);
+
+    int sky_row, sky_col, sky_rows, sky_cols;
+    getbegyx(main_win, sky_row, sky_col);
+    getmaxyx(main_win, sky_rows, sky_cols);
+    stream_encode_frame(objects, sky, julian_date, sky_rows, sky_cols);
+
+    return framebuffer_publish(framebuffer, frame, sky_row, sky_col, sky_rows, sky_cols, objects, julian_date);
+}
+
 void catch_winch(int sig)
 {
     (void)sig;
     perform_resize = true;
 }
 
+void catch_stop(int sig)
+{
+    (void)sig;
+    perform_stop = 1;
+}
+
 void resize_ncurses(void)
 {
     // Resize ncurses internal terminal
@@ -554,8 +1295,8 @@ void resize_meta(WINDOW *win)
     wnoutrefresh(win);
 #endif
 
-    const int meta_lines = 6; // Allows for 6 rows
-    const int meta_cols = 45; // Set to allow enough room for longest line (elapsed time)
+    const int meta_lines = 10; // Allows for 10 rows
+    const int meta_cols = 45;  // Set to allow enough room for longest line (elapsed time)
 
     wresize(win, MIN(LINES, meta_lines), MIN(COLS, meta_cols));
 #ifdef _WIN32
@@ -583,7 +1324,81 @@ const char *get_timezone(const struct tm *local_time)
 #endif
 }
 
-void render_metadata(WINDOW *win, const struct Conf *config)
+/* Format a julian date as a local "hh:mm", or "--:--" if there is no event
+ */
+static void format_event_time(double event_julian_date, char *buffer, size_t size)
+{
+    if (isnan(event_julian_date))
+    {
+        snprintf(buffer, size, "--:--");
+        return;
+    }
+
+    const double JULIAN_DATE_EPOCH = 2440587.5;
+    time_t utc_time = (time_t)((event_julian_date - JULIAN_DATE_EPOCH) * 86400);
+    const struct tm *local_time = localtime(&utc_time);
+    if (local_time == NULL)
+    {
+        local_time = gmtime(&utc_time);
+    }
+    strftime(buffer, size, "%H:%M", local_time);
+}
+
+/* Rise and set times shown in the metadata window, searched from the start of
+ * the local day. They only change with the day or the observer, so they are
+ * computed once rather than every frame
+ */
+struct DayEvents
+{
+    bool valid;
+    int year;
+    int day_of_year;
+    double latitude;
+    double longitude;
+    struct RiseTransitSet sun;
+    struct RiseTransitSet moon;
+};
+
+static const struct DayEvents *get_day_events(const struct tm *local_time, double latitude, double longitude,
+                                              const struct Planet *planet_table, const struct Moon *moon_object)
+{
+    static struct DayEvents cache = {0};
+
+    if (cache.valid && cache.year == local_time->tm_year && cache.day_of_year == local_time->tm_yday &&
+        cache.latitude == latitude && cache.longitude == longitude)
+    {
+        return &cache;
+    }
+
+    struct tm midnight = *local_time;
+    midnight.tm_hour = 0;
+    midnight.tm_min = 0;
+    midnight.tm_sec = 0;
+    midnight.tm_isdst = -1;
+    time_t midnight_time = mktime(&midnight);
+
+    const double JULIAN_DATE_EPOCH = 2440587.5;
+    double midnight_julian_date = julian_date;
+    if (midnight_time != (time_t)-1)
+    {
+        midnight_julian_date = (double)midnight_time / 86400 + JULIAN_DATE_EPOCH;
+    }
+
+    struct RiseTransitSet planet_events[NUM_PLANETS];
+    calc_planet_rise_transit_set(planet_table, midnight_julian_date, latitude, longitude, planet_events);
+    calc_moon_rise_transit_set(moon_object, midnight_julian_date, latitude, longitude, &cache.moon);
+    cache.sun = planet_events[SUN];
+
+    cache.valid = true;
+    cache.year = local_time->tm_year;
+    cache.day_of_year = local_time->tm_yday;
+    cache.latitude = latitude;
+    cache.longitude = longitude;
+    return &cache;
+}
+
+void render_metadata(WINDOW *win, const struct Conf *config, const struct Planet *planet_table,
+                     const struct Moon *moon_object)
 {
     // Gregorian Date (local time)
 
@@ -624,15 +1439,41 @@ void render_metadata(WINDOW *win, const struct Conf *config)
     const char *lunar_phase = get_moon_phase_name(phase);
     mvwprintw(win, 2, 0, "Lunar Phase: \t%s", lunar_phase);
 
+    // Rise and set of the Sun and Moon on the current day (local time)
+    const struct DayEvents *events = get_day_events(local_time, config->latitude, config->longitude, planet_table, moon_object);
+
+    char rise[8], set[8];
+    format_event_time(events->sun.rise, rise, sizeof(rise));
+    format_event_time(events->sun.set, set, sizeof(set));
+    mvwprintw(win, 3, 0, "Sun Rise/Set: \t%s / %s", rise, set);
+    format_event_time(events->moon.rise, rise, sizeof(rise));
+    format_event_time(events->moon.set, set, sizeof(set));
+    mvwprintw(win, 4, 0, "Moon Rise/Set: \t%s / %s", rise, set);
+
     // Lat and Lon (convert back to degrees)
     int deg, min;
     double sec;
     decimal_to_dms(config->latitude * 180 / M_PI, &deg, &min, &sec);
-    mvwprintw(win, 3, 0, "Latitude: \t%d° %d' %.2f\"", deg, min, sec);
+    mvwprintw(win, 5, 0, "Latitude: \t%d° %d' %.2f\"", deg, min, sec);
 
     // Longitude
     decimal_to_dms(config->longitude * 180 / M_PI, &deg, &min, &sec);
-    mvwprintw(win, 4, 0, "Longitude: \t%d° %d' %.2f\"", deg, min, sec);
+    mvwprintw(win, 6, 0, "Longitude: \t%d° %d' %.2f\"", deg, min, sec);
+
+    // Nearest city and its timezone
+    double distance_km;
+    const CityData *city = nearest_city(config->latitude * 180 / M_PI, config->longitude * 180 / M_PI, &distance_km);
+    if (city != NULL)
+    {
+        // Names and timezones can be longer than the window, which would wrap
+        // onto the rows below
+        char nearest[256];
+        snprintf(nearest, sizeof(nearest), "%s, %s (%.0f km)", city->city_name, city->country_code, distance_km);
+        mvwaddstr(win, 7, 0, "Nearest City: \t");
+        mvwaddstr_truncate(win, 7, getcurx(win), nearest);
+        mvwaddstr(win, 8, 0, "City Timezone: \t");
+        mvwaddstr_truncate(win, 8, getcurx(win), city->timezone);
+    }
 
     // Elapsed time
     int eyears, edays, ehours, emins, esecs;
@@ -641,7 +1482,7 @@ void render_metadata(WINDOW *win, const struct Conf *config)
     const char *day_label = (edays == 1) ? " day" : "days";
 
     // Display elapsed time with proper labels
-    mvwprintw(win, 5, 0, "Elapsed Time: \t%03d %s, %03d %s, %02d:%02d:%02d", eyears, year_label, edays, day_label, ehours,
+    mvwprintw(win, 9, 0, "Elapsed Time: \t%03d %s, %03d %s, %02d:%02d:%02d", eyears, year_label, edays, day_label, ehours,
               emins, esecs);
 
     return;
@@ -42,7 +42,7 @@ static struct Entry parse_entry(uint8_t *buffer)
     return entry_data;
 }
 
-bool parse_entries(uint8_t *data, size_t data_size, struct Entry **entries_out, unsigned int *num_entries_out)
+bool parse_entries(const uint8_t *data, size_t data_size, struct Entry **entries_out, unsigned int *num_entries_out)
 {
     // Check if there's enough data to read the header
     if (data_size < HEADER_BYTES)
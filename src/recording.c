@@ -0,0 +1,319 @@
+#include "recording.h"
+
+#include "ephemeris.h"
+#include "macros.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Size of the stdio buffer of the recording file
+#define RECORDING_FILE_BUFFER (1 << 16)
+
+// Events queued beyond this many bytes are dropped and the next frame is
+// redrawn in full, rather than growing without bound behind a stalled disk
+#define RECORDING_MAX_PENDING (64 << 20)
+
+// Header of an event queued for the writer, followed by `length` bytes
+struct RecordingEvent
+{
+    double time; // Seconds since the recording started
+    uint32_t length;
+    char type; // 'o' for output, 'r' for resize
+};
+
+/* Append `data` as the contents of a JSON string
+ */
+static bool append_json_string(struct AnsiBuffer *out, const char *data, size_t length)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    bool ok = true;
+    size_t run = 0; // Start of the bytes that need no escaping
+
+    for (size_t i = 0; i < length && ok; ++i)
+    {
+        unsigned char c = (unsigned char)data[i];
+        if (c >= 0x20 && c != '"' && c != '\\')
+        {
+            continue;
+        }
+
+        ok = ansi_buffer_append(out, &data[run], i - run);
+        if (c == '"' || c == '\\')
+        {
+            char escaped[2] = {'\\', (char)c};
+            ok = ok && ansi_buffer_append(out, escaped, sizeof(escaped));
+        }
+        else
+        {
+            char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            ok = ok && ansi_buffer_append(out, escaped, sizeof(escaped));
+        }
+        run = i + 1;
+    }
+
+    return ok && ansi_buffer_append(out, &data[run], length - run);
+}
+
+/* Format queued events as asciicast lines into `out`
+ */
+static bool format_events(struct AnsiBuffer *out, const struct AnsiBuffer *events)
+{
+    bool ok = true;
+    size_t offset = 0;
+
+    while (offset < events->length && ok)
+    {
+        struct RecordingEvent event;
+        memcpy(&event, &events->data[offset], sizeof(event));
+        offset += sizeof(event);
+
+        // printf would follow the locale's decimal separator
+        char prefix[48];
+        size_t length = 0;
+        prefix[length++] = '[';
+        length += format_fixed(&prefix[length], event.time, 6);
+        memcpy(&prefix[length], ", \"", 3);
+        length += 3;
+        prefix[length++] = event.type;
+        memcpy(&prefix[length], "\", \"", 4);
+        length += 4;
+
+        ok = ansi_buffer_append(out, prefix, length);
+        ok = ok && append_json_string(out, &events->data[offset], event.length);
+        ok = ok && ansi_buffer_append(out, "\"]\n", 3);
+        offset += event.length;
+    }
+
+    return ok;
+}
+
+static void run_writer(void *arg)
+{
+    struct Recording *recording = arg;
+    struct AnsiBuffer batch = {0};
+    struct AnsiBuffer out = {0};
+
+    mutex_lock(&recording->mutex);
+    while (true)
+    {
+        while (recording->pending.length == 0 && !recording->stop)
+        {
+            condition_wait(&recording->condition, &recording->mutex);
+        }
+        if (recording->pending.length == 0)
+        {
+            break; // Stopped with nothing left to write
+        }
+
+        // Take everything queued so far and let the render loop continue
+        struct AnsiBuffer swap = batch;
+        batch = recording->pending;
+        recording->pending = swap;
+        recording->pending.length = 0;
+        mutex_unlock(&recording->mutex);
+
+        out.length = 0;
+        bool ok = format_events(&out, &batch);
+        ok = ok && fwrite(out.data, 1, out.length, recording->file) == out.length;
+        batch.length = 0;
+
+        mutex_lock(&recording->mutex);
+        recording->failed = recording->failed || !ok;
+    }
+    mutex_unlock(&recording->mutex);
+
+    free_ansi_buffer(&batch);
+    free_ansi_buffer(&out);
+}
+
+static bool write_header(FILE *file, int rows, int cols)
+{
+    struct AnsiBuffer header = {0};
+    char numbers[128];
+    snprintf(numbers, sizeof(numbers), "{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %lld", cols, rows,
+             (long long)time(NULL));
+
+    bool ok = ansi_buffer_append(&header, numbers, strlen(numbers));
+    ok = ok && ansi_buffer_append(&header, ", \"title\": \"astroterm\"", 22);
+
+    const char *term = getenv("TERM");
+    if (term != NULL)
+    {
+        ok = ok && ansi_buffer_append(&header, ", \"env\": {\"TERM\": \"", 19);
+        ok = ok && append_json_string(&header, term, strlen(term));
+        ok = ok && ansi_buffer_append(&header, "\"}", 2);
+    }
+    ok = ok && ansi_buffer_append(&header, "}\n", 2);
+
+    ok = ok && fwrite(header.data, 1, header.length, file) == header.length;
+    free_ansi_buffer(&header);
+    return ok;
+}
+
+bool generate_recording(struct Recording *recording, const char *path, int rows, int cols)
+{
+    memset(recording, 0, sizeof(*recording));
+    recording->redraw = true;
+    recording->rows = rows;
+    recording->cols = cols;
+
+    recording->file = fopen(path, "wb");
+    if (recording->file == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to open recording file '%s'\n", path);
+        return false;
+    }
+    setvbuf(recording->file, NULL, _IOFBF, RECORDING_FILE_BUFFER);
+
+    bool success = write_header(recording->file, rows, cols);
+    success = success && generate_ansi_frame(&recording->frames[0], rows, cols);
+    success = success && generate_ansi_frame(&recording->frames[1], rows, cols);
+    if (!success)
+    {
+        fprintf(stderr, "ERROR: Unable to write recording file '%s'\n", path);
+        free_ansi_frame(&recording->frames[0]);
+        free_ansi_frame(&recording->frames[1]);
+        fclose(recording->file);
+        return false;
+    }
+
+    bool mutex_created = mutex_init(&recording->mutex);
+    bool condition_created = condition_init(&recording->condition);
+    if (!mutex_created || !condition_created || !thread_create(&recording->writer, run_writer, recording))
+    {
+        fprintf(stderr, "ERROR: Unable to start the recording writer\n");
+        if (mutex_created)
+        {
+            mutex_destroy(&recording->mutex);
+        }
+        if (condition_created)
+        {
+            condition_destroy(&recording->condition);
+        }
+        free_ansi_frame(&recording->frames[0]);
+        free_ansi_frame(&recording->frames[1]);
+        fclose(recording->file);
+        return false;
+    }
+
+    sw_gettime(&recording->start);
+    return true;
+}
+
+bool free_recording(struct Recording *recording)
+{
+    mutex_lock(&recording->mutex);
+    recording->stop = true;
+    condition_signal(&recording->condition);
+    mutex_unlock(&recording->mutex);
+    thread_join(&recording->writer);
+
+    bool success = !recording->failed;
+    success = fclose(recording->file) == 0 && success;
+
+    condition_destroy(&recording->condition);
+    mutex_destroy(&recording->mutex);
+    free_ansi_frame(&recording->frames[0]);
+    free_ansi_frame(&recording->frames[1]);
+    free_ansi_buffer(&recording->events);
+    free_ansi_buffer(&recording->pending);
+    return success;
+}
+
+/* Queue an event of the given type in `events`
+ */
+static bool append_event(struct AnsiBuffer *events, double time, char type, const char *data, size_t length)
+{
+    struct RecordingEvent event = {.time = time, .length = (uint32_t)length, .type = type};
+    return ansi_buffer_append(events, (const char *)&event, sizeof(event)) &&
+           ansi_buffer_append(events, data, length);
+}
+
+bool recording_capture(struct Recording *recording, WINDOW *win)
+{
+    struct SwTimestamp now;
+    unsigned long long elapsed = 0;
+    sw_gettime(&now);
+    sw_timediff_usec(now, recording->start, &elapsed);
+    double time = (double)elapsed / 1.0E6;
+
+    int rows, cols;
+    getmaxyx(win, rows, cols);
+    int next = 1 - recording->current;
+    struct AnsiFrame *frame = &recording->frames[next];
+    struct AnsiFrame *prev = &recording->frames[recording->current];
+
+    recording->events.length = 0;
+
+    // Follow the terminal's size
+    if (frame->rows != rows || frame->cols != cols)
+    {
+        free_ansi_frame(frame);
+        if (!generate_ansi_frame(frame, rows, cols))
+        {
+            return false;
+        }
+    }
+
+    if (rows != recording->rows || cols != recording->cols)
+    {
+        char size[32];
+        int length = snprintf(size, sizeof(size), "%dx%d", cols, rows);
+        if (!append_event(&recording->events, time, 'r', size, (size_t)length))
+        {
+            return false;
+        }
+    }
+
+    ansi_frame_capture(frame, win);
+
+    // Encode the changes after the event header they are appended to
+    size_t header = recording->events.length;
+    struct RecordingEvent event = {.time = time, .type = 'o'};
+    bool ok = ansi_buffer_append(&recording->events, (const char *)&event, sizeof(event));
+    ok = ok && ansi_encode_frame(&recording->events, recording->redraw ? NULL : prev, frame);
+    if (!ok)
+    {
+        return false;
+    }
+
+    size_t changes = recording->events.length - header - sizeof(event);
+    if (changes == 0)
+    {
+        recording->events.length = header; // Nothing changed
+    }
+    else
+    {
+        event.length = (uint32_t)changes;
+        memcpy(&recording->events.data[header], &event, sizeof(event));
+    }
+    recording->current = next;
+
+    if (recording->events.length == 0)
+    {
+        return true;
+    }
+
+    mutex_lock(&recording->mutex);
+    bool failed = recording->failed;
+    bool queued = !failed && recording->pending.length + recording->events.length <= RECORDING_MAX_PENDING &&
+                  ansi_buffer_append(&recording->pending, recording->events.data, recording->events.length);
+    if (queued)
+    {
+        condition_signal(&recording->condition);
+    }
+    mutex_unlock(&recording->mutex);
+
+    // Frames that could not be queued are caught up on with a full redraw
+    recording->redraw = !queued;
+    if (queued)
+    {
+        recording->rows = rows;
+        recording->cols = cols;
+    }
+
+    return !failed;
+}
@@ -0,0 +1,1026 @@
+#include "server.h"
+
+#include "ansi.h"
+#include "city.h"
+#include "constell_graph.h"
+#include "core.h"
+#include "macros.h"
+#include "sky.h"
+#include "stopwatch.h"
+#include "term.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// File descriptors kept free of clients
+#define RESERVED_FDS 16
+
+// Longest option name or value
+#define MAX_TOKEN 128
+
+bool parse_server_address(const char *string, struct ServerAddress *address)
+{
+    memset(address, 0, sizeof(*address));
+
+    if (string == NULL || *string == '\0')
+    {
+        return false;
+    }
+
+    if (strchr(string, '/') != NULL)
+    {
+        size_t length = strlen(string);
+        if (length >= sizeof(address->path))
+        {
+            return false;
+        }
+#ifndef _WIN32
+        // Paths that do not fit would be silently truncated when binding
+        struct sockaddr_un addr;
+        if (length >= sizeof(addr.sun_path))
+        {
+            return false;
+        }
+#endif
+        address->is_unix = true;
+        strcpy(address->path, string);
+        return true;
+    }
+
+    const char *port = string;
+    const char *colon = strrchr(string, ':');
+    if (colon != NULL)
+    {
+        const char *host = string;
+        size_t host_length = (size_t)(colon - string);
+
+        // IPv6 addresses are given in brackets, e.g. "[::1]:7878"
+        if (host_length >= 2 && host[0] == '[' && host[host_length - 1] == ']')
+        {
+            host++;
+            host_length -= 2;
+        }
+
+        if (host_length == 0 || host_length >= sizeof(address->host))
+        {
+            return false;
+        }
+        memcpy(address->host, host, host_length);
+        address->host[host_length] = '\0';
+        port = colon + 1;
+    }
+    else
+    {
+        strcpy(address->host, "127.0.0.1");
+    }
+
+    size_t port_length = strlen(port);
+    if (port_length == 0 || port_length >= sizeof(address->port))
+    {
+        return false;
+    }
+    for (const char *c = port; *c != '\0'; ++c)
+    {
+        if (!isdigit((unsigned char)*c))
+        {
+            return false;
+        }
+    }
+
+    long number = strtol(port, NULL, 10);
+    if (number < 1 || number > 65535)
+    {
+        return false;
+    }
+    strcpy(address->port, port);
+    return true;
+}
+
+/* Read the next "key" or "key=value" token, where values may be quoted.
+ * Returns false at the end of the request or if a token is too long
+ */
+static bool next_token(const char **cursor, char *key, char *value, bool *has_value, bool *too_long)
+{
+    const char *c = *cursor;
+    *too_long = false;
+
+    while (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n')
+    {
+        c++;
+    }
+    if (*c == '\0')
+    {
+        return false;
+    }
+
+    size_t length = 0;
+    while (*c != '\0' && *c != '=' && !isspace((unsigned char)*c))
+    {
+        if (length + 1 >= MAX_TOKEN)
+        {
+            *too_long = true;
+            return false;
+        }
+        key[length++] = *c++;
+    }
+    key[length] = '\0';
+
+    *has_value = *c == '=';
+    length = 0;
+    if (*has_value)
+    {
+        c++;
+        bool quoted = *c == '"';
+        if (quoted)
+        {
+            c++;
+        }
+
+        while (*c != '\0' && (quoted ? *c != '"' : !isspace((unsigned char)*c)))
+        {
+            if (length + 1 >= MAX_TOKEN)
+            {
+                *too_long = true;
+                return false;
+            }
+            value[length++] = *c++;
+        }
+
+        if (quoted && *c == '"')
+        {
+            c++;
+        }
+    }
+    value[length] = '\0';
+
+    *cursor = c;
+    return true;
+}
+
+static bool parse_number(const char *string, double min, double max, double *value)
+{
+    char *end;
+    double number = strtod(string, &end);
+    if (end == string || *end != '\0' || !isfinite(number) || number < min || number > max)
+    {
+        return false;
+    }
+
+    *value = number;
+    return true;
+}
+
+static bool parse_flag(const char *string, bool has_value, bool *flag)
+{
+    if (!has_value || strcmp(string, "1") == 0)
+    {
+        *flag = true;
+        return true;
+    }
+    if (strcmp(string, "0") == 0)
+    {
+        *flag = false;
+        return true;
+    }
+    return false;
+}
+
+bool parse_view_options(const char *request, const struct ViewOptions *defaults, struct ViewOptions *options,
+                        char *error, size_t error_size)
+{
+    *options = *defaults;
+
+    char key[MAX_TOKEN];
+    char value[MAX_TOKEN];
+    bool has_value;
+    bool too_long;
+    const char *cursor = request;
+
+    while (next_token(&cursor, key, value, &has_value, &too_long))
+    {
+        double number = 0.0;
+        bool valid = true;
+
+        if (strcmp(key, "rows") == 0 || strcmp(key, "cols") == 0)
+        {
+            valid = has_value && parse_number(value, 1, SERVER_MAX_SIZE, &number) && number == floor(number);
+            if (valid)
+            {
+                *(key[0] == 'r' ? &options->rows : &options->cols) = (int)number;
+            }
+        }
+        else if (strcmp(key, "lat") == 0)
+        {
+            valid = has_value && parse_number(value, -90.0, 90.0, &number);
+            options->latitude = number * M_PI / 180.0;
+        }
+        else if (strcmp(key, "lon") == 0)
+        {
+            valid = has_value && parse_number(value, -180.0, 180.0, &number);
+            options->longitude = number * M_PI / 180.0;
+        }
+        else if (strcmp(key, "threshold") == 0)
+        {
+            valid = has_value && parse_number(value, -HUGE_VAL, HUGE_VAL, &number);
+            options->threshold = (float)number;
+        }
+        else if (strcmp(key, "label-threshold") == 0)
+        {
+            valid = has_value && parse_number(value, -HUGE_VAL, HUGE_VAL, &number);
+            options->label_thresh = (float)number;
+        }
+        else if (strcmp(key, "city") == 0)
+        {
+            const CityData *city = has_value ? find_city(value) : NULL;
+
+            if (city == NULL)
+            {
+                snprintf(error, error_size, "Could not find city \"%s\"", value);
+                return false;
+            }
+            options->latitude = city->latitude * M_PI / 180.0;
+            options->longitude = city->longitude * M_PI / 180.0;
+        }
+        else if (strcmp(key, "color") == 0)
+        {
+            valid = parse_flag(value, has_value, &options->color);
+        }
+        else if (strcmp(key, "unicode") == 0)
+        {
+            valid = parse_flag(value, has_value, &options->unicode);
+        }
+        else if (strcmp(key, "braille") == 0)
+        {
+            valid = parse_flag(value, has_value, &options->braille);
+        }
+        else if (strcmp(key, "braille-stars") == 0)
+        {
+            valid = parse_flag(value, has_value, &options->braille_stars);
+        }
+        else if (strcmp(key, "combine-stars") == 0)
+        {
+            valid = parse_flag(value, has_value, &options->combine_stars);
+        }
+        else if (strcmp(key, "grid") == 0)
+        {
+            valid = parse_flag(value, has_value, &options->grid);
+        }
+        else if (strcmp(key, "constellations") == 0)
+        {
+            valid = parse_flag(value, has_value, &options->constell);
+        }
+        else
+        {
+            snprintf(error, error_size, "Unknown option \"%s\"", key);
+            return false;
+        }
+
+        if (!valid)
+        {
+            snprintf(error, error_size, "Invalid value \"%s\" for option \"%s\"", value, key);
+            return false;
+        }
+    }
+
+    if (too_long)
+    {
+        snprintf(error, error_size, "Option too long");
+        return false;
+    }
+
+    return true;
+}
+
+bool same_view_options(const struct ViewOptions *a, const struct ViewOptions *b)
+{
+    return a->latitude == b->latitude && a->longitude == b->longitude && a->threshold == b->threshold &&
+           a->label_thresh == b->label_thresh && a->rows == b->rows && a->cols == b->cols && a->color == b->color &&
+           a->unicode == b->unicode && a->braille == b->braille && a->braille_stars == b->braille_stars &&
+           a->combine_stars == b->combine_stars && a->grid == b->grid && a->constell == b->constell;
+}
+
+#ifdef _WIN32
+
+bool run_server(const struct ServerConf *conf, struct Sky *sky)
+{
+    (void)conf;
+    (void)sky;
+    fprintf(stderr, "ERROR: The sky server is not supported on Windows\n");
+    return false;
+}
+
+#else
+
+enum ClientState
+{
+    CLIENT_HANDSHAKE = 0, // Waiting for the option line
+    CLIENT_ACTIVE
+};
+
+struct View
+{
+    struct ViewOptions options;
+    struct Conf config;
+    WINDOW *pad;     // Whole client terminal
+    WINDOW *sky_win; // Square projection centered in `pad`
+    struct Compositor compositor;
+
+    struct AnsiFrame frames[2]; // Last two frames rendered, alternating
+    int current;                // Index of the last frame rendered
+    bool rendered;              // Whether any frame was rendered yet
+
+    struct AnsiBuffer diff; // Difference between the last two frames
+    struct AnsiBuffer full; // Last frame in full, encoded on demand
+    bool full_valid;
+
+    unsigned int num_clients;
+};
+
+struct Client
+{
+    int fd;
+    enum ClientState state;
+    unsigned long long connected; // Server time of connection (microseconds)
+    bool reading;                 // Whether the client may still send anything
+
+    char request[SERVER_MAX_REQUEST];
+    size_t request_length;
+
+    struct View *view;
+    struct AnsiBuffer pending; // Output the socket did not accept yet
+    size_t pending_offset;
+    bool needs_full; // Send the next frame in full rather than as a difference
+};
+
+struct Server
+{
+    const struct ServerConf *conf;
+    struct Sky *sky;
+    int listener;
+    struct SwTimestamp start;
+
+    struct Client *clients;
+    unsigned int num_clients;
+    unsigned int max_clients;
+    struct pollfd *poll_fds; // Listener followed by one entry per client
+
+    struct View **views;
+    unsigned int num_views;
+};
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void catch_stop(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static unsigned long long server_time(const struct Server *server)
+{
+    struct SwTimestamp now;
+    sw_gettime(&now);
+
+    unsigned long long elapsed;
+    sw_timediff_usec(now, server->start, &elapsed);
+    return elapsed;
+}
+
+static bool set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+static int open_unix_listener(const struct ServerAddress *address)
+{
+    // Replace a socket left behind by a previous server, but nothing else
+    struct stat info;
+    if (stat(address->path, &info) == 0 && S_ISSOCK(info.st_mode))
+    {
+        unlink(address->path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    // Checked to fit when the address was parsed
+    memcpy(addr.sun_path, address->path, strlen(address->path) + 1);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int open_tcp_listener(const struct ServerAddress *address)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    struct addrinfo *results;
+    int status = getaddrinfo(address->host, address->port, &hints, &results);
+    if (status != 0)
+    {
+        fprintf(stderr, "ERROR: Unable to resolve '%s': %s\n", address->host, gai_strerror(status));
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *result = results; result != NULL && fd == -1; result = result->ai_next)
+    {
+        fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+        if (fd == -1)
+        {
+            continue;
+        }
+
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(fd, result->ai_addr, result->ai_addrlen) == -1)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    freeaddrinfo(results);
+    return fd;
+}
+
+static void free_view(struct View *view)
+{
+    free_compositor(&view->compositor);
+    delwin(view->sky_win);
+    delwin(view->pad);
+    free_ansi_frame(&view->frames[0]);
+    free_ansi_frame(&view->frames[1]);
+    free_ansi_buffer(&view->diff);
+    free_ansi_buffer(&view->full);
+    free(view);
+}
+
+/* Find the view of clients with the given options, creating it if needed.
+ * Returns NULL upon memory allocation error
+ */
+static struct View *get_view(struct Server *server, const struct ViewOptions *options)
+{
+    for (unsigned int i = 0; i < server->num_views; ++i)
+    {
+        if (same_view_options(&server->views[i]->options, options))
+        {
+            return server->views[i];
+        }
+    }
+
+    struct View **views = realloc(server->views, (server->num_views + 1) * sizeof(struct View *));
+    if (views == NULL)
+    {
+        return NULL;
+    }
+    server->views = views;
+
+    struct View *view = calloc(1, sizeof(struct View));
+    if (view == NULL)
+    {
+        return NULL;
+    }
+
+    view->options = *options;
+    view->config = (struct Conf){
+        .latitude = options->latitude,
+        .longitude = options->longitude,
+        .threshold = options->threshold,
+        .label_thresh = options->label_thresh,
+        .unicode = options->unicode,
+        .braille = options->braille,
+        .braille_stars = options->braille_stars,
+        .combine_stars = options->combine_stars,
+        .color = options->color,
+        .grid = options->grid,
+        .constell = options->constell,
+    };
+
+    // Square projection with the largest area, as in the interactive view
+    int rows = options->rows;
+    int cols = options->cols;
+    bool success = newpad_centered_square(rows, cols, server->conf->aspect_ratio, &view->pad, &view->sky_win);
+    success = success && generate_ansi_frame(&view->frames[0], rows, cols);
+    success = success && generate_ansi_frame(&view->frames[1], rows, cols);
+    if (!success)
+    {
+        free_view(view);
+        return NULL;
+    }
+
+    server->views[server->num_views++] = view;
+    return view;
+}
+
+static void release_view(struct Server *server, struct View *view)
+{
+    if (--view->num_clients > 0)
+    {
+        return;
+    }
+
+    for (unsigned int i = 0; i < server->num_views; ++i)
+    {
+        if (server->views[i] == view)
+        {
+            server->views[i] = server->views[--server->num_views];
+            break;
+        }
+    }
+    free_view(view);
+}
+
+static void remove_client(struct Server *server, unsigned int index)
+{
+    struct Client *client = &server->clients[index];
+
+    if (client->view != NULL)
+    {
+        release_view(server, client->view);
+    }
+    close(client->fd);
+    free_ansi_buffer(&client->pending);
+
+    server->clients[index] = server->clients[--server->num_clients];
+}
+
+/* Write as much as the socket accepts without blocking, adding the number of
+ * bytes written to `sent`. Returns false upon write error
+ */
+static bool write_to_client(const struct Client *client, const char *data, size_t length, size_t *sent)
+{
+    while (*sent < length)
+    {
+        ssize_t result = write(client->fd, data + *sent, length - *sent);
+        if (result >= 0)
+        {
+            *sent += (size_t)result;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        }
+        else if (errno != EINTR)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool send_to_client(struct Client *client, const char *data, size_t length)
+{
+    size_t sent = 0;
+    if (!write_to_client(client, data, length, &sent))
+    {
+        return false;
+    }
+
+    if (sent < length)
+    {
+        client->pending.length = 0;
+        client->pending_offset = 0;
+        return ansi_buffer_append(&client->pending, data + sent, length - sent);
+    }
+    return true;
+}
+
+/* Write pending output, advancing through the buffer in place
+ */
+static bool flush_client(struct Client *client)
+{
+    if (!write_to_client(client, client->pending.data, client->pending.length, &client->pending_offset))
+    {
+        return false;
+    }
+
+    if (client->pending_offset == client->pending.length)
+    {
+        client->pending.length = 0;
+        client->pending_offset = 0;
+    }
+    return true;
+}
+
+static bool has_pending(const struct Client *client)
+{
+    return client->pending.length > client->pending_offset;
+}
+
+/* Assign a client its view once its options are known. Returns false if the
+ * client should be dropped
+ */
+static bool activate_client(struct Server *server, struct Client *client)
+{
+    client->request[client->request_length] = '\0';
+
+    struct ViewOptions options;
+    char error[MAX_TOKEN + 64];
+    if (!parse_view_options(client->request, &server->conf->defaults, &options, error, sizeof(error)))
+    {
+        char message[sizeof(error) + 16];
+        int length = snprintf(message, sizeof(message), "ERROR: %s\r\n", error);
+        send_to_client(client, message, (size_t)length);
+        return false;
+    }
+
+    client->view = get_view(server, &options);
+    if (client->view == NULL)
+    {
+        fprintf(stderr, "Allocation of memory for view failed\n");
+        return false;
+    }
+
+    client->view->num_clients++;
+    client->state = CLIENT_ACTIVE;
+    client->needs_full = true;
+    return true;
+}
+
+/* Read from a client. Returns false if the client should be dropped
+ */
+static bool read_client(struct Server *server, struct Client *client)
+{
+    char discard[512];
+
+    while (true)
+    {
+        char *buffer = discard;
+        size_t size = sizeof(discard);
+        if (client->state == CLIENT_HANDSHAKE)
+        {
+            buffer = &client->request[client->request_length];
+            size = SERVER_MAX_REQUEST - 1 - client->request_length;
+            if (size == 0)
+            {
+                return false;
+            }
+        }
+
+        ssize_t result = read(client->fd, buffer, size);
+        if (result == 0)
+        {
+            // The client will not send anything else, but may still read
+            client->reading = false;
+            return client->state == CLIENT_ACTIVE || activate_client(server, client);
+        }
+        if (result < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+
+        if (client->state == CLIENT_HANDSHAKE)
+        {
+            char *newline = memchr(buffer, '\n', (size_t)result);
+            client->request_length += (size_t)result;
+            if (newline != NULL)
+            {
+                client->request_length = (size_t)(newline - client->request);
+                if (!activate_client(server, client))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+}
+
+static void accept_clients(struct Server *server)
+{
+    while (true)
+    {
+        int fd = accept(server->listener, NULL, NULL);
+        if (fd == -1)
+        {
+            return;
+        }
+
+        if (server->num_clients >= server->max_clients || !set_nonblocking(fd))
+        {
+            const char *message = "ERROR: Server is full\r\n";
+            ssize_t ignored = write(fd, message, strlen(message));
+            (void)ignored;
+            close(fd);
+            continue;
+        }
+
+        server->clients[server->num_clients++] = (struct Client){
+            .fd = fd,
+            .state = CLIENT_HANDSHAKE,
+            .connected = server_time(server),
+            .reading = true,
+        };
+    }
+}
+
+static const struct AnsiBuffer *full_frame(struct View *view)
+{
+    if (!view->full_valid)
+    {
+        view->full.length = 0;
+        view->full_valid = ansi_encode_frame(&view->full, NULL, &view->frames[view->current]);
+    }
+    return view->full_valid ? &view->full : NULL;
+}
+
+static void render_views(struct Server *server, double julian_date)
+{
+    struct Sky *sky = server->sky;
+
+    for (unsigned int i = 0; i < server->num_views; ++i)
+    {
+        struct View *view = server->views[i];
+
+        if (view->config.constell)
+        {
+            constell_graph_set_threshold(sky->constell_graph, view->config.threshold);
+        }
+
+        update_sky(sky, &view->config, julian_date);
+        render_sky(view->sky_win, &view->config, sky, &view->compositor);
+
+        int next = 1 - view->current;
+        ansi_frame_capture(&view->frames[next], view->pad);
+
+        view->diff.length = 0;
+        const struct AnsiFrame *prev = view->rendered ? &view->frames[view->current] : NULL;
+        if (!ansi_encode_frame(&view->diff, prev, &view->frames[next]))
+        {
+            // Resend everything rather than an incomplete difference
+            view->diff.length = 0;
+            view->rendered = false;
+        }
+        else
+        {
+            view->rendered = true;
+        }
+
+        view->current = next;
+        view->full_valid = false;
+    }
+}
+
+/* Send the frames just rendered. Returns false if the client should be dropped
+ */
+static bool send_frame(struct Client *client)
+{
+    struct View *view = client->view;
+
+    // Clients still reading an older frame skip this one entirely
+    if (has_pending(client) || !view->rendered)
+    {
+        client->needs_full = true;
+        return true;
+    }
+
+    const struct AnsiBuffer *frame = client->needs_full ? full_frame(view) : &view->diff;
+    if (frame == NULL)
+    {
+        return true;
+    }
+
+    client->needs_full = false;
+    return send_to_client(client, frame->data, frame->length);
+}
+
+static void serve(struct Server *server)
+{
+    const struct ServerConf *conf = server->conf;
+    const unsigned long long frame_usec = (unsigned long long)(1.0E6 / conf->fps);
+    const unsigned long long handshake_usec = SERVER_HANDSHAKE_MS * 1000ULL;
+    const double microsec_per_day = 24.0 * 60.0 * 60.0 * 1.0E6;
+
+    unsigned long long next_frame = 0;
+
+    while (!stop_requested)
+    {
+        unsigned long long now = server_time(server);
+
+        // Wake up for the next frame or the earliest handshake deadline
+        unsigned long long wake = next_frame;
+        for (unsigned int i = 0; i < server->num_clients; ++i)
+        {
+            if (server->clients[i].state == CLIENT_HANDSHAKE)
+            {
+                wake = MIN(wake, server->clients[i].connected + handshake_usec);
+            }
+        }
+        int timeout_ms = wake > now ? (int)((wake - now + 999) / 1000) : 0;
+
+        server->poll_fds[0] = (struct pollfd){.fd = server->listener, .events = POLLIN};
+        for (unsigned int i = 0; i < server->num_clients; ++i)
+        {
+            const struct Client *client = &server->clients[i];
+            short events = (short)((client->reading ? POLLIN : 0) | (has_pending(client) ? POLLOUT : 0));
+            server->poll_fds[i + 1] = (struct pollfd){.fd = client->fd, .events = events};
+        }
+
+        unsigned int num_polled = server->num_clients;
+        if (poll(server->poll_fds, num_polled + 1, timeout_ms) == -1 && errno != EINTR)
+        {
+            perror("poll");
+            return;
+        }
+
+        // Clients are removed by swapping in the last one, so iterate backwards
+        // to visit each polled client exactly once
+        for (unsigned int i = num_polled; i-- > 0;)
+        {
+            struct Client *client = &server->clients[i];
+            short revents = server->poll_fds[i + 1].revents;
+
+            bool keep = !(revents & (POLLERR | POLLNVAL));
+            if (keep && (revents & (POLLIN | POLLHUP)) && client->reading)
+            {
+                keep = read_client(server, client);
+            }
+            if (keep && (revents & POLLOUT))
+            {
+                keep = flush_client(client);
+            }
+            if (keep && (revents & POLLHUP) && !client->reading && client->state == CLIENT_ACTIVE)
+            {
+                // Hung up in both directions
+                keep = false;
+            }
+
+            if (!keep)
+            {
+                remove_client(server, i);
+            }
+        }
+
+        if (server->poll_fds[0].revents & POLLIN)
+        {
+            accept_clients(server);
+        }
+
+        now = server_time(server);
+
+        // Serve the defaults to clients that did not send any options
+        for (unsigned int i = server->num_clients; i-- > 0;)
+        {
+            struct Client *client = &server->clients[i];
+            if (client->state == CLIENT_HANDSHAKE && now >= client->connected + handshake_usec &&
+                !activate_client(server, client))
+            {
+                remove_client(server, i);
+            }
+        }
+
+        if (now < next_frame)
+        {
+            continue;
+        }
+
+        double julian_date = conf->julian_date + (double)now / microsec_per_day * conf->speed;
+        render_views(server, julian_date);
+
+        for (unsigned int i = server->num_clients; i-- > 0;)
+        {
+            struct Client *client = &server->clients[i];
+            if (client->state == CLIENT_ACTIVE && !send_frame(client))
+            {
+                remove_client(server, i);
+            }
+        }
+
+        // Skip frames rather than fall further behind
+        next_frame = MAX(next_frame + frame_usec, now);
+    }
+}
+
+bool run_server(const struct ServerConf *conf, struct Sky *sky)
+{
+    struct Server server = {.conf = conf, .sky = sky, .listener = -1};
+
+    // Unicode symbols are rendered into pads as wide characters
+    if (MB_CUR_MAX == 1)
+    {
+        setlocale(LC_CTYPE, "C.UTF-8");
+    }
+
+    server.listener = conf->address.is_unix ? open_unix_listener(&conf->address) : open_tcp_listener(&conf->address);
+    if (server.listener == -1 || listen(server.listener, SOMAXCONN) == -1 || !set_nonblocking(server.listener))
+    {
+        if (conf->address.is_unix)
+        {
+            fprintf(stderr, "ERROR: Unable to listen on '%s': %s\n", conf->address.path, strerror(errno));
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Unable to listen on '%s:%s': %s\n", conf->address.host, conf->address.port,
+                    strerror(errno));
+        }
+        if (server.listener != -1)
+        {
+            close(server.listener);
+        }
+        return false;
+    }
+
+    // Each client takes a file descriptor. Keep a few for the listener and
+    // standard streams so accepting never fails while the listener is ready
+    unsigned int max_clients = conf->max_clients;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        if (limit.rlim_cur < limit.rlim_max)
+        {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+            getrlimit(RLIMIT_NOFILE, &limit);
+        }
+        if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < max_clients + RESERVED_FDS)
+        {
+            max_clients = limit.rlim_cur > RESERVED_FDS ? (unsigned int)(limit.rlim_cur - RESERVED_FDS) : 1;
+        }
+    }
+    server.max_clients = max_clients;
+
+    server.clients = malloc(MAX(1, max_clients) * sizeof(struct Client));
+    server.poll_fds = malloc((max_clients + 1) * sizeof(struct pollfd));
+    SCREEN *screen = ncurses_init_headless();
+    if (server.clients == NULL || server.poll_fds == NULL || screen == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to initialize the server\n");
+        free(server.clients);
+        free(server.poll_fds);
+        if (screen != NULL)
+        {
+            ncurses_kill_headless(screen);
+        }
+        close(server.listener);
+        return false;
+    }
+
+    // Dropped clients are noticed through write errors instead
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, catch_stop);
+    signal(SIGTERM, catch_stop);
+
+    if (conf->address.is_unix)
+    {
+        printf("Serving the sky on %s\n", conf->address.path);
+    }
+    else
+    {
+        printf("Serving the sky on %s:%s\n", conf->address.host, conf->address.port);
+    }
+    fflush(stdout);
+
+    sw_gettime(&server.start);
+    serve(&server);
+
+    while (server.num_clients > 0)
+    {
+        remove_client(&server, server.num_clients - 1);
+    }
+    free(server.clients);
+    free(server.poll_fds);
+    free(server.views);
+    ncurses_kill_headless(screen);
+
+    close(server.listener);
+    if (conf->address.is_unix)
+    {
+        unlink(conf->address.path);
+    }
+
+    return true;
+}
+
+#endif // _WIN32
@@ -0,0 +1,161 @@
+#include "sky.h"
+#include "macros.h"
+
+#include "core_position.h"
+#include "core_render.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool copy_sky(struct SkyCopy *copy, const struct Sky *sky)
+{
+    copy->moon = *sky->moon_object;
+    copy->sky_index = (struct SkyIndex){0};
+    copy->sky = (struct Sky){
+        .num_stars = sky->num_stars,
+        .sky_index = &copy->sky_index,
+        .constell_graph = sky->constell_graph,
+        .moon_object = &copy->moon,
+    };
+
+    copy->sky.star_table = malloc(MAX(1, sky->num_stars) * sizeof(struct Star));
+    copy->sky.planet_table = malloc(NUM_PLANETS * sizeof(struct Planet));
+    if (copy->sky.star_table == NULL || copy->sky.planet_table == NULL)
+    {
+        return false;
+    }
+    memcpy(copy->sky.star_table, sky->star_table, sky->num_stars * sizeof(struct Star));
+    memcpy(copy->sky.planet_table, sky->planet_table, NUM_PLANETS * sizeof(struct Planet));
+
+    return generate_sky_index(&copy->sky_index, copy->sky.star_table, sky->num_stars, sky->sky_index->num_by_mag);
+}
+
+void free_sky_copy(struct SkyCopy *copy)
+{
+    free_sky_index(&copy->sky_index);
+    free(copy->sky.star_table);
+    free(copy->sky.planet_table);
+    copy->sky.star_table = NULL;
+    copy->sky.planet_table = NULL;
+}
+
+void update_sky(struct Sky *sky, const struct Conf *config, double julian_date)
+{
+    update_star_positions_indexed(sky->star_table, sky->sky_index, julian_date, config->latitude, config->longitude,
+                                  config->threshold);
+    if (config->constell)
+    {
+        update_constell_positions(sky->star_table, sky->constell_graph, julian_date, config->latitude,
+                                  config->longitude);
+    }
+    update_planet_positions(sky->planet_table, julian_date, config->latitude, config->longitude);
+    update_moon_position(sky->moon_object, julian_date, config->latitude, config->longitude);
+    update_moon_phase(sky->moon_object, julian_date, config->latitude);
+}
+
+/* Bin the stars and place every label for a frame
+ */
+static void prepare_sky(const struct Canvas *canvas, const struct Conf *config, const struct Sky *sky, struct StarBins *stars,
+                        struct LabelLayout *labels)
+{
+    bin_stars(stars, canvas, config, sky->star_table, sky->sky_index->num_visible, sky->sky_index->visible);
+    place_labels(labels, canvas, config, stars, sky->planet_table, sky->moon_object);
+}
+
+/* Draw everything directly, in the same order as the layers
+ */
+static void render_sky_direct(struct Canvas *canvas, const struct Conf *config, const struct Sky *sky,
+                              const struct StarBins *stars, const struct LabelLayout *labels)
+{
+    canvas_erase(canvas);
+    if (config->grid)
+    {
+        render_azimuthal_grid(canvas, config);
+    }
+    render_stars_stereo(canvas, config, stars, labels);
+    if (config->constell)
+    {
+        render_constells(canvas, config, sky->constell_graph, sky->star_table);
+    }
+    render_planets_stereo(canvas, config, sky->planet_table, labels);
+    render_moon_stereo(canvas, config, sky->moon_object, labels);
+    if (!config->grid)
+    {
+        render_cardinal_directions(canvas, config);
+    }
+}
+
+void render_sky_canvas(struct Canvas *canvas, const struct Conf *config, const struct Sky *sky, struct StarBins *stars,
+                       struct LabelLayout *labels)
+{
+    prepare_sky(canvas, config, sky, stars, labels);
+    render_sky_direct(canvas, config, sky, stars, labels);
+}
+
+void render_sky(WINDOW *win, const struct Conf *config, const struct Sky *sky, struct Compositor *compositor)
+{
+    struct Canvas canvas = window_canvas(win);
+    if (compositor == NULL)
+    {
+        // Nowhere to keep memory between frames
+        struct StarBins stars = {0};
+        struct LabelLayout labels = {0};
+        render_sky_canvas(&canvas, config, sky, &stars, &labels);
+        free_star_bins(&stars);
+        free_label_layout(&labels);
+        return;
+    }
+
+    struct StarBins *stars = &compositor->stars;
+    struct LabelLayout *labels = &compositor->labels;
+    prepare_sky(&canvas, config, sky, stars, labels);
+    if (!compositor_begin(compositor, win))
+    {
+        render_sky_direct(&canvas, config, sky, stars, labels);
+        return;
+    }
+
+    render_azimuthal_grid_layer(compositor, config);
+
+    uint64_t signature = stars_layer_signature(&canvas, config, stars, sky->star_table, sky->constell_graph, labels);
+    WINDOW *pad = compositor_redraw_layer(compositor, LAYER_STARS, signature);
+    if (pad != NULL)
+    {
+        struct Canvas layer = window_canvas(pad);
+        render_stars_stereo(&layer, config, stars, labels);
+        if (config->constell)
+        {
+            render_constells(&layer, config, sky->constell_graph, sky->star_table);
+        }
+    }
+
+    // In the order `render_planets_stereo` and `render_moon_stereo` draw them
+    struct LayerItem bodies[NUM_PLANETS];
+    unsigned int num_bodies = 0;
+    for (int i = NUM_PLANETS - 1; i >= 0; --i)
+    {
+        if (i != EARTH)
+        {
+            object_layer_item(&canvas, &sky->planet_table[i].base, config, &labels->planets[i], &bodies[num_bodies++]);
+        }
+    }
+    object_layer_item(&canvas, &sky->moon_object->base, config, &labels->moon, &bodies[num_bodies++]);
+    pad = compositor_redraw_items(compositor, LAYER_BODIES, bodies, num_bodies);
+    if (pad != NULL)
+    {
+        struct Canvas layer = window_canvas(pad);
+        render_planets_stereo(&layer, config, sky->planet_table, labels);
+        render_moon_stereo(&layer, config, sky->moon_object, labels);
+    }
+
+    uint64_t directions = layer_signature_add(LAYER_SIGNATURE_SEED, config->grid);
+    directions = layer_signature_add(directions, config->color);
+    pad = compositor_redraw_layer(compositor, LAYER_DIRECTIONS, directions);
+    if (pad != NULL && !config->grid)
+    {
+        struct Canvas layer = window_canvas(pad);
+        render_cardinal_directions(&layer, config);
+    }
+
+    compositor_composite(compositor, win);
+}
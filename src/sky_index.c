@@ -0,0 +1,353 @@
+#include "sky_index.h"
+
+#include "core.h"
+#include "macros.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Desired number of stars per leaf tile. The leaf order is chosen so the
+// average tile holds about this many stars
+#define STARS_PER_LEAF 16
+
+// Number of base (order 0) HEALPix pixels
+#define BASE_PIXELS 12
+
+static unsigned int tiles_in_level(int order)
+{
+    return BASE_PIXELS << (2 * order);
+}
+
+/* Offset of the first tile of a level in the flat tile array
+ */
+static unsigned int level_offset(int order)
+{
+    // 12 * (1 + 4 + ... + 4^(order - 1))
+    return 4 * ((1u << (2 * order)) - 1);
+}
+
+/* Interleave the bits of `v` with zeros: 0b111 -> 0b010101
+ */
+static unsigned int spread_bits(unsigned int v)
+{
+    unsigned int result = 0;
+    for (int i = 0; i < SKY_INDEX_MAX_ORDER; ++i)
+    {
+        result |= ((v >> i) & 1u) << (2 * i);
+    }
+    return result;
+}
+
+unsigned int sky_index_pixel(int order, double right_ascension, double declination)
+{
+    // Górski et al. 2005, section 4 (as done in HEALPix's ang2pix_nest)
+
+    int nside = 1 << order;
+    double z = sin(declination);
+    double za = fabs(z);
+
+    // Longitude in units of π/2, in [0, 4)
+    double tt = fmod(right_ascension, 2.0 * M_PI);
+    tt += tt < 0 ? 2.0 * M_PI : 0.0;
+    tt *= 2.0 / M_PI;
+
+    int face, ix, iy;
+
+    if (za <= 2.0 / 3.0)
+    {
+        // Equatorial region
+        double temp1 = nside * (0.5 + tt);
+        double temp2 = nside * (z * 0.75);
+        int jp = (int)(temp1 - temp2); // Index of ascending edge line
+        int jm = (int)(temp1 + temp2); // Index of descending edge line
+        int ifp = jp / nside;
+        int ifm = jm / nside;
+
+        face = (ifp == ifm) ? (ifp | 4) : ((ifp < ifm) ? ifp : (ifm + 8));
+        ix = jm & (nside - 1);
+        iy = nside - (jp & (nside - 1)) - 1;
+    }
+    else
+    {
+        // Polar caps
+        int ntt = MIN((int)tt, 3);
+        double tp = tt - ntt;
+        double tmp = nside * sqrt(3.0 * (1.0 - za));
+
+        int jp = MIN((int)(tp * tmp), nside - 1);
+        int jm = MIN((int)((1.0 - tp) * tmp), nside - 1);
+
+        if (z >= 0)
+        {
+            face = ntt;
+            ix = nside - jm - 1;
+            iy = nside - jp - 1;
+        }
+        else
+        {
+            face = ntt + 8;
+            ix = jp;
+            iy = jm;
+        }
+    }
+
+    return ((unsigned int)face << (2 * order)) + spread_bits(ix) + (spread_bits(iy) << 1);
+}
+
+static void star_unit_vector(const struct Star *star, double *x, double *y, double *z)
+{
+    *x = cos(star->declination) * cos(star->right_ascension);
+    *y = cos(star->declination) * sin(star->right_ascension);
+    *z = sin(star->declination);
+}
+
+/* Compute the bounding cap of the stars in a tile's run
+ */
+static void bound_tile(struct SkyTile *tile, const struct Star *star_table, const int *star_indices)
+{
+    double sx = 0.0, sy = 0.0, sz = 0.0;
+    for (unsigned int i = tile->first; i < tile->first + tile->count; ++i)
+    {
+        double x, y, z;
+        star_unit_vector(&star_table[star_indices[i]], &x, &y, &z);
+        sx += x;
+        sy += y;
+        sz += z;
+    }
+
+    double norm = sqrt(sx * sx + sy * sy + sz * sz);
+    if (tile->count == 0 || norm < 1.0E-9)
+    {
+        // Degenerate: treat the tile as covering the whole sky
+        tile->x = 0.0;
+        tile->y = 0.0;
+        tile->z = 1.0;
+        tile->radius = M_PI;
+        return;
+    }
+
+    tile->x = sx / norm;
+    tile->y = sy / norm;
+    tile->z = sz / norm;
+
+    double min_dot = 1.0;
+    for (unsigned int i = tile->first; i < tile->first + tile->count; ++i)
+    {
+        double x, y, z;
+        star_unit_vector(&star_table[star_indices[i]], &x, &y, &z);
+        double dot = x * tile->x + y * tile->y + z * tile->z;
+        min_dot = MIN(min_dot, dot);
+    }
+
+    // Pad slightly to absorb rounding
+    tile->radius = acos(MAX(-1.0, min_dot)) + 1.0E-9;
+}
+
+bool generate_sky_index(struct SkyIndex *index, const struct Star *star_table, unsigned int num_stars,
+                        const int *num_by_mag)
+{
+    int order = 0;
+    while (order < SKY_INDEX_MAX_ORDER && (unsigned long)tiles_in_level(order) * STARS_PER_LEAF < num_stars)
+    {
+        order++;
+    }
+
+    unsigned int num_leaves = tiles_in_level(order);
+    unsigned int num_tiles = level_offset(order + 1);
+
+    index->order = order;
+    index->num_stars = num_stars;
+    index->num_by_mag = num_by_mag;
+    index->num_visible = 0;
+    index->max_motion = 0.0;
+
+    index->tiles = calloc(num_tiles, sizeof(struct SkyTile));
+    index->star_indices = malloc(num_stars * sizeof(int));
+    index->rank = malloc(num_stars * sizeof(int));
+    index->visible = malloc(num_stars * sizeof(int));
+    unsigned int *leaf_of = malloc(num_stars * sizeof(unsigned int));
+
+    if (index->tiles == NULL || index->star_indices == NULL || index->rank == NULL || index->visible == NULL ||
+        leaf_of == NULL)
+    {
+        printf("Allocation of memory for sky index failed\n");
+        free(leaf_of);
+        free_sky_index(index);
+        return false;
+    }
+
+    struct SkyTile *leaves = &index->tiles[level_offset(order)];
+
+    // Count the stars in each leaf
+    for (unsigned int i = 0; i < num_stars; ++i)
+    {
+        const struct Star *star = &star_table[i];
+        leaf_of[i] = sky_index_pixel(order, star->right_ascension, star->declination);
+        leaves[leaf_of[i]].count++;
+
+        double motion = fabs(star->ra_motion) * cos(star->declination) + fabs(star->dec_motion);
+        index->max_motion = MAX(index->max_motion, motion);
+    }
+
+    unsigned int offset = 0;
+    for (unsigned int p = 0; p < num_leaves; ++p)
+    {
+        leaves[p].first = offset;
+        offset += leaves[p].count;
+        leaves[p].count = 0;
+    }
+
+    // Fill leaves in order of decreasing brightness so every run is sorted
+    // brightest first. `num_by_mag` lists the dimmest star first
+    for (unsigned int i = num_stars; i-- > 0;)
+    {
+        int table_index = num_by_mag[i] - 1;
+        struct SkyTile *leaf = &leaves[leaf_of[table_index]];
+        index->star_indices[leaf->first + leaf->count] = table_index;
+        leaf->count++;
+        index->rank[table_index] = (int)i;
+    }
+
+    free(leaf_of);
+
+    // Coarser levels own the union of their children's runs
+    for (int level = order - 1; level >= 0; --level)
+    {
+        struct SkyTile *parents = &index->tiles[level_offset(level)];
+        const struct SkyTile *children = &index->tiles[level_offset(level + 1)];
+        for (unsigned int p = 0; p < tiles_in_level(level); ++p)
+        {
+            parents[p].first = children[4 * p].first;
+            parents[p].count = children[4 * p].count + children[4 * p + 1].count + children[4 * p + 2].count +
+                               children[4 * p + 3].count;
+        }
+    }
+
+    for (unsigned int t = 0; t < num_tiles; ++t)
+    {
+        bound_tile(&index->tiles[t], star_table, index->star_indices);
+    }
+
+    return true;
+}
+
+void free_sky_index(struct SkyIndex *index)
+{
+    free(index->tiles);
+    free(index->star_indices);
+    free(index->rank);
+    free(index->visible);
+    index->tiles = NULL;
+    index->star_indices = NULL;
+    index->rank = NULL;
+    index->visible = NULL;
+    index->num_stars = 0;
+    index->num_visible = 0;
+}
+
+double sky_index_motion_margin(const struct SkyIndex *index, double julian_date)
+{
+    const double J2000 = 2451545.0;
+    const double days_per_year = 365.2425;
+    return index->max_motion * fabs(julian_date - J2000) / days_per_year;
+}
+
+struct CapQuery
+{
+    const struct SkyIndex *index;
+    const struct Star *star_table;
+    double x, y, z; // Unit vector of the cap center
+    double radius;
+    double margin;
+    float threshold;
+    int *out;
+    unsigned int max_out;
+    unsigned int num_out;
+};
+
+/* Append the stars of a tile's leaves that pass the magnitude threshold
+ */
+static void collect_tile(struct CapQuery *query, int level, unsigned int pixel)
+{
+    const struct SkyIndex *index = query->index;
+    int shift = 2 * (index->order - level);
+    const struct SkyTile *leaves = &index->tiles[level_offset(index->order)];
+
+    for (unsigned int p = pixel << shift; p < (pixel + 1) << shift; ++p)
+    {
+        const struct SkyTile *leaf = &leaves[p];
+        for (unsigned int i = leaf->first; i < leaf->first + leaf->count; ++i)
+        {
+            int table_index = index->star_indices[i];
+            if (query->star_table[table_index].magnitude > query->threshold)
+            {
+                // Runs are sorted brightest first
+                break;
+            }
+            if (query->num_out == query->max_out)
+            {
+                return;
+            }
+            query->out[query->num_out++] = table_index;
+        }
+    }
+}
+
+static void query_tile(struct CapQuery *query, int level, unsigned int pixel)
+{
+    const struct SkyTile *tile = &query->index->tiles[level_offset(level) + pixel];
+    if (tile->count == 0)
+    {
+        return;
+    }
+
+    double tile_radius = tile->radius + query->margin;
+    double dot = tile->x * query->x + tile->y * query->y + tile->z * query->z;
+
+    // Disjoint caps: the separation of the centers exceeds both radii
+    if (query->radius + tile_radius < M_PI && dot < cos(query->radius + tile_radius))
+    {
+        return;
+    }
+
+    // The tile lies entirely within the query cap or is a leaf
+    bool contained = tile_radius <= query->radius && dot >= cos(query->radius - tile_radius);
+    if (contained || level == query->index->order)
+    {
+        collect_tile(query, level, pixel);
+        return;
+    }
+
+    for (unsigned int child = 4 * pixel; child < 4 * pixel + 4; ++child)
+    {
+        query_tile(query, level + 1, child);
+    }
+}
+
+unsigned int sky_index_query_cap(const struct SkyIndex *index, const struct Star *star_table, double right_ascension,
+                                 double declination, double radius, double margin, float threshold, int *out,
+                                 unsigned int max_out)
+{
+    struct CapQuery query = {
+        .index = index,
+        .star_table = star_table,
+        .x = cos(declination) * cos(right_ascension),
+        .y = cos(declination) * sin(right_ascension),
+        .z = sin(declination),
+        .radius = radius,
+        .margin = margin,
+        .threshold = threshold,
+        .out = out,
+        .max_out = max_out,
+        .num_out = 0,
+    };
+
+    for (unsigned int pixel = 0; pixel < BASE_PIXELS; ++pixel)
+    {
+        query_tile(&query, 0, pixel);
+    }
+
+    return query.num_out;
+}
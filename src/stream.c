@@ -0,0 +1,213 @@
+#include "stream.h"
+
+#include "bit.h"
+#include "coord.h"
+#include "core.h"
+#include "core_render.h"
+#include "ephemeris.h"
+#include "macros.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define write _write
+#else
+#include <unistd.h>
+#endif
+
+// Upper bound on the length of a NDJSON object or the frame around them
+#define MAX_NDJSON_RECORD 192
+
+bool parse_stream_format(const char *string, enum StreamFormat *format)
+{
+    if (strcmp(string, "ndjson") == 0)
+    {
+        *format = STREAM_NDJSON;
+        return true;
+    }
+    if (strcmp(string, "binary") == 0)
+    {
+        *format = STREAM_BINARY;
+        return true;
+    }
+    return false;
+}
+
+bool generate_stream(struct Stream *stream, int fd, enum StreamFormat format, unsigned int num_stars)
+{
+    size_t max_objects = (size_t)num_stars + NUM_PLANETS + 1;
+    size_t record_size = format == STREAM_BINARY ? STREAM_RECORD_SIZE : MAX_NDJSON_RECORD;
+
+    stream->fd = fd;
+    stream->format = format;
+    stream->length = 0;
+    stream->capacity = MAX_NDJSON_RECORD + max_objects * record_size;
+    stream->buffer = malloc(stream->capacity);
+    if (stream->buffer == NULL)
+    {
+        printf("Allocation of memory for stream buffer failed\n");
+        return false;
+    }
+
+    return true;
+}
+
+void free_stream(struct Stream *stream)
+{
+    free(stream->buffer);
+    stream->buffer = NULL;
+    stream->length = 0;
+    stream->capacity = 0;
+}
+
+static void append_string(struct Stream *stream, const char *string)
+{
+    size_t length = strlen(string);
+    memcpy(&stream->buffer[stream->length], string, length);
+    stream->length += length;
+}
+
+static void append_fixed(struct Stream *stream, double value, int decimals)
+{
+    stream->length += format_fixed(&stream->buffer[stream->length], value, decimals);
+}
+
+static void append_object(struct Stream *stream, unsigned int index, enum ObjectType object, int id,
+                          const struct ObjectBase *base, float magnitude, int height, int width)
+{
+    static const char *const object_names[] = {"star", "planet", "moon"};
+
+    // Cell the object is drawn at, as in `render_object_stereo`
+    double radius, theta;
+    horizontal_to_polar(base->azimuth, base->altitude, &radius, &theta);
+    int row = -1, col = -1;
+    if (fabs(radius) <= 1)
+    {
+        polar_to_win(radius, theta, height, width, &row, &col);
+    }
+
+    double azimuth = base->azimuth * 180.0 / M_PI;
+    double altitude = base->altitude * 180.0 / M_PI;
+
+    if (stream->format == STREAM_BINARY)
+    {
+        uint8_t *record = (uint8_t *)&stream->buffer[stream->length];
+        uint32_to_bytes_LE((uint32_t)id, record);
+        record[4] = (uint8_t)object;
+        record[5] = 0;
+        record[6] = 0;
+        record[7] = 0;
+        float32_to_bytes_LE((float)azimuth, record + 8);
+        float32_to_bytes_LE((float)altitude, record + 12);
+        float32_to_bytes_LE(magnitude, record + 16);
+        uint16_to_bytes_LE((uint16_t)(int16_t)row, record + 20);
+        uint16_to_bytes_LE((uint16_t)(int16_t)col, record + 22);
+        stream->length += STREAM_RECORD_SIZE;
+        return;
+    }
+
+    append_string(stream, index > 0 ? ",{\"object\":\"" : "{\"object\":\"");
+    append_string(stream, object_names[object]);
+    append_string(stream, "\",\"id\":");
+    append_fixed(stream, id, 0);
+
+    // Only planet and moon names are fixed, short and never need escaping
+    if (object != OBJECT_STAR && base->label != NULL)
+    {
+        append_string(stream, ",\"name\":\"");
+        append_string(stream, base->label);
+        append_string(stream, "\"");
+    }
+
+    append_string(stream, ",\"azimuth\":");
+    append_fixed(stream, azimuth, 6);
+    append_string(stream, ",\"altitude\":");
+    append_fixed(stream, altitude, 6);
+    append_string(stream, ",\"magnitude\":");
+    append_fixed(stream, magnitude, 2);
+    append_string(stream, ",\"row\":");
+    append_fixed(stream, row, 0);
+    append_string(stream, ",\"col\":");
+    append_fixed(stream, col, 0);
+    append_string(stream, "}");
+}
+
+void stream_encode_frame(struct Stream *stream, const struct Sky *sky, double julian_date, int height, int width)
+{
+    stream->length = 0;
+
+    if (stream->format == STREAM_BINARY)
+    {
+        // The record count is filled in once known
+        memcpy(stream->buffer, STREAM_BINARY_MAGIC, 4);
+        double64_to_bytes_LE(julian_date, (uint8_t *)&stream->buffer[8]);
+        stream->length = STREAM_HEADER_SIZE;
+    }
+    else
+    {
+        append_string(stream, "{\"julian_date\":");
+        append_fixed(stream, julian_date, 8);
+        append_string(stream, ",\"objects\":[");
+    }
+
+    unsigned int count = 0;
+
+    // Stars above the horizon passing the threshold, brightest last
+    const struct SkyIndex *index = sky->sky_index;
+    for (unsigned int i = 0; i < index->num_visible; ++i)
+    {
+        const struct Star *star = &sky->star_table[index->visible[i] - 1];
+        append_object(stream, count++, OBJECT_STAR, star->catalog_number, &star->base, star->magnitude, height, width);
+    }
+
+    for (int i = SUN; i < NUM_PLANETS; ++i)
+    {
+        const struct Planet *planet = &sky->planet_table[i];
+        if (i != EARTH && planet->base.altitude >= 0.0)
+        {
+            append_object(stream, count++, OBJECT_PLANET, i, &planet->base, planet->magnitude, height, width);
+        }
+    }
+
+    const struct Moon *moon = sky->moon_object;
+    if (moon->base.altitude >= 0.0)
+    {
+        append_object(stream, count++, OBJECT_MOON, 0, &moon->base, moon->magnitude, height, width);
+    }
+
+    if (stream->format == STREAM_BINARY)
+    {
+        uint32_to_bytes_LE(count, (uint8_t *)&stream->buffer[4]);
+    }
+    else
+    {
+        append_string(stream, "]}\n");
+    }
+}
+
+bool stream_write_frame(struct Stream *stream)
+{
+    // Pipes may accept less than a frame at once
+    size_t written = 0;
+    while (written < stream->length)
+    {
+        long result = (long)write(stream->fd, stream->buffer + written, (unsigned int)(stream->length - written));
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (result <= 0)
+        {
+            return false;
+        }
+        written += (size_t)result;
+    }
+
+    return true;
+}
@@ -1,13 +1,15 @@
 #include "term.h"
+#include "macros.h"
 
 #include <curses.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <wchar.h>
 
 #ifdef _WIN32
-#include <stdio.h>
 #include <windows.h>
 extern BOOL WINAPI GetCurrentConsoleFont(HANDLE hConsoleOutput, BOOL bMaximumWindow, PCONSOLE_FONT_INFO lpConsoleCurrentFont);
 #else
@@ -15,14 +17,36 @@ extern BOOL WINAPI GetCurrentConsoleFont(HANDLE hConsoleOutput, BOOL bMaximumWin
 #include <unistd.h>
 #endif
 
+/* Initialize the color pairs used by object colors
+ */
+static void init_colors(void)
+{
+    start_color();
+    use_default_colors(); // Use terminal colors (fg and bg for pair 0)
+
+    // Colors with default backgrounds
+    init_pair(1, COLOR_BLACK, -1);
+    init_pair(2, COLOR_RED, -1);
+    init_pair(3, COLOR_GREEN, -1);
+    init_pair(4, COLOR_YELLOW, -1);
+    init_pair(5, COLOR_BLUE, -1);
+    init_pair(6, COLOR_MAGENTA, -1);
+    init_pair(7, COLOR_CYAN, -1);
+    init_pair(8, COLOR_WHITE, -1);
+}
+
 void ncurses_init(bool color)
 {
     initscr();
     clear();
-    noecho();    // Input characters aren't echoed
-    cbreak();    // Disable line buffering
-    curs_set(0); // Make cursor invisible
-    timeout(0);  // Non-blocking read for getch
+    noecho();             // Input characters aren't echoed
+    cbreak();             // Disable line buffering
+    curs_set(0);          // Make cursor invisible
+    timeout(0);           // Non-blocking read for getch
+    keypad(stdscr, TRUE); // Arrow keys for scrubbing through time
+#ifdef NCURSES_VERSION
+    set_escdelay(25); // Tell ESC from arrow keys without a noticeable delay
+#endif
 
     // Set the console output code page to UTF-8 on Windows
 #ifdef _WIN32
@@ -38,18 +62,7 @@ void ncurses_init(bool color)
             exit(EXIT_FAILURE);
         }
 
-        start_color();
-        use_default_colors(); // Use terminal colors (fg and bg for pair 0)
-
-        // Colors with default backgrounds
-        init_pair(1, COLOR_BLACK, -1);
-        init_pair(2, COLOR_RED, -1);
-        init_pair(3, COLOR_GREEN, -1);
-        init_pair(4, COLOR_YELLOW, -1);
-        init_pair(5, COLOR_BLUE, -1);
-        init_pair(6, COLOR_MAGENTA, -1);
-        init_pair(7, COLOR_CYAN, -1);
-        init_pair(8, COLOR_WHITE, -1);
+        init_colors();
     }
 }
 
@@ -58,18 +71,91 @@ void ncurses_kill(void)
     endwin();
 }
 
-void win_resize_square(WINDOW *win, float aspect)
+// Null device backing the headless screen
+static FILE *headless_file = NULL;
+
+SCREEN *ncurses_init_headless(void)
+{
+#ifdef _WIN32
+    headless_file = fopen("NUL", "r+");
+#else
+    headless_file = fopen("/dev/null", "r+");
+#endif
+    if (headless_file == NULL)
+    {
+        return NULL;
+    }
+
+    // Any terminal with colors will do, nothing is ever displayed
+    SCREEN *screen = newterm("xterm", headless_file, headless_file);
+    if (screen == NULL)
+    {
+        fclose(headless_file);
+        headless_file = NULL;
+        return NULL;
+    }
+
+    set_term(screen);
+    if (has_colors())
+    {
+        init_colors();
+    }
+    return screen;
+}
+
+void ncurses_kill_headless(SCREEN *screen)
+{
+    endwin();
+    delscreen(screen);
+    fclose(headless_file);
+    headless_file = NULL;
+}
+
+void fit_square(int rows, int cols, float aspect, int *height, int *width)
 {
-    if (COLS < LINES * aspect)
+    if (cols < rows * aspect)
     {
-        wresize(win, COLS / aspect, COLS);
+        *height = (int)(cols / aspect);
+        *width = cols;
     }
     else
     {
-        wresize(win, LINES, LINES * aspect);
+        *height = rows;
+        *width = (int)(rows * aspect);
     }
 }
 
+void centered_square(int rows, int cols, double aspect, int *top, int *left, int *height, int *width)
+{
+    fit_square(rows, cols, (float)(aspect > 0.0 ? aspect : DEFAULT_CELL_ASPECT), height, width);
+    *height = MAX(1, *height);
+    *width = MAX(1, *width);
+    *top = (rows - *height) / 2;
+    *left = (cols - *width) / 2;
+}
+
+bool newpad_centered_square(int rows, int cols, double aspect, WINDOW **pad, WINDOW **square)
+{
+    int top, left, height, width;
+    centered_square(rows, cols, aspect, &top, &left, &height, &width);
+
+    *pad = newpad(rows, cols);
+    *square = *pad != NULL ? subpad(*pad, height, width, top, left) : NULL;
+    if (*square == NULL && *pad != NULL)
+    {
+        delwin(*pad);
+        *pad = NULL;
+    }
+    return *square != NULL;
+}
+
+void win_resize_square(WINDOW *win, float aspect)
+{
+    int height, width;
+    fit_square(LINES, COLS, aspect, &height, &width);
+    wresize(win, height, width);
+}
+
 void wrectangle(WINDOW *win, int ya, int xa, int yb, int xb)
 {
     mvwhline(win, ya, xa, 0, xb - xa);
@@ -175,21 +261,41 @@ float get_cell_aspect_ratio(void)
     return default_height;
 }
 
-#define MAX_STR_LEN 2048
 void mvwaddstr_truncate(WINDOW *win, int y, int x, const char *str)
 {
     // Remaining space on the current line
-    int max_x = getmaxx(win);
-    int space_left = max_x - x;
+    int space_left = getmaxx(win) - x;
+
+    // Keep whole characters while they fit, counting columns rather than bytes
+    mbstate_t state = {0};
+    size_t length = 0;
+    while (str[length] != '\0')
+    {
+        wchar_t wc;
+        size_t bytes = mbrtowc(&wc, str + length, MB_CUR_MAX, &state);
+        int width = 1;
+        if (bytes == (size_t)-1 || bytes == (size_t)-2)
+        {
+            // Invalid sequences are shown byte by byte
+            bytes = 1;
+            state = (mbstate_t){0};
+        }
+        else if (wcwidth(wc) >= 0)
+        {
+            width = wcwidth(wc);
+        }
+
+        if (width > space_left)
+        {
+            break;
+        }
+        space_left -= width;
+        length += bytes;
+    }
 
-    // Don't write beyond the line
-    if (space_left > 0)
+    if (length > 0)
     {
-        // Truncate if necessary
-        char truncated[MAX_STR_LEN];
-        strncpy(truncated, str, space_left);
-        truncated[space_left] = '\0';
-        mvwaddstr(win, y, x, truncated);
+        mvwaddnstr(win, y, x, str, (int)length);
     }
 }
 
@@ -0,0 +1,205 @@
+#include "thread.h"
+
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+static DWORD WINAPI thread_start(LPVOID param)
+{
+    struct Thread *thread = param;
+    thread->func(thread->arg);
+    return 0;
+}
+
+bool thread_create(struct Thread *thread, void (*func)(void *arg), void *arg)
+{
+    thread->func = func;
+    thread->arg = arg;
+    thread->handle = CreateThread(NULL, 0, thread_start, thread, 0, NULL);
+    return thread->handle != NULL;
+}
+
+void thread_join(struct Thread *thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+bool mutex_init(struct Mutex *mutex)
+{
+    InitializeCriticalSection(&mutex->handle);
+    return true;
+}
+
+void mutex_destroy(struct Mutex *mutex)
+{
+    DeleteCriticalSection(&mutex->handle);
+}
+
+void mutex_lock(struct Mutex *mutex)
+{
+    EnterCriticalSection(&mutex->handle);
+}
+
+void mutex_unlock(struct Mutex *mutex)
+{
+    LeaveCriticalSection(&mutex->handle);
+}
+
+bool condition_init(struct Condition *condition)
+{
+    InitializeConditionVariable(&condition->handle);
+    return true;
+}
+
+void condition_destroy(struct Condition *condition)
+{
+    // Win32 condition variables need no cleanup
+    (void)condition;
+}
+
+void condition_wait(struct Condition *condition, struct Mutex *mutex)
+{
+    SleepConditionVariableCS(&condition->handle, &mutex->handle, INFINITE);
+}
+
+void condition_signal(struct Condition *condition)
+{
+    WakeConditionVariable(&condition->handle);
+}
+
+unsigned int thread_hardware_concurrency(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned int)info.dwNumberOfProcessors : 1;
+}
+
+#else
+
+static void *thread_start(void *param)
+{
+    struct Thread *thread = param;
+    thread->func(thread->arg);
+    return NULL;
+}
+
+bool thread_create(struct Thread *thread, void (*func)(void *arg), void *arg)
+{
+    thread->func = func;
+    thread->arg = arg;
+    return pthread_create(&thread->handle, NULL, thread_start, thread) == 0;
+}
+
+void thread_join(struct Thread *thread)
+{
+    pthread_join(thread->handle, NULL);
+}
+
+bool mutex_init(struct Mutex *mutex)
+{
+    return pthread_mutex_init(&mutex->handle, NULL) == 0;
+}
+
+void mutex_destroy(struct Mutex *mutex)
+{
+    pthread_mutex_destroy(&mutex->handle);
+}
+
+void mutex_lock(struct Mutex *mutex)
+{
+    pthread_mutex_lock(&mutex->handle);
+}
+
+void mutex_unlock(struct Mutex *mutex)
+{
+    pthread_mutex_unlock(&mutex->handle);
+}
+
+bool condition_init(struct Condition *condition)
+{
+    return pthread_cond_init(&condition->handle, NULL) == 0;
+}
+
+void condition_destroy(struct Condition *condition)
+{
+    pthread_cond_destroy(&condition->handle);
+}
+
+void condition_wait(struct Condition *condition, struct Mutex *mutex)
+{
+    pthread_cond_wait(&condition->handle, &mutex->handle);
+}
+
+void condition_signal(struct Condition *condition)
+{
+    pthread_cond_signal(&condition->handle);
+}
+
+unsigned int thread_hardware_concurrency(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+}
+
+#endif // _WIN32
+
+struct ParallelTask
+{
+    struct Thread thread;
+    bool started;
+    unsigned int index;
+    void (*task)(unsigned int index, void *data);
+    void *data;
+};
+
+static void parallel_task_start(void *arg)
+{
+    struct ParallelTask *task = arg;
+    task->task(task->index, task->data);
+}
+
+void parallel_run(unsigned int count, void (*task)(unsigned int index, void *data), void *data)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    struct ParallelTask *tasks = calloc(count, sizeof(struct ParallelTask));
+    if (tasks == NULL)
+    {
+        // Run everything serially
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            task(i, data);
+        }
+        return;
+    }
+
+    for (unsigned int i = 1; i < count; ++i)
+    {
+        tasks[i] = (struct ParallelTask){.index = i, .task = task, .data = data};
+        tasks[i].started = thread_create(&tasks[i].thread, parallel_task_start, &tasks[i]);
+    }
+
+    task(0, data);
+
+    for (unsigned int i = 1; i < count; ++i)
+    {
+        if (tasks[i].started)
+        {
+            thread_join(&tasks[i].thread);
+        }
+        else
+        {
+            task(i, data);
+        }
+    }
+
+    free(tasks);
+}
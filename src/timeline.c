@@ -0,0 +1,247 @@
+#include "timeline.h"
+
+#include "macros.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// No frame is ever this far from the start
+#define NO_FRAME LLONG_MIN
+
+unsigned int timeline_prefetch_depth(float speed, int fps, unsigned int capacity)
+{
+    double doublings = floor(log2(MAX(1.0, fabs((double)speed))));
+    double depth = MAX(1, fps / 2) * (1.0 + doublings);
+    return (unsigned int)MAX(1.0, MIN(depth, capacity / 2.0));
+}
+
+double timeline_julian_date(const struct Timeline *timeline, long long frame)
+{
+    // Computed from the start rather than accumulated so frames always match
+    return timeline->julian_date_start + (double)frame * timeline->step;
+}
+
+static struct TimelineFrame *slot_of(const struct Timeline *timeline, long long frame)
+{
+    long long capacity = (long long)timeline->capacity;
+    return &timeline->slots[((frame % capacity) + capacity) % capacity];
+}
+
+static void take_snapshot(const struct Timeline *timeline, struct TimelineFrame *snapshot, long long frame,
+                          const struct Sky *sky)
+{
+    const struct SkyIndex *index = sky->sky_index;
+    unsigned int num_visible = MIN(index->num_visible, timeline->max_visible);
+
+    snapshot->frame = frame;
+    snapshot->num_visible = num_visible;
+    memcpy(snapshot->visible, index->visible, num_visible * sizeof(int));
+
+    double *position = snapshot->positions;
+    for (unsigned int i = 0; i < num_visible; ++i)
+    {
+        const struct Star *star = &sky->star_table[index->visible[i] - 1];
+        *position++ = star->base.azimuth;
+        *position++ = star->base.altitude;
+    }
+    for (unsigned int i = 0; i < timeline->num_vertices; ++i)
+    {
+        const struct Star *star = &sky->star_table[sky->constell_graph->vertices[i]];
+        *position++ = star->base.azimuth;
+        *position++ = star->base.altitude;
+    }
+
+    for (int i = 0; i < NUM_PLANETS; ++i)
+    {
+        snapshot->planet_positions[i][0] = sky->planet_table[i].base.azimuth;
+        snapshot->planet_positions[i][1] = sky->planet_table[i].base.altitude;
+    }
+    snapshot->moon_position[0] = sky->moon_object->base.azimuth;
+    snapshot->moon_position[1] = sky->moon_object->base.altitude;
+    snapshot->moon_symbol = sky->moon_object->base.symbol_unicode;
+}
+
+/* Find the first frame ahead of the playhead that is not cached yet
+ */
+static bool next_prefetch(const struct Timeline *timeline, long long *frame)
+{
+    for (unsigned int k = 1; k <= timeline->depth; ++k)
+    {
+        long long ahead = timeline->playhead + (long long)k * timeline->direction;
+        if (slot_of(timeline, ahead)->frame != ahead)
+        {
+            *frame = ahead;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void run_prefetcher(void *arg)
+{
+    struct Timeline *timeline = arg;
+
+    mutex_lock(&timeline->mutex);
+    while (!timeline->stop)
+    {
+        long long frame;
+        if (!next_prefetch(timeline, &frame))
+        {
+            condition_wait(&timeline->condition, &timeline->mutex);
+            continue;
+        }
+
+        mutex_unlock(&timeline->mutex);
+        update_sky(&timeline->copy.sky, &timeline->config, timeline_julian_date(timeline, frame));
+        mutex_lock(&timeline->mutex);
+
+        // The playhead may have jumped away meanwhile
+        long long distance = (frame - timeline->playhead) * timeline->direction;
+        if (distance > 0 && distance <= (long long)timeline->depth)
+        {
+            take_snapshot(timeline, slot_of(timeline, frame), frame, &timeline->copy.sky);
+        }
+    }
+    mutex_unlock(&timeline->mutex);
+}
+
+static void free_snapshots(struct Timeline *timeline)
+{
+    for (unsigned int i = 0; timeline->slots != NULL && i < timeline->capacity; ++i)
+    {
+        free(timeline->slots[i].visible);
+        free(timeline->slots[i].positions);
+    }
+    free(timeline->slots);
+    free_sky_copy(&timeline->copy);
+}
+
+bool generate_timeline(struct Timeline *timeline, const struct Conf *config, const struct Sky *sky,
+                       double julian_date_start, double step, unsigned int capacity, unsigned int depth)
+{
+    memset(timeline, 0, sizeof(*timeline));
+    timeline->config = *config;
+    timeline->julian_date_start = julian_date_start;
+    timeline->step = step;
+    timeline->capacity = MAX(1, capacity);
+    timeline->depth = MIN(depth, timeline->capacity / 2);
+    timeline->direction = 1;
+
+    // Only stars passing the threshold are ever visible
+    for (unsigned int i = 0; i < sky->num_stars; ++i)
+    {
+        timeline->max_visible += sky->star_table[i].magnitude <= config->threshold;
+    }
+    timeline->num_vertices = config->constell && sky->constell_graph != NULL ? sky->constell_graph->num_vertices : 0;
+
+    bool success = copy_sky(&timeline->copy, sky);
+    timeline->slots = success ? calloc(timeline->capacity, sizeof(struct TimelineFrame)) : NULL;
+    success = timeline->slots != NULL;
+    for (unsigned int i = 0; success && i < timeline->capacity; ++i)
+    {
+        struct TimelineFrame *slot = &timeline->slots[i];
+        slot->frame = NO_FRAME;
+        slot->visible = malloc(MAX(1, timeline->max_visible) * sizeof(int));
+        slot->positions = malloc(MAX(1, timeline->max_visible + timeline->num_vertices) * 2 * sizeof(double));
+        success = slot->visible != NULL && slot->positions != NULL;
+    }
+    if (!success)
+    {
+        printf("Allocation of memory for timeline failed\n");
+        free_snapshots(timeline);
+        return false;
+    }
+
+    bool mutex_created = mutex_init(&timeline->mutex);
+    bool condition_created = condition_init(&timeline->condition);
+    if (!mutex_created || !condition_created || !thread_create(&timeline->prefetcher, run_prefetcher, timeline))
+    {
+        if (mutex_created)
+        {
+            mutex_destroy(&timeline->mutex);
+        }
+        if (condition_created)
+        {
+            condition_destroy(&timeline->condition);
+        }
+        free_snapshots(timeline);
+        return false;
+    }
+
+    return true;
+}
+
+void free_timeline(struct Timeline *timeline)
+{
+    mutex_lock(&timeline->mutex);
+    timeline->stop = true;
+    condition_signal(&timeline->condition);
+    mutex_unlock(&timeline->mutex);
+    thread_join(&timeline->prefetcher);
+
+    condition_destroy(&timeline->condition);
+    mutex_destroy(&timeline->mutex);
+    free_snapshots(timeline);
+}
+
+bool timeline_restore(struct Timeline *timeline, long long frame, struct Sky *sky)
+{
+    mutex_lock(&timeline->mutex);
+
+    const struct TimelineFrame *snapshot = slot_of(timeline, frame);
+    bool cached = snapshot->frame == frame;
+    if (cached)
+    {
+        struct SkyIndex *index = sky->sky_index;
+        index->num_visible = snapshot->num_visible;
+        memcpy(index->visible, snapshot->visible, snapshot->num_visible * sizeof(int));
+
+        const double *position = snapshot->positions;
+        for (unsigned int i = 0; i < snapshot->num_visible; ++i)
+        {
+            struct Star *star = &sky->star_table[snapshot->visible[i] - 1];
+            star->base.azimuth = *position++;
+            star->base.altitude = *position++;
+        }
+        for (unsigned int i = 0; i < timeline->num_vertices; ++i)
+        {
+            struct Star *star = &sky->star_table[sky->constell_graph->vertices[i]];
+            star->base.azimuth = *position++;
+            star->base.altitude = *position++;
+        }
+
+        for (int i = 0; i < NUM_PLANETS; ++i)
+        {
+            sky->planet_table[i].base.azimuth = snapshot->planet_positions[i][0];
+            sky->planet_table[i].base.altitude = snapshot->planet_positions[i][1];
+        }
+        sky->moon_object->base.azimuth = snapshot->moon_position[0];
+        sky->moon_object->base.altitude = snapshot->moon_position[1];
+        sky->moon_object->base.symbol_unicode = snapshot->moon_symbol;
+    }
+
+    mutex_unlock(&timeline->mutex);
+    return cached;
+}
+
+void timeline_store(struct Timeline *timeline, long long frame, const struct Sky *sky)
+{
+    mutex_lock(&timeline->mutex);
+    take_snapshot(timeline, slot_of(timeline, frame), frame, sky);
+    mutex_unlock(&timeline->mutex);
+}
+
+void timeline_seek(struct Timeline *timeline, long long frame, int direction)
+{
+    mutex_lock(&timeline->mutex);
+    if (frame != timeline->playhead || direction != timeline->direction)
+    {
+        timeline->playhead = frame;
+        timeline->direction = direction;
+        condition_signal(&timeline->condition);
+    }
+    mutex_unlock(&timeline->mutex);
+}
@@ -0,0 +1,224 @@
+#include "visibility.h"
+
+#include "astro.h"
+#include "core.h"
+#include "core_position.h"
+#include "macros.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Objects transformed at once. Every observer processes a block before moving
+// to the next so the block's coordinates stay in cache
+#define BLOCK_SIZE 256
+
+/* Append a direction given in rectangular coordinates as a unit vector
+ */
+static void add_object(struct SkySnapshot *snapshot, enum ObjectType type, int index, double x, double y, double z)
+{
+    double norm = sqrt(x * x + y * y + z * z);
+    unsigned int i = snapshot->num_objects++;
+    snapshot->x[i] = x / norm;
+    snapshot->y[i] = y / norm;
+    snapshot->z[i] = z / norm;
+    snapshot->types[i] = type;
+    snapshot->indices[i] = index;
+}
+
+bool generate_sky_snapshot(struct SkySnapshot *snapshot, const struct Star *star_table, unsigned int num_stars,
+                           const struct Planet *planet_table, const struct Moon *moon_object, float threshold,
+                           double julian_date)
+{
+    unsigned int capacity = num_stars + NUM_PLANETS + 1;
+
+    snapshot->julian_date = julian_date;
+    snapshot->gmst = greenwich_mean_sidereal_time_rad(julian_date);
+    snapshot->num_objects = 0;
+    snapshot->x = malloc(capacity * sizeof(double));
+    snapshot->y = malloc(capacity * sizeof(double));
+    snapshot->z = malloc(capacity * sizeof(double));
+    snapshot->types = malloc(capacity * sizeof(enum ObjectType));
+    snapshot->indices = malloc(capacity * sizeof(int));
+
+    if (snapshot->x == NULL || snapshot->y == NULL || snapshot->z == NULL || snapshot->types == NULL ||
+        snapshot->indices == NULL)
+    {
+        printf("Allocation of memory for sky snapshot failed\n");
+        free_sky_snapshot(snapshot);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < num_stars; ++i)
+    {
+        const struct Star *star = &star_table[i];
+        if (star->magnitude > threshold)
+        {
+            continue;
+        }
+
+        double right_ascension, declination;
+        calc_star_position(star->right_ascension, star->ra_motion, star->declination, star->dec_motion, julian_date,
+                           &right_ascension, &declination);
+        add_object(snapshot, OBJECT_STAR, (int)i, cos(declination) * cos(right_ascension),
+                   cos(declination) * sin(right_ascension), sin(declination));
+    }
+
+    // Heliocentric coordinates of the Earth-Moon barycenter
+    double xe, ye, ze;
+    calc_planet_helio_ICRF(planet_table[EARTH].elements, planet_table[EARTH].rates, planet_table[EARTH].extras, julian_date,
+                           &xe, &ye, &ze);
+
+    for (int i = SUN; i < NUM_PLANETS; ++i)
+    {
+        if (i == EARTH)
+        {
+            continue;
+        }
+
+        double xg, yg, zg;
+        calc_planet_geo_position(planet_table, i, xe, ye, ze, julian_date, &xg, &yg, &zg);
+        add_object(snapshot, OBJECT_PLANET, i, xg, yg, zg);
+    }
+
+    double xm, ym, zm;
+    calc_moon_geo_ICRF(moon_object->elements, moon_object->rates, julian_date, &xm, &ym, &zm);
+    add_object(snapshot, OBJECT_MOON, 0, xm, ym, zm);
+
+    return true;
+}
+
+void free_sky_snapshot(struct SkySnapshot *snapshot)
+{
+    free(snapshot->x);
+    free(snapshot->y);
+    free(snapshot->z);
+    free(snapshot->types);
+    free(snapshot->indices);
+    snapshot->x = NULL;
+    snapshot->y = NULL;
+    snapshot->z = NULL;
+    snapshot->types = NULL;
+    snapshot->indices = NULL;
+    snapshot->num_objects = 0;
+}
+
+static bool reserve(struct VisibilityList *list, unsigned int count)
+{
+    if (list->count + count <= list->capacity)
+    {
+        return true;
+    }
+
+    unsigned int capacity = MAX(2 * list->capacity, list->count + count);
+    struct VisibleObject *objects = realloc(list->objects, capacity * sizeof(struct VisibleObject));
+    if (objects == NULL)
+    {
+        return false;
+    }
+
+    list->objects = objects;
+    list->capacity = capacity;
+    return true;
+}
+
+/* Rotation taking equatorial unit vectors to an observer's horizon
+ */
+struct ObserverFrame
+{
+    double sin_lat;
+    double cos_lat;
+    double sin_lst; // Local sidereal time
+    double cos_lst;
+};
+
+bool compute_visibility(const struct SkySnapshot *snapshot, const struct Observer *observers, unsigned int num_observers,
+                        struct VisibilityList *lists)
+{
+    struct ObserverFrame *frames = malloc(MAX(1, num_observers) * sizeof(struct ObserverFrame));
+    if (frames == NULL)
+    {
+        printf("Allocation of memory for observer frames failed\n");
+        return false;
+    }
+
+    for (unsigned int o = 0; o < num_observers; ++o)
+    {
+        double local_sidereal_time = snapshot->gmst + observers[o].longitude;
+        frames[o].sin_lat = sin(observers[o].latitude);
+        frames[o].cos_lat = cos(observers[o].latitude);
+        frames[o].sin_lst = sin(local_sidereal_time);
+        frames[o].cos_lst = cos(local_sidereal_time);
+        lists[o].count = 0;
+    }
+
+    const double *x = snapshot->x;
+    const double *y = snapshot->y;
+    const double *z = snapshot->z;
+    double sin_alt[BLOCK_SIZE];
+
+    for (unsigned int begin = 0; begin < snapshot->num_objects; begin += BLOCK_SIZE)
+    {
+        unsigned int end = MIN(snapshot->num_objects, begin + BLOCK_SIZE);
+
+        for (unsigned int o = 0; o < num_observers; ++o)
+        {
+            const struct ObserverFrame *frame = &frames[o];
+            struct VisibilityList *list = &lists[o];
+
+            if (!reserve(list, end - begin))
+            {
+                printf("Allocation of memory for visibility list failed\n");
+                free(frames);
+                return false;
+            }
+
+            // cos(dec) * cos(hour angle) = x * cos(lst) + y * sin(lst). This
+            // loop has no branches and vectorizes
+            for (unsigned int i = begin; i < end; ++i)
+            {
+                double cos_ha = x[i] * frame->cos_lst + y[i] * frame->sin_lst;
+                sin_alt[i - begin] = frame->sin_lat * z[i] + frame->cos_lat * cos_ha;
+            }
+
+            for (unsigned int i = begin; i < end; ++i)
+            {
+                if (sin_alt[i - begin] < 0.0)
+                {
+                    continue;
+                }
+
+                double cos_ha = x[i] * frame->cos_lst + y[i] * frame->sin_lst;
+                double sin_ha = x[i] * frame->sin_lst - y[i] * frame->cos_lst;
+
+                // As in `equatorial_to_horizontal`, scaled by cos(dec), with
+                // azimuth 0 at North
+                double azimuth = atan2(sin_ha, cos_ha * frame->sin_lat - z[i] * frame->cos_lat) - M_PI;
+                if (azimuth < 0.0)
+                {
+                    azimuth += 2.0 * M_PI;
+                }
+
+                struct VisibleObject *object = &list->objects[list->count++];
+                object->type = snapshot->types[i];
+                object->index = snapshot->indices[i];
+                object->azimuth = azimuth;
+                object->altitude = asin(MIN(1.0, sin_alt[i - begin]));
+            }
+        }
+    }
+
+    free(frames);
+    return true;
+}
+
+void free_visibility_lists(struct VisibilityList *lists, unsigned int num_observers)
+{
+    for (unsigned int o = 0; o < num_observers; ++o)
+    {
+        free(lists[o].objects);
+        lists[o].objects = NULL;
+        lists[o].count = 0;
+        lists[o].capacity = 0;
+    }
+}
@@ -0,0 +1,163 @@
+#include "ansi.h"
+#include "term.h"
+#include "unity.h"
+
+#include <curses.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+static SCREEN *screen;
+static struct AnsiFrame prev;
+static struct AnsiFrame next;
+static struct AnsiBuffer buffer;
+
+#define CLEAR "\x1b[0m\x1b[?25l\x1b[2J"
+
+void setUp(void)
+{
+    setlocale(LC_ALL, "");
+    screen = ncurses_init_headless();
+    TEST_ASSERT_NOT_NULL(screen);
+
+    TEST_ASSERT_TRUE(generate_ansi_frame(&prev, 3, 4));
+    TEST_ASSERT_TRUE(generate_ansi_frame(&next, 3, 4));
+    buffer = (struct AnsiBuffer){0};
+}
+
+void tearDown(void)
+{
+    free_ansi_frame(&prev);
+    free_ansi_frame(&next);
+    free_ansi_buffer(&buffer);
+    ncurses_kill_headless(screen);
+}
+
+static void set_cell(struct AnsiFrame *frame, int y, int x, const char *text, short color, unsigned char attrs)
+{
+    struct AnsiCell *cell = &frame->cells[y * frame->cols + x];
+    strcpy(cell->text, text);
+    cell->color = color;
+    cell->attrs = attrs;
+}
+
+/* Encode and compare as a NUL terminated string
+ */
+static void assert_encoded(const char *expected, const struct AnsiFrame *from, const struct AnsiFrame *to)
+{
+    buffer.length = 0;
+    TEST_ASSERT_TRUE(ansi_encode_frame(&buffer, from, to));
+    TEST_ASSERT_TRUE(ansi_buffer_append(&buffer, "", 1));
+    TEST_ASSERT_EQUAL_STRING(expected, buffer.data);
+}
+
+void test_full_frame_skips_blanks(void)
+{
+    set_cell(&next, 0, 1, "a", -1, 0);
+    set_cell(&next, 2, 3, "b", 1, ANSI_BOLD);
+    assert_encoded(CLEAR "\x1b[1;2H\x1b[0ma\x1b[3;4H\x1b[0;1;31mb", NULL, &next);
+}
+
+void test_full_frame_on_resize(void)
+{
+    struct AnsiFrame small;
+    TEST_ASSERT_TRUE(generate_ansi_frame(&small, 2, 2));
+    assert_encoded(CLEAR, &small, &next);
+    free_ansi_frame(&small);
+}
+
+void test_unchanged_frame_is_empty(void)
+{
+    set_cell(&prev, 1, 1, "x", 2, 0);
+    set_cell(&next, 1, 1, "x", 2, 0);
+    assert_encoded("", &prev, &next);
+}
+
+void test_diff_writes_changed_cells(void)
+{
+    set_cell(&prev, 0, 0, "x", -1, 0);
+    set_cell(&next, 1, 2, "y", 3, ANSI_DIM);
+    assert_encoded("\x1b[1;1H\x1b[0m \x1b[2;3H\x1b[0;2;33my", &prev, &next);
+}
+
+void test_diff_contiguous_cells_share_move_and_style(void)
+{
+    set_cell(&next, 1, 0, "a", 4, 0);
+    set_cell(&next, 1, 1, "b", 4, 0);
+    set_cell(&next, 1, 2, "c", 4, 0);
+    assert_encoded("\x1b[2;1H\x1b[0;34mabc", &prev, &next);
+}
+
+void test_wide_character_advances_two_columns(void)
+{
+    set_cell(&next, 0, 0, "世", -1, 0);
+    set_cell(&next, 0, 1, "", -1, 0);
+    set_cell(&next, 0, 2, "z", -1, 0);
+    assert_encoded("\x1b[1;1H\x1b[0m世z", &prev, &next);
+}
+
+static void assert_lines(const char *expected, const struct AnsiFrame *frame, bool styled)
+{
+    buffer.length = 0;
+    TEST_ASSERT_TRUE(ansi_encode_lines(&buffer, frame, styled));
+    TEST_ASSERT_TRUE(ansi_buffer_append(&buffer, "", 1));
+    TEST_ASSERT_EQUAL_STRING(expected, buffer.data);
+}
+
+void test_lines_trim_trailing_blanks(void)
+{
+    set_cell(&next, 0, 1, "a", -1, 0);
+    set_cell(&next, 2, 0, "世", 2, 0);
+    set_cell(&next, 2, 1, "", 2, 0);
+    assert_lines(" a\n\n世\n", &next, false);
+}
+
+void test_lines_reset_style_per_line(void)
+{
+    set_cell(&next, 0, 0, "a", 1, ANSI_BOLD);
+    set_cell(&next, 0, 1, "b", -1, 0);
+    set_cell(&next, 1, 2, "c", 4, 0);
+    assert_lines("\x1b[0;1;31ma\x1b[0mb\n  \x1b[0;34mc\x1b[0m\n\n", &next, true);
+}
+
+void test_capture_window(void)
+{
+    WINDOW *win = newpad(3, 4);
+    TEST_ASSERT_NOT_NULL(win);
+
+    mvwaddstr(win, 0, 0, "ab");
+    wattron(win, COLOR_PAIR(2) | A_BOLD);
+    mvwaddstr(win, 2, 3, "★");
+    wattroff(win, COLOR_PAIR(2) | A_BOLD);
+
+    ansi_frame_capture(&next, win);
+    TEST_ASSERT_EQUAL_STRING("a", next.cells[0].text);
+    TEST_ASSERT_EQUAL_STRING("b", next.cells[1].text);
+    TEST_ASSERT_EQUAL_STRING(" ", next.cells[2].text);
+    TEST_ASSERT_EQUAL(-1, next.cells[0].color);
+
+    const struct AnsiCell *star = &next.cells[2 * 4 + 3];
+    TEST_ASSERT_EQUAL_STRING("★", star->text);
+    if (has_colors())
+    {
+        TEST_ASSERT_EQUAL(COLOR_RED, star->color);
+    }
+    TEST_ASSERT_EQUAL(ANSI_BOLD, star->attrs);
+
+    delwin(win);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_full_frame_skips_blanks);
+    RUN_TEST(test_full_frame_on_resize);
+    RUN_TEST(test_unchanged_frame_is_empty);
+    RUN_TEST(test_diff_writes_changed_cells);
+    RUN_TEST(test_diff_contiguous_cells_share_move_and_style);
+    RUN_TEST(test_wide_character_advances_two_columns);
+    RUN_TEST(test_lines_trim_trailing_blanks);
+    RUN_TEST(test_lines_reset_style_per_line);
+    RUN_TEST(test_capture_window);
+    return UNITY_END();
+}
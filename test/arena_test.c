@@ -0,0 +1,71 @@
+#include "arena.h"
+#include "unity.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static struct Arena arena;
+
+void setUp(void)
+{
+    arena_init(&arena, 64);
+}
+
+void tearDown(void)
+{
+    arena_free(&arena);
+}
+
+void test_arena_alloc_first_is_base(void)
+{
+    // The first allocation starts the block, so it can be freed on its own
+    void *first = arena_alloc(&arena, 8, _Alignof(double));
+    TEST_ASSERT_EQUAL_PTR(arena.base, first);
+}
+
+void test_arena_alloc_alignment(void)
+{
+    TEST_ASSERT_NOT_NULL(arena_alloc(&arena, 1, 1));
+
+    int *aligned = arena_alloc(&arena, 2 * sizeof(int), _Alignof(int));
+    TEST_ASSERT_NOT_NULL(aligned);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)aligned % _Alignof(int));
+
+    // Allocations do not overlap
+    TEST_ASSERT_TRUE((unsigned char *)aligned >= arena.base + 1);
+}
+
+void test_arena_alloc_full(void)
+{
+    TEST_ASSERT_NOT_NULL(arena_alloc(&arena, 60, 1));
+    TEST_ASSERT_NULL(arena_alloc(&arena, 8, 1));
+    TEST_ASSERT_NOT_NULL(arena_alloc(&arena, 4, 1));
+    TEST_ASSERT_NULL(arena_alloc(&arena, 1, 1));
+    TEST_ASSERT_EQUAL_UINT(64, arena.used);
+
+    // Huge requests must not wrap around
+    TEST_ASSERT_NULL(arena_alloc(&arena, SIZE_MAX, 1));
+}
+
+void test_arena_strndup(void)
+{
+    char *vega = arena_strndup(&arena, "Vega,extra", 4);
+    char *deneb = arena_strndup(&arena, "Deneb", 5);
+    TEST_ASSERT_EQUAL_STRING("Vega", vega);
+    TEST_ASSERT_EQUAL_STRING("Deneb", deneb);
+
+    // Strings are packed back to back
+    TEST_ASSERT_EQUAL_PTR(vega + 5, deneb);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_arena_alloc_first_is_base);
+    RUN_TEST(test_arena_alloc_alignment);
+    RUN_TEST(test_arena_alloc_full);
+    RUN_TEST(test_arena_strndup);
+
+    return UNITY_END();
+}
@@ -1,4 +1,5 @@
 #include "astro.h"
+#include "coord.h"
 #include "unity.h"
 #include <math.h>
 #include <time.h>
@@ -284,6 +285,11 @@ void test_get_moon_phase_image(void)
     TEST_ASSERT_EQUAL_STRING("🌔", get_moon_phase_image(WANING_GIBBOUS, false));
     TEST_ASSERT_EQUAL_STRING("🌓", get_moon_phase_image(LAST_QUARTER, false));
     TEST_ASSERT_EQUAL_STRING("🌒", get_moon_phase_image(WANING_CRESCENT, false));
+
+    // Images stay valid after later calls
+    const char *new_moon = get_moon_phase_image(NEW_MOON, true);
+    get_moon_phase_image(FULL_MOON, true);
+    TEST_ASSERT_EQUAL_STRING("🌑", new_moon);
 }
 
 // -----------------------------------------------------------------------------
@@ -313,6 +319,57 @@ void test_decimal_to_dms(void)
     TEST_ASSERT_FLOAT_WITHIN(0.001, 0.0, seconds);
 }
 
+// calc_rise_transit_set_fixed
+
+static void fixed_horizontal(double right_ascension, double declination, double latitude, double longitude,
+                             double julian_date, double *azimuth, double *altitude)
+{
+    double gmst = greenwich_mean_sidereal_time_rad(julian_date);
+    equatorial_to_horizontal(right_ascension, declination, gmst, latitude, longitude, azimuth, altitude);
+}
+
+void test_calc_rise_transit_set_fixed(void)
+{
+    double julian_date = 2459146.0; // 2020 October 23 12:00:00.0 UT1
+    // Boston, MA in radians
+    double latitude = 42.3601 * M_PI / 180;
+    double longitude = -71.0589 * M_PI / 180;
+    double horizon = RISE_SET_ALTITUDE_STAR * M_PI / 180;
+
+    // Arcturus
+    double right_ascension = 3.733528, declination = 0.334798;
+    struct RiseTransitSet events;
+    calc_rise_transit_set_fixed(right_ascension, declination, latitude, longitude, horizon, julian_date, &events);
+    TEST_ASSERT_EQUAL_INT(RISE_SET_NORMAL, events.kind);
+
+    // Every event is the next one, within a sidereal day
+    TEST_ASSERT_TRUE(events.rise >= julian_date && events.rise < julian_date + 1.0);
+    TEST_ASSERT_TRUE(events.transit >= julian_date && events.transit < julian_date + 1.0);
+    TEST_ASSERT_TRUE(events.set >= julian_date && events.set < julian_date + 1.0);
+
+    double azimuth, altitude;
+    fixed_horizontal(right_ascension, declination, latitude, longitude, events.rise, &azimuth, &altitude);
+    TEST_ASSERT_DOUBLE_WITHIN(EPSILON, horizon, altitude);
+    TEST_ASSERT_TRUE(azimuth < M_PI); // Rises in the east
+
+    fixed_horizontal(right_ascension, declination, latitude, longitude, events.set, &azimuth, &altitude);
+    TEST_ASSERT_DOUBLE_WITHIN(EPSILON, horizon, altitude);
+    TEST_ASSERT_TRUE(azimuth > M_PI); // Sets in the west
+
+    // Culminates due south at its highest altitude
+    fixed_horizontal(right_ascension, declination, latitude, longitude, events.transit, &azimuth, &altitude);
+    TEST_ASSERT_DOUBLE_WITHIN(EPSILON, M_PI, azimuth);
+    TEST_ASSERT_DOUBLE_WITHIN(EPSILON, M_PI / 2 - latitude + declination, altitude);
+
+    // Polaris never sets, and the south celestial pole never rises
+    calc_rise_transit_set_fixed(0.662, 1.5580, latitude, longitude, horizon, julian_date, &events);
+    TEST_ASSERT_EQUAL_INT(RISE_SET_CIRCUMPOLAR, events.kind);
+    TEST_ASSERT_TRUE(isnan(events.rise) && isnan(events.set) && !isnan(events.transit));
+
+    calc_rise_transit_set_fixed(0.0, -1.5, latitude, longitude, horizon, julian_date, &events);
+    TEST_ASSERT_EQUAL_INT(RISE_SET_NEVER_RISES, events.kind);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -327,5 +384,6 @@ int main(void)
     RUN_TEST(test_get_moon_phase_name);
     RUN_TEST(test_get_moon_phase_image);
     RUN_TEST(test_decimal_to_dms);
+    RUN_TEST(test_calc_rise_transit_set_fixed);
     return UNITY_END();
 }
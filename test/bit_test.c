@@ -103,6 +103,34 @@ void test_bytes_to_bool32_LE(void)
     TEST_ASSERT_FALSE(bytes_to_bool32_LE(buffer));
 }
 
+void test_uint32_to_bytes_LE(void)
+{
+    uint8_t buffer[4];
+    uint32_to_bytes_LE(0x12345678, buffer);
+    TEST_ASSERT_EQUAL_HEX8(0x78, buffer[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x56, buffer[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x34, buffer[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x12, buffer[3]);
+    TEST_ASSERT_EQUAL_UINT32(0x12345678, bytes_to_uint32_LE(buffer));
+
+    uint16_to_bytes_LE(0xBEEF, buffer);
+    TEST_ASSERT_EQUAL_UINT16(0xBEEF, bytes_to_uint16_LE(buffer));
+}
+
+void test_float_to_bytes_LE_round_trip(void)
+{
+    uint8_t buffer[8];
+    float32_to_bytes_LE(-1.5f, buffer);
+    TEST_ASSERT_EQUAL_FLOAT(-1.5f, bytes_to_float32_LE(buffer));
+
+    double64_to_bytes_LE(2451545.125, buffer);
+    TEST_ASSERT_EQUAL_DOUBLE(2451545.125, bytes_to_double64_LE(buffer));
+
+    uint64_to_bytes_LE(0x0102030405060708ULL, buffer);
+    TEST_ASSERT_EQUAL_HEX8(0x08, buffer[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, buffer[7]);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -115,6 +143,8 @@ int main(void)
     RUN_TEST(test_bytes_to_float32_LE);
     RUN_TEST(test_bytes_to_double64_LE);
     RUN_TEST(test_bytes_to_bool32_LE);
+    RUN_TEST(test_uint32_to_bytes_LE);
+    RUN_TEST(test_float_to_bytes_LE_round_trip);
 
     return UNITY_END();
 }
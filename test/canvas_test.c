@@ -0,0 +1,192 @@
+#include "ansi.h"
+#include "canvas.h"
+#include "term.h"
+#include "unity.h"
+
+#include <curses.h>
+#include <locale.h>
+#include <string.h>
+
+// A region of cells in the middle of a larger grid, drawn into both as a
+// subpad and as cells in memory
+#define ROWS 5
+#define COLS 8
+#define TOP 1
+#define LEFT 1
+#define HEIGHT 3
+#define WIDTH 6
+
+static SCREEN *screen;
+static WINDOW *pad;
+static WINDOW *sub;
+static struct Canvas window;
+static struct Canvas whole;
+static struct Canvas cells;
+
+void setUp(void)
+{
+    // Wide and zero width characters are measured as in UTF-8
+    if (setlocale(LC_ALL, "C.UTF-8") == NULL)
+    {
+        setlocale(LC_ALL, "");
+    }
+    screen = ncurses_init_headless();
+    TEST_ASSERT_NOT_NULL(screen);
+
+    pad = newpad(ROWS, COLS);
+    sub = subpad(pad, HEIGHT, WIDTH, TOP, LEFT);
+    TEST_ASSERT_NOT_NULL(sub);
+    window = window_canvas(sub);
+
+    TEST_ASSERT_TRUE(generate_cell_canvas(&whole, ROWS, COLS));
+    cells = canvas_region(&whole, TOP, LEFT, HEIGHT, WIDTH);
+}
+
+void tearDown(void)
+{
+    free_canvas(&whole);
+    delwin(sub);
+    delwin(pad);
+    ncurses_kill_headless(screen);
+}
+
+/* Draw a string on both canvases
+ */
+static void add_str(int y, int x, const char *str)
+{
+    canvas_add_str(&window, y, x, str);
+    canvas_add_str(&cells, y, x, str);
+}
+
+/* Check that the cells read back as the window does
+ */
+static void assert_same_frames(void)
+{
+    struct AnsiFrame expected, actual;
+    TEST_ASSERT_TRUE(generate_ansi_frame(&expected, ROWS, COLS));
+    TEST_ASSERT_TRUE(generate_ansi_frame(&actual, ROWS, COLS));
+    ansi_frame_capture(&expected, pad);
+    canvas_capture(&whole, &actual);
+
+    for (int i = 0; i < ROWS * COLS; ++i)
+    {
+        char message[64];
+        snprintf(message, sizeof(message), "Row %d, column %d", i / COLS, i % COLS);
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(expected.cells[i].text, actual.cells[i].text, message);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(expected.cells[i].color, actual.cells[i].color, message);
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected.cells[i].attrs, actual.cells[i].attrs, message);
+    }
+
+    free_ansi_frame(&expected);
+    free_ansi_frame(&actual);
+}
+
+void test_strings_wrap_and_stop_at_the_corner(void)
+{
+    add_str(0, 4, "Algorab");
+    add_str(2, 3, "Betelgeuse");
+    add_str(3, 0, "outside");
+    add_str(-1, 2, "outside");
+    assert_same_frames();
+}
+
+void test_wide_characters_move_to_the_next_row(void)
+{
+    add_str(0, 5, "🌕");
+    add_str(1, 0, "a🌑b🌑c");
+    add_str(2, 5, "🌕🌕");
+    assert_same_frames();
+}
+
+void test_overwritten_halves_of_wide_characters(void)
+{
+    add_str(0, 0, "🌕🌕🌕");
+    add_str(0, 1, "x");
+    add_str(0, 4, "🌑");
+    canvas_add_char(&window, 1, 2, '+');
+    canvas_add_char(&cells, 1, 2, '+');
+    add_str(1, 1, "🌕");
+    add_str(1, 3, "🌕");
+    assert_same_frames();
+}
+
+void test_zero_width_characters_join_the_one_before(void)
+{
+    add_str(0, 0, "♃\xef\xb8\x8e");
+    add_str(0, 2, "🌕\xef\xb8\x8e");
+    add_str(1, 0, "\xef\xb8\x8e");
+    add_str(2, 5, "a\xef\xb8\x8e");
+    assert_same_frames();
+}
+
+void test_lines_are_clipped(void)
+{
+    const char *fills[] = {"-", "|", "─", "│", "•"};
+    for (int i = 0; i < (int)(sizeof(fills) / sizeof(fills[0])); ++i)
+    {
+        canvas_erase(&window);
+        canvas_erase(&cells);
+        add_str(0, 0, "🌕🌕🌕");
+        add_str(2, 2, "🌑🌑");
+
+        canvas_hline(&window, 0, 1, fills[i], 3);
+        canvas_hline(&cells, 0, 1, fills[i], 3);
+        canvas_hline(&window, 2, 4, fills[i], 0);
+        canvas_hline(&cells, 2, 4, fills[i], 0);
+        canvas_vline(&window, -1, 3, fills[i], 10);
+        canvas_vline(&cells, -1, 3, fills[i], 10);
+        canvas_hline(&window, 1, 4, fills[i], 10);
+        canvas_hline(&cells, 1, 4, fills[i], 10);
+        assert_same_frames();
+    }
+}
+
+void test_color_pairs(void)
+{
+    canvas_color_on(&window, 2);
+    canvas_color_on(&cells, 2);
+    add_str(0, 0, "red");
+    canvas_color_off(&window, 2);
+    canvas_color_off(&cells, 2);
+    add_str(1, 0, "plain");
+
+    // Turning off any pair draws without color again
+    canvas_color_on(&window, 5);
+    canvas_color_on(&cells, 5);
+    add_str(2, 0, "N");
+    canvas_color_off(&window, 3);
+    canvas_color_off(&cells, 3);
+    add_str(2, 1, "S");
+    assert_same_frames();
+}
+
+void test_braille_layer_of_cells(void)
+{
+    TEST_ASSERT_NULL(canvas_braille_cell(&cells, HEIGHT, 0));
+    TEST_ASSERT_NULL(canvas_braille_cell(&cells, 0, -1));
+
+    unsigned char *dots = canvas_braille_cell(&cells, 1, 2);
+    TEST_ASSERT_NOT_NULL(dots);
+    TEST_ASSERT_EQUAL_HEX8(0, *dots);
+    *dots = 0x41;
+
+    // Regions share the layer of the grid they lie in
+    struct Canvas inner = canvas_region(&cells, 1, 1, 2, 2);
+    TEST_ASSERT_EQUAL_PTR(dots, canvas_braille_cell(&inner, 0, 1));
+
+    canvas_clear_braille(&inner);
+    TEST_ASSERT_EQUAL_HEX8(0, *dots);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_strings_wrap_and_stop_at_the_corner);
+    RUN_TEST(test_wide_characters_move_to_the_next_row);
+    RUN_TEST(test_overwritten_halves_of_wide_characters);
+    RUN_TEST(test_zero_width_characters_join_the_one_before);
+    RUN_TEST(test_lines_are_clipped);
+    RUN_TEST(test_color_pairs);
+    RUN_TEST(test_braille_layer_of_cells);
+    return UNITY_END();
+}
@@ -1,5 +1,7 @@
 #include "city.h"
 #include "unity.h"
+#include <math.h>
+#include <stdbool.h>
 #include <string.h>
 
 void setUp(void)
@@ -13,12 +15,11 @@ void tearDown(void)
 void test_get_city(void)
 {
     // Test for a city that exists
-    CityData *city = get_city("Tunis");
+    const CityData *city = get_city("Tunis");
     TEST_ASSERT_NOT_NULL(city);
     TEST_ASSERT_EQUAL_STRING("Tunis", city->city_name);
     TEST_ASSERT_EQUAL_FLOAT(36.81897, city->latitude);
     TEST_ASSERT_EQUAL_FLOAT(10.16579, city->longitude);
-    free_city(city);
 
     // Test for another city that exists
     city = get_city("Boston");
@@ -26,7 +27,6 @@ void test_get_city(void)
     TEST_ASSERT_EQUAL_STRING("Boston", city->city_name);
     TEST_ASSERT_EQUAL_FLOAT(42.35843, city->latitude);
     TEST_ASSERT_EQUAL_FLOAT(-71.05977, city->longitude);
-    free_city(city);
 
     // Test for cities with duplicate names. The larger should maintain the same
     // name
@@ -35,7 +35,6 @@ void test_get_city(void)
     TEST_ASSERT_EQUAL_STRING("London", city->city_name);
     TEST_ASSERT_EQUAL_FLOAT(51.50853, city->latitude);
     TEST_ASSERT_EQUAL_FLOAT(-0.12574, city->longitude);
-    free_city(city);
     // TODO: test other "London"
 
     // Test for yet another city that exists
@@ -44,7 +43,6 @@ void test_get_city(void)
     TEST_ASSERT_EQUAL_STRING("Lisbon", city->city_name);
     TEST_ASSERT_EQUAL_FLOAT(38.72509, city->latitude);
     TEST_ASSERT_EQUAL_FLOAT(-9.1498, city->longitude);
-    free_city(city);
 
     // Test for a city with mixed case and spaces (regression test for PR #79)
     city = get_city("Rio de Janeiro");
@@ -52,7 +50,6 @@ void test_get_city(void)
     TEST_ASSERT_EQUAL_STRING("Rio de Janeiro", city->city_name);
     TEST_ASSERT_EQUAL_FLOAT(-22.90642, city->latitude);
     TEST_ASSERT_EQUAL_FLOAT(-43.18223, city->longitude);
-    free_city(city);
 
     // Test for a city with non-ASCII characters
     city = get_city("Thủ Dầu Một");
@@ -60,7 +57,11 @@ void test_get_city(void)
     TEST_ASSERT_EQUAL_STRING("Thủ Dầu Một", city->city_name);
     TEST_ASSERT_EQUAL_FLOAT(10.9804, city->latitude);
     TEST_ASSERT_EQUAL_FLOAT(106.6519, city->longitude);
-    free_city(city);
+
+    // Lookups ignore case and surrounding whitespace
+    city = get_city("  bOSTON \t");
+    TEST_ASSERT_NOT_NULL(city);
+    TEST_ASSERT_EQUAL_STRING("Boston", city->city_name);
 
     // Test for a city that does not exist
     city = get_city("NonexistentCity");
@@ -73,6 +74,30 @@ void test_get_city(void)
     // Test for a null input
     city = get_city(NULL);
     TEST_ASSERT_NULL(city);
+
+    // Test for an input longer than any city name
+    char long_name[512];
+    memset(long_name, 'a', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    city = get_city(long_name);
+    TEST_ASSERT_NULL(city);
+}
+
+void test_get_city_metadata(void)
+{
+    // Parsed at build time along with the coordinates
+    const CityData *city = get_city("Tunis");
+    TEST_ASSERT_NOT_NULL(city);
+    TEST_ASSERT_EQUAL_STRING("TN", city->country_code);
+    TEST_ASSERT_EQUAL_STRING("Africa/Tunis", city->timezone);
+    TEST_ASSERT_EQUAL_STRING("tunis", city->normalized_name);
+    TEST_ASSERT_GREATER_THAN(0, city->population);
+
+    // The more populous London is chosen
+    city = get_city("London");
+    TEST_ASSERT_NOT_NULL(city);
+    TEST_ASSERT_EQUAL_STRING("GB", city->country_code);
+    TEST_ASSERT_EQUAL_STRING("Europe/London", city->timezone);
 }
 
 // -----------------------------------------------------------------------------
@@ -136,15 +161,282 @@ void test_iter_cities_null_callback_should_not_crash(void)
     TEST_ASSERT_TRUE(1);
 }
 
+//------------------------------------------------------------------------------
+// Tests for complete_city
+//------------------------------------------------------------------------------
+
+void test_complete_city_prefix(void)
+{
+    const CityData *matches[20];
+    int count = complete_city("  bOs", matches, 20);
+    TEST_ASSERT_GREATER_THAN(0, count);
+
+    bool found_boston = false;
+    for (int i = 0; i < count; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(0, strncmp(matches[i]->normalized_name, "bos", 3));
+        found_boston |= strcmp(matches[i]->city_name, "Boston") == 0;
+
+        // Ranked by decreasing population
+        if (i > 0)
+        {
+            TEST_ASSERT_TRUE(matches[i - 1]->population >= matches[i]->population);
+        }
+    }
+    TEST_ASSERT_TRUE(found_boston);
+
+    // Trailing spaces are significant
+    count = complete_city("new ", matches, 20);
+    for (int i = 0; i < count; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(0, strncmp(matches[i]->normalized_name, "new ", 4));
+    }
+}
+
+void test_complete_city_top_n(void)
+{
+    // An empty prefix matches every city, so only the most populous remain
+    const CityData *matches[5];
+    int count = complete_city("", matches, 5);
+    TEST_ASSERT_EQUAL_INT(5, count);
+
+    int smallest = matches[4]->population;
+    CityCursor cursor;
+    city_cursor_init(&cursor);
+    const CityData *city;
+    int larger = 0;
+    while ((city = city_cursor_next(&cursor)) != NULL)
+    {
+        larger += city->population > smallest;
+    }
+    TEST_ASSERT_LESS_THAN(5, larger);
+}
+
+void test_complete_city_unique_names(void)
+{
+    // London appears once, as the most populous London
+    const CityData *matches[20];
+    int count = complete_city("london", matches, 20);
+    int londons = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(matches[i]->city_name, "London") == 0)
+        {
+            londons++;
+            TEST_ASSERT_EQUAL_PTR(get_city("London"), matches[i]);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(1, londons);
+}
+
+void test_complete_city_no_match(void)
+{
+    const CityData *matches[20];
+    TEST_ASSERT_EQUAL_INT(0, complete_city("zzzzzz", matches, 20));
+    TEST_ASSERT_EQUAL_INT(0, complete_city(NULL, matches, 20));
+    TEST_ASSERT_EQUAL_INT(0, complete_city("a", matches, 0));
+}
+
+//------------------------------------------------------------------------------
+// Tests for search_cities
+//------------------------------------------------------------------------------
+
+void test_search_cities_typos(void)
+{
+    CityMatch matches[5];
+    int count = search_cities("Sao Paolo", matches, 5);
+    TEST_ASSERT_GREATER_THAN(0, count);
+    TEST_ASSERT_EQUAL_PTR(get_city("São Paulo"), matches[0].city);
+    TEST_ASSERT_FALSE(matches[0].exact);
+
+    count = search_cities("Bostn", matches, 5);
+    TEST_ASSERT_GREATER_THAN(0, count);
+    TEST_ASSERT_EQUAL_STRING("Boston", matches[0].city->city_name);
+
+    // Ranked by decreasing similarity when populations are comparable
+    for (int i = 0; i < count; i++)
+    {
+        TEST_ASSERT_TRUE(matches[i].similarity > 0.0f && matches[i].similarity <= 1.0f);
+    }
+}
+
+void test_search_cities_accents(void)
+{
+    // Missing accents and different punctuation still match exactly
+    CityMatch matches[5];
+    int count = search_cities("zurich", matches, 5);
+    TEST_ASSERT_GREATER_THAN(0, count);
+    TEST_ASSERT_EQUAL_PTR(get_city("Zürich"), matches[0].city);
+    TEST_ASSERT_TRUE(matches[0].exact);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, matches[0].similarity);
+
+    count = search_cities("  SAO-PAULO ", matches, 5);
+    TEST_ASSERT_GREATER_THAN(0, count);
+    TEST_ASSERT_EQUAL_PTR(get_city("São Paulo"), matches[0].city);
+    TEST_ASSERT_TRUE(matches[0].exact);
+}
+
+void test_search_cities_exact_first(void)
+{
+    // Exact matches are listed ahead of larger cities with similar names
+    const char *queries[] = {"zurich", "sao paulo", "paris", "london", "san jose"};
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++)
+    {
+        CityMatch matches[20];
+        int count = search_cities(queries[q], matches, 20);
+        TEST_ASSERT_GREATER_THAN(0, count);
+        TEST_ASSERT_TRUE(matches[0].exact);
+        for (int i = 1; i < count; i++)
+        {
+            TEST_ASSERT_TRUE(matches[i - 1].exact || !matches[i].exact);
+        }
+    }
+}
+
+void test_find_city(void)
+{
+    TEST_ASSERT_EQUAL_PTR(get_city("Zürich"), find_city("Zürich"));
+    TEST_ASSERT_EQUAL_PTR(get_city("Zürich"), find_city("zurich"));
+    TEST_ASSERT_EQUAL_PTR(get_city("São Paulo"), find_city("  SAO-PAULO "));
+
+    // Close but not exact matches are not accepted
+    TEST_ASSERT_NULL(find_city("Sao Paolo"));
+    TEST_ASSERT_NULL(find_city("qxjzvw"));
+}
+
+void test_search_cities_no_match(void)
+{
+    CityMatch matches[5];
+    TEST_ASSERT_EQUAL_INT(0, search_cities("qxjzvw", matches, 5));
+    TEST_ASSERT_EQUAL_INT(0, search_cities("", matches, 5));
+    TEST_ASSERT_EQUAL_INT(0, search_cities("!?", matches, 5));
+    TEST_ASSERT_EQUAL_INT(0, search_cities(NULL, matches, 5));
+}
+
+//------------------------------------------------------------------------------
+// Tests for nearest_city
+//------------------------------------------------------------------------------
+
+static double haversine_km(double lat1, double lon1, double lat2, double lon2)
+{
+    const double to_rad = 3.14159265358979323846 / 180.0;
+    double dlat = (lat2 - lat1) * to_rad;
+    double dlon = (lon2 - lon1) * to_rad;
+    double a = sin(dlat / 2) * sin(dlat / 2) + cos(lat1 * to_rad) * cos(lat2 * to_rad) * sin(dlon / 2) * sin(dlon / 2);
+    return 2.0 * 6371.0 * asin(sqrt(a));
+}
+
+void test_nearest_city_at_city(void)
+{
+    double distance;
+    const CityData *city = nearest_city(36.81897, 10.16579, &distance);
+    TEST_ASSERT_NOT_NULL(city);
+    TEST_ASSERT_EQUAL_STRING("Tunis", city->city_name);
+    TEST_ASSERT_EQUAL_STRING("Africa/Tunis", city->timezone);
+    TEST_ASSERT_DOUBLE_WITHIN(0.1, 0.0, distance);
+
+    // A few kilometers outside of Boston
+    city = nearest_city(42.40, -71.10, NULL);
+    TEST_ASSERT_NOT_NULL(city);
+    TEST_ASSERT_EQUAL_STRING("America/New_York", city->timezone);
+}
+
+void test_nearest_city_matches_brute_force(void)
+{
+    // Deterministic spread of positions, including the poles and antimeridian
+    for (int i = 0; i < 200; i++)
+    {
+        double latitude = -90.0 + 180.0 * ((i * 37) % 200) / 199.0;
+        double longitude = -180.0 + 360.0 * ((i * 73) % 200) / 200.0;
+
+        double distance;
+        const CityData *city = nearest_city(latitude, longitude, &distance);
+        TEST_ASSERT_NOT_NULL(city);
+
+        double best = INFINITY;
+        CityCursor cursor;
+        city_cursor_init(&cursor);
+        const CityData *other;
+        while ((other = city_cursor_next(&cursor)) != NULL)
+        {
+            best = fmin(best, haversine_km(latitude, longitude, other->latitude, other->longitude));
+        }
+
+        // Positions are stored in single precision
+        TEST_ASSERT_DOUBLE_WITHIN(1.0, best, distance);
+        TEST_ASSERT_DOUBLE_WITHIN(1.0, best, haversine_km(latitude, longitude, city->latitude, city->longitude));
+    }
+}
+
+//------------------------------------------------------------------------------
+// Tests for the city cursor
+//------------------------------------------------------------------------------
+
+void test_city_cursor_matches_iter_cities(void)
+{
+    int iter_count = 0;
+    iter_cities(count_cities_cb, &iter_count);
+
+    CityCursor cursor;
+    city_cursor_init(&cursor);
+
+    int cursor_count = 0;
+    const CityData *city;
+    while ((city = city_cursor_next(&cursor)) != NULL)
+    {
+        TEST_ASSERT_NOT_NULL(city->city_name);
+        cursor_count++;
+    }
+    TEST_ASSERT_EQUAL_INT(iter_count, cursor_count);
+
+    // An exhausted cursor stays exhausted
+    TEST_ASSERT_NULL(city_cursor_next(&cursor));
+}
+
+void test_city_cursor_yields_lookup_entries(void)
+{
+    // Views point into the same table get_city uses
+    const CityData *tunis = get_city("Tunis");
+
+    CityCursor cursor;
+    city_cursor_init(&cursor);
+
+    bool found = false;
+    const CityData *city;
+    while ((city = city_cursor_next(&cursor)) != NULL)
+    {
+        found |= city == tunis;
+    }
+    TEST_ASSERT_TRUE(found);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
 
     RUN_TEST(test_get_city);
+    RUN_TEST(test_get_city_metadata);
 
     RUN_TEST(test_iter_cities_should_iterate_all_rows);
     RUN_TEST(test_iter_cities_should_parse_data_correctly);
     RUN_TEST(test_iter_cities_null_callback_should_not_crash);
 
+    RUN_TEST(test_complete_city_prefix);
+    RUN_TEST(test_complete_city_top_n);
+    RUN_TEST(test_complete_city_unique_names);
+    RUN_TEST(test_complete_city_no_match);
+
+    RUN_TEST(test_search_cities_typos);
+    RUN_TEST(test_search_cities_accents);
+    RUN_TEST(test_search_cities_exact_first);
+    RUN_TEST(test_find_city);
+    RUN_TEST(test_search_cities_no_match);
+
+    RUN_TEST(test_nearest_city_at_city);
+    RUN_TEST(test_nearest_city_matches_brute_force);
+
+    RUN_TEST(test_city_cursor_matches_iter_cities);
+    RUN_TEST(test_city_cursor_yields_lookup_entries);
+
     return UNITY_END();
 }
@@ -0,0 +1,88 @@
+#include "constell_graph.h"
+#include "core.h"
+#include "unity.h"
+
+#include <string.h>
+
+#define NUM_TEST_STARS 8
+
+static struct Star star_table[NUM_TEST_STARS];
+static struct ConstellGraph graph;
+
+// Two figures sharing star 3, and one referencing a star outside the table
+static int figure_a[] = {1, 2, 2, 3};
+static int figure_b[] = {3, 4, 4, 5, 5, 3};
+static int figure_c[] = {6, 42};
+static const struct Constell constell_table[] = {
+    {.num_segments = 2, .star_numbers = figure_a},
+    {.num_segments = 3, .star_numbers = figure_b},
+    {.num_segments = 1, .star_numbers = figure_c},
+};
+
+void setUp(void)
+{
+    memset(star_table, 0, sizeof(star_table));
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        star_table[i].catalog_number = i + 1;
+        star_table[i].magnitude = 1.0f;
+    }
+    star_table[3].magnitude = 4.5f; // Star 4, only in figure b
+
+    generate_constell_graph(&graph, constell_table, 3, star_table, NUM_TEST_STARS);
+}
+
+void tearDown(void)
+{
+    free_constell_graph(&graph);
+}
+
+void test_generate_constell_graph_edges(void)
+{
+    TEST_ASSERT_EQUAL_UINT(3, graph.num_constells);
+
+    // Offsets delimit each figure's edges; the invalid figure has none
+    unsigned int expected_offsets[] = {0, 2, 5, 5};
+    TEST_ASSERT_EQUAL_UINT_ARRAY(expected_offsets, graph.offsets, 4);
+
+    // Catalog numbers are resolved to table indices
+    int expected_edges[] = {0, 1, 1, 2, 2, 3, 3, 4, 4, 2};
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected_edges, graph.edges, 10);
+
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, graph.max_magnitude[0]);
+    TEST_ASSERT_EQUAL_FLOAT(4.5f, graph.max_magnitude[1]);
+}
+
+void test_generate_constell_graph_vertices(void)
+{
+    // Shared stars are listed once
+    int expected_vertices[] = {0, 1, 2, 3, 4};
+    TEST_ASSERT_EQUAL_UINT(5, graph.num_vertices);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected_vertices, graph.vertices, 5);
+}
+
+void test_constell_graph_set_threshold(void)
+{
+    constell_graph_set_threshold(&graph, 5.0f);
+    TEST_ASSERT_EQUAL_UINT(5, graph.num_visible_edges);
+
+    // Figure b has a star dimmer than the threshold
+    constell_graph_set_threshold(&graph, 4.0f);
+    TEST_ASSERT_EQUAL_UINT(2, graph.num_visible_edges);
+    int expected_edges[] = {0, 1, 1, 2};
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected_edges, graph.visible_edges, 4);
+
+    constell_graph_set_threshold(&graph, 0.0f);
+    TEST_ASSERT_EQUAL_UINT(0, graph.num_visible_edges);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_generate_constell_graph_edges);
+    RUN_TEST(test_generate_constell_graph_vertices);
+    RUN_TEST(test_constell_graph_set_threshold);
+
+    return UNITY_END();
+}
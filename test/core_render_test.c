@@ -0,0 +1,586 @@
+#include "ansi.h"
+#include "coord.h"
+#include "core.h"
+#include "core_render.h"
+#include "drawing.h"
+#include "term.h"
+#include "unity.h"
+
+#include <curses.h>
+#include <locale.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static SCREEN *screen;
+static struct Conf config;
+
+void setUp(void)
+{
+    // Symbols are measured in cells as drawn with UTF-8
+    if (setlocale(LC_ALL, "C.UTF-8") == NULL)
+    {
+        setlocale(LC_ALL, "");
+    }
+    screen = ncurses_init_headless();
+    TEST_ASSERT_NOT_NULL(screen);
+    config = (struct Conf){.grid = true, .unicode = true};
+}
+
+void tearDown(void)
+{
+    ncurses_kill_headless(screen);
+}
+
+/* Check that two windows of the same size show the same cells
+ */
+static void assert_same_cells(WINDOW *expected, WINDOW *actual)
+{
+    int rows, cols;
+    getmaxyx(expected, rows, cols);
+
+    struct AnsiFrame a, b;
+    TEST_ASSERT_TRUE(generate_ansi_frame(&a, rows, cols));
+    TEST_ASSERT_TRUE(generate_ansi_frame(&b, rows, cols));
+    ansi_frame_capture(&a, expected);
+    ansi_frame_capture(&b, actual);
+
+    for (int i = 0; i < rows * cols; ++i)
+    {
+        TEST_ASSERT_EQUAL_STRING(a.cells[i].text, b.cells[i].text);
+    }
+
+    free_ansi_frame(&a);
+    free_ansi_frame(&b);
+}
+
+/* Place the labels of objects at the first free spot, in order
+ */
+static void place_test_labels(WINDOW *win, const struct ObjectBase *objects, unsigned int num_objects,
+                              struct LabelSpot *spots)
+{
+    int rows, cols;
+    getmaxyx(win, rows, cols);
+
+    struct LabelGrid grid = {0};
+    TEST_ASSERT_TRUE(label_grid_reset(&grid, rows, cols));
+    for (unsigned int i = 0; i < num_objects; ++i)
+    {
+        double radius, theta;
+        horizontal_to_polar(objects[i].azimuth, objects[i].altitude, &radius, &theta);
+
+        int y, x;
+        polar_to_win(radius, theta, rows, cols, &y, &x);
+        int width = object_symbol_width(&objects[i], &config);
+        label_grid_occupy(&grid, y, x, width);
+        spots[i].shown = label_grid_place(&grid, y, x, width, (int)strlen(objects[i].label), &spots[i].y, &spots[i].x);
+    }
+    free_label_grid(&grid);
+}
+
+/* Draw the test scene, with the grid under two objects, into a compositor's
+ * layers. `direct` gets the same drawn as it would have been before layers
+ */
+static void render_scene(WINDOW *win, WINDOW *direct, struct Compositor *compositor, struct ObjectBase *objects,
+                         unsigned int num_objects)
+{
+    struct Canvas canvas = window_canvas(win);
+    struct LabelSpot spots[4];
+    place_test_labels(win, objects, num_objects, spots);
+
+    TEST_ASSERT_TRUE(compositor_begin(compositor, win));
+
+    render_azimuthal_grid_layer(compositor, &config);
+    compositor_redraw_layer(compositor, LAYER_STARS, LAYER_SIGNATURE_SEED);
+    compositor_redraw_layer(compositor, LAYER_DIRECTIONS, LAYER_SIGNATURE_SEED);
+
+    struct LayerItem items[4];
+    for (unsigned int i = 0; i < num_objects; ++i)
+    {
+        object_layer_item(&canvas, &objects[i], &config, &spots[i], &items[i]);
+    }
+    WINDOW *pad = compositor_redraw_items(compositor, LAYER_BODIES, items, num_objects);
+    struct Canvas layer = window_canvas(pad);
+    for (unsigned int i = 0; pad != NULL && i < num_objects; ++i)
+    {
+        render_object_stereo(&layer, &objects[i], &config, &spots[i]);
+    }
+
+    compositor_composite(compositor, win);
+
+    struct Canvas direct_canvas = window_canvas(direct);
+    werase(direct);
+    render_azimuthal_grid(&direct_canvas, &config);
+    for (unsigned int i = 0; i < num_objects; ++i)
+    {
+        render_object_stereo(&direct_canvas, &objects[i], &config, &spots[i]);
+    }
+}
+
+static struct ObjectBase test_objects[2] = {
+    {.azimuth = 0.0, .altitude = 1.0, .symbol_ASCII = 'o', .symbol_unicode = "\u25CF", .label = "Planet"},
+    {.azimuth = 2.0, .altitude = 0.5, .symbol_ASCII = 'M', .symbol_unicode = "\U0001F315", .label = "Moon"},
+};
+
+void test_layers_match_direct_drawing(void)
+{
+    WINDOW *win = newpad(31, 61);
+    WINDOW *direct = newpad(31, 61);
+    struct Compositor compositor = {0};
+
+    render_scene(win, direct, &compositor, test_objects, 2);
+    assert_same_cells(direct, win);
+
+    free_compositor(&compositor);
+    delwin(win);
+    delwin(direct);
+}
+
+void test_unchanged_layers_are_not_drawn_again(void)
+{
+    WINDOW *win = newpad(31, 61);
+    struct Canvas canvas = window_canvas(win);
+    WINDOW *direct = newpad(31, 61);
+    struct Compositor compositor = {0};
+
+    render_scene(win, direct, &compositor, test_objects, 2);
+
+    render_azimuthal_grid_layer(&compositor, &config);
+    TEST_ASSERT_FALSE(compositor.layers[LAYER_GRID].all_dirty);
+    struct LabelSpot spots[2];
+    place_test_labels(win, test_objects, 2, spots);
+    struct LayerItem items[2];
+    object_layer_item(&canvas, &test_objects[0], &config, &spots[0], &items[0]);
+    object_layer_item(&canvas, &test_objects[1], &config, &spots[1], &items[1]);
+    TEST_ASSERT_NULL(compositor_redraw_items(&compositor, LAYER_BODIES, items, 2));
+
+    untouchwin(win);
+    compositor_composite(&compositor, win);
+    TEST_ASSERT_FALSE(is_wintouched(win));
+    assert_same_cells(direct, win);
+
+    free_compositor(&compositor);
+    delwin(win);
+    delwin(direct);
+}
+
+void test_moved_item_composites_only_around_it(void)
+{
+    WINDOW *win = newpad(31, 61);
+    struct Canvas canvas = window_canvas(win);
+    WINDOW *direct = newpad(31, 61);
+    struct Compositor compositor = {0};
+    struct ObjectBase objects[2] = {test_objects[0], test_objects[1]};
+
+    render_scene(win, direct, &compositor, objects, 2);
+
+    struct LabelSpot spots[2];
+    place_test_labels(win, objects, 2, spots);
+    struct LayerItem before;
+    object_layer_item(&canvas, &objects[1], &config, &spots[1], &before);
+    objects[1].azimuth = 4.0;
+    place_test_labels(win, objects, 2, spots);
+    struct LayerItem after;
+    object_layer_item(&canvas, &objects[1], &config, &spots[1], &after);
+    TEST_ASSERT_TRUE(before.visible && after.visible);
+
+    untouchwin(win);
+    render_scene(win, direct, &compositor, objects, 2);
+    assert_same_cells(direct, win);
+
+    for (int y = 0; y < 31; ++y)
+    {
+        bool moved = (y >= before.rect.top && y <= before.rect.bottom) || (y >= after.rect.top && y <= after.rect.bottom);
+        TEST_ASSERT_EQUAL(moved, is_linetouched(win, y));
+    }
+
+    free_compositor(&compositor);
+    delwin(win);
+    delwin(direct);
+}
+
+void test_empty_cells_show_layers_below(void)
+{
+    WINDOW *win = newpad(21, 41);
+    struct Compositor compositor = {0};
+
+    TEST_ASSERT_TRUE(compositor_begin(&compositor, win));
+    WINDOW *grid = compositor_redraw_layer(&compositor, LAYER_GRID, 1);
+    WINDOW *stars = compositor_redraw_layer(&compositor, LAYER_STARS, 1);
+    WINDOW *bodies = compositor_redraw_layer(&compositor, LAYER_BODIES, 1);
+    WINDOW *directions = compositor_redraw_layer(&compositor, LAYER_DIRECTIONS, 1);
+    mvwaddstr(grid, 5, 5, "grid");
+    mvwaddstr(stars, 5, 6, "*");
+    mvwaddstr(bodies, 5, 4, "a ");
+    mvwaddstr(directions, 5, 8, "N");
+
+    // Left over from before the compositor was used
+    mvwaddstr(win, 0, 0, "stale");
+    compositor_composite(&compositor, win);
+
+    // The space drawn over the start of the grid covers it
+    char row[12];
+    mvwinnstr(win, 5, 1, row, 9);
+    TEST_ASSERT_EQUAL_STRING("   a *iN ", row);
+    mvwinnstr(win, 0, 0, row, 5);
+    TEST_ASSERT_EQUAL_STRING("     ", row);
+
+    free_compositor(&compositor);
+    delwin(win);
+}
+
+void test_resize_and_invalidate_redraw_every_layer(void)
+{
+    WINDOW *small = newpad(21, 41);
+    WINDOW *large = newpad(41, 81);
+    struct Compositor compositor = {0};
+
+    TEST_ASSERT_TRUE(compositor_begin(&compositor, small));
+    TEST_ASSERT_NOT_NULL(compositor_redraw_layer(&compositor, LAYER_GRID, 1));
+    TEST_ASSERT_NULL(compositor_redraw_layer(&compositor, LAYER_GRID, 1));
+    TEST_ASSERT_NOT_NULL(compositor_redraw_layer(&compositor, LAYER_GRID, 2));
+
+    TEST_ASSERT_TRUE(compositor_begin(&compositor, large));
+    TEST_ASSERT_EQUAL_INT(41, compositor.height);
+    TEST_ASSERT_EQUAL_INT(81, compositor.width);
+    TEST_ASSERT_NOT_NULL(compositor_redraw_layer(&compositor, LAYER_GRID, 2));
+    TEST_ASSERT_EQUAL_INT(81, getmaxx(compositor.layers[LAYER_GRID].pad));
+
+    invalidate_compositor(&compositor);
+    TEST_ASSERT_NULL(compositor.layers[LAYER_GRID].pad);
+    TEST_ASSERT_TRUE(compositor_begin(&compositor, large));
+    TEST_ASSERT_NOT_NULL(compositor_redraw_layer(&compositor, LAYER_GRID, 2));
+
+    free_compositor(&compositor);
+    TEST_ASSERT_NULL(compositor.layers[LAYER_GRID].pad);
+    delwin(small);
+    delwin(large);
+}
+
+/* Composite a frame showing only the grid
+ */
+static void composite_grid(WINDOW *win, struct Compositor *compositor)
+{
+    TEST_ASSERT_TRUE(compositor_begin(compositor, win));
+    render_azimuthal_grid_layer(compositor, &config);
+    for (int i = LAYER_GRID + 1; i < NUM_LAYERS; ++i)
+    {
+        compositor_redraw_layer(compositor, i, LAYER_SIGNATURE_SEED);
+    }
+    compositor_composite(compositor, win);
+}
+
+void test_grid_layer_is_drawn_once(void)
+{
+    WINDOW *win = newpad(21, 41);
+    struct Compositor compositor = {0};
+
+    composite_grid(win, &compositor);
+
+    // Left as it is while the window size and options stay the same
+    mvwaddch(compositor.layers[LAYER_GRID].pad, 0, 0, 'x');
+    composite_grid(win, &compositor);
+    TEST_ASSERT_EQUAL_CHAR('x', mvwinch(compositor.layers[LAYER_GRID].pad, 0, 0) & A_CHARTEXT);
+
+    config.unicode = false;
+    composite_grid(win, &compositor);
+    TEST_ASSERT_NOT_EQUAL('x', mvwinch(compositor.layers[LAYER_GRID].pad, 0, 0) & A_CHARTEXT);
+
+    free_compositor(&compositor);
+    delwin(win);
+}
+
+void test_grid_layer_follows_window_size_and_options(void)
+{
+    WINDOW *small = newpad(21, 41);
+    WINDOW *large = newpad(41, 81);
+    WINDOW *direct = newpad(41, 81);
+    struct Canvas direct_canvas = window_canvas(direct);
+    struct Compositor compositor = {0};
+
+    composite_grid(small, &compositor);
+    composite_grid(large, &compositor);
+    render_azimuthal_grid(&direct_canvas, &config);
+    assert_same_cells(direct, large);
+
+    config.unicode = false;
+    composite_grid(large, &compositor);
+    werase(direct);
+    render_azimuthal_grid(&direct_canvas, &config);
+    assert_same_cells(direct, large);
+
+    // Turning the grid off empties the layer
+    config.grid = false;
+    composite_grid(large, &compositor);
+    werase(direct);
+    assert_same_cells(direct, large);
+
+    free_compositor(&compositor);
+    delwin(small);
+    delwin(large);
+    delwin(direct);
+}
+
+/* Signature of the stars layer showing two stars, binned anew
+ */
+static uint64_t stars_signature(WINDOW *win, struct StarBins *bins, const struct Star *stars, const int *num_by_mag)
+{
+    struct Canvas canvas = window_canvas(win);
+    bin_stars(bins, &canvas, &config, stars, 2, num_by_mag);
+    return stars_layer_signature(&canvas, &config, bins, stars, NULL, NULL);
+}
+
+void test_stars_signature_follows_cells(void)
+{
+    WINDOW *win = newpad(31, 61);
+    struct StarBins bins = {0};
+    struct Star stars[2] = {
+        {.base = {.azimuth = 1.0, .altitude = 0.8, .symbol_ASCII = '*'}, .catalog_number = 1, .magnitude = 1.0f},
+        {.base = {.azimuth = 3.0, .altitude = 0.4, .symbol_ASCII = '.'}, .catalog_number = 2, .magnitude = 4.0f},
+    };
+    int *num_by_mag = NULL;
+    TEST_ASSERT_TRUE(star_numbers_by_magnitude(&num_by_mag, stars, 2));
+    config.threshold = 5.0f;
+    config.label_thresh = 0.0f;
+
+    uint64_t signature = stars_signature(win, &bins, stars, num_by_mag);
+    stars[1].base.azimuth += 1e-6;
+    TEST_ASSERT_TRUE(signature == stars_signature(win, &bins, stars, num_by_mag));
+    stars[1].base.azimuth += 0.5;
+    TEST_ASSERT_TRUE(signature != stars_signature(win, &bins, stars, num_by_mag));
+
+    // Stars below the threshold are not drawn, wherever they are
+    config.threshold = 2.0f;
+    signature = stars_signature(win, &bins, stars, num_by_mag);
+    stars[1].base.azimuth += 0.5;
+    TEST_ASSERT_TRUE(signature == stars_signature(win, &bins, stars, num_by_mag));
+
+    // Nor are stars hidden by brighter ones in the same cell
+    config.threshold = 5.0f;
+    stars[1].base = stars[0].base;
+    signature = stars_signature(win, &bins, stars, num_by_mag);
+    stars[1].base.azimuth += 1e-6;
+    stars[1].catalog_number = 3;
+    TEST_ASSERT_TRUE(signature == stars_signature(win, &bins, stars, num_by_mag));
+
+    free(num_by_mag);
+    free_star_bins(&bins);
+    delwin(win);
+}
+
+void test_bins_keep_brightest_star_per_cell(void)
+{
+    WINDOW *win = newpad(31, 61);
+    struct Canvas canvas = window_canvas(win);
+    struct Star stars[4] = {
+        {.base = {.azimuth = 1.0, .altitude = 0.8}, .catalog_number = 1, .magnitude = 1.0f},
+        {.base = {.azimuth = 1.0, .altitude = 0.8}, .catalog_number = 2, .magnitude = 3.0f},
+        {.base = {.azimuth = 3.0, .altitude = 0.4}, .catalog_number = 3, .magnitude = 2.0f},
+        {.base = {.azimuth = 1.0, .altitude = -0.1}, .catalog_number = 4, .magnitude = 0.0f},
+    };
+    int *num_by_mag = NULL;
+    TEST_ASSERT_TRUE(star_numbers_by_magnitude(&num_by_mag, stars, 4));
+    config.threshold = 5.0f;
+    config.unicode = false;
+
+    struct StarBins bins = {0};
+    bin_stars(&bins, &canvas, &config, stars, 4, num_by_mag);
+
+    // Stars below the horizon are left out, and the brighter of two in a cell
+    // kept, though the fainter comes first in `num_by_mag`
+    TEST_ASSERT_EQUAL_UINT(2, bins.num_occupied);
+    TEST_ASSERT_EQUAL_PTR(&stars[0], bins.occupied[0].star);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, bins.occupied[0].magnitude);
+    TEST_ASSERT_EQUAL_PTR(&stars[2], bins.occupied[1].star);
+    int y = bins.occupied[1].y;
+    int x = bins.occupied[1].x;
+    TEST_ASSERT_EQUAL_INT(1, bins.cells[y * 61 + x]);
+
+    // A star two magnitudes fainter adds 10^-0.8 of the brighter one's light
+    config.combine_stars = true;
+    const int *cells = bins.cells;
+    bin_stars(&bins, &canvas, &config, stars, 4, num_by_mag);
+    TEST_ASSERT_EQUAL_PTR(cells, bins.cells);
+    TEST_ASSERT_EQUAL_UINT(2, bins.num_occupied);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f - 0.15973f, bins.occupied[0].magnitude);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, bins.occupied[1].magnitude);
+
+    // Drawn once per cell, with the symbol of the combined brightness
+    render_stars_stereo(&canvas, &config, &bins, NULL);
+    char symbol_ASCII;
+    const char *symbol_unicode;
+    star_symbols(bins.occupied[0].magnitude, &symbol_ASCII, &symbol_unicode);
+    TEST_ASSERT_EQUAL_CHAR(symbol_ASCII, (char)(mvwinch(win, bins.occupied[0].y, bins.occupied[0].x) & A_CHARTEXT));
+
+    free(num_by_mag);
+    free_star_bins(&bins);
+    delwin(win);
+}
+
+/* Braille dot of a star's position on a window, from its top left
+ */
+static void star_dot(WINDOW *win, const struct Star *star, int *dot_y, int *dot_x)
+{
+    double radius, theta;
+    horizontal_to_polar(star->base.azimuth, star->base.altitude, &radius, &theta);
+    polar_to_win(radius, theta, 4 * getmaxy(win), 2 * getmaxx(win), dot_y, dot_x);
+}
+
+void test_braille_stars_share_cells(void)
+{
+    WINDOW *win = newpad(31, 61);
+    struct Canvas canvas = window_canvas(win);
+    struct Star stars[2] = {
+        {.base = {.azimuth = 1.0, .altitude = 0.8}, .catalog_number = 1, .magnitude = 4.0f},
+        {.base = {.azimuth = 1.0, .altitude = 0.8}, .catalog_number = 2, .magnitude = 5.0f},
+    };
+    int *num_by_mag = NULL;
+    TEST_ASSERT_TRUE(star_numbers_by_magnitude(&num_by_mag, stars, 2));
+    config.threshold = 5.0f;
+    config.braille_stars = true;
+
+    // Move the fainter star to the next dot of the same cell, either way
+    int y, x, other_y, other_x;
+    star_dot(win, &stars[0], &y, &x);
+    double step = -1e-3;
+    do
+    {
+        stars[1].base.altitude += step;
+        star_dot(win, &stars[1], &other_y, &other_x);
+        if ((other_y / 4 != y / 4 || other_x / 2 != x / 2) && step < 0)
+        {
+            stars[1].base.altitude = stars[0].base.altitude;
+            step = -step;
+            other_y = y;
+            other_x = x;
+        }
+    } while (other_y == y && other_x == x);
+    TEST_ASSERT_EQUAL_INT(y / 4, other_y / 4);
+    TEST_ASSERT_EQUAL_INT(x / 2, other_x / 2);
+
+    struct StarBins bins = {0};
+    uint64_t signature = stars_signature(win, &bins, stars, num_by_mag);
+
+    // Both stars are dots of one glyph, though only the brighter is binned
+    unsigned char mask = braille_dot(y % 4, x % 2) | braille_dot(other_y % 4, other_x % 2);
+    TEST_ASSERT_EQUAL_UINT(1, bins.num_occupied);
+    TEST_ASSERT_EQUAL_PTR(&stars[0], bins.occupied[0].star);
+    TEST_ASSERT_EQUAL_HEX8(mask, bins.dots[(y / 4) * 61 + x / 2]);
+
+    render_stars_stereo(&canvas, &config, &bins, NULL);
+    cchar_t cell;
+    wchar_t glyph[CCHARW_MAX];
+    attr_t attrs;
+    short pair;
+    mvwin_wch(win, y / 4, x / 2, &cell);
+    getcchar(&cell, glyph, &attrs, &pair, NULL);
+    TEST_ASSERT_EQUAL_HEX32(0x2800 | mask, glyph[0]);
+
+    // Hidden stars still change the layer as they move between dots
+    stars[1].base.altitude = stars[0].base.altitude;
+    TEST_ASSERT_TRUE(signature != stars_signature(win, &bins, stars, num_by_mag));
+    TEST_ASSERT_EQUAL_HEX8(braille_dot(y % 4, x % 2), bins.dots[(y / 4) * 61 + x / 2]);
+
+    free(num_by_mag);
+    free_star_bins(&bins);
+    delwin(win);
+}
+
+/* Point an object at the middle of a cell of a window
+ */
+static void aim_at_cell(WINDOW *win, struct ObjectBase *object, int y, int x)
+{
+    double rad_y = (getmaxy(win) - 1) / 2.0;
+    double rad_x = (getmaxx(win) - 1) / 2.0;
+    double north = (rad_y - y) / rad_y;
+    double east = (x - rad_x) / rad_x;
+    object->azimuth = atan2(north, east) - M_PI / 2;
+    object->altitude = M_PI / 2 - 2 * atan(hypot(north, east));
+}
+
+void test_labels_give_way_to_brighter_objects(void)
+{
+    WINDOW *win = newpad(31, 61);
+    struct Canvas canvas = window_canvas(win);
+    struct Star stars[3] = {
+        {.base = {.symbol_ASCII = '*', .label = "Alpha"}, .catalog_number = 1, .magnitude = 1.0f},
+        {.base = {.symbol_ASCII = '*', .label = "Beta"}, .catalog_number = 2, .magnitude = 2.0f},
+        {.base = {.symbol_ASCII = '*', .label = "Gamma"}, .catalog_number = 3, .magnitude = 3.0f},
+    };
+
+    struct Planet planets[NUM_PLANETS] = {0};
+    for (int i = 0; i < NUM_PLANETS; ++i)
+    {
+        planets[i].base = (struct ObjectBase){.altitude = -1.0, .symbol_ASCII = 'p', .label = "Planet"};
+    }
+    planets[VENUS].base.azimuth = 1.0;
+    planets[VENUS].base.altitude = 0.8;
+    planets[VENUS].magnitude = -4.0f;
+    struct Moon moon = {.base = {.altitude = -1.0, .symbol_ASCII = 'M', .label = "Moon"}};
+
+    // Alpha lies under Venus, and Beta just right of both
+    int y, x;
+    double radius, theta;
+    horizontal_to_polar(1.0, 0.8, &radius, &theta);
+    polar_to_win(radius, theta, 31, 61, &y, &x);
+    aim_at_cell(win, &stars[0].base, y, x);
+    aim_at_cell(win, &stars[1].base, y, x + 1);
+    aim_at_cell(win, &stars[2].base, y + 10, x);
+
+    config = (struct Conf){.threshold = 5.0f, .label_thresh = 2.5f};
+    int *num_by_mag = NULL;
+    TEST_ASSERT_TRUE(star_numbers_by_magnitude(&num_by_mag, stars, 3));
+    struct StarBins bins = {0};
+    bin_stars(&bins, &canvas, &config, stars, 3, num_by_mag);
+    TEST_ASSERT_EQUAL_UINT(3, bins.num_occupied);
+
+    struct LabelLayout labels = {0};
+    place_labels(&labels, &canvas, &config, &bins, planets, &moon);
+
+    // Venus is brightest and keeps the usual spot, then the stars by magnitude
+    TEST_ASSERT_TRUE(labels.planets[VENUS].shown);
+    TEST_ASSERT_EQUAL_INT(y - 1, labels.planets[VENUS].y);
+    TEST_ASSERT_EQUAL_INT(x + 1, labels.planets[VENUS].x);
+    TEST_ASSERT_EQUAL_UINT(2, labels.num_stars);
+    TEST_ASSERT_EQUAL_PTR(&stars[0], labels.stars[0].star);
+    TEST_ASSERT_EQUAL_INT(y, labels.stars[0].spot.y);
+    TEST_ASSERT_EQUAL_INT(x + 2, labels.stars[0].spot.x);
+    TEST_ASSERT_EQUAL_PTR(&stars[1], labels.stars[1].star);
+    TEST_ASSERT_EQUAL_INT(y - 1, labels.stars[1].spot.y);
+    TEST_ASSERT_EQUAL_INT(x - 3, labels.stars[1].spot.x);
+    TEST_ASSERT_FALSE(labels.planets[MARS].shown);
+    TEST_ASSERT_FALSE(labels.moon.shown);
+
+    // Stars fainter than the label threshold keep their names
+    TEST_ASSERT_EQUAL_STRING("Gamma", stars[2].base.label);
+
+    // Star labels move back once Venus is gone, which the stars layer follows
+    uint64_t signature = stars_layer_signature(&canvas, &config, &bins, stars, NULL, &labels);
+    planets[VENUS].base.altitude = -1.0;
+    place_labels(&labels, &canvas, &config, &bins, planets, &moon);
+    TEST_ASSERT_EQUAL_INT(y - 1, labels.stars[0].spot.y);
+    TEST_ASSERT_EQUAL_INT(x + 1, labels.stars[0].spot.x);
+    TEST_ASSERT_TRUE(signature != stars_layer_signature(&canvas, &config, &bins, stars, NULL, &labels));
+
+    free(num_by_mag);
+    free_star_bins(&bins);
+    free_label_layout(&labels);
+    delwin(win);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_layers_match_direct_drawing);
+    RUN_TEST(test_unchanged_layers_are_not_drawn_again);
+    RUN_TEST(test_moved_item_composites_only_around_it);
+    RUN_TEST(test_empty_cells_show_layers_below);
+    RUN_TEST(test_resize_and_invalidate_redraw_every_layer);
+    RUN_TEST(test_grid_layer_is_drawn_once);
+    RUN_TEST(test_grid_layer_follows_window_size_and_options);
+    RUN_TEST(test_stars_signature_follows_cells);
+    RUN_TEST(test_bins_keep_brightest_star_per_cell);
+    RUN_TEST(test_braille_stars_share_cells);
+    RUN_TEST(test_labels_give_way_to_brighter_objects);
+    return UNITY_END();
+}
@@ -10,6 +10,7 @@
 #include "macros.h"
 #include "unity.h"
 
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -162,6 +163,27 @@ void test_generate_constell_table(void)
     TEST_ASSERT_EQUAL_INT_ARRAY(expected_star_numbers, constell_table[19].star_numbers, 2);
 }
 
+void test_generate_constell_table_parsing(void)
+{
+    // The last line need not end in a newline
+    const char data[] = "Lyr 2 7001 7056 7056 7106\nCVn 1 4915 4785";
+    struct Constell *table = NULL;
+    unsigned int num = 0;
+    TEST_ASSERT_TRUE(generate_constell_table((const uint8_t *)data, strlen(data), &table, &num));
+    TEST_ASSERT_EQUAL_UINT(2, num);
+    TEST_ASSERT_EQUAL_UINT(2, table[0].num_segments);
+    int expected_lyr[] = {7001, 7056, 7056, 7106};
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected_lyr, table[0].star_numbers, 4);
+    int expected_cvn[] = {4915, 4785};
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected_cvn, table[1].star_numbers, 2);
+    free_constells(table, num);
+
+    // Too few star numbers for the number of segments
+    const char malformed[] = "Lyr 3 7001 7056\n";
+    TEST_ASSERT_FALSE(generate_constell_table((const uint8_t *)malformed, strlen(malformed), &table, &num));
+    TEST_ASSERT_NULL(table);
+}
+
 void test_star_numbers_by_magnitude(void)
 {
     TEST_ASSERT_NOT_NULL(num_by_mag);
@@ -253,6 +275,80 @@ void test_update_moon_position(void)
     TEST_ASSERT_DOUBLE_WITHIN(M_EPSILON, -1.118899, moon_object.base.altitude);
 }
 
+// Error of refined events in radians of altitude, from interpolating hourly
+// positions and the half second bisection tolerance
+#define EVENT_EPSILON 0.001
+
+void test_calc_planet_rise_transit_set(void)
+{
+    double julian_date = 2460676.5; // 2025 January 1 00:00:00.0 UT1
+    // Boston, MA in radians
+    double latitude = 42.3601 * M_PI / 180;
+    double longitude = -71.0589 * M_PI / 180;
+
+    struct RiseTransitSet events[NUM_PLANETS];
+    calc_planet_rise_transit_set(planet_table, julian_date, latitude, longitude, events);
+
+    // Sunrise 07:13, solar noon 11:48 and sunset 16:23 EST
+    // https://gml.noaa.gov/grad/solcalc/
+    TEST_ASSERT_EQUAL_INT(RISE_SET_NORMAL, events[SUN].kind);
+    TEST_ASSERT_DOUBLE_WITHIN(0.003, 2460677.0090, events[SUN].rise);
+    TEST_ASSERT_DOUBLE_WITHIN(0.003, 2460677.1998, events[SUN].transit);
+    TEST_ASSERT_DOUBLE_WITHIN(0.003, 2460677.3910, events[SUN].set);
+
+    for (int i = SUN; i < NUM_PLANETS; ++i)
+    {
+        if (i == EARTH)
+        {
+            continue;
+        }
+
+        double horizon = (i == SUN ? RISE_SET_ALTITUDE_SUN : RISE_SET_ALTITUDE_STAR) * M_PI / 180;
+
+        // Events agree with positions computed directly
+        if (!isnan(events[i].rise))
+        {
+            update_planet_positions(planet_table, events[i].rise, latitude, longitude);
+            TEST_ASSERT_DOUBLE_WITHIN(EVENT_EPSILON, horizon, planet_table[i].base.altitude);
+        }
+        if (!isnan(events[i].set))
+        {
+            update_planet_positions(planet_table, events[i].set, latitude, longitude);
+            TEST_ASSERT_DOUBLE_WITHIN(EVENT_EPSILON, horizon, planet_table[i].base.altitude);
+        }
+        TEST_ASSERT_FALSE(isnan(events[i].transit));
+        update_planet_positions(planet_table, events[i].transit, latitude, longitude);
+        TEST_ASSERT_DOUBLE_WITHIN(EVENT_EPSILON, M_PI, planet_table[i].base.azimuth);
+    }
+}
+
+void test_calc_moon_rise_transit_set(void)
+{
+    double julian_date = 2460676.5; // 2025 January 1 00:00:00.0 UT1
+    // Boston, MA in radians
+    double latitude = 42.3601 * M_PI / 180;
+    double longitude = -71.0589 * M_PI / 180;
+    double horizon = RISE_SET_ALTITUDE_MOON * M_PI / 180;
+
+    struct RiseTransitSet events;
+    calc_moon_rise_transit_set(&moon_object, julian_date, latitude, longitude, &events);
+    TEST_ASSERT_EQUAL_INT(RISE_SET_NORMAL, events.kind);
+
+    double times[] = {events.rise, events.set};
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!isnan(times[i]))
+        {
+            TEST_ASSERT_TRUE(times[i] >= julian_date && times[i] <= julian_date + 1.0);
+            update_moon_position(&moon_object, times[i], latitude, longitude);
+            TEST_ASSERT_DOUBLE_WITHIN(EVENT_EPSILON, horizon, moon_object.base.altitude);
+        }
+    }
+
+    update_moon_position(&moon_object, events.transit, latitude, longitude);
+    TEST_ASSERT_DOUBLE_WITHIN(EVENT_EPSILON, M_PI, moon_object.base.azimuth);
+}
+
 void test_map_float_to_int_range(void)
 {
     int result;
@@ -304,10 +400,13 @@ int main(void)
     RUN_TEST(test_generate_star_table);
     RUN_TEST(test_generate_name_table);
     RUN_TEST(test_generate_constell_table);
+    RUN_TEST(test_generate_constell_table_parsing);
     RUN_TEST(test_star_numbers_by_magnitude);
     RUN_TEST(test_update_star_positions);
     RUN_TEST(test_update_planet_positions);
     RUN_TEST(test_update_moon_position);
+    RUN_TEST(test_calc_planet_rise_transit_set);
+    RUN_TEST(test_calc_moon_rise_transit_set);
     RUN_TEST(test_map_float_to_int_range);
     RUN_TEST(test_string_to_time);
     RUN_TEST(test_elapsed_time_to_components);
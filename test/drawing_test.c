@@ -1,4 +1,5 @@
 #include "bit.h"
+#include "canvas.h"
 #include "drawing.h"
 #include "unity.h"
 
@@ -71,10 +72,11 @@ const char diagonal_ascii_10x10[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH] = {
 void test_diagonal_ascii_10x10(void)
 {
     WINDOW *win = newwin(10, 10, 0, 0);
+    struct Canvas canvas = window_canvas(win);
     char actual[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH];
 
     // Draw the line
-    draw_line_ASCII(win, 0, 0, 9, 9);
+    draw_line_ASCII(&canvas, 0, 0, 9, 9);
 
     // Read window content into an array
     read_window_to_array(win, actual, 10, 10);
@@ -109,10 +111,11 @@ const char diagonal_ascii_opposite_10x10[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH] =
 void test_diagonal_ascii_opposite_10x10(void)
 {
     WINDOW *win = newwin(10, 10, 0, 0);
+    struct Canvas canvas = window_canvas(win);
     char actual[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH];
 
     // Draw the line (opposite diagonal)
-    draw_line_ASCII(win, 9, 0, 0, 9);
+    draw_line_ASCII(&canvas, 9, 0, 0, 9);
 
     // Read window content into an ASCII array
     read_window_to_array(win, actual, 10, 10);
@@ -148,10 +151,11 @@ const char vertical_ascii_11x11[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH] = {
 void test_vertical_ascii_11x11(void)
 {
     WINDOW *win = newwin(11, 11, 0, 0);
+    struct Canvas canvas = window_canvas(win);
     char actual[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH];
 
     // Draw the line
-    draw_line_ASCII(win, 0, 5, 10, 5);
+    draw_line_ASCII(&canvas, 0, 5, 10, 5);
 
     // Read window content into an ASCII array
     read_window_to_array(win, actual, 11, 11);
@@ -187,10 +191,11 @@ const char horizontal_ascii_11x11[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH] = {
 void test_horizontal_ascii_11x11(void)
 {
     WINDOW *win = newwin(11, 11, 0, 0);
+    struct Canvas canvas = window_canvas(win);
     char actual[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH];
 
     // Draw the line
-    draw_line_ASCII(win, 5, 0, 5, 10);
+    draw_line_ASCII(&canvas, 5, 0, 5, 10);
 
     // Read window content into an ASCII array
     read_window_to_array(win, actual, 11, 11);
@@ -258,10 +263,11 @@ const wchar_t diagonal_smooth_10x10[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH] = {
 void test_diagonal_smooth_10x10(void)
 {
     WINDOW *win = newwin(10, 10, 0, 0);
+    struct Canvas canvas = window_canvas(win);
     wchar_t actual[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH];
 
     // Draw the line
-    draw_line_smooth(win, 0, 0, 9, 9);
+    draw_line_smooth(&canvas, 0, 0, 9, 9);
 
     // Read window content into a wide-character array
     read_window_to_wide_array(win, actual, 10, 10);
@@ -296,10 +302,11 @@ const wchar_t diagonal_smooth_opposite_10x10[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH
 void test_diagonal_smooth_opposite_10x10(void)
 {
     WINDOW *win = newwin(10, 10, 0, 0);
+    struct Canvas canvas = window_canvas(win);
     wchar_t actual[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH];
 
     // Draw the line (opposite diagonal)
-    draw_line_smooth(win, 9, 0, 0, 9);
+    draw_line_smooth(&canvas, 9, 0, 0, 9);
 
     // Read window content into a wide-character array
     read_window_to_wide_array(win, actual, 10, 10);
@@ -335,10 +342,11 @@ const wchar_t vertical_smooth_11x11[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH] = {
 void test_vertical_smooth_11x11(void)
 {
     WINDOW *win = newwin(11, 11, 0, 0);
+    struct Canvas canvas = window_canvas(win);
     wchar_t actual[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH];
 
     // Draw the line
-    draw_line_smooth(win, 0, 5, 10, 5);
+    draw_line_smooth(&canvas, 0, 5, 10, 5);
 
     // Read window content into a wide-character array
     read_window_to_wide_array(win, actual, 11, 11);
@@ -374,10 +382,11 @@ const wchar_t horizontal_smooth_11x11[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH] = {
 void test_horizontal_smooth_11x11(void)
 {
     WINDOW *win = newwin(11, 11, 0, 0);
+    struct Canvas canvas = window_canvas(win);
     wchar_t actual[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH];
 
     // Draw the line
-    draw_line_smooth(win, 5, 0, 5, 10);
+    draw_line_smooth(&canvas, 5, 0, 5, 10);
 
     // Read window content into a wide-character array
     read_window_to_wide_array(win, actual, 11, 11);
@@ -412,14 +421,15 @@ const wchar_t vertical_braille_11x11[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH] = {
 
 void test_vertical_braille_11x11(void)
 {
-    // Important: Clear the global braille layer state before drawing
-    clear_braille_lines();
-
     WINDOW *win = newwin(11, 11, 0, 0);
+    struct Canvas canvas = window_canvas(win);
     wchar_t actual[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH];
 
+    // Important: Clear the braille layer shared by windows before drawing
+    canvas_clear_braille(&canvas);
+
     // Draw the line
-    draw_line_braille(win, 0, 5, 10, 5);
+    draw_line_braille(&canvas, 0, 5, 10, 5);
 
     // Read window content into a wide-character array
     read_window_to_wide_array(win, actual, 11, 11);
@@ -454,14 +464,15 @@ const wchar_t horizontal_braille_11x11[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH] = {
 
 void test_horizontal_braille_11x11(void)
 {
-    // Important: Clear the global braille layer state before drawing
-    clear_braille_lines();
-
     WINDOW *win = newwin(11, 11, 0, 0);
+    struct Canvas canvas = window_canvas(win);
     wchar_t actual[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH];
 
+    // Important: Clear the braille layer shared by windows before drawing
+    canvas_clear_braille(&canvas);
+
     // Draw the line
-    draw_line_braille(win, 5, 0, 5, 10);
+    draw_line_braille(&canvas, 5, 0, 5, 10);
 
     // Read window content into a wide-character array
     read_window_to_wide_array(win, actual, 11, 11);
@@ -491,14 +502,15 @@ const wchar_t diagonal_braille_6x11[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH] = {
 
 void test_diagonal_braille_6x11(void)
 {
-    // Important: Clear the global braille layer state before drawing
-    clear_braille_lines();
-
     WINDOW *win = newwin(6, 11, 0, 0);
+    struct Canvas canvas = window_canvas(win);
     wchar_t actual[MAX_WINDOW_HEIGHT][MAX_WINDOW_WIDTH];
 
+    // Important: Clear the braille layer shared by windows before drawing
+    canvas_clear_braille(&canvas);
+
     // Draw the line (0,0 to 5,10)
-    draw_line_braille(win, 0, 0, 5, 10);
+    draw_line_braille(&canvas, 0, 0, 5, 10);
 
     // Read window content into a wide-character array
     read_window_to_wide_array(win, actual, 6, 11);
@@ -511,6 +523,97 @@ void test_diagonal_braille_6x11(void)
     delwin(win);
 }
 
+// -----------------------------------------------------------------------------
+// Clipping
+// -----------------------------------------------------------------------------
+
+typedef void (*LineFunction)(struct Canvas *canvas, int ya, int xa, int yb, int xb);
+
+// Segments crossing the edges of a 10x20 window, each inside a 60x90 window
+// when moved down 20 rows and right 30 columns
+static const int clipped_segments[][4] = {
+    {-10, -20, 25, 50}, // Shallow, down and right
+    {25, 50, -10, -20}, // Shallow, up and left
+    {15, -25, -5, 45},  // Shallow, up and right
+    {-15, 5, 30, 12},   // Steep
+    {30, 25, -20, -5},  // Steep, up and left
+    {5, -30, 5, 60},    // Horizontal
+    {-20, 7, 39, 7},    // Vertical
+    {-4, 2, 5, 19},     // Shallow, through the top edge
+    {0, -4, 9, 2},      // Steep, through the left edge
+    {-20, -30, -1, 59}, // Above the window
+};
+
+// Check that a line drawn across a small window shows the same as the part of
+// the whole line drawn in a larger one
+static void assert_clipped_lines_match(LineFunction draw_line)
+{
+    for (size_t i = 0; i < sizeof(clipped_segments) / sizeof(clipped_segments[0]); i++)
+    {
+        const int *segment = clipped_segments[i];
+
+        WINDOW *large = newpad(60, 90);
+        struct Canvas large_canvas = window_canvas(large);
+        canvas_clear_braille(&large_canvas);
+        draw_line(&large_canvas, segment[0] + 20, segment[1] + 30, segment[2] + 20, segment[3] + 30);
+
+        WINDOW *win = newpad(10, 20);
+        struct Canvas canvas = window_canvas(win);
+        canvas_clear_braille(&canvas);
+        draw_line(&canvas, segment[0], segment[1], segment[2], segment[3]);
+
+        for (int y = 0; y < 10; y++)
+        {
+            for (int x = 0; x < 20; x++)
+            {
+                cchar_t expected, actual;
+                wchar_t expected_wch[CCHARW_MAX], actual_wch[CCHARW_MAX];
+                attr_t attrs;
+                short pair;
+                mvwin_wch(large, y + 20, x + 30, &expected);
+                mvwin_wch(win, y, x, &actual);
+                getcchar(&expected, expected_wch, &attrs, &pair, NULL);
+                getcchar(&actual, actual_wch, &attrs, &pair, NULL);
+
+                char message[64];
+                snprintf(message, sizeof(message), "Segment %zu at row %d, column %d", i, y, x);
+                TEST_ASSERT_EQUAL_HEX32_MESSAGE(expected_wch[0], actual_wch[0], message);
+            }
+        }
+
+        delwin(win);
+        delwin(large);
+    }
+}
+
+void test_clipped_ascii(void)
+{
+    assert_clipped_lines_match(draw_line_ASCII);
+}
+
+void test_clipped_smooth(void)
+{
+    assert_clipped_lines_match(draw_line_smooth);
+}
+
+void test_clipped_dotted(void)
+{
+    assert_clipped_lines_match(draw_line_dotted);
+}
+
+void test_clipped_braille(void)
+{
+    assert_clipped_lines_match(draw_line_braille);
+
+    // Nothing is drawn outside the braille layer, however far off the line runs
+    WINDOW *win = newpad(10, 20);
+    struct Canvas canvas = window_canvas(win);
+    canvas_clear_braille(&canvas);
+    draw_line_braille(&canvas, -100000, -100000, 100000, 100000);
+    draw_line_braille(&canvas, -5, -100000, -5, 100000);
+    delwin(win);
+}
+
 // -----------------------------------------------------------------------------
 // Unity
 // -----------------------------------------------------------------------------
@@ -569,5 +672,10 @@ int main(void)
     RUN_TEST(test_horizontal_braille_11x11);
     RUN_TEST(test_diagonal_braille_6x11);
 
+    RUN_TEST(test_clipped_ascii);
+    RUN_TEST(test_clipped_smooth);
+    RUN_TEST(test_clipped_dotted);
+    RUN_TEST(test_clipped_braille);
+
     return UNITY_END();
 }
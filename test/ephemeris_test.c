@@ -0,0 +1,224 @@
+#include "bit.h"
+#include "core.h"
+#include "ephemeris.h"
+#include "macros.h"
+#include "test_sky.h"
+#include "unity.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_TEST_STARS 500
+
+static struct TestSky test_sky;
+static struct EphemerisConf conf;
+
+void setUp(void)
+{
+    generate_test_sky(&test_sky, NUM_TEST_STARS, 7, 8.0f);
+    test_sky.star_table[0].base.label = "Comma, \"Quoted\"";
+
+    conf = (struct EphemerisConf){
+        .julian_date_start = 2460676.5,
+        .julian_date_end = 2460677.5,
+        .step = 1.0 / 24.0,
+        .latitude = 42.3601 * M_PI / 180,
+        .longitude = -71.0589 * M_PI / 180,
+        .threshold = 5.0f,
+        .format = EPHEMERIS_CSV,
+        .num_threads = 1,
+    };
+}
+
+void tearDown(void)
+{
+    free_test_sky(&test_sky);
+}
+
+/* Run the ephemeris into memory. Returns a buffer the caller frees
+ */
+static char *run_ephemeris(const struct EphemerisConf *config, long *length)
+{
+    FILE *out = tmpfile();
+    TEST_ASSERT_NOT_NULL(out);
+    TEST_ASSERT_TRUE(generate_ephemeris(out, config, test_sky.star_table, NUM_TEST_STARS, test_sky.planet_table,
+                                        &test_sky.moon_object));
+
+    *length = ftell(out);
+    rewind(out);
+    char *buffer = malloc(*length + 1);
+    TEST_ASSERT_EQUAL_size_t(*length, fread(buffer, 1, *length, out));
+    buffer[*length] = '\0';
+    fclose(out);
+    return buffer;
+}
+
+void test_ephemeris_num_steps(void)
+{
+    // Both ends are included
+    TEST_ASSERT_EQUAL_UINT(25, ephemeris_num_steps(&conf));
+
+    conf.julian_date_end = conf.julian_date_start;
+    TEST_ASSERT_EQUAL_UINT(1, ephemeris_num_steps(&conf));
+
+    conf.julian_date_end = conf.julian_date_start - 1.0;
+    TEST_ASSERT_EQUAL_UINT(0, ephemeris_num_steps(&conf));
+}
+
+void test_parse_ephemeris_step(void)
+{
+    double step;
+    TEST_ASSERT_TRUE(parse_ephemeris_step("1d", &step));
+    TEST_ASSERT_DOUBLE_WITHIN(1.0E-12, 1.0, step);
+    TEST_ASSERT_TRUE(parse_ephemeris_step("6h", &step));
+    TEST_ASSERT_DOUBLE_WITHIN(1.0E-12, 0.25, step);
+    TEST_ASSERT_TRUE(parse_ephemeris_step("30m", &step));
+    TEST_ASSERT_DOUBLE_WITHIN(1.0E-12, 30.0 / 1440.0, step);
+    TEST_ASSERT_TRUE(parse_ephemeris_step("90", &step));
+    TEST_ASSERT_DOUBLE_WITHIN(1.0E-12, 90.0 / 86400.0, step);
+
+    TEST_ASSERT_FALSE(parse_ephemeris_step("", &step));
+    TEST_ASSERT_FALSE(parse_ephemeris_step("0s", &step));
+    TEST_ASSERT_FALSE(parse_ephemeris_step("-1h", &step));
+    TEST_ASSERT_FALSE(parse_ephemeris_step("1w", &step));
+    TEST_ASSERT_FALSE(parse_ephemeris_step("1hh", &step));
+}
+
+void test_generate_ephemeris_csv(void)
+{
+    long length;
+    char *csv = run_ephemeris(&conf, &length);
+
+    TEST_ASSERT_EQUAL_STRING_LEN("julian_date,object,id,name,azimuth,altitude,magnitude\n", csv, 54);
+    TEST_ASSERT_EQUAL_STRING_LEN("2460676.50000000,", csv + 54, 17);
+
+    // Every row lists an object above the horizon
+    unsigned long rows = 0;
+    for (char *line = strchr(csv, '\n') + 1; *line != '\0'; line = strchr(line, '\n') + 1)
+    {
+        double julian_date;
+        char object[8];
+        int id;
+        TEST_ASSERT_EQUAL_INT(3, sscanf(line, "%lf,%7[a-z],%d,", &julian_date, object, &id));
+        TEST_ASSERT_TRUE(julian_date >= conf.julian_date_start - 1.0E-6 && julian_date <= conf.julian_date_end + 1.0E-6);
+
+        const char *last = strrchr(line, ',');
+        const char *field = last - 1;
+        while (*field != ',')
+        {
+            field--;
+        }
+        double altitude = atof(field + 1);
+        TEST_ASSERT_TRUE(altitude >= 0.0);
+
+        // Numbers are formatted like printf
+        char expected[32];
+        snprintf(expected, sizeof(expected), "%.6f,", altitude);
+        TEST_ASSERT_EQUAL_STRING_LEN(expected, field + 1, strlen(expected));
+
+        if (strcmp(object, "star") == 0)
+        {
+            TEST_ASSERT_TRUE(test_sky.star_table[id - 1].magnitude <= conf.threshold);
+            if (id == 1)
+            {
+                // Names with separators are quoted
+                TEST_ASSERT_NOT_NULL(strstr(line, ",\"Comma, \"\"Quoted\"\"\","));
+            }
+        }
+        else if (strcmp(object, "planet") == 0)
+        {
+            TEST_ASSERT_TRUE(id >= SUN && id < NUM_PLANETS && id != EARTH);
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL_STRING("moon", object);
+        }
+        rows++;
+    }
+    TEST_ASSERT_GREATER_THAN(ephemeris_num_steps(&conf), rows);
+
+    free(csv);
+}
+
+void test_generate_ephemeris_threads_match(void)
+{
+    // The output is independent of the number of threads
+    conf.julian_date_end = conf.julian_date_start + 20.0;
+    conf.step = 1.0 / 48.0;
+
+    long serial_length;
+    char *serial = run_ephemeris(&conf, &serial_length);
+
+    conf.num_threads = 4;
+    long parallel_length;
+    char *parallel = run_ephemeris(&conf, &parallel_length);
+
+    TEST_ASSERT_EQUAL_INT(serial_length, parallel_length);
+    TEST_ASSERT_EQUAL_MEMORY(serial, parallel, serial_length);
+
+    free(serial);
+    free(parallel);
+}
+
+void test_generate_ephemeris_binary(void)
+{
+    long csv_length;
+    char *csv = run_ephemeris(&conf, &csv_length);
+
+    conf.format = EPHEMERIS_BINARY;
+    conf.num_threads = 3;
+    long length;
+    char *binary = run_ephemeris(&conf, &length);
+    const uint8_t *bytes = (const uint8_t *)binary;
+
+    TEST_ASSERT_EQUAL_MEMORY(EPHEMERIS_BINARY_MAGIC, bytes, 8);
+    TEST_ASSERT_EQUAL_UINT32(EPHEMERIS_BINARY_VERSION, bytes_to_uint32_LE(bytes + 8));
+    TEST_ASSERT_EQUAL_UINT32(EPHEMERIS_RECORD_SIZE, bytes_to_uint32_LE(bytes + 12));
+    TEST_ASSERT_EQUAL_INT(0, (length - EPHEMERIS_HEADER_SIZE) % EPHEMERIS_RECORD_SIZE);
+
+    // One record per CSV row, in the same order
+    long num_records = (length - EPHEMERIS_HEADER_SIZE) / EPHEMERIS_RECORD_SIZE;
+    char *line = strchr(csv, '\n') + 1;
+    for (long i = 0; i < num_records; ++i)
+    {
+        const uint8_t *record = bytes + EPHEMERIS_HEADER_SIZE + i * EPHEMERIS_RECORD_SIZE;
+
+        double julian_date;
+        char object[8];
+        int id;
+        TEST_ASSERT_EQUAL_INT(3, sscanf(line, "%lf,%7[a-z],%d,", &julian_date, object, &id));
+
+        TEST_ASSERT_DOUBLE_WITHIN(1.0E-7, julian_date, bytes_to_double64_LE(record));
+        TEST_ASSERT_EQUAL_INT32(id, bytes_to_int32_LE(record + 8));
+        enum ObjectType expected = object[0] == 's'   ? OBJECT_STAR
+                                   : object[0] == 'p' ? OBJECT_PLANET
+                                                      : OBJECT_MOON;
+        TEST_ASSERT_EQUAL_UINT8(expected, record[12]);
+        TEST_ASSERT_TRUE(bytes_to_float32_LE(record + 20) >= 0.0f);
+
+        // Magnitude is the last column, as names may be quoted with commas
+        char *end = strchr(line, '\n');
+        *end = '\0';
+        TEST_ASSERT_FLOAT_WITHIN(0.005f, strtof(strrchr(line, ',') + 1, NULL), bytes_to_float32_LE(record + 24));
+
+        line = end + 1;
+    }
+    TEST_ASSERT_EQUAL_CHAR('\0', *line);
+
+    free(csv);
+    free(binary);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_ephemeris_num_steps);
+    RUN_TEST(test_parse_ephemeris_step);
+    RUN_TEST(test_generate_ephemeris_csv);
+    RUN_TEST(test_generate_ephemeris_threads_match);
+    RUN_TEST(test_generate_ephemeris_binary);
+
+    return UNITY_END();
+}
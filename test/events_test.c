@@ -0,0 +1,240 @@
+#include "astro.h"
+#include "coord.h"
+#include "core.h"
+#include "events.h"
+#include "macros.h"
+#include "test_sky.h"
+#include "unity.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_TEST_STARS 300
+#define JULIAN_DATE 2460000.3
+
+static struct TestSky test_sky;
+static struct EventsConf conf;
+
+/* Place a star at an offset in declination from the Moon's geocentric position
+ * at a given time
+ */
+static void place_star_near_moon(struct Star *star, double julian_date, double offset)
+{
+    double x, y, z;
+    calc_moon_geo_ICRF(test_sky.moon_object.elements, test_sky.moon_object.rates, julian_date, &x, &y, &z);
+    equatorial_rectangular_to_spherical(x, y, z, &star->right_ascension, &star->declination);
+    star->declination += offset;
+    star->magnitude = 1.0f;
+}
+
+void setUp(void)
+{
+    // The first stars are placed by tests
+    generate_test_sky(&test_sky, NUM_TEST_STARS, 11, 6.0f);
+    place_star_near_moon(&test_sky.star_table[0], JULIAN_DATE, 0.0);
+    place_star_near_moon(&test_sky.star_table[1], JULIAN_DATE, 0.6 * TO_RAD);
+    place_star_near_moon(&test_sky.star_table[2], JULIAN_DATE, 3.0 * TO_RAD);
+    test_sky.star_table[0].base.label = "Test, \"Star\"";
+    index_test_sky(&test_sky);
+
+    conf = (struct EventsConf){
+        .julian_date_start = JULIAN_DATE - 3.0,
+        .julian_date_end = JULIAN_DATE + 3.0,
+        .separation = 1.0 * TO_RAD,
+        .threshold = 6.0f,
+        .num_threads = 1,
+    };
+}
+
+void tearDown(void)
+{
+    free_test_sky(&test_sky);
+}
+
+/* Search the test sky for events with the current configuration
+ */
+static bool search_test_sky(struct SkyEvent **events, unsigned int *num_events)
+{
+    return search_events(&conf, test_sky.star_table, &test_sky.sky_index, test_sky.planet_table, &test_sky.moon_object,
+                         events, num_events);
+}
+
+/* Find the event between two objects, or NULL
+ */
+static const struct SkyEvent *find_event(const struct SkyEvent *events, unsigned int num_events, enum ObjectType object,
+                                         int id, enum ObjectType other_object, int other_id)
+{
+    for (unsigned int i = 0; i < num_events; ++i)
+    {
+        const struct SkyEvent *event = &events[i];
+        if (event->object == object && event->id == id && event->other_object == other_object &&
+            event->other_id == other_id)
+        {
+            return event;
+        }
+    }
+    return NULL;
+}
+
+void test_moon_occults_star_on_its_path(void)
+{
+    struct SkyEvent *events;
+    unsigned int num_events;
+    TEST_ASSERT_TRUE(search_test_sky(&events, &num_events));
+
+    const struct SkyEvent *event = find_event(events, num_events, OBJECT_MOON, 0, OBJECT_STAR, 1);
+    TEST_ASSERT_NOT_NULL(event);
+    TEST_ASSERT_EQUAL_INT(EVENT_OCCULTATION, event->type);
+    TEST_ASSERT_DOUBLE_WITHIN(1.0 / 1440.0, JULIAN_DATE, event->julian_date);
+    TEST_ASSERT_DOUBLE_WITHIN(0.01 * TO_RAD, 0.0, event->separation);
+
+    free(events);
+}
+
+void test_moon_appulse_and_miss(void)
+{
+    struct SkyEvent *events;
+    unsigned int num_events;
+    TEST_ASSERT_TRUE(search_test_sky(&events, &num_events));
+
+    // The star is offset in declination and the Moon's path is inclined to the
+    // equator, so they pass somewhat closer than the offset
+    const struct SkyEvent *event = find_event(events, num_events, OBJECT_MOON, 0, OBJECT_STAR, 2);
+    TEST_ASSERT_NOT_NULL(event);
+    TEST_ASSERT_EQUAL_INT(EVENT_APPULSE, event->type);
+    TEST_ASSERT_DOUBLE_WITHIN(0.6 / 24.0, JULIAN_DATE, event->julian_date);
+    TEST_ASSERT_DOUBLE_WITHIN(0.1 * TO_RAD, 0.5 * TO_RAD, event->separation);
+
+    TEST_ASSERT_NULL(find_event(events, num_events, OBJECT_MOON, 0, OBJECT_STAR, 3));
+
+    free(events);
+}
+
+void test_stars_below_threshold_are_skipped(void)
+{
+    test_sky.star_table[0].magnitude = 7.0f;
+    index_test_sky(&test_sky);
+
+    struct SkyEvent *events;
+    unsigned int num_events;
+    TEST_ASSERT_TRUE(search_test_sky(&events, &num_events));
+    TEST_ASSERT_NULL(find_event(events, num_events, OBJECT_MOON, 0, OBJECT_STAR, 1));
+    TEST_ASSERT_NOT_NULL(find_event(events, num_events, OBJECT_MOON, 0, OBJECT_STAR, 2));
+
+    free(events);
+}
+
+void test_great_conjunction_of_2020(void)
+{
+    // Jupiter and Saturn passed 0.1° apart on 2020-12-21
+    conf.julian_date_start = 2459184.5; // 2020-12-01
+    conf.julian_date_end = 2459215.5;   // 2021-01-01
+    conf.threshold = -10.0f;
+
+    struct SkyEvent *events;
+    unsigned int num_events;
+    TEST_ASSERT_TRUE(search_test_sky(&events, &num_events));
+
+    const struct SkyEvent *event = find_event(events, num_events, OBJECT_PLANET, JUPITER, OBJECT_PLANET, SATURN);
+    TEST_ASSERT_NOT_NULL(event);
+    TEST_ASSERT_EQUAL_INT(EVENT_CONJUNCTION, event->type);
+    TEST_ASSERT_DOUBLE_WITHIN(1.5, 2459205.25, event->julian_date);
+    TEST_ASSERT_DOUBLE_WITHIN(0.1 * TO_RAD, 0.1 * TO_RAD, event->separation);
+
+    free(events);
+}
+
+void test_events_are_sorted_and_in_range(void)
+{
+    conf.julian_date_start = 2460310.5;
+    conf.julian_date_end = 2460310.5 + 365.0;
+    conf.num_threads = 3;
+
+    struct SkyEvent *events;
+    unsigned int num_events;
+    TEST_ASSERT_TRUE(search_test_sky(&events, &num_events));
+    TEST_ASSERT_GREATER_THAN_UINT(10, num_events);
+
+    for (unsigned int i = 0; i < num_events; ++i)
+    {
+        TEST_ASSERT_TRUE(events[i].julian_date >= conf.julian_date_start);
+        TEST_ASSERT_TRUE(events[i].julian_date <= conf.julian_date_end);
+        TEST_ASSERT_TRUE(events[i].separation <= conf.separation);
+        TEST_ASSERT_TRUE(i == 0 || events[i - 1].julian_date <= events[i].julian_date);
+    }
+
+    free(events);
+}
+
+void test_results_do_not_depend_on_threads(void)
+{
+    conf.julian_date_start = 2460310.5;
+    conf.julian_date_end = 2460310.5 + 365.0;
+
+    struct SkyEvent *serial, *parallel;
+    unsigned int num_serial, num_parallel;
+    TEST_ASSERT_TRUE(search_test_sky(&serial, &num_serial));
+    conf.num_threads = 7;
+    TEST_ASSERT_TRUE(search_test_sky(&parallel, &num_parallel));
+
+    TEST_ASSERT_EQUAL_UINT(num_serial, num_parallel);
+    for (unsigned int i = 0; i < num_serial; ++i)
+    {
+        TEST_ASSERT_EQUAL_DOUBLE(serial[i].julian_date, parallel[i].julian_date);
+        TEST_ASSERT_EQUAL_INT(serial[i].other_id, parallel[i].other_id);
+    }
+
+    free(serial);
+    free(parallel);
+}
+
+void test_empty_range(void)
+{
+    conf.julian_date_end = conf.julian_date_start - 1.0;
+
+    struct SkyEvent *events;
+    unsigned int num_events;
+    TEST_ASSERT_TRUE(search_test_sky(&events, &num_events));
+    TEST_ASSERT_EQUAL_UINT(0, num_events);
+    free(events);
+}
+
+void test_write_events_csv(void)
+{
+    struct SkyEvent events[] = {
+        {2460000.75, 0.1 * TO_RAD, EVENT_OCCULTATION, OBJECT_MOON, 0, OBJECT_STAR, 1},
+        {2460001.0, 0.5 * TO_RAD, EVENT_CONJUNCTION, OBJECT_PLANET, VENUS, OBJECT_PLANET, JUPITER},
+    };
+
+    FILE *out = tmpfile();
+    TEST_ASSERT_NOT_NULL(out);
+    TEST_ASSERT_TRUE(write_events(out, events, 2, test_sky.star_table, test_sky.planet_table, &test_sky.moon_object));
+
+    char buffer[512];
+    rewind(out);
+    size_t length = fread(buffer, 1, sizeof(buffer) - 1, out);
+    buffer[length] = '\0';
+    fclose(out);
+
+    TEST_ASSERT_EQUAL_STRING("julian_date,date,event,object,id,name,other_object,other_id,other_name,separation\n"
+                             "2460000.75000000,2023-02-25T06:00:00,occultation,moon,0,Moon,star,1,"
+                             "\"Test, \"\"Star\"\"\",0.100000\n"
+                             "2460001.00000000,2023-02-25T12:00:00,conjunction,planet,2,Venus,planet,5,Jupiter,"
+                             "0.500000\n",
+                             buffer);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_moon_occults_star_on_its_path);
+    RUN_TEST(test_moon_appulse_and_miss);
+    RUN_TEST(test_stars_below_threshold_are_skipped);
+    RUN_TEST(test_great_conjunction_of_2020);
+    RUN_TEST(test_events_are_sorted_and_in_range);
+    RUN_TEST(test_results_do_not_depend_on_threads);
+    RUN_TEST(test_empty_range);
+    RUN_TEST(test_write_events_csv);
+    return UNITY_END();
+}
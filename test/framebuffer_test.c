@@ -0,0 +1,223 @@
+#include "ansi.h"
+#include "framebuffer.h"
+#include "stream.h"
+#include "thread.h"
+#include "unity.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Header field offsets, as documented in framebuffer.h
+#define OFFSET_FRAME_NUMBER 24
+#define OFFSET_JULIAN_DATE 32
+#define OFFSET_ROWS 40
+#define OFFSET_SKY_ROW 48
+#define OFFSET_CELLS 64
+#define OFFSET_OBJECTS 68
+#define OFFSET_OBJECTS_SIZE 72
+
+#define NUM_CONCURRENT_FRAMES 2000
+
+static char name[64];
+static struct Framebuffer framebuffer;
+static struct AnsiFrame frame;
+static struct Stream objects;
+
+void setUp(void)
+{
+#ifdef _WIN32
+    TEST_IGNORE_MESSAGE("Shared memory export is not supported on Windows");
+#else
+    snprintf(name, sizeof(name), "/astroterm_test_%ld", (long)getpid());
+    TEST_ASSERT_TRUE(generate_framebuffer(&framebuffer, name, 3, 4, 10));
+    TEST_ASSERT_TRUE(generate_ansi_frame(&frame, 3, 4));
+    TEST_ASSERT_TRUE(generate_stream(&objects, -1, STREAM_BINARY, 10));
+
+    // A stand-in for an encoded frame of objects
+    memset(objects.buffer, 0xAB, 40);
+    objects.length = 40;
+#endif
+}
+
+void tearDown(void)
+{
+#ifndef _WIN32
+    free_stream(&objects);
+    free_ansi_frame(&frame);
+    free_framebuffer(&framebuffer);
+#endif
+}
+
+#ifndef _WIN32
+
+static uint32_t read_u32(const uint8_t *data, size_t offset)
+{
+    uint32_t value;
+    memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+static uint64_t read_u64(const uint8_t *data, size_t offset)
+{
+    uint64_t value;
+    memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+static double read_double(const uint8_t *data, size_t offset)
+{
+    double value;
+    memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+void test_read_before_publish(void)
+{
+    uint8_t buffer[4096];
+    size_t length;
+    TEST_ASSERT_FALSE(framebuffer_read(framebuffer.segment, framebuffer.size, buffer, sizeof(buffer), &length));
+}
+
+void test_publish_and_read(void)
+{
+    strcpy(frame.cells[1 * 4 + 2].text, "★");
+    frame.cells[1 * 4 + 2].color = 3;
+    frame.cells[1 * 4 + 2].attrs = ANSI_BOLD;
+    TEST_ASSERT_TRUE(framebuffer_publish(&framebuffer, &frame, 0, 1, 3, 2, &objects, 2460677.5));
+
+    // Read through a separate read-only mapping, as another process would
+    int fd = shm_open(name, O_RDONLY, 0);
+    TEST_ASSERT_NOT_EQUAL(-1, fd);
+    void *segment = mmap(NULL, framebuffer.size, PROT_READ, MAP_SHARED, fd, 0);
+    TEST_ASSERT_NOT_EQUAL(MAP_FAILED, segment);
+
+    uint8_t buffer[4096];
+    size_t length;
+    TEST_ASSERT_TRUE(framebuffer_read(segment, framebuffer.size, buffer, sizeof(buffer), &length));
+    TEST_ASSERT_EQUAL_size_t(FRAMEBUFFER_HEADER_SIZE + 12 * FRAMEBUFFER_CELL_SIZE + 40, length);
+
+    TEST_ASSERT_EQUAL_STRING(FRAMEBUFFER_MAGIC, (const char *)buffer);
+    TEST_ASSERT_EQUAL_UINT32(FRAMEBUFFER_VERSION, read_u32(buffer, 8));
+    TEST_ASSERT_EQUAL_UINT32(2, read_u32(buffer, 12));
+    TEST_ASSERT_EQUAL_UINT64(1, read_u64(buffer, OFFSET_FRAME_NUMBER));
+    TEST_ASSERT_EQUAL_DOUBLE(2460677.5, read_double(buffer, OFFSET_JULIAN_DATE));
+    TEST_ASSERT_EQUAL_UINT32(3, read_u32(buffer, OFFSET_ROWS));
+    TEST_ASSERT_EQUAL_UINT32(4, read_u32(buffer, OFFSET_ROWS + 4));
+    TEST_ASSERT_EQUAL_UINT32(0, read_u32(buffer, OFFSET_SKY_ROW));
+    TEST_ASSERT_EQUAL_UINT32(1, read_u32(buffer, OFFSET_SKY_ROW + 4));
+    TEST_ASSERT_EQUAL_UINT32(3, read_u32(buffer, OFFSET_SKY_ROW + 8));
+    TEST_ASSERT_EQUAL_UINT32(2, read_u32(buffer, OFFSET_SKY_ROW + 12));
+
+    const uint8_t *cell = buffer + read_u32(buffer, OFFSET_CELLS) + (1 * 4 + 2) * FRAMEBUFFER_CELL_SIZE;
+    TEST_ASSERT_EQUAL_STRING("★", (const char *)cell);
+    int16_t color;
+    memcpy(&color, cell + 16, sizeof(color));
+    TEST_ASSERT_EQUAL_INT16(3, color);
+    TEST_ASSERT_EQUAL_UINT8(ANSI_BOLD, cell[18]);
+
+    TEST_ASSERT_EQUAL_UINT32(40, read_u32(buffer, OFFSET_OBJECTS_SIZE));
+    TEST_ASSERT_EACH_EQUAL_UINT8(0xAB, buffer + read_u32(buffer, OFFSET_OBJECTS), 40);
+
+    // Too small a buffer reports the size needed
+    TEST_ASSERT_FALSE(framebuffer_read(segment, framebuffer.size, buffer, 100, &length));
+    TEST_ASSERT_EQUAL_size_t(FRAMEBUFFER_HEADER_SIZE + 12 * FRAMEBUFFER_CELL_SIZE + 40, length);
+
+    munmap(segment, framebuffer.size);
+    close(fd);
+}
+
+void test_segment_grows(void)
+{
+    size_t old_size = framebuffer.size;
+    void *old_segment = mmap(NULL, old_size, PROT_READ, MAP_SHARED, framebuffer.fd, 0);
+    TEST_ASSERT_NOT_EQUAL(MAP_FAILED, old_segment);
+
+    struct AnsiFrame large;
+    TEST_ASSERT_TRUE(generate_ansi_frame(&large, 30, 40));
+    TEST_ASSERT_TRUE(framebuffer_publish(&framebuffer, &large, 0, 0, 30, 40, &objects, 2460677.5));
+    TEST_ASSERT_TRUE(framebuffer.size > old_size);
+
+    // Readers mapping the old size are told to map again
+    uint8_t buffer[64];
+    size_t length;
+    TEST_ASSERT_FALSE(framebuffer_read(old_segment, old_size, buffer, sizeof(buffer), &length));
+    TEST_ASSERT_EQUAL_size_t(framebuffer.size, length);
+
+    free_ansi_frame(&large);
+    munmap(old_segment, old_size);
+}
+
+struct WriterData
+{
+    struct Framebuffer *framebuffer;
+    struct AnsiFrame *frame;
+    struct Stream *objects;
+};
+
+static void write_frames(void *arg)
+{
+    struct WriterData *data = arg;
+    for (int n = 1; n <= NUM_CONCURRENT_FRAMES; ++n)
+    {
+        // Every cell of frame n holds the last digit of n
+        char digit[2] = {(char)('0' + n % 10), '\0'};
+        for (int i = 0; i < data->frame->rows * data->frame->cols; ++i)
+        {
+            strcpy(data->frame->cells[i].text, digit);
+        }
+        framebuffer_publish(data->framebuffer, data->frame, 0, 0, 1, 1, data->objects, (double)n);
+    }
+}
+
+void test_concurrent_reads_are_consistent(void)
+{
+    struct WriterData data = {&framebuffer, &frame, &objects};
+    struct Thread writer;
+    TEST_ASSERT_TRUE(thread_create(&writer, write_frames, &data));
+
+    uint8_t buffer[4096];
+    size_t length;
+    double last = 0.0;
+    while (last < NUM_CONCURRENT_FRAMES)
+    {
+        if (!framebuffer_read(framebuffer.segment, framebuffer.size, buffer, sizeof(buffer), &length))
+        {
+            continue;
+        }
+
+        double n = read_double(buffer, OFFSET_JULIAN_DATE);
+        TEST_ASSERT_TRUE(n >= last);
+        TEST_ASSERT_EQUAL_UINT64((uint64_t)n, read_u64(buffer, OFFSET_FRAME_NUMBER));
+
+        char digit = (char)('0' + (int)n % 10);
+        for (int i = 0; i < 12; ++i)
+        {
+            TEST_ASSERT_EQUAL_CHAR(digit, buffer[FRAMEBUFFER_HEADER_SIZE + i * FRAMEBUFFER_CELL_SIZE]);
+        }
+        last = n;
+    }
+
+    thread_join(&writer);
+}
+
+#endif // _WIN32
+
+int main(void)
+{
+    UNITY_BEGIN();
+#ifndef _WIN32
+    RUN_TEST(test_read_before_publish);
+    RUN_TEST(test_publish_and_read);
+    RUN_TEST(test_segment_grows);
+    RUN_TEST(test_concurrent_reads_are_consistent);
+#endif
+    return UNITY_END();
+}
@@ -0,0 +1,311 @@
+#include "ansi.h"
+#include "core.h"
+#include "frames.h"
+#include "macros.h"
+#include "sky.h"
+#include "term.h"
+#include "test_sky.h"
+#include "unity.h"
+
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define make_directory(path) _mkdir(path)
+#define remove_directory(path) _rmdir(path)
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#define make_directory(path) mkdir(path, 0700)
+#define remove_directory(path) rmdir(path)
+#endif
+
+#define NUM_TEST_STARS 500
+#define NUM_TEST_JOBS 5
+
+static struct TestSky test_sky;
+static struct Conf view;
+
+void setUp(void)
+{
+    setlocale(LC_ALL, "");
+
+    generate_test_sky(&test_sky, NUM_TEST_STARS, 11, 8.0f);
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        test_sky.star_table[i].base.symbol_ASCII = '*';
+        test_sky.star_table[i].base.symbol_unicode = "•";
+    }
+    view = (struct Conf){.threshold = 4.0f, .label_thresh = 0.25f, .color = true};
+}
+
+void tearDown(void)
+{
+    free_test_sky(&test_sky);
+}
+
+/* Read a whole file into a NUL terminated string, or NULL if it is missing
+ */
+static char *read_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = malloc((size_t)size + 1);
+    size_t read = fread(data, 1, (size_t)size, file);
+    data[read] = '\0';
+    fclose(file);
+    return data;
+}
+
+static void frame_path(char *path, size_t size, const char *directory, int number, const char *extension)
+{
+    snprintf(path, size, "%s/frame_%06d.%s", directory, number, extension);
+}
+
+static void remove_frames(const char *directory, const char *extension)
+{
+    char path[256];
+    for (int i = 1; i <= NUM_TEST_JOBS; ++i)
+    {
+        frame_path(path, sizeof(path), directory, i, extension);
+        remove(path);
+    }
+    remove_directory(directory);
+}
+
+void test_parse_format(void)
+{
+    enum FramesFormat format;
+    TEST_ASSERT_TRUE(parse_frames_format("ansi", &format));
+    TEST_ASSERT_EQUAL(FRAMES_ANSI, format);
+    TEST_ASSERT_TRUE(parse_frames_format("text", &format));
+    TEST_ASSERT_EQUAL(FRAMES_TEXT, format);
+    TEST_ASSERT_FALSE(parse_frames_format("png", &format));
+}
+
+void test_parse_job_coordinates(void)
+{
+    struct FrameJob job;
+    char error[256];
+    TEST_ASSERT_TRUE(parse_frame_job("2025-01-01T00:00:00,42.5,-71.25\n", &job, error, sizeof(error)));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 2460676.5, job.julian_date);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 42.5 * M_PI / 180.0, job.latitude);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, -71.25 * M_PI / 180.0, job.longitude);
+}
+
+void test_parse_job_city(void)
+{
+    struct FrameJob job;
+    char error[256];
+    TEST_ASSERT_TRUE(parse_frame_job("2025-06-01T12:00:00, Boston \r\n", &job, error, sizeof(error)));
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 42.36 * M_PI / 180.0, job.latitude);
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, -71.06 * M_PI / 180.0, job.longitude);
+}
+
+void test_parse_job_errors(void)
+{
+    struct FrameJob job;
+    char error[256];
+    TEST_ASSERT_FALSE(parse_frame_job("2025-01-01T00:00:00", &job, error, sizeof(error)));
+    TEST_ASSERT_FALSE(parse_frame_job("2025-01-01T00:00:00,", &job, error, sizeof(error)));
+    TEST_ASSERT_FALSE(parse_frame_job("yesterday,0,0", &job, error, sizeof(error)));
+    TEST_ASSERT_NOT_NULL(strstr(error, "yesterday"));
+
+    // Out of range coordinates are not a city either
+    TEST_ASSERT_FALSE(parse_frame_job("2025-01-01T00:00:00,95,0", &job, error, sizeof(error)));
+    TEST_ASSERT_NOT_NULL(strstr(error, "95,0"));
+}
+
+void test_read_jobs_skips_comments_and_blank_lines(void)
+{
+    FILE *in = tmpfile();
+    TEST_ASSERT_NOT_NULL(in);
+    fputs("# time,latitude,longitude\n\n2025-01-01T00:00:00,0,0\n  \n2025-01-02T00:00:00,10,20\n", in);
+    rewind(in);
+
+    struct FrameJob *jobs = NULL;
+    unsigned int num_jobs;
+    TEST_ASSERT_TRUE(read_frame_jobs(in, &jobs, &num_jobs));
+    TEST_ASSERT_EQUAL_UINT(2, num_jobs);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 2460677.5, jobs[1].julian_date);
+
+    free(jobs);
+    fclose(in);
+}
+
+void test_read_jobs_rejects_malformed_line(void)
+{
+    FILE *in = tmpfile();
+    TEST_ASSERT_NOT_NULL(in);
+    fputs("2025-01-01T00:00:00,0,0\nnot a job\n", in);
+    rewind(in);
+
+    struct FrameJob *jobs = NULL;
+    unsigned int num_jobs;
+    TEST_ASSERT_FALSE(read_frame_jobs(in, &jobs, &num_jobs));
+
+    free(jobs);
+    fclose(in);
+}
+
+static struct FrameJob test_job(int i)
+{
+    return (struct FrameJob){
+        .julian_date = 2460677.0 + 0.1 * i,
+        .latitude = (-60.0 + 30.0 * i) * M_PI / 180.0,
+        .longitude = (20.0 * i) * M_PI / 180.0,
+    };
+}
+
+/* Render the test jobs into `directory` with the given number of threads
+ */
+static void render_jobs(const char *directory, enum FramesFormat format, unsigned int num_threads)
+{
+    struct FrameJob jobs[NUM_TEST_JOBS];
+    for (int i = 0; i < NUM_TEST_JOBS; ++i)
+    {
+        jobs[i] = test_job(i);
+    }
+
+    struct FramesConf conf = {
+        .directory = directory,
+        .format = format,
+        .rows = 12,
+        .cols = 30,
+        .num_threads = num_threads,
+    };
+
+    TEST_ASSERT_EQUAL(0, make_directory(directory));
+    TEST_ASSERT_TRUE(render_frames(&conf, &view, jobs, NUM_TEST_JOBS, &test_sky.sky));
+}
+
+void test_render_text_frames(void)
+{
+    render_jobs("frames_test_text", FRAMES_TEXT, 2);
+
+    char path[256];
+    for (int i = 1; i <= NUM_TEST_JOBS; ++i)
+    {
+        frame_path(path, sizeof(path), "frames_test_text", i, "txt");
+        char *text = read_file(path);
+        TEST_ASSERT_NOT_NULL_MESSAGE(text, path);
+
+        // One line per row, no escape sequences
+        unsigned int lines = 0;
+        for (const char *c = text; *c != '\0'; ++c)
+        {
+            lines += *c == '\n';
+        }
+        TEST_ASSERT_EQUAL_UINT(12, lines);
+        TEST_ASSERT_NULL(strchr(text, '\x1b'));
+        TEST_ASSERT_NOT_NULL(strchr(text, '*'));
+        free(text);
+    }
+
+    remove_frames("frames_test_text", "txt");
+}
+
+void test_render_is_independent_of_threads(void)
+{
+    render_jobs("frames_test_serial", FRAMES_ANSI, 1);
+    render_jobs("frames_test_parallel", FRAMES_ANSI, 3);
+
+    char path[256];
+    for (int i = 1; i <= NUM_TEST_JOBS; ++i)
+    {
+        frame_path(path, sizeof(path), "frames_test_serial", i, "ans");
+        char *serial = read_file(path);
+        frame_path(path, sizeof(path), "frames_test_parallel", i, "ans");
+        char *parallel = read_file(path);
+        TEST_ASSERT_NOT_NULL(serial);
+        TEST_ASSERT_NOT_NULL(parallel);
+        TEST_ASSERT_EQUAL_STRING(serial, parallel);
+        free(serial);
+        free(parallel);
+    }
+
+    // Rendering leaves the caller's tables alone
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        TEST_ASSERT_EQUAL_DOUBLE(0.0, test_sky.star_table[i].base.azimuth);
+    }
+
+    remove_frames("frames_test_serial", "ans");
+    remove_frames("frames_test_parallel", "ans");
+}
+
+void test_render_matches_curses(void)
+{
+    view.unicode = true;
+    view.grid = true;
+    render_jobs("frames_test_curses", FRAMES_ANSI, 2);
+
+    SCREEN *screen = ncurses_init_headless();
+    TEST_ASSERT_NOT_NULL(screen);
+    WINDOW *pad, *sky_win;
+    TEST_ASSERT_TRUE(newpad_centered_square(12, 30, view.aspect_ratio, &pad, &sky_win));
+    struct AnsiFrame frame;
+    TEST_ASSERT_TRUE(generate_ansi_frame(&frame, 12, 30));
+    struct AnsiBuffer buffer = {0};
+
+    char path[256];
+    for (int i = 0; i < NUM_TEST_JOBS; ++i)
+    {
+        struct FrameJob job = test_job(i);
+        struct Conf config = view;
+        config.latitude = job.latitude;
+        config.longitude = job.longitude;
+        update_sky(&test_sky.sky, &config, job.julian_date);
+        render_sky(sky_win, &config, &test_sky.sky, NULL);
+        ansi_frame_capture(&frame, pad);
+
+        buffer.length = 0;
+        TEST_ASSERT_TRUE(ansi_encode_lines(&buffer, &frame, true));
+        TEST_ASSERT_TRUE(ansi_buffer_append(&buffer, "", 1));
+        frame_path(path, sizeof(path), "frames_test_curses", i + 1, "ans");
+        char *written = read_file(path);
+        TEST_ASSERT_NOT_NULL(written);
+        TEST_ASSERT_EQUAL_STRING(buffer.data, written);
+        free(written);
+    }
+
+    free_ansi_buffer(&buffer);
+    free_ansi_frame(&frame);
+    delwin(sky_win);
+    delwin(pad);
+    ncurses_kill_headless(screen);
+    remove_frames("frames_test_curses", "ans");
+}
+
+void test_render_reports_unwritable_directory(void)
+{
+    struct FrameJob job = {.julian_date = 2460677.0};
+    struct FramesConf conf = {.directory = "frames_test_missing/nested", .format = FRAMES_TEXT, .rows = 4, .cols = 8};
+    TEST_ASSERT_FALSE(render_frames(&conf, &view, &job, 1, &test_sky.sky));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_format);
+    RUN_TEST(test_parse_job_coordinates);
+    RUN_TEST(test_parse_job_city);
+    RUN_TEST(test_parse_job_errors);
+    RUN_TEST(test_read_jobs_skips_comments_and_blank_lines);
+    RUN_TEST(test_read_jobs_rejects_malformed_line);
+    RUN_TEST(test_render_text_frames);
+    RUN_TEST(test_render_is_independent_of_threads);
+    RUN_TEST(test_render_matches_curses);
+    RUN_TEST(test_render_reports_unwritable_directory);
+    return UNITY_END();
+}
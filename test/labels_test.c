@@ -0,0 +1,120 @@
+#include "labels.h"
+#include "unity.h"
+
+static struct LabelGrid grid;
+
+void setUp(void)
+{
+    TEST_ASSERT_TRUE(label_grid_reset(&grid, 10, 130));
+}
+
+void tearDown(void)
+{
+    free_label_grid(&grid);
+}
+
+void test_occupy_across_words(void)
+{
+    label_grid_occupy(&grid, 3, 60, 10);
+
+    TEST_ASSERT_TRUE(label_grid_is_free(&grid, 3, 0, 60));
+    TEST_ASSERT_FALSE(label_grid_is_free(&grid, 3, 59, 2));
+    TEST_ASSERT_FALSE(label_grid_is_free(&grid, 3, 64, 1));
+    TEST_ASSERT_FALSE(label_grid_is_free(&grid, 3, 69, 1));
+    TEST_ASSERT_TRUE(label_grid_is_free(&grid, 3, 70, 60));
+    TEST_ASSERT_TRUE(label_grid_is_free(&grid, 2, 0, 130));
+    TEST_ASSERT_TRUE(label_grid_is_free(&grid, 4, 0, 130));
+}
+
+void test_cells_outside_are_not_free(void)
+{
+    TEST_ASSERT_FALSE(label_grid_is_free(&grid, -1, 0, 1));
+    TEST_ASSERT_FALSE(label_grid_is_free(&grid, 10, 0, 1));
+    TEST_ASSERT_FALSE(label_grid_is_free(&grid, 0, -1, 2));
+    TEST_ASSERT_FALSE(label_grid_is_free(&grid, 0, 125, 6));
+
+    // Marking cells outside is harmless
+    label_grid_occupy(&grid, -1, 0, 5);
+    label_grid_occupy(&grid, 0, -3, 4);
+    label_grid_occupy(&grid, 0, 128, 10);
+    TEST_ASSERT_FALSE(label_grid_is_free(&grid, 0, 0, 1));
+    TEST_ASSERT_TRUE(label_grid_is_free(&grid, 0, 1, 127));
+    TEST_ASSERT_FALSE(label_grid_is_free(&grid, 0, 128, 2));
+}
+
+void test_place_above_right_first(void)
+{
+    int y, x;
+    TEST_ASSERT_TRUE(label_grid_place(&grid, 5, 20, 1, 4, &y, &x));
+    TEST_ASSERT_EQUAL_INT(4, y);
+    TEST_ASSERT_EQUAL_INT(21, x);
+    TEST_ASSERT_FALSE(label_grid_is_free(&grid, 4, 24, 1));
+    TEST_ASSERT_TRUE(label_grid_is_free(&grid, 4, 25, 1));
+}
+
+void test_place_around_occupied_cells(void)
+{
+    int y, x;
+
+    // Above right is taken, so the label goes to the right of the symbol
+    label_grid_occupy(&grid, 4, 22, 1);
+    TEST_ASSERT_TRUE(label_grid_place(&grid, 5, 20, 2, 4, &y, &x));
+    TEST_ASSERT_EQUAL_INT(5, y);
+    TEST_ASSERT_EQUAL_INT(23, x);
+
+    // Then above left, ending next to the symbol
+    TEST_ASSERT_TRUE(label_grid_place(&grid, 5, 20, 2, 4, &y, &x));
+    TEST_ASSERT_EQUAL_INT(4, y);
+    TEST_ASSERT_EQUAL_INT(16, x);
+
+    // Then left, below right and below left
+    TEST_ASSERT_TRUE(label_grid_place(&grid, 5, 20, 2, 4, &y, &x));
+    TEST_ASSERT_EQUAL_INT(5, y);
+    TEST_ASSERT_EQUAL_INT(15, x);
+    TEST_ASSERT_TRUE(label_grid_place(&grid, 5, 20, 2, 4, &y, &x));
+    TEST_ASSERT_EQUAL_INT(6, y);
+    TEST_ASSERT_EQUAL_INT(21, x);
+    TEST_ASSERT_TRUE(label_grid_place(&grid, 5, 20, 2, 4, &y, &x));
+    TEST_ASSERT_EQUAL_INT(6, y);
+    TEST_ASSERT_EQUAL_INT(16, x);
+
+    TEST_ASSERT_FALSE(label_grid_place(&grid, 5, 20, 2, 4, &y, &x));
+}
+
+void test_place_inside_window(void)
+{
+    int y, x;
+
+    // Labels never run off the right edge or the top row
+    TEST_ASSERT_TRUE(label_grid_place(&grid, 0, 127, 1, 6, &y, &x));
+    TEST_ASSERT_EQUAL_INT(0, y);
+    TEST_ASSERT_EQUAL_INT(120, x);
+
+    TEST_ASSERT_FALSE(label_grid_place(&grid, 5, 0, 1, 200, &y, &x));
+}
+
+void test_reset_clears_and_reuses_memory(void)
+{
+    label_grid_occupy(&grid, 0, 0, 130);
+    const uint64_t *bits = grid.bits;
+
+    TEST_ASSERT_TRUE(label_grid_reset(&grid, 5, 64));
+    TEST_ASSERT_EQUAL_PTR(bits, grid.bits);
+    TEST_ASSERT_TRUE(label_grid_is_free(&grid, 0, 0, 64));
+    TEST_ASSERT_FALSE(label_grid_is_free(&grid, 0, 0, 65));
+
+    TEST_ASSERT_TRUE(label_grid_reset(&grid, 40, 200));
+    TEST_ASSERT_TRUE(label_grid_is_free(&grid, 39, 0, 200));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_occupy_across_words);
+    RUN_TEST(test_cells_outside_are_not_free);
+    RUN_TEST(test_place_above_right_first);
+    RUN_TEST(test_place_around_occupied_cells);
+    RUN_TEST(test_place_inside_window);
+    RUN_TEST(test_reset_clears_and_reuses_memory);
+    return UNITY_END();
+}
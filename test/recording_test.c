@@ -0,0 +1,148 @@
+#include "recording.h"
+#include "term.h"
+#include "unity.h"
+
+#include <curses.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORDING_PATH "recording_test.cast"
+#define MAX_LINES 16
+
+static SCREEN *screen;
+static char *contents;
+static char *lines[MAX_LINES];
+static int num_lines;
+
+void setUp(void)
+{
+    setlocale(LC_ALL, "");
+    screen = ncurses_init_headless();
+    TEST_ASSERT_NOT_NULL(screen);
+    contents = NULL;
+    num_lines = 0;
+}
+
+void tearDown(void)
+{
+    free(contents);
+    remove(RECORDING_PATH);
+    ncurses_kill_headless(screen);
+}
+
+/* Read the recording and split it into lines
+ */
+static void read_recording(void)
+{
+    FILE *file = fopen(RECORDING_PATH, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    contents = malloc((size_t)size + 1);
+    size_t read = fread(contents, 1, (size_t)size, file);
+    contents[read] = '\0';
+    fclose(file);
+
+    for (char *line = strtok(contents, "\n"); line != NULL && num_lines < MAX_LINES; line = strtok(NULL, "\n"))
+    {
+        lines[num_lines++] = line;
+    }
+}
+
+void test_header_and_full_first_frame(void)
+{
+    struct Recording recording;
+    TEST_ASSERT_TRUE(generate_recording(&recording, RECORDING_PATH, 3, 4));
+
+    WINDOW *win = newpad(3, 4);
+    mvwaddstr(win, 1, 1, "ab");
+    TEST_ASSERT_TRUE(recording_capture(&recording, win));
+    TEST_ASSERT_TRUE(free_recording(&recording));
+    delwin(win);
+
+    read_recording();
+    TEST_ASSERT_EQUAL_INT(2, num_lines);
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"version\": 2, \"width\": 4, \"height\": 3, ", lines[0], 40);
+    TEST_ASSERT_EQUAL_STRING_LEN("[0.", lines[1], 3);
+    TEST_ASSERT_NOT_NULL(
+        strstr(lines[1], ", \"o\", \"\\u001b[0m\\u001b[?25l\\u001b[2J\\u001b[2;2H\\u001b[0mab\"]"));
+}
+
+void test_only_changes_are_recorded(void)
+{
+    struct Recording recording;
+    TEST_ASSERT_TRUE(generate_recording(&recording, RECORDING_PATH, 3, 4));
+
+    WINDOW *win = newpad(3, 4);
+    mvwaddstr(win, 0, 0, "abcd");
+    TEST_ASSERT_TRUE(recording_capture(&recording, win));
+
+    // Nothing changed: no event
+    TEST_ASSERT_TRUE(recording_capture(&recording, win));
+
+    mvwaddstr(win, 0, 2, "X");
+    TEST_ASSERT_TRUE(recording_capture(&recording, win));
+    TEST_ASSERT_TRUE(free_recording(&recording));
+    delwin(win);
+
+    read_recording();
+    TEST_ASSERT_EQUAL_INT(3, num_lines);
+    TEST_ASSERT_NOT_NULL(strstr(lines[2], ", \"o\", \"\\u001b[1;3H\\u001b[0mX\"]"));
+}
+
+void test_special_characters_are_escaped(void)
+{
+    struct Recording recording;
+    TEST_ASSERT_TRUE(generate_recording(&recording, RECORDING_PATH, 1, 4));
+
+    WINDOW *win = newpad(1, 4);
+    mvwaddstr(win, 0, 0, "\"\\★");
+    TEST_ASSERT_TRUE(recording_capture(&recording, win));
+    TEST_ASSERT_TRUE(free_recording(&recording));
+    delwin(win);
+
+    read_recording();
+    TEST_ASSERT_EQUAL_INT(2, num_lines);
+    TEST_ASSERT_NOT_NULL(strstr(lines[1], "\\u001b[0m\\\"\\\\★\"]"));
+}
+
+void test_resize_is_recorded_with_full_frame(void)
+{
+    struct Recording recording;
+    TEST_ASSERT_TRUE(generate_recording(&recording, RECORDING_PATH, 3, 4));
+
+    WINDOW *small = newpad(3, 4);
+    TEST_ASSERT_TRUE(recording_capture(&recording, small));
+
+    WINDOW *large = newpad(5, 6);
+    mvwaddstr(large, 4, 5, "z");
+    TEST_ASSERT_TRUE(recording_capture(&recording, large));
+    TEST_ASSERT_TRUE(free_recording(&recording));
+    delwin(small);
+    delwin(large);
+
+    read_recording();
+    TEST_ASSERT_EQUAL_INT(4, num_lines);
+    TEST_ASSERT_NOT_NULL(strstr(lines[2], ", \"r\", \"6x5\"]"));
+    TEST_ASSERT_NOT_NULL(strstr(lines[3], "\\u001b[2J\\u001b[5;6H\\u001b[0mz\"]"));
+}
+
+void test_unwritable_path(void)
+{
+    struct Recording recording;
+    TEST_ASSERT_FALSE(generate_recording(&recording, "recording_test_missing/nested.cast", 3, 4));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_header_and_full_first_frame);
+    RUN_TEST(test_only_changes_are_recorded);
+    RUN_TEST(test_special_characters_are_escaped);
+    RUN_TEST(test_resize_is_recorded_with_full_frame);
+    RUN_TEST(test_unwritable_path);
+    return UNITY_END();
+}
@@ -0,0 +1,156 @@
+#include "macros.h"
+#include "server.h"
+#include "unity.h"
+
+#include <math.h>
+#include <stdbool.h>
+
+static const struct ViewOptions defaults = {
+    .latitude = 0.5,
+    .longitude = -1.0,
+    .threshold = 5.0f,
+    .label_thresh = 0.25f,
+    .rows = 24,
+    .cols = 80,
+    .color = true,
+};
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_parse_server_address_unix(void)
+{
+    struct ServerAddress address;
+    TEST_ASSERT_TRUE(parse_server_address("/tmp/astroterm.sock", &address));
+    TEST_ASSERT_TRUE(address.is_unix);
+    TEST_ASSERT_EQUAL_STRING("/tmp/astroterm.sock", address.path);
+
+    TEST_ASSERT_TRUE(parse_server_address("./sky", &address));
+    TEST_ASSERT_TRUE(address.is_unix);
+}
+
+void test_parse_server_address_tcp(void)
+{
+    struct ServerAddress address;
+    TEST_ASSERT_TRUE(parse_server_address("7878", &address));
+    TEST_ASSERT_FALSE(address.is_unix);
+    TEST_ASSERT_EQUAL_STRING("127.0.0.1", address.host);
+    TEST_ASSERT_EQUAL_STRING("7878", address.port);
+
+    TEST_ASSERT_TRUE(parse_server_address("0.0.0.0:80", &address));
+    TEST_ASSERT_EQUAL_STRING("0.0.0.0", address.host);
+    TEST_ASSERT_EQUAL_STRING("80", address.port);
+
+    TEST_ASSERT_TRUE(parse_server_address("[::1]:65535", &address));
+    TEST_ASSERT_EQUAL_STRING("::1", address.host);
+    TEST_ASSERT_EQUAL_STRING("65535", address.port);
+}
+
+void test_parse_server_address_invalid(void)
+{
+    struct ServerAddress address;
+    TEST_ASSERT_FALSE(parse_server_address("", &address));
+    TEST_ASSERT_FALSE(parse_server_address("0", &address));
+    TEST_ASSERT_FALSE(parse_server_address("65536", &address));
+    TEST_ASSERT_FALSE(parse_server_address("localhost", &address));
+    TEST_ASSERT_FALSE(parse_server_address("localhost:", &address));
+    TEST_ASSERT_FALSE(parse_server_address(":7878", &address));
+    TEST_ASSERT_FALSE(parse_server_address("12ab", &address));
+
+    // Unix socket paths longer than any platform's `sun_path`
+    char path[160];
+    memset(path, 'a', sizeof(path) - 1);
+    path[0] = '/';
+    path[sizeof(path) - 1] = '\0';
+    TEST_ASSERT_FALSE(parse_server_address(path, &address));
+    path[103] = '\0';
+    TEST_ASSERT_TRUE(parse_server_address(path, &address));
+}
+
+void test_parse_view_options_empty(void)
+{
+    struct ViewOptions options;
+    char error[256];
+    TEST_ASSERT_TRUE(parse_view_options("", &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_TRUE(same_view_options(&defaults, &options));
+
+    TEST_ASSERT_TRUE(parse_view_options("  \r\n", &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_TRUE(same_view_options(&defaults, &options));
+}
+
+void test_parse_view_options_values(void)
+{
+    struct ViewOptions options;
+    char error[256];
+    TEST_ASSERT_TRUE(parse_view_options("rows=40 cols=120 lat=42.36 lon=-71.06 threshold=4 label-threshold=1.5\r\n",
+                                        &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_EQUAL(40, options.rows);
+    TEST_ASSERT_EQUAL(120, options.cols);
+    TEST_ASSERT_DOUBLE_WITHIN(1.0E-9, 42.36 * M_PI / 180.0, options.latitude);
+    TEST_ASSERT_DOUBLE_WITHIN(1.0E-9, -71.06 * M_PI / 180.0, options.longitude);
+    TEST_ASSERT_EQUAL_FLOAT(4.0f, options.threshold);
+    TEST_ASSERT_EQUAL_FLOAT(1.5f, options.label_thresh);
+    TEST_ASSERT_FALSE(same_view_options(&defaults, &options));
+}
+
+void test_parse_view_options_flags(void)
+{
+    struct ViewOptions options;
+    char error[256];
+    TEST_ASSERT_TRUE(parse_view_options("unicode grid=1 constellations color=0 braille braille-stars combine-stars",
+                                        &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_TRUE(options.unicode);
+    TEST_ASSERT_TRUE(options.grid);
+    TEST_ASSERT_TRUE(options.constell);
+    TEST_ASSERT_TRUE(options.braille);
+    TEST_ASSERT_TRUE(options.braille_stars);
+    TEST_ASSERT_TRUE(options.combine_stars);
+    TEST_ASSERT_FALSE(options.color);
+}
+
+void test_parse_view_options_city(void)
+{
+    struct ViewOptions options;
+    char error[256];
+    TEST_ASSERT_TRUE(parse_view_options("city=\"New York City\" rows=30", &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 40.71 * M_PI / 180.0, options.latitude);
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, -74.01 * M_PI / 180.0, options.longitude);
+    TEST_ASSERT_EQUAL(30, options.rows);
+
+    TEST_ASSERT_FALSE(parse_view_options("city=Atlantis", &defaults, &options, error, sizeof(error)));
+}
+
+void test_parse_view_options_invalid(void)
+{
+    struct ViewOptions options;
+    char error[256];
+    TEST_ASSERT_FALSE(parse_view_options("zoom=2", &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_EQUAL_STRING("Unknown option \"zoom\"", error);
+
+    TEST_ASSERT_FALSE(parse_view_options("rows=0", &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_FALSE(parse_view_options("rows=12.5", &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_FALSE(parse_view_options("cols=100000", &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_FALSE(parse_view_options("lat=91", &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_FALSE(parse_view_options("lon=east", &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_FALSE(parse_view_options("lat", &defaults, &options, error, sizeof(error)));
+    TEST_ASSERT_FALSE(parse_view_options("color=yes", &defaults, &options, error, sizeof(error)));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_server_address_unix);
+    RUN_TEST(test_parse_server_address_tcp);
+    RUN_TEST(test_parse_server_address_invalid);
+    RUN_TEST(test_parse_view_options_empty);
+    RUN_TEST(test_parse_view_options_values);
+    RUN_TEST(test_parse_view_options_flags);
+    RUN_TEST(test_parse_view_options_city);
+    RUN_TEST(test_parse_view_options_invalid);
+    return UNITY_END();
+}
@@ -0,0 +1,192 @@
+#include "core.h"
+#include "core_position.h"
+#include "macros.h"
+#include "sky_index.h"
+#include "unity.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define NUM_TEST_STARS 2000
+
+static struct Star *star_table;
+static int *num_by_mag;
+static struct SkyIndex sky_index;
+
+void setUp(void)
+{
+    // Deterministic pseudo-random sky with uniformly distributed stars
+    srand(42);
+    star_table = calloc(NUM_TEST_STARS, sizeof(struct Star));
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        star_table[i].catalog_number = i + 1;
+        star_table[i].right_ascension = 2.0 * M_PI * rand() / (double)RAND_MAX;
+        star_table[i].declination = asin(2.0 * rand() / (double)RAND_MAX - 1.0);
+        star_table[i].magnitude = (float)(-1.0 + 9.0 * rand() / (double)RAND_MAX);
+    }
+
+    star_numbers_by_magnitude(&num_by_mag, star_table, NUM_TEST_STARS);
+    generate_sky_index(&sky_index, star_table, NUM_TEST_STARS, num_by_mag);
+}
+
+void tearDown(void)
+{
+    free_sky_index(&sky_index);
+    free(num_by_mag);
+    free(star_table);
+}
+
+static double angular_distance(double ra_a, double dec_a, double ra_b, double dec_b)
+{
+    double dot = sin(dec_a) * sin(dec_b) + cos(dec_a) * cos(dec_b) * cos(ra_a - ra_b);
+    return acos(MAX(-1.0, MIN(1.0, dot)));
+}
+
+void test_sky_index_pixel_poles(void)
+{
+    // The north pole lies in a northern base pixel and the south pole in a
+    // southern one
+    TEST_ASSERT_LESS_THAN(4, sky_index_pixel(0, 0.3, M_PI / 2));
+    TEST_ASSERT_GREATER_OR_EQUAL(8, sky_index_pixel(0, 0.3, -M_PI / 2));
+
+    // Equatorial directions lie in the middle ring
+    unsigned int equator = sky_index_pixel(0, M_PI / 4, 0.0);
+    TEST_ASSERT_TRUE(equator >= 4 && equator < 8);
+}
+
+void test_sky_index_pixel_nested(void)
+{
+    // A pixel's parent in the nested scheme is the pixel at the coarser order
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        double ra = star_table[i].right_ascension;
+        double dec = star_table[i].declination;
+        unsigned int fine = sky_index_pixel(4, ra, dec);
+        TEST_ASSERT_LESS_THAN(12u << 8, fine);
+        TEST_ASSERT_EQUAL_UINT(sky_index_pixel(3, ra, dec), fine >> 2);
+    }
+}
+
+void test_generate_sky_index_runs(void)
+{
+    // Every star is indexed exactly once
+    int *seen = calloc(NUM_TEST_STARS, sizeof(int));
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        seen[sky_index.star_indices[i]]++;
+    }
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT(1, seen[i]);
+    }
+    free(seen);
+
+    // Each star lies within the bounding cap of its leaf
+    unsigned int num_leaves = 12u << (2 * sky_index.order);
+    const struct SkyTile *leaves = &sky_index.tiles[4 * ((1u << (2 * sky_index.order)) - 1)];
+    for (unsigned int p = 0; p < num_leaves; ++p)
+    {
+        float prev_magnitude = -INFINITY;
+        for (unsigned int i = leaves[p].first; i < leaves[p].first + leaves[p].count; ++i)
+        {
+            const struct Star *star = &star_table[sky_index.star_indices[i]];
+            double tile_ra = atan2(leaves[p].y, leaves[p].x);
+            double tile_dec = asin(leaves[p].z);
+            TEST_ASSERT_TRUE(angular_distance(star->right_ascension, star->declination, tile_ra, tile_dec) <=
+                             leaves[p].radius + 1.0E-6);
+
+            // Runs are sorted brightest first
+            TEST_ASSERT_TRUE(star->magnitude >= prev_magnitude);
+            prev_magnitude = star->magnitude;
+        }
+    }
+}
+
+void test_sky_index_query_cap_superset(void)
+{
+    int *out = malloc(NUM_TEST_STARS * sizeof(int));
+    bool *found = calloc(NUM_TEST_STARS, sizeof(bool));
+
+    double ra = 1.2, dec = 0.4, radius = 0.3;
+    float threshold = 5.0f;
+    unsigned int count = sky_index_query_cap(&sky_index, star_table, ra, dec, radius, 0.0, threshold, out, NUM_TEST_STARS);
+
+    // The query visits far fewer stars than the catalog...
+    TEST_ASSERT_LESS_THAN(NUM_TEST_STARS / 4, count);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        TEST_ASSERT_TRUE(star_table[out[i]].magnitude <= threshold);
+        found[out[i]] = true;
+    }
+
+    // ...but misses no star inside the cap
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        const struct Star *star = &star_table[i];
+        if (star->magnitude <= threshold &&
+            angular_distance(star->right_ascension, star->declination, ra, dec) <= radius)
+        {
+            TEST_ASSERT_TRUE(found[i]);
+        }
+    }
+
+    free(found);
+    free(out);
+}
+
+void test_update_star_positions_indexed(void)
+{
+    double julian_date = 2459146.0;
+    double latitude = 42.3601 * M_PI / 180;
+    double longitude = -71.0589 * M_PI / 180;
+    float threshold = 5.0f;
+
+    update_star_positions_indexed(star_table, &sky_index, julian_date, latitude, longitude, threshold);
+
+    // Reference positions from the exhaustive update
+    struct Star *reference = malloc(NUM_TEST_STARS * sizeof(struct Star));
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        reference[i] = star_table[i];
+    }
+    update_star_positions(reference, NUM_TEST_STARS, julian_date, latitude, longitude);
+
+    int expected_visible = 0;
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        if (reference[i].magnitude <= threshold && reference[i].base.altitude >= 0.0)
+        {
+            expected_visible++;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(expected_visible, sky_index.num_visible);
+
+    // Visible stars match the exhaustive update and are sorted dimmest first
+    float prev_magnitude = INFINITY;
+    for (unsigned int i = 0; i < sky_index.num_visible; ++i)
+    {
+        int table_index = sky_index.visible[i] - 1;
+        const struct Star *star = &star_table[table_index];
+        TEST_ASSERT_DOUBLE_WITHIN(1.0E-12, reference[table_index].base.azimuth, star->base.azimuth);
+        TEST_ASSERT_DOUBLE_WITHIN(1.0E-12, reference[table_index].base.altitude, star->base.altitude);
+        TEST_ASSERT_TRUE(star->magnitude <= prev_magnitude);
+        prev_magnitude = star->magnitude;
+    }
+
+    free(reference);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sky_index_pixel_poles);
+    RUN_TEST(test_sky_index_pixel_nested);
+    RUN_TEST(test_generate_sky_index_runs);
+    RUN_TEST(test_sky_index_query_cap_superset);
+    RUN_TEST(test_update_star_positions_indexed);
+
+    return UNITY_END();
+}
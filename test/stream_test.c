@@ -0,0 +1,156 @@
+#include "bit.h"
+#include "core.h"
+#include "macros.h"
+#include "sky.h"
+#include "sky_index.h"
+#include "stream.h"
+#include "test_sky.h"
+#include "unity.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_TEST_STARS 500
+#define JULIAN_DATE 2460677.25
+#define HEIGHT 24
+#define WIDTH 48
+
+static struct TestSky test_sky;
+static struct Conf config;
+
+void setUp(void)
+{
+    generate_test_sky(&test_sky, NUM_TEST_STARS, 5, 8.0f);
+    config = (struct Conf){.latitude = 0.7, .longitude = -1.2, .threshold = 4.0f};
+    update_sky(&test_sky.sky, &config, JULIAN_DATE);
+}
+
+void tearDown(void)
+{
+    free_test_sky(&test_sky);
+}
+
+static unsigned int expected_count(void)
+{
+    unsigned int count = test_sky.sky_index.num_visible;
+    for (int i = SUN; i < NUM_PLANETS; ++i)
+    {
+        count += i != EARTH && test_sky.planet_table[i].base.altitude >= 0.0;
+    }
+    return count + (test_sky.moon_object.base.altitude >= 0.0);
+}
+
+static unsigned int count_occurrences(const char *haystack, const char *needle)
+{
+    unsigned int count = 0;
+    for (const char *c = strstr(haystack, needle); c != NULL; c = strstr(c + 1, needle))
+    {
+        count++;
+    }
+    return count;
+}
+
+void test_parse_stream_format(void)
+{
+    enum StreamFormat format;
+    TEST_ASSERT_TRUE(parse_stream_format("ndjson", &format));
+    TEST_ASSERT_EQUAL_INT(STREAM_NDJSON, format);
+    TEST_ASSERT_TRUE(parse_stream_format("binary", &format));
+    TEST_ASSERT_EQUAL_INT(STREAM_BINARY, format);
+    TEST_ASSERT_FALSE(parse_stream_format("csv", &format));
+}
+
+void test_ndjson_frame(void)
+{
+    struct Stream stream;
+    TEST_ASSERT_TRUE(generate_stream(&stream, -1, STREAM_NDJSON, NUM_TEST_STARS));
+    stream_encode_frame(&stream, &test_sky.sky, JULIAN_DATE, HEIGHT, WIDTH);
+
+    TEST_ASSERT_TRUE(stream.length < stream.capacity);
+    stream.buffer[stream.length] = '\0';
+
+    // One line per frame
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"julian_date\":2460677.25000000,\"objects\":[", stream.buffer, 43);
+    TEST_ASSERT_EQUAL_STRING("]}\n", &stream.buffer[stream.length - 3]);
+    TEST_ASSERT_EQUAL_UINT(1, count_occurrences(stream.buffer, "\n"));
+    TEST_ASSERT_EQUAL_UINT(expected_count(), count_occurrences(stream.buffer, "{\"object\":"));
+    TEST_ASSERT_EQUAL_UINT(test_sky.sky_index.num_visible, count_occurrences(stream.buffer, "{\"object\":\"star\""));
+
+    // The first star listed is the dimmest visible one
+    const struct Star *star = &test_sky.star_table[test_sky.sky_index.visible[0] - 1];
+    char expected[64];
+    snprintf(expected, sizeof(expected), "{\"object\":\"star\",\"id\":%d,\"azimuth\":", star->catalog_number);
+    TEST_ASSERT_NOT_NULL(strstr(stream.buffer, expected));
+
+    free_stream(&stream);
+}
+
+void test_binary_frame(void)
+{
+    struct Stream stream;
+    TEST_ASSERT_TRUE(generate_stream(&stream, -1, STREAM_BINARY, NUM_TEST_STARS));
+    stream_encode_frame(&stream, &test_sky.sky, JULIAN_DATE, HEIGHT, WIDTH);
+
+    const uint8_t *data = (const uint8_t *)stream.buffer;
+    unsigned int count = expected_count();
+    TEST_ASSERT_EQUAL_MEMORY(STREAM_BINARY_MAGIC, data, 4);
+    TEST_ASSERT_EQUAL_UINT32(count, bytes_to_uint32_LE(data + 4));
+    TEST_ASSERT_EQUAL_size_t(STREAM_HEADER_SIZE + count * STREAM_RECORD_SIZE, stream.length);
+
+    TEST_ASSERT_EQUAL_DOUBLE(JULIAN_DATE, bytes_to_double64_LE(data + 8));
+
+    const struct Star *star = &test_sky.star_table[test_sky.sky_index.visible[0] - 1];
+    const uint8_t *record = data + STREAM_HEADER_SIZE;
+    TEST_ASSERT_EQUAL_INT32(star->catalog_number, bytes_to_int32_LE(record));
+    TEST_ASSERT_EQUAL_UINT8(OBJECT_STAR, record[4]);
+    TEST_ASSERT_FLOAT_WITHIN(1.0E-3, star->base.azimuth * 180.0 / M_PI, bytes_to_float32_LE(record + 8));
+    TEST_ASSERT_FLOAT_WITHIN(1.0E-3, star->base.altitude * 180.0 / M_PI, bytes_to_float32_LE(record + 12));
+    TEST_ASSERT_EQUAL_FLOAT(star->magnitude, bytes_to_float32_LE(record + 16));
+
+    // Objects above the horizon fall inside the projection
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        record = data + STREAM_HEADER_SIZE + i * STREAM_RECORD_SIZE;
+        int row = bytes_to_int16_LE(record + 20);
+        int col = bytes_to_int16_LE(record + 22);
+        TEST_ASSERT_TRUE(row >= 0 && row < HEIGHT);
+        TEST_ASSERT_TRUE(col >= 0 && col < WIDTH);
+    }
+
+    free_stream(&stream);
+}
+
+void test_write_frame(void)
+{
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+
+    struct Stream stream;
+    TEST_ASSERT_TRUE(generate_stream(&stream, fileno(file), STREAM_NDJSON, NUM_TEST_STARS));
+    stream_encode_frame(&stream, &test_sky.sky, JULIAN_DATE, HEIGHT, WIDTH);
+    TEST_ASSERT_TRUE(stream_write_frame(&stream));
+    TEST_ASSERT_TRUE(stream_write_frame(&stream));
+
+    char *contents = malloc(2 * stream.length);
+    rewind(file);
+    TEST_ASSERT_EQUAL_size_t(2 * stream.length, fread(contents, 1, 2 * stream.length, file));
+    TEST_ASSERT_EQUAL_MEMORY(stream.buffer, contents, stream.length);
+    TEST_ASSERT_EQUAL_MEMORY(stream.buffer, contents + stream.length, stream.length);
+
+    free(contents);
+    free_stream(&stream);
+    fclose(file);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_stream_format);
+    RUN_TEST(test_ndjson_frame);
+    RUN_TEST(test_binary_frame);
+    RUN_TEST(test_write_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,52 @@
+#include "test_sky.h"
+
+#include "data/keplerian_elements.h"
+#include "macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+void generate_test_sky(struct TestSky *test_sky, unsigned int num_stars, unsigned int seed, float max_magnitude)
+{
+    *test_sky = (struct TestSky){.num_stars = num_stars};
+
+    srand(seed);
+    test_sky->star_table = calloc(num_stars, sizeof(struct Star));
+    for (unsigned int i = 0; i < num_stars; ++i)
+    {
+        struct Star *star = &test_sky->star_table[i];
+        star->catalog_number = i + 1;
+        star->right_ascension = 2.0 * M_PI * rand() / (double)RAND_MAX;
+        star->declination = asin(2.0 * rand() / (double)RAND_MAX - 1.0);
+        star->magnitude = (float)(-1.0 + (max_magnitude + 1.0) * rand() / (double)RAND_MAX);
+    }
+
+    generate_planet_table(&test_sky->planet_table, planet_elements, planet_rates, planet_extras);
+    generate_moon_object(&test_sky->moon_object, &moon_elements, &moon_rates);
+    index_test_sky(test_sky);
+
+    test_sky->sky = (struct Sky){
+        .star_table = test_sky->star_table,
+        .num_stars = num_stars,
+        .sky_index = &test_sky->sky_index,
+        .planet_table = test_sky->planet_table,
+        .moon_object = &test_sky->moon_object,
+    };
+}
+
+void index_test_sky(struct TestSky *test_sky)
+{
+    free_sky_index(&test_sky->sky_index);
+    free(test_sky->num_by_mag);
+    star_numbers_by_magnitude(&test_sky->num_by_mag, test_sky->star_table, test_sky->num_stars);
+    generate_sky_index(&test_sky->sky_index, test_sky->star_table, test_sky->num_stars, test_sky->num_by_mag);
+}
+
+void free_test_sky(struct TestSky *test_sky)
+{
+    free_sky_index(&test_sky->sky_index);
+    free(test_sky->num_by_mag);
+    free_stars(test_sky->star_table, test_sky->num_stars);
+    free_planets(test_sky->planet_table, NUM_PLANETS);
+    free_moon_object(test_sky->moon_object);
+}
@@ -0,0 +1,35 @@
+/* Deterministic pseudo-random sky shared by tests that position and render
+ * whole catalogs. Stars are spread uniformly over the sphere, and the planets
+ * and the Moon use the real orbital elements
+ */
+
+#ifndef TEST_SKY_H
+#define TEST_SKY_H
+
+#include "core.h"
+#include "sky.h"
+#include "sky_index.h"
+
+struct TestSky
+{
+    struct Star *star_table;
+    unsigned int num_stars;
+    struct Planet *planet_table;
+    struct Moon moon_object;
+    int *num_by_mag;
+    struct SkyIndex sky_index;
+    struct Sky sky; // Points into the test sky, which must not be moved
+};
+
+/* Generate `num_stars` stars from `seed`, with catalog numbers from 1 and
+ * magnitudes uniform between -1 and `max_magnitude`, then index them
+ */
+void generate_test_sky(struct TestSky *test_sky, unsigned int num_stars, unsigned int seed, float max_magnitude);
+
+/* Index the stars again, after a test moved them or changed their magnitudes
+ */
+void index_test_sky(struct TestSky *test_sky);
+
+void free_test_sky(struct TestSky *test_sky);
+
+#endif // TEST_SKY_H
@@ -0,0 +1,140 @@
+#include "thread.h"
+#include "unity.h"
+
+#include <stdlib.h>
+
+#define NUM_TASKS 16
+#define NUM_ITEMS 10000
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static void square_task(unsigned int index, void *data)
+{
+    unsigned long *results = data;
+    results[index] = (unsigned long)index * index;
+}
+
+static void increment(void *arg)
+{
+    int *value = arg;
+    (*value)++;
+}
+
+void test_thread_hardware_concurrency(void)
+{
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT(1, thread_hardware_concurrency());
+}
+
+void test_thread_create_join(void)
+{
+    int value = 41;
+    struct Thread thread;
+    TEST_ASSERT_TRUE(thread_create(&thread, increment, &value));
+    thread_join(&thread);
+    TEST_ASSERT_EQUAL_INT(42, value);
+}
+
+void test_parallel_run_every_index(void)
+{
+    unsigned long results[NUM_TASKS];
+    for (unsigned int i = 0; i < NUM_TASKS; ++i)
+    {
+        results[i] = 0xDEAD;
+    }
+
+    parallel_run(NUM_TASKS, square_task, results);
+
+    for (unsigned int i = 0; i < NUM_TASKS; ++i)
+    {
+        TEST_ASSERT_EQUAL_UINT(i * i, results[i]);
+    }
+}
+
+void test_parallel_run_single(void)
+{
+    unsigned long result = 0xDEAD;
+    parallel_run(1, square_task, &result);
+    TEST_ASSERT_EQUAL_UINT(0, result);
+
+    // Nothing to run
+    parallel_run(0, square_task, NULL);
+}
+
+struct Channel
+{
+    struct Mutex mutex;
+    struct Condition condition;
+    int value;
+    bool full;
+    bool done;
+};
+
+static void consume(void *arg)
+{
+    struct Channel *channel = arg;
+    long sum = 0;
+
+    mutex_lock(&channel->mutex);
+    while (!channel->done)
+    {
+        while (!channel->full)
+        {
+            condition_wait(&channel->condition, &channel->mutex);
+        }
+        sum += channel->value;
+        channel->done = channel->value == NUM_ITEMS;
+        channel->full = false;
+        condition_signal(&channel->condition);
+    }
+    channel->value = (int)(sum % 1000000);
+    mutex_unlock(&channel->mutex);
+}
+
+void test_mutex_and_condition_hand_off(void)
+{
+    struct Channel channel = {.full = false, .done = false};
+    TEST_ASSERT_TRUE(mutex_init(&channel.mutex));
+    TEST_ASSERT_TRUE(condition_init(&channel.condition));
+
+    struct Thread consumer;
+    TEST_ASSERT_TRUE(thread_create(&consumer, consume, &channel));
+
+    // Hand items over one at a time; each waits for the last to be taken
+    for (int i = 1; i <= NUM_ITEMS; ++i)
+    {
+        mutex_lock(&channel.mutex);
+        while (channel.full)
+        {
+            condition_wait(&channel.condition, &channel.mutex);
+        }
+        channel.value = i;
+        channel.full = true;
+        condition_signal(&channel.condition);
+        mutex_unlock(&channel.mutex);
+    }
+
+    thread_join(&consumer);
+    TEST_ASSERT_EQUAL_INT((long)NUM_ITEMS * (NUM_ITEMS + 1) / 2 % 1000000, channel.value);
+
+    condition_destroy(&channel.condition);
+    mutex_destroy(&channel.mutex);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_thread_hardware_concurrency);
+    RUN_TEST(test_thread_create_join);
+    RUN_TEST(test_parallel_run_every_index);
+    RUN_TEST(test_parallel_run_single);
+    RUN_TEST(test_mutex_and_condition_hand_off);
+
+    return UNITY_END();
+}
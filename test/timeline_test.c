@@ -0,0 +1,208 @@
+#include "constell_graph.h"
+#include "core.h"
+#include "macros.h"
+#include "sky.h"
+#include "sky_index.h"
+#include "stopwatch.h"
+#include "test_sky.h"
+#include "timeline.h"
+#include "unity.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_TEST_STARS 500
+#define JULIAN_DATE 2460677.25
+#define STEP (1.0 / 24.0) // An hour per frame
+#define CAPACITY 16
+#define DEPTH 4
+
+static struct TestSky test_sky;
+static struct Conf config;
+
+void setUp(void)
+{
+    generate_test_sky(&test_sky, NUM_TEST_STARS, 7, 8.0f);
+    config = (struct Conf){.latitude = 0.7, .longitude = -1.2, .threshold = 4.0f};
+    update_sky(&test_sky.sky, &config, JULIAN_DATE);
+}
+
+void tearDown(void)
+{
+    free_test_sky(&test_sky);
+}
+
+/* Check that the sky shows what `update_sky` computes for a frame
+ */
+static void assert_sky_at_frame(const struct Timeline *timeline, long long frame)
+{
+    struct SkyIndex expected_index;
+    struct Star *expected_stars = malloc(NUM_TEST_STARS * sizeof(struct Star));
+    struct Planet expected_planets[NUM_PLANETS];
+    struct Moon expected_moon = test_sky.moon_object;
+    memcpy(expected_stars, test_sky.star_table, NUM_TEST_STARS * sizeof(struct Star));
+    memcpy(expected_planets, test_sky.planet_table, sizeof(expected_planets));
+    generate_sky_index(&expected_index, expected_stars, NUM_TEST_STARS, test_sky.num_by_mag);
+
+    struct Sky expected = {
+        .star_table = expected_stars,
+        .num_stars = NUM_TEST_STARS,
+        .sky_index = &expected_index,
+        .planet_table = expected_planets,
+        .moon_object = &expected_moon,
+    };
+    update_sky(&expected, &config, timeline_julian_date(timeline, frame));
+
+    TEST_ASSERT_EQUAL_UINT(expected_index.num_visible, test_sky.sky_index.num_visible);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected_index.visible, test_sky.sky_index.visible, expected_index.num_visible);
+    for (unsigned int i = 0; i < expected_index.num_visible; ++i)
+    {
+        int number = expected_index.visible[i];
+        TEST_ASSERT_EQUAL_DOUBLE(expected_stars[number - 1].base.azimuth, test_sky.star_table[number - 1].base.azimuth);
+        TEST_ASSERT_EQUAL_DOUBLE(expected_stars[number - 1].base.altitude, test_sky.star_table[number - 1].base.altitude);
+    }
+    for (int i = 0; i < NUM_PLANETS; ++i)
+    {
+        TEST_ASSERT_EQUAL_DOUBLE(expected_planets[i].base.azimuth, test_sky.planet_table[i].base.azimuth);
+        TEST_ASSERT_EQUAL_DOUBLE(expected_planets[i].base.altitude, test_sky.planet_table[i].base.altitude);
+    }
+    TEST_ASSERT_EQUAL_DOUBLE(expected_moon.base.azimuth, test_sky.moon_object.base.azimuth);
+    TEST_ASSERT_EQUAL_DOUBLE(expected_moon.base.altitude, test_sky.moon_object.base.altitude);
+    TEST_ASSERT_EQUAL_STRING(expected_moon.base.symbol_unicode, test_sky.moon_object.base.symbol_unicode);
+
+    free_sky_index(&expected_index);
+    free(expected_stars);
+}
+
+/* Wait for the prefetch thread to cache a frame. Returns false after a second
+ */
+static bool wait_for_frame(struct Timeline *timeline, long long frame)
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (timeline_restore(timeline, frame, &test_sky.sky))
+        {
+            return true;
+        }
+        sw_sleep(1000);
+    }
+    return false;
+}
+
+void test_prefetch_depth_adapts_to_speed(void)
+{
+    TEST_ASSERT_EQUAL_UINT(12, timeline_prefetch_depth(1.0f, 24, 256));
+    TEST_ASSERT_EQUAL_UINT(12, timeline_prefetch_depth(-1.0f, 24, 256));
+    TEST_ASSERT_EQUAL_UINT(12, timeline_prefetch_depth(0.5f, 24, 256));
+    TEST_ASSERT_EQUAL_UINT(36, timeline_prefetch_depth(4.0f, 24, 256));
+    TEST_ASSERT_EQUAL_UINT(40, timeline_prefetch_depth(-1000.0f, 8, 256));
+
+    // At most half the ring
+    TEST_ASSERT_EQUAL_UINT(128, timeline_prefetch_depth(1.0E9f, 24, 256));
+    TEST_ASSERT_EQUAL_UINT(1, timeline_prefetch_depth(1.0f, 1, 1));
+}
+
+void test_restore_stored_frame(void)
+{
+    struct Timeline timeline;
+    TEST_ASSERT_TRUE(generate_timeline(&timeline, &config, &test_sky.sky, JULIAN_DATE, STEP, CAPACITY, 0));
+
+    TEST_ASSERT_FALSE(timeline_restore(&timeline, 3, &test_sky.sky));
+
+    update_sky(&test_sky.sky, &config, timeline_julian_date(&timeline, 3));
+    timeline_store(&timeline, 3, &test_sky.sky);
+
+    // Move the sky elsewhere and bring the frame back
+    update_sky(&test_sky.sky, &config, timeline_julian_date(&timeline, 9));
+    TEST_ASSERT_TRUE(timeline_restore(&timeline, 3, &test_sky.sky));
+    assert_sky_at_frame(&timeline, 3);
+
+    free_timeline(&timeline);
+}
+
+void test_frame_is_evicted_by_its_slot(void)
+{
+    struct Timeline timeline;
+    TEST_ASSERT_TRUE(generate_timeline(&timeline, &config, &test_sky.sky, JULIAN_DATE, STEP, CAPACITY, 0));
+
+    timeline_store(&timeline, 2, &test_sky.sky);
+    timeline_store(&timeline, 2 + CAPACITY, &test_sky.sky);
+    TEST_ASSERT_FALSE(timeline_restore(&timeline, 2, &test_sky.sky));
+    TEST_ASSERT_TRUE(timeline_restore(&timeline, 2 + CAPACITY, &test_sky.sky));
+
+    // Negative frames share the ring too
+    timeline_store(&timeline, -1, &test_sky.sky);
+    TEST_ASSERT_FALSE(timeline_restore(&timeline, CAPACITY - 1, &test_sky.sky));
+    TEST_ASSERT_TRUE(timeline_restore(&timeline, -1, &test_sky.sky));
+
+    free_timeline(&timeline);
+}
+
+void test_frames_ahead_are_prefetched(void)
+{
+    struct Timeline timeline;
+    TEST_ASSERT_TRUE(generate_timeline(&timeline, &config, &test_sky.sky, JULIAN_DATE, STEP, CAPACITY, DEPTH));
+
+    timeline_seek(&timeline, 10, 1);
+    for (long long frame = 11; frame <= 10 + DEPTH; ++frame)
+    {
+        TEST_ASSERT_TRUE(wait_for_frame(&timeline, frame));
+        assert_sky_at_frame(&timeline, frame);
+    }
+
+    // Nothing beyond the prefetch depth
+    sw_sleep(20000);
+    TEST_ASSERT_FALSE(timeline_restore(&timeline, 11 + DEPTH, &test_sky.sky));
+
+    free_timeline(&timeline);
+}
+
+void test_frames_behind_are_prefetched_in_reverse(void)
+{
+    struct Timeline timeline;
+    TEST_ASSERT_TRUE(generate_timeline(&timeline, &config, &test_sky.sky, JULIAN_DATE, STEP, CAPACITY, DEPTH));
+
+    timeline_seek(&timeline, 0, -1);
+    for (long long frame = -1; frame >= -DEPTH; --frame)
+    {
+        TEST_ASSERT_TRUE(wait_for_frame(&timeline, frame));
+        assert_sky_at_frame(&timeline, frame);
+    }
+
+    free_timeline(&timeline);
+}
+
+void test_constellation_vertices_are_restored(void)
+{
+    struct ConstellGraph graph = {.num_vertices = 2, .vertices = (int[]){4, 250}};
+    test_sky.sky.constell_graph = &graph;
+    config.constell = true;
+
+    struct Timeline timeline;
+    TEST_ASSERT_TRUE(generate_timeline(&timeline, &config, &test_sky.sky, JULIAN_DATE, STEP, CAPACITY, 0));
+
+    update_sky(&test_sky.sky, &config, timeline_julian_date(&timeline, 5));
+    double azimuth = test_sky.star_table[250].base.azimuth;
+    double altitude = test_sky.star_table[250].base.altitude;
+    timeline_store(&timeline, 5, &test_sky.sky);
+
+    update_sky(&test_sky.sky, &config, timeline_julian_date(&timeline, 6));
+    TEST_ASSERT_TRUE(timeline_restore(&timeline, 5, &test_sky.sky));
+    TEST_ASSERT_EQUAL_DOUBLE(azimuth, test_sky.star_table[250].base.azimuth);
+    TEST_ASSERT_EQUAL_DOUBLE(altitude, test_sky.star_table[250].base.altitude);
+
+    free_timeline(&timeline);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_prefetch_depth_adapts_to_speed);
+    RUN_TEST(test_restore_stored_frame);
+    RUN_TEST(test_frame_is_evicted_by_its_slot);
+    RUN_TEST(test_frames_ahead_are_prefetched);
+    RUN_TEST(test_frames_behind_are_prefetched_in_reverse);
+    RUN_TEST(test_constellation_vertices_are_restored);
+    return UNITY_END();
+}
@@ -0,0 +1,149 @@
+#include "core.h"
+#include "core_position.h"
+#include "macros.h"
+#include "test_sky.h"
+#include "unity.h"
+#include "visibility.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define NUM_TEST_STARS 1000
+#define NUM_OBSERVERS 40
+
+static struct TestSky test_sky;
+static struct Observer observers[NUM_OBSERVERS];
+
+void setUp(void)
+{
+    generate_test_sky(&test_sky, NUM_TEST_STARS, 11, 8.0f);
+
+    // Deterministic pseudo-random proper motions and observers
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        test_sky.star_table[i].ra_motion = 1.0E-6 * (rand() / (double)RAND_MAX - 0.5);
+        test_sky.star_table[i].dec_motion = 1.0E-6 * (rand() / (double)RAND_MAX - 0.5);
+    }
+
+    for (int o = 0; o < NUM_OBSERVERS; ++o)
+    {
+        observers[o].latitude = asin(2.0 * rand() / (double)RAND_MAX - 1.0);
+        observers[o].longitude = M_PI * (2.0 * rand() / (double)RAND_MAX - 1.0);
+    }
+}
+
+void tearDown(void)
+{
+    free_test_sky(&test_sky);
+}
+
+void test_generate_sky_snapshot(void)
+{
+    float threshold = 5.0f;
+    struct SkySnapshot snapshot;
+    TEST_ASSERT_TRUE(generate_sky_snapshot(&snapshot, test_sky.star_table, NUM_TEST_STARS, test_sky.planet_table,
+                                           &test_sky.moon_object, threshold, 2459146.0));
+
+    unsigned int num_bright = 0;
+    for (int i = 0; i < NUM_TEST_STARS; ++i)
+    {
+        num_bright += test_sky.star_table[i].magnitude <= threshold;
+    }
+
+    // Stars, then every planet but the Earth, then the Moon
+    TEST_ASSERT_EQUAL_UINT(num_bright + NUM_PLANETS, snapshot.num_objects);
+    TEST_ASSERT_EQUAL_INT(OBJECT_PLANET, snapshot.types[num_bright]);
+    TEST_ASSERT_EQUAL_INT(SUN, snapshot.indices[num_bright]);
+    TEST_ASSERT_EQUAL_INT(OBJECT_MOON, snapshot.types[snapshot.num_objects - 1]);
+
+    for (unsigned int i = 0; i < snapshot.num_objects; ++i)
+    {
+        double norm = snapshot.x[i] * snapshot.x[i] + snapshot.y[i] * snapshot.y[i] + snapshot.z[i] * snapshot.z[i];
+        TEST_ASSERT_DOUBLE_WITHIN(1.0E-12, 1.0, norm);
+        TEST_ASSERT_TRUE(snapshot.types[i] != OBJECT_PLANET || snapshot.indices[i] != EARTH);
+    }
+
+    free_sky_snapshot(&snapshot);
+}
+
+void test_compute_visibility_matches_update(void)
+{
+    double julian_date = 2459146.0;
+    float threshold = 5.0f;
+
+    struct SkySnapshot snapshot;
+    generate_sky_snapshot(&snapshot, test_sky.star_table, NUM_TEST_STARS, test_sky.planet_table, &test_sky.moon_object,
+                          threshold, julian_date);
+
+    struct VisibilityList lists[NUM_OBSERVERS] = {0};
+    TEST_ASSERT_TRUE(compute_visibility(&snapshot, observers, NUM_OBSERVERS, lists));
+
+    for (int o = 0; o < NUM_OBSERVERS; ++o)
+    {
+        double latitude = observers[o].latitude;
+        double longitude = observers[o].longitude;
+
+        // Reference: the full per-observer pipeline
+        update_star_positions(test_sky.star_table, NUM_TEST_STARS, julian_date, latitude, longitude);
+        update_planet_positions(test_sky.planet_table, julian_date, latitude, longitude);
+        update_moon_position(&test_sky.moon_object, julian_date, latitude, longitude);
+
+        unsigned int n = 0;
+        for (int i = 0; i < NUM_TEST_STARS; ++i)
+        {
+            const struct Star *star = &test_sky.star_table[i];
+            if (star->magnitude > threshold || star->base.altitude < 0.0)
+            {
+                continue;
+            }
+            TEST_ASSERT_LESS_THAN_UINT(lists[o].count, n);
+            const struct VisibleObject *object = &lists[o].objects[n++];
+            TEST_ASSERT_EQUAL_INT(OBJECT_STAR, object->type);
+            TEST_ASSERT_EQUAL_INT(i, object->index);
+            TEST_ASSERT_DOUBLE_WITHIN(1.0E-9, star->base.azimuth, object->azimuth);
+            TEST_ASSERT_DOUBLE_WITHIN(1.0E-9, star->base.altitude, object->altitude);
+        }
+
+        for (int i = SUN; i < NUM_PLANETS; ++i)
+        {
+            const struct Planet *planet = &test_sky.planet_table[i];
+            if (i == EARTH || planet->base.altitude < 0.0)
+            {
+                continue;
+            }
+            TEST_ASSERT_LESS_THAN_UINT(lists[o].count, n);
+            const struct VisibleObject *object = &lists[o].objects[n++];
+            TEST_ASSERT_EQUAL_INT(OBJECT_PLANET, object->type);
+            TEST_ASSERT_EQUAL_INT(i, object->index);
+            TEST_ASSERT_DOUBLE_WITHIN(1.0E-9, planet->base.azimuth, object->azimuth);
+            TEST_ASSERT_DOUBLE_WITHIN(1.0E-9, planet->base.altitude, object->altitude);
+        }
+
+        if (test_sky.moon_object.base.altitude >= 0.0)
+        {
+            TEST_ASSERT_LESS_THAN_UINT(lists[o].count, n);
+            const struct VisibleObject *object = &lists[o].objects[n++];
+            TEST_ASSERT_EQUAL_INT(OBJECT_MOON, object->type);
+            TEST_ASSERT_DOUBLE_WITHIN(1.0E-9, test_sky.moon_object.base.azimuth, object->azimuth);
+            TEST_ASSERT_DOUBLE_WITHIN(1.0E-9, test_sky.moon_object.base.altitude, object->altitude);
+        }
+
+        TEST_ASSERT_EQUAL_UINT(n, lists[o].count);
+    }
+
+    // Lists are reused by later calls
+    TEST_ASSERT_TRUE(compute_visibility(&snapshot, observers, 1, lists));
+
+    free_visibility_lists(lists, NUM_OBSERVERS);
+    free_sky_snapshot(&snapshot);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_generate_sky_snapshot);
+    RUN_TEST(test_compute_visibility_matches_update);
+
+    return UNITY_END();
+}